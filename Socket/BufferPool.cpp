@@ -0,0 +1,353 @@
+/**
+* @file BufferPool.cpp
+* @brief implementation of the I/O buffer pool
+*/
+
+#include "BufferPool.h"
+
+#include <algorithm>
+#include <mutex>
+#include <new>
+
+#ifdef LINUX
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+   // a thread keeps up to 32 MB per class, and at most 256 blocks
+   const size_t CACHE_BYTES_PER_CLASS = 32 * 1024 * 1024;
+   const size_t MAX_CACHED_BLOCKS = 256;
+   // the depot holds what a few threads would keep
+   const size_t DEPOT_FACTOR = 4;
+
+   const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+   // set once the thread's cache is destroyed, later releases go to the depot
+   thread_local bool s_bThreadCacheGone = false;
+
+   inline size_t ClassSize(const unsigned uClass)
+   {
+      return CBufferPool::MIN_CLASS_SIZE << uClass;
+   }
+
+   inline unsigned ClassOf(const size_t uSize)
+   {
+      unsigned uClass = 0;
+      while (ClassSize(uClass) < uSize)
+         ++uClass;
+      return uClass;
+   }
+
+   inline size_t CacheLimit(const unsigned uClass)
+   {
+      return std::min(MAX_CACHED_BLOCKS, std::max<size_t>(4, CACHE_BYTES_PER_CLASS / ClassSize(uClass)));
+   }
+}
+
+// singly linked free list
+struct CBufferPool::ThreadCache
+{
+   ThreadCache()
+   {
+      std::fill(m_pHeads, m_pHeads + CLASS_COUNT, nullptr);
+      std::fill(m_uCounts, m_uCounts + CLASS_COUNT, 0);
+   }
+
+   ~ThreadCache()
+   {
+      Flush(CBufferPool::GetSharedState());
+      s_bThreadCacheGone = true;
+   }
+
+   void Flush(SharedState& State);
+
+   Block* m_pHeads[CLASS_COUNT];
+   size_t m_uCounts[CLASS_COUNT];
+};
+
+struct CBufferPool::SharedState
+{
+   SharedState() :
+      m_pArena(nullptr),
+      m_uArenaSize(0),
+      m_uArenaUsed(0)
+   {
+      std::fill(m_pDepots, m_pDepots + CLASS_COUNT, nullptr);
+      std::fill(m_uDepotCounts, m_uDepotCounts + CLASS_COUNT, 0);
+   }
+
+   std::mutex m_mtxDepots;
+   Block*     m_pDepots[CLASS_COUNT];
+   size_t     m_uDepotCounts[CLASS_COUNT];
+
+   std::mutex m_mtxArena;
+   char*      m_pArena;
+   size_t     m_uArenaSize;
+   size_t     m_uArenaUsed;
+
+   std::atomic<unsigned long long> m_uAcquires{ 0 };
+   std::atomic<unsigned long long> m_uThreadCacheHits{ 0 };
+   std::atomic<unsigned long long> m_uDepotHits{ 0 };
+   std::atomic<unsigned long long> m_uArenaAllocations{ 0 };
+   std::atomic<unsigned long long> m_uSystemAllocations{ 0 };
+   std::atomic<unsigned long long> m_uSystemFrees{ 0 };
+};
+
+const size_t   CBufferPool::MIN_CLASS_SIZE;
+const size_t   CBufferPool::MAX_CLASS_SIZE;
+const unsigned CBufferPool::CLASS_COUNT;
+const unsigned CPooledBuffer::NO_CLASS;
+const size_t   CPooledBuffer::HEADER_SIZE;
+
+CPooledBuffer::CPooledBuffer(const CPooledBuffer& Other) :
+   m_pBlock(Other.m_pBlock)
+{
+   if (m_pBlock != nullptr)
+      m_pBlock->m_uRefs.fetch_add(1, std::memory_order_relaxed);
+}
+
+CPooledBuffer::CPooledBuffer(CPooledBuffer&& Other) noexcept :
+   m_pBlock(Other.m_pBlock)
+{
+   Other.m_pBlock = nullptr;
+}
+
+CPooledBuffer& CPooledBuffer::operator=(const CPooledBuffer& Other)
+{
+   if (m_pBlock != Other.m_pBlock)
+   {
+      Reset();
+      m_pBlock = Other.m_pBlock;
+      if (m_pBlock != nullptr)
+         m_pBlock->m_uRefs.fetch_add(1, std::memory_order_relaxed);
+   }
+   return *this;
+}
+
+CPooledBuffer& CPooledBuffer::operator=(CPooledBuffer&& Other) noexcept
+{
+   if (this != &Other)
+   {
+      Reset();
+      m_pBlock = Other.m_pBlock;
+      Other.m_pBlock = nullptr;
+   }
+   return *this;
+}
+
+bool CPooledBuffer::Resize(const size_t uSize)
+{
+   if (m_pBlock == nullptr || uSize > m_pBlock->m_uCapacity)
+      return false;
+
+   m_pBlock->m_uSize = uSize;
+   return true;
+}
+
+void CPooledBuffer::Reset()
+{
+   if (m_pBlock != nullptr && m_pBlock->m_uRefs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      CBufferPool::Release(m_pBlock);
+
+   m_pBlock = nullptr;
+}
+
+CBufferPool::ThreadCache& CBufferPool::GetThreadCache()
+{
+   thread_local ThreadCache Cache;
+   return Cache;
+}
+
+CBufferPool::SharedState& CBufferPool::GetSharedState()
+{
+   // never destroyed : threads may still release buffers while the process exits
+   static SharedState* pState = new SharedState;
+   return *pState;
+}
+
+CPooledBuffer CBufferPool::Acquire(const size_t uSize)
+{
+   SharedState& State = GetSharedState();
+   State.m_uAcquires.fetch_add(1, std::memory_order_relaxed);
+
+   Block* pBlock = nullptr;
+   if (uSize > MAX_CLASS_SIZE)
+      pBlock = NewBlock(CPooledBuffer::NO_CLASS, uSize);
+   else
+   {
+      const unsigned uClass = ClassOf(uSize);
+      ThreadCache* pCache = s_bThreadCacheGone ? nullptr : &GetThreadCache();
+
+      if (pCache != nullptr && pCache->m_pHeads[uClass] != nullptr)
+      {
+         pBlock = pCache->m_pHeads[uClass];
+         pCache->m_pHeads[uClass] = pBlock->m_pNext;
+         --pCache->m_uCounts[uClass];
+         State.m_uThreadCacheHits.fetch_add(1, std::memory_order_relaxed);
+      }
+      else
+      {
+         {
+            std::lock_guard<std::mutex> Lock(State.m_mtxDepots);
+            pBlock = State.m_pDepots[uClass];
+            if (pBlock != nullptr)
+            {
+               State.m_pDepots[uClass] = pBlock->m_pNext;
+               --State.m_uDepotCounts[uClass];
+            }
+         }
+
+         if (pBlock != nullptr)
+            State.m_uDepotHits.fetch_add(1, std::memory_order_relaxed);
+         else
+            pBlock = NewBlock(uClass, ClassSize(uClass));
+      }
+   }
+
+   pBlock->m_uRefs.store(1, std::memory_order_relaxed);
+   pBlock->m_uSize = uSize;
+   pBlock->m_pNext = nullptr;
+
+   return CPooledBuffer(pBlock);
+}
+
+CBufferPool::Block* CBufferPool::NewBlock(const unsigned uClass, const size_t uCapacity)
+{
+   SharedState& State = GetSharedState();
+   const size_t uBlockSize = CPooledBuffer::HEADER_SIZE + uCapacity;
+
+   char* pMemory = nullptr;
+   bool bArena = false;
+
+   if (uClass != CPooledBuffer::NO_CLASS)
+   {
+      std::lock_guard<std::mutex> Lock(State.m_mtxArena);
+      if (State.m_pArena != nullptr && State.m_uArenaSize - State.m_uArenaUsed >= uBlockSize)
+      {
+         pMemory = State.m_pArena + State.m_uArenaUsed;
+         State.m_uArenaUsed += uBlockSize; // sizes are multiples of 64, blocks stay aligned
+         bArena = true;
+      }
+   }
+
+   if (bArena)
+      State.m_uArenaAllocations.fetch_add(1, std::memory_order_relaxed);
+   else
+   {
+      pMemory = static_cast<char*>(::operator new(uBlockSize));
+      State.m_uSystemAllocations.fetch_add(1, std::memory_order_relaxed);
+   }
+
+   Block* pBlock = new (pMemory) Block;
+   pBlock->m_uClass = uClass;
+   pBlock->m_bArena = bArena;
+   pBlock->m_uCapacity = uCapacity;
+
+   return pBlock;
+}
+
+void CBufferPool::Release(Block* pBlock)
+{
+   SharedState& State = GetSharedState();
+
+   if (pBlock->m_uClass != CPooledBuffer::NO_CLASS)
+   {
+      const unsigned uClass = pBlock->m_uClass;
+      ThreadCache* pCache = s_bThreadCacheGone ? nullptr : &GetThreadCache();
+
+      if (pCache != nullptr && pCache->m_uCounts[uClass] < CacheLimit(uClass))
+      {
+         pBlock->m_pNext = pCache->m_pHeads[uClass];
+         pCache->m_pHeads[uClass] = pBlock;
+         ++pCache->m_uCounts[uClass];
+         return;
+      }
+
+      std::lock_guard<std::mutex> Lock(State.m_mtxDepots);
+      if (pBlock->m_bArena || State.m_uDepotCounts[uClass] < DEPOT_FACTOR * CacheLimit(uClass))
+      {
+         pBlock->m_pNext = State.m_pDepots[uClass];
+         State.m_pDepots[uClass] = pBlock;
+         ++State.m_uDepotCounts[uClass];
+         return;
+      }
+   }
+
+   pBlock->~Block();
+   ::operator delete(static_cast<void*>(pBlock));
+   State.m_uSystemFrees.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CBufferPool::ThreadCache::Flush(SharedState& State)
+{
+   std::lock_guard<std::mutex> Lock(State.m_mtxDepots);
+   for (unsigned uClass = 0; uClass < CLASS_COUNT; ++uClass)
+   {
+      while (m_pHeads[uClass] != nullptr)
+      {
+         Block* pBlock = m_pHeads[uClass];
+         m_pHeads[uClass] = pBlock->m_pNext;
+
+         pBlock->m_pNext = State.m_pDepots[uClass];
+         State.m_pDepots[uClass] = pBlock;
+         ++State.m_uDepotCounts[uClass];
+      }
+      m_uCounts[uClass] = 0;
+   }
+}
+
+void CBufferPool::FlushThreadCache()
+{
+   if (!s_bThreadCacheGone)
+      GetThreadCache().Flush(GetSharedState());
+}
+
+CBufferPool::Stats CBufferPool::GetStats()
+{
+   SharedState& State = GetSharedState();
+
+   Stats Current;
+   Current.m_uAcquires = State.m_uAcquires.load(std::memory_order_relaxed);
+   Current.m_uThreadCacheHits = State.m_uThreadCacheHits.load(std::memory_order_relaxed);
+   Current.m_uDepotHits = State.m_uDepotHits.load(std::memory_order_relaxed);
+   Current.m_uArenaAllocations = State.m_uArenaAllocations.load(std::memory_order_relaxed);
+   Current.m_uSystemAllocations = State.m_uSystemAllocations.load(std::memory_order_relaxed);
+   Current.m_uSystemFrees = State.m_uSystemFrees.load(std::memory_order_relaxed);
+
+   return Current;
+}
+
+bool CBufferPool::EnableHugePageArena(const size_t uBytes)
+{
+#ifdef LINUX
+   SharedState& State = GetSharedState();
+   std::lock_guard<std::mutex> Lock(State.m_mtxArena);
+
+   if (State.m_pArena != nullptr || uBytes == 0)
+      return false;
+
+   const size_t uSize = (uBytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+   // reserved huge pages first, then transparent huge pages on a regular mapping
+   void* pArena = mmap(nullptr, uSize, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+   if (pArena == MAP_FAILED)
+   {
+      pArena = mmap(nullptr, uSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (pArena == MAP_FAILED)
+         return false;
+
+      madvise(pArena, uSize, MADV_HUGEPAGE);
+   }
+
+   State.m_pArena = static_cast<char*>(pArena);
+   State.m_uArenaSize = uSize;
+   State.m_uArenaUsed = 0;
+
+   return true;
+#else
+   (void) uBytes;
+   return false;
+#endif
+}
@@ -0,0 +1,121 @@
+/*
+* @file BufferPool.h
+* @brief size-classed pool of refcounted I/O buffers with thread-local free lists
+* @date 2026-10-17
+*
+* CBufferPool::Acquire hands out a CPooledBuffer whose capacity is rounded up to a
+* power of two size class (256 bytes to 16 MB). The last handle released puts the
+* block back on a free list of the releasing thread : a thread handling messages of
+* similar sizes keeps reusing the same blocks and doesn't call the allocator anymore.
+* The free lists are bounded, the excess goes to a shared depot the other threads
+* draw from. Under Linux, blocks can be carved from a huge page backed arena.
+*/
+
+#ifndef INCLUDE_BUFFERPOOL_H_
+#define INCLUDE_BUFFERPOOL_H_
+
+#include <atomic>
+#include <cstddef>
+
+class CBufferPool;
+
+class CPooledBuffer
+{
+public:
+   CPooledBuffer() : m_pBlock(nullptr) {}
+   ~CPooledBuffer() { Reset(); }
+
+   // copies share the block (no data copy), it returns to the pool with the last handle
+   CPooledBuffer(const CPooledBuffer& Other);
+   CPooledBuffer(CPooledBuffer&& Other) noexcept;
+   CPooledBuffer& operator=(const CPooledBuffer& Other);
+   CPooledBuffer& operator=(CPooledBuffer&& Other) noexcept;
+
+   inline char* Data() { return m_pBlock ? m_pBlock->Data() : nullptr; }
+   inline const char* Data() const { return m_pBlock ? m_pBlock->Data() : nullptr; }
+   inline size_t Size() const { return m_pBlock ? m_pBlock->m_uSize : 0; }
+   inline size_t Capacity() const { return m_pBlock ? m_pBlock->m_uCapacity : 0; }
+
+   /* sets the length of the data, the content is kept. Fails beyond the capacity. */
+   bool Resize(const size_t uSize);
+
+   unsigned UseCount() const { return m_pBlock ? m_pBlock->m_uRefs.load(std::memory_order_acquire) : 0; }
+
+   explicit operator bool() const { return m_pBlock != nullptr; }
+
+   // drops this handle
+   void Reset();
+
+private:
+   friend class CBufferPool;
+
+   static const unsigned NO_CLASS = ~0u;
+   /* the header fills a cache line : the data of the arena blocks is 64-byte aligned, the blocks
+    * from operator new (C++14, no std::align_val_t) only have the alignment of max_align_t */
+   static const size_t   HEADER_SIZE = 64;
+
+   struct Block
+   {
+      std::atomic<unsigned> m_uRefs;
+      unsigned              m_uClass;  // NO_CLASS : allocated for its exact size, freed on release
+      bool                  m_bArena;  // carved from the huge page arena, never freed
+      size_t                m_uCapacity;
+      size_t                m_uSize;
+      Block*                m_pNext;   // free list link
+
+      inline char* Data() { return reinterpret_cast<char*>(this) + HEADER_SIZE; }
+   };
+
+   explicit CPooledBuffer(Block* pBlock) : m_pBlock(pBlock) {}
+
+   Block* m_pBlock;
+};
+
+class CBufferPool
+{
+public:
+   static const size_t   MIN_CLASS_SIZE = 256;
+   static const size_t   MAX_CLASS_SIZE = 16 * 1024 * 1024;
+   static const unsigned CLASS_COUNT = 17;
+
+   /* process-wide counters, to check that a steady state doesn't allocate anymore */
+   struct Stats
+   {
+      unsigned long long m_uAcquires;
+      unsigned long long m_uThreadCacheHits;   // reused from the calling thread's free list
+      unsigned long long m_uDepotHits;         // reused from the shared depot
+      unsigned long long m_uArenaAllocations;  // new blocks carved from the arena
+      unsigned long long m_uSystemAllocations; // new blocks from operator new
+      unsigned long long m_uSystemFrees;
+   };
+
+   /* a buffer of uSize bytes (Size() == uSize), its capacity is the size class. Sizes above
+    * MAX_CLASS_SIZE aren't pooled : they're allocated and freed each time. */
+   static CPooledBuffer Acquire(const size_t uSize);
+
+   static Stats GetStats();
+
+   /* reserves uBytes (rounded up to 2 MB) backed by huge pages (MAP_HUGETLB, or transparent
+    * huge pages if none are reserved) where the new blocks are carved until it's full.
+    * Can only be done once, returns false if it couldn't be mapped or on other systems. */
+   static bool EnableHugePageArena(const size_t uBytes);
+
+   /* hands the calling thread's free blocks over to the depot (done at thread exit) */
+   static void FlushThreadCache();
+
+private:
+   friend class CPooledBuffer;
+
+   typedef CPooledBuffer::Block Block;
+
+   struct ThreadCache;
+   struct SharedState;
+
+   static ThreadCache& GetThreadCache();
+   static SharedState& GetSharedState();
+
+   static Block* NewBlock(const unsigned uClass, const size_t uCapacity);
+   static void Release(Block* pBlock);
+};
+
+#endif
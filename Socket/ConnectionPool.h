@@ -0,0 +1,345 @@
+/*
+* @file ConnectionPool.h
+* @brief thread-safe pool of connected clients, keyed by "host:port"
+* @date 2026-10-17
+*
+* Connect() resolves the server, creates a socket and does the TCP (and TLS) handshake
+* each time. CConnectionPool keeps the connections given back to it and lends them out
+* again : the most recently used one first (its peer-side state is the warmest), after
+* checking that the peer didn't close it while it was idle. Connections idle for longer
+* than a timeout are closed by Prune(), down to a minimum kept per server.
+*
+* The client class only needs Connect(host, port), Disconnect() and GetSocketDescriptor() :
+* CTCPClient and CTCPSSLClient can both be pooled. A client with a ProbeConnection() member
+* is probed with it instead of ASocket::ProbeConnection(GetSocketDescriptor()) : the TLS
+* client processes the session tickets the server sends after the handshake, which would
+* otherwise make its idle connections look READABLE, and reports the data OpenSSL buffered.
+*/
+
+#ifndef INCLUDE_CONNECTIONPOOL_H_
+#define INCLUDE_CONNECTIONPOOL_H_
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Socket.h"
+
+template <class TClient>
+class CConnectionPool
+{
+public:
+   typedef std::function<std::unique_ptr<TClient>()> ClientFactory;
+
+   struct Settings
+   {
+      Settings() :
+         m_uMinIdle(0),
+         m_uMaxIdle(8),
+         m_uIdleTimeoutMs(30000),
+         m_bProbe(true)
+      {}
+
+      size_t m_uMinIdle;       // per server, kept by Prune and opened by Warm
+      size_t m_uMaxIdle;       // per server, the connections given back beyond it are closed
+      size_t m_uIdleTimeoutMs; // 0 : never expire
+      bool   m_bProbe;         // check the connections before lending them out
+   };
+
+   struct Stats
+   {
+      unsigned long long m_uCheckouts;       // successful Acquire calls
+      unsigned long long m_uHits;            // served with an idle connection
+      unsigned long long m_uConnects;        // new connections
+      unsigned long long m_uConnectFailures;
+      unsigned long long m_uProbeFailures;   // idle connections found closed (or with pending data)
+      unsigned long long m_uExpired;         // closed by Prune
+      unsigned long long m_uOverflows;       // given back beyond m_uMaxIdle
+      unsigned long long m_ullCheckoutNs;    // time spent in Acquire, total
+      unsigned long long m_ullMaxCheckoutNs;
+
+      double GetHitRate() const { return m_uCheckouts ? static_cast<double>(m_uHits) / m_uCheckouts : 0.0; }
+      double GetAverageCheckoutUs() const { return m_uCheckouts ? m_ullCheckoutNs / (1000.0 * m_uCheckouts) : 0.0; }
+   };
+
+   /* a borrowed connection, given back to the pool when destroyed (the pool must outlive it).
+    * Discard() closes it instead : after an error, or if the protocol state is unknown. */
+   class Lease
+   {
+   public:
+      Lease() : m_pPool(nullptr) {}
+      ~Lease() { Release(); }
+
+      Lease(Lease&& Other) noexcept :
+         m_pPool(Other.m_pPool),
+         m_strKey(std::move(Other.m_strKey)),
+         m_pClient(std::move(Other.m_pClient))
+      {
+         Other.m_pPool = nullptr;
+      }
+
+      Lease& operator=(Lease&& Other) noexcept
+      {
+         if (this != &Other)
+         {
+            Release();
+            m_pPool = Other.m_pPool;
+            m_strKey = std::move(Other.m_strKey);
+            m_pClient = std::move(Other.m_pClient);
+            Other.m_pPool = nullptr;
+         }
+         return *this;
+      }
+
+      Lease(const Lease&) = delete;
+      Lease& operator=(const Lease&) = delete;
+
+      TClient* operator->() const { return m_pClient.get(); }
+      TClient& operator*() const { return *m_pClient; }
+      TClient* Get() const { return m_pClient.get(); }
+      explicit operator bool() const { return m_pClient != nullptr; }
+
+      void Discard()
+      {
+         if (m_pClient)
+            m_pClient->Disconnect();
+         m_pClient.reset();
+         m_pPool = nullptr;
+      }
+
+      // gives the connection back now
+      void Release()
+      {
+         if (m_pPool != nullptr && m_pClient)
+            m_pPool->GiveBack(m_strKey, std::move(m_pClient));
+         m_pClient.reset();
+         m_pPool = nullptr;
+      }
+
+   private:
+      friend class CConnectionPool;
+
+      Lease(CConnectionPool* pPool, const std::string& strKey, std::unique_ptr<TClient> pClient) :
+         m_pPool(pPool),
+         m_strKey(strKey),
+         m_pClient(std::move(pClient))
+      {}
+
+      CConnectionPool*         m_pPool;
+      std::string              m_strKey;
+      std::unique_ptr<TClient> m_pClient;
+   };
+
+   explicit CConnectionPool(const ClientFactory& fnFactory, const Settings& oSettings = Settings()) :
+      m_fnFactory(fnFactory),
+      m_oSettings(oSettings),
+      m_oStats()
+   {
+   }
+
+   ~CConnectionPool() { Clear(); }
+
+   CConnectionPool(const CConnectionPool&) = delete;
+   CConnectionPool& operator=(const CConnectionPool&) = delete;
+
+   /* an idle connection to the server if a live one is available, a new one otherwise.
+    * The lease is empty if the connection failed. */
+   Lease Acquire(const std::string& strHost, const std::string& strPort)
+   {
+      const auto StartTime = std::chrono::steady_clock::now();
+      const std::string strKey = strHost + ":" + strPort;
+
+      std::unique_ptr<TClient> pClient;
+      bool bHit = false;
+
+      // probed outside of the lock, the dead ones are dropped until a live one is found
+      while (!bHit)
+      {
+         {
+            std::lock_guard<std::mutex> Lock(m_mtxPool);
+            auto it = m_mapIdle.find(strKey);
+            if (it == m_mapIdle.end() || it->second.empty())
+               break;
+
+            pClient = std::move(it->second.back().m_pClient);
+            it->second.pop_back();
+         }
+
+         bHit = !m_oSettings.m_bProbe || Probe(*pClient, 0) == ASocket::CONNECTION_ALIVE;
+         if (!bHit)
+         {
+            pClient->Disconnect();
+            pClient.reset();
+
+            std::lock_guard<std::mutex> Lock(m_mtxPool);
+            ++m_oStats.m_uProbeFailures;
+         }
+      }
+
+      bool bConnected = bHit;
+      if (!bHit)
+      {
+         pClient = m_fnFactory();
+         bConnected = pClient && pClient->Connect(strHost, strPort);
+      }
+
+      const unsigned long long ullElapsedNs = static_cast<unsigned long long>(
+         std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - StartTime).count());
+
+      std::lock_guard<std::mutex> Lock(m_mtxPool);
+      if (!bConnected)
+      {
+         ++m_oStats.m_uConnectFailures;
+         return Lease();
+      }
+
+      ++m_oStats.m_uCheckouts;
+      if (bHit)
+         ++m_oStats.m_uHits;
+      else
+         ++m_oStats.m_uConnects;
+      m_oStats.m_ullCheckoutNs += ullElapsedNs;
+      if (ullElapsedNs > m_oStats.m_ullMaxCheckoutNs)
+         m_oStats.m_ullMaxCheckoutNs = ullElapsedNs;
+
+      return Lease(this, strKey, std::move(pClient));
+   }
+
+   /* opens connections until the server has m_uMinIdle idle ones (at most m_uMaxIdle, the pool
+    * wouldn't keep more), returns false if one failed */
+   bool Warm(const std::string& strHost, const std::string& strPort)
+   {
+      const std::string strKey = strHost + ":" + strPort;
+      const size_t uTarget = std::min(m_oSettings.m_uMinIdle, m_oSettings.m_uMaxIdle);
+
+      while (GetIdleCount(strHost, strPort) < uTarget)
+      {
+         std::unique_ptr<TClient> pClient = m_fnFactory();
+         if (!pClient || !pClient->Connect(strHost, strPort))
+         {
+            std::lock_guard<std::mutex> Lock(m_mtxPool);
+            ++m_oStats.m_uConnectFailures;
+            return false;
+         }
+
+         {
+            std::lock_guard<std::mutex> Lock(m_mtxPool);
+            ++m_oStats.m_uConnects;
+         }
+         GiveBack(strKey, std::move(pClient));
+      }
+      return true;
+   }
+
+   /* closes the connections idle for longer than the timeout, keeping m_uMinIdle per server
+    * (the most recently used ones). Returns how many were closed. */
+   size_t Prune()
+   {
+      if (m_oSettings.m_uIdleTimeoutMs == 0)
+         return 0;
+
+      const auto Deadline = std::chrono::steady_clock::now() - std::chrono::milliseconds(m_oSettings.m_uIdleTimeoutMs);
+      std::vector<std::unique_ptr<TClient>> vecExpired;
+      {
+         std::lock_guard<std::mutex> Lock(m_mtxPool);
+         for (auto& Server : m_mapIdle)
+         {
+            // the oldest ones are at the front
+            std::vector<IdleConnection>& vecIdle = Server.second;
+            size_t uExpired = 0;
+            while (uExpired < vecIdle.size() && vecIdle.size() - uExpired > m_oSettings.m_uMinIdle &&
+                   vecIdle[uExpired].m_IdleSince < Deadline)
+            {
+               vecExpired.push_back(std::move(vecIdle[uExpired].m_pClient));
+               ++uExpired;
+            }
+            vecIdle.erase(vecIdle.begin(), vecIdle.begin() + uExpired);
+         }
+         m_oStats.m_uExpired += vecExpired.size();
+      }
+
+      for (auto& pClient : vecExpired)
+         pClient->Disconnect();
+
+      return vecExpired.size();
+   }
+
+   /* closes every idle connection */
+   void Clear()
+   {
+      std::unordered_map<std::string, std::vector<IdleConnection>> mapIdle;
+      {
+         std::lock_guard<std::mutex> Lock(m_mtxPool);
+         mapIdle.swap(m_mapIdle);
+      }
+
+      for (auto& Server : mapIdle)
+         for (auto& Idle : Server.second)
+            Idle.m_pClient->Disconnect();
+   }
+
+   size_t GetIdleCount(const std::string& strHost, const std::string& strPort) const
+   {
+      std::lock_guard<std::mutex> Lock(m_mtxPool);
+      auto it = m_mapIdle.find(strHost + ":" + strPort);
+      return (it == m_mapIdle.end()) ? 0 : it->second.size();
+   }
+
+   Stats GetStats() const
+   {
+      std::lock_guard<std::mutex> Lock(m_mtxPool);
+      return m_oStats;
+   }
+
+   const Settings& GetSettings() const { return m_oSettings; }
+
+protected:
+   struct IdleConnection
+   {
+      std::unique_ptr<TClient>              m_pClient;
+      std::chrono::steady_clock::time_point m_IdleSince;
+   };
+
+   // the client's own probe when it has one (the int argument prefers this overload)
+   template <class T>
+   static auto Probe(T& Client, int) -> decltype(Client.ProbeConnection())
+   {
+      return Client.ProbeConnection();
+   }
+
+   template <class T>
+   static ASocket::ConnectionState Probe(T& Client, long)
+   {
+      return ASocket::ProbeConnection(Client.GetSocketDescriptor());
+   }
+
+   void GiveBack(const std::string& strKey, std::unique_ptr<TClient> pClient)
+   {
+      {
+         std::lock_guard<std::mutex> Lock(m_mtxPool);
+         std::vector<IdleConnection>& vecIdle = m_mapIdle[strKey];
+         if (vecIdle.size() < m_oSettings.m_uMaxIdle)
+         {
+            vecIdle.push_back(IdleConnection{ std::move(pClient), std::chrono::steady_clock::now() });
+            return;
+         }
+         ++m_oStats.m_uOverflows;
+      }
+
+      pClient->Disconnect();
+   }
+
+   ClientFactory m_fnFactory;
+   Settings      m_oSettings;
+
+   mutable std::mutex m_mtxPool;
+   std::unordered_map<std::string, std::vector<IdleConnection>> m_mapIdle; // most recent at the back
+   Stats m_oStats;
+};
+
+#endif
@@ -0,0 +1,298 @@
+/**
+* @file CoroReactor.cpp
+* @brief implementation of the coroutine reactor and of its pool
+*/
+
+#ifdef COROUTINES
+#ifdef LINUX
+#include "CoroReactor.h"
+
+#include <cerrno>
+#include <cstring>
+#include <exception>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace
+{
+   const size_t EVENTS_PER_WAIT = 1024;
+}
+
+CCoroReactor::CCoroReactor(const ASocket::LogFnCallback oLogger,
+                           const ASocket::SettingsFlag eSettings /*= ASocket::ALL_FLAGS*/) :
+   m_oLog(oLogger),
+   m_eSettingsFlags(eSettings),
+   m_EpollFd(epoll_create1(EPOLL_CLOEXEC)),
+   m_WakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+   m_bStopRequested(false),
+   m_bStopping(false),
+   m_uTaskCount(0)
+{
+   if (m_EpollFd < 0 || m_WakeFd < 0)
+   {
+      if (m_eSettingsFlags & ASocket::ENABLE_LOG)
+         m_oLog(ASocket::StringFormat("[CoroReactor][Error] epoll/eventfd setup failed : %s", strerror(errno)));
+      return;
+   }
+
+   struct epoll_event Event;
+   memset(&Event, 0, sizeof(Event));
+   Event.events = EPOLLIN;
+   Event.data.fd = m_WakeFd;
+   if (epoll_ctl(m_EpollFd, EPOLL_CTL_ADD, m_WakeFd, &Event) < 0 && (m_eSettingsFlags & ASocket::ENABLE_LOG))
+      m_oLog(ASocket::StringFormat("[CoroReactor][Error] epoll_ctl failed : %s", strerror(errno)));
+}
+
+CCoroReactor::~CCoroReactor()
+{
+   // tasks spawned but never run (Run wasn't called) are destroyed with their arguments
+   for (std::coroutine_handle<> Handle : m_vecPosted)
+      Handle.destroy();
+
+   if (m_WakeFd >= 0)
+      close(m_WakeFd);
+   if (m_EpollFd >= 0)
+      close(m_EpollFd);
+}
+
+CCoroReactor::DetachedTask CCoroReactor::RunDetached(CCoroReactor* pReactor, CCoroTask<void> Task)
+{
+   try
+   {
+      co_await Task;
+   }
+   catch (const std::exception& Exception)
+   {
+      if (pReactor->m_eSettingsFlags & ASocket::ENABLE_LOG)
+         pReactor->m_oLog(ASocket::StringFormat("[CoroReactor][Error] a task threw : %s", Exception.what()));
+   }
+   catch (...)
+   {
+      if (pReactor->m_eSettingsFlags & ASocket::ENABLE_LOG)
+         pReactor->m_oLog("[CoroReactor][Error] a task threw an unknown exception");
+   }
+
+   pReactor->m_uTaskCount.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void CCoroReactor::Spawn(CCoroTask<void> Task)
+{
+   m_uTaskCount.fetch_add(1, std::memory_order_relaxed);
+   Post(RunDetached(this, std::move(Task)).m_Handle);
+}
+
+void CCoroReactor::Post(std::coroutine_handle<> Handle)
+{
+   bool bWasEmpty;
+   {
+      std::lock_guard<std::mutex> Lock(m_mtxPosted);
+      bWasEmpty = m_vecPosted.empty();
+      m_vecPosted.push_back(Handle);
+   }
+
+   // the loop drains the whole queue each time it's woken up
+   if (bWasEmpty)
+   {
+      const uint64_t uOne = 1;
+      if (write(m_WakeFd, &uOne, sizeof(uOne)) < 0 && errno != EAGAIN && (m_eSettingsFlags & ASocket::ENABLE_LOG))
+         m_oLog(ASocket::StringFormat("[CoroReactor][Error] eventfd write failed : %s", strerror(errno)));
+   }
+}
+
+void CCoroReactor::ResumePosted()
+{
+   m_vecResuming.clear();
+   {
+      std::lock_guard<std::mutex> Lock(m_mtxPosted);
+      m_vecResuming.swap(m_vecPosted);
+   }
+
+   for (std::coroutine_handle<> Handle : m_vecResuming)
+      Handle.resume();
+}
+
+void CCoroReactor::Stop()
+{
+   m_bStopRequested.store(true);
+
+   const uint64_t uOne = 1;
+   if (write(m_WakeFd, &uOne, sizeof(uOne)) < 0 && errno != EAGAIN && (m_eSettingsFlags & ASocket::ENABLE_LOG))
+      m_oLog(ASocket::StringFormat("[CoroReactor][Error] eventfd write failed : %s", strerror(errno)));
+}
+
+bool CCoroReactor::Register(const ASocket::Socket Fd)
+{
+   if (Fd < 0)
+      return false;
+
+   struct epoll_event Event;
+   memset(&Event, 0, sizeof(Event));
+   Event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+   Event.data.fd = Fd;
+
+   if (epoll_ctl(m_EpollFd, EPOLL_CTL_ADD, Fd, &Event) < 0)
+   {
+      if (m_eSettingsFlags & ASocket::ENABLE_LOG)
+         m_oLog(ASocket::StringFormat("[CoroReactor][Error] epoll_ctl failed : %s", strerror(errno)));
+
+      return false;
+   }
+
+   if (static_cast<size_t>(Fd) >= m_vecWaiters.size())
+      m_vecWaiters.resize(static_cast<size_t>(Fd) + 1);
+
+   return true;
+}
+
+void CCoroReactor::Unregister(const ASocket::Socket Fd)
+{
+   if (Fd < 0 || static_cast<size_t>(Fd) >= m_vecWaiters.size())
+      return;
+
+   epoll_ctl(m_EpollFd, EPOLL_CTL_DEL, Fd, nullptr);
+
+   // a coroutine still waiting on the socket is resumed later, its operation then fails
+   const Waiters FdWaiters = m_vecWaiters[Fd];
+   m_vecWaiters[Fd] = Waiters();
+   if (FdWaiters.m_Reader)
+      Post(FdWaiters.m_Reader);
+   if (FdWaiters.m_Writer)
+      Post(FdWaiters.m_Writer);
+}
+
+void CCoroReactor::ReadinessAwaiter::await_suspend(std::coroutine_handle<> Handle) const noexcept
+{
+   Waiters& FdWaiters = m_Reactor.m_vecWaiters[m_Fd];
+   (m_bWrite ? FdWaiters.m_Writer : FdWaiters.m_Reader) = Handle;
+}
+
+bool CCoroReactor::Run()
+{
+   if (m_EpollFd < 0 || m_WakeFd < 0)
+      return false;
+
+   m_bStopping = false;
+   std::vector<struct epoll_event> vecEvents(EVENTS_PER_WAIT);
+
+   while (!m_bStopRequested.load())
+   {
+      const int iReady = epoll_wait(m_EpollFd, vecEvents.data(), static_cast<int>(vecEvents.size()), -1);
+      if (iReady < 0)
+      {
+         if (errno == EINTR)
+            continue;
+
+         if (m_eSettingsFlags & ASocket::ENABLE_LOG)
+            m_oLog(ASocket::StringFormat("[CoroReactor][Error] epoll_wait failed : %s", strerror(errno)));
+         break;
+      }
+
+      for (int i = 0; i < iReady; ++i)
+      {
+         const ASocket::Socket Fd = vecEvents[i].data.fd;
+         const uint32_t uEvents = vecEvents[i].events;
+
+         if (Fd == m_WakeFd)
+         {
+            uint64_t uCount;
+            while (read(m_WakeFd, &uCount, sizeof(uCount)) > 0)
+               ;
+            ResumePosted();
+            continue;
+         }
+
+         // the handles are taken before resuming, the coroutine can wait again right away
+         if (uEvents & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+         {
+            std::coroutine_handle<> Reader = m_vecWaiters[Fd].m_Reader;
+            m_vecWaiters[Fd].m_Reader = nullptr;
+            if (Reader)
+               Reader.resume();
+         }
+
+         if (uEvents & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+         {
+            std::coroutine_handle<> Writer = m_vecWaiters[Fd].m_Writer;
+            m_vecWaiters[Fd].m_Writer = nullptr;
+            if (Writer)
+               Writer.resume();
+         }
+      }
+   }
+
+   m_bStopping = true;
+   ResumeAllWaiters();
+   m_bStopRequested.store(false);
+   m_bStopping = false;
+
+   return true;
+}
+
+void CCoroReactor::ResumeAllWaiters()
+{
+   // with m_bStopping set, the socket operations fail instead of waiting again
+   bool bResumed = true;
+   while (bResumed)
+   {
+      bResumed = false;
+      ResumePosted();
+
+      for (size_t uFd = 0; uFd < m_vecWaiters.size(); ++uFd)
+      {
+         std::coroutine_handle<> Handles[2] = { m_vecWaiters[uFd].m_Reader, m_vecWaiters[uFd].m_Writer };
+         m_vecWaiters[uFd] = Waiters();
+
+         for (std::coroutine_handle<> Handle : Handles)
+         {
+            if (Handle)
+            {
+               Handle.resume();
+               bResumed = true;
+            }
+         }
+      }
+
+      std::lock_guard<std::mutex> Lock(m_mtxPosted);
+      bResumed = bResumed || !m_vecPosted.empty();
+   }
+}
+
+CCoroReactorPool::CCoroReactorPool(const ASocket::LogFnCallback oLogger,
+                                   const size_t uThreads,
+                                   const ASocket::SettingsFlag eSettings /*= ASocket::ALL_FLAGS*/) :
+   m_uNext(0)
+{
+   for (size_t i = 0; i < ((uThreads > 0) ? uThreads : 1); ++i)
+      m_vecReactors.emplace_back(new CCoroReactor(oLogger, eSettings));
+
+   for (auto& pReactor : m_vecReactors)
+   {
+      CCoroReactor* pRunning = pReactor.get();
+      m_vecThreads.emplace_back([pRunning] { pRunning->Run(); });
+   }
+}
+
+CCoroReactorPool::~CCoroReactorPool()
+{
+   Stop();
+}
+
+CCoroReactor& CCoroReactorPool::GetNext()
+{
+   return *m_vecReactors[m_uNext.fetch_add(1, std::memory_order_relaxed) % m_vecReactors.size()];
+}
+
+void CCoroReactorPool::Stop()
+{
+   for (auto& pReactor : m_vecReactors)
+      pReactor->Stop();
+
+   for (auto& Thread : m_vecThreads)
+      if (Thread.joinable())
+         Thread.join();
+}
+
+#endif
+#endif
@@ -0,0 +1,152 @@
+/*
+* @file CoroReactor.h
+* @brief single-threaded epoll loop resuming the coroutines waiting on its sockets (Linux, C++20)
+* @date 2026-10-17
+*
+* Built with SOCKET_CPP_WITH_COROUTINES. A blocked thread per connection reserves a whole
+* stack (8 MB by default) : a coroutine suspended on a CCoroReactor only keeps its frame, a
+* few hundred bytes, so one thread can serve as many connections as it has descriptors.
+* Sockets are registered once (edge-triggered, see CCoroSocket) and a coroutine waiting on
+* one is resumed by Run, on the reactor's thread, when it becomes ready. Everything but
+* Spawn and Stop must be called from that thread. CCoroReactorPool runs one reactor per
+* thread, a connection stays on the reactor it was spawned on.
+*/
+
+#ifndef INCLUDE_COROREACTOR_H_
+#define INCLUDE_COROREACTOR_H_
+
+#ifdef COROUTINES
+#ifdef LINUX
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "CoroTask.h"
+#include "Socket.h"
+
+class CCoroReactor
+{
+public:
+   explicit CCoroReactor(const ASocket::LogFnCallback oLogger,
+                         const ASocket::SettingsFlag eSettings = ASocket::ALL_FLAGS);
+   ~CCoroReactor();
+
+   CCoroReactor(const CCoroReactor&) = delete;
+   CCoroReactor& operator=(const CCoroReactor&) = delete;
+
+   /* runs the loop on the calling thread until Stop. The coroutines still waiting are then
+    * resumed, their socket operations fail, so that they can end. */
+   bool Run();
+
+   // thread-safe, Run returns once the current iteration is over
+   void Stop();
+
+   /* thread-safe : starts Task on the reactor's thread, detached. It's destroyed when it ends,
+    * an exception escaping it is logged. */
+   void Spawn(CCoroTask<void> Task);
+
+   // spawned tasks which didn't end yet
+   size_t GetTaskCount() const { return m_uTaskCount.load(std::memory_order_relaxed); }
+
+   bool IsStopping() const { return m_bStopping; }
+
+   /* the reactor's thread only : adds a socket to the epoll set (edge-triggered, read and
+    * write readiness), it must be unregistered before being closed : the coroutines waiting
+    * on it are then resumed by the loop */
+   bool Register(const ASocket::Socket Fd);
+   void Unregister(const ASocket::Socket Fd);
+
+   struct ReadinessAwaiter
+   {
+      CCoroReactor&         m_Reactor;
+      const ASocket::Socket m_Fd;
+      const bool            m_bWrite;
+
+      bool await_ready() const noexcept { return m_Reactor.m_bStopping; }
+      void await_suspend(std::coroutine_handle<> Handle) const noexcept;
+      void await_resume() const noexcept {}
+   };
+
+   /* suspends the caller until a registered socket is readable (or writable) : an operation
+    * must first have failed with EAGAIN, and it must be retried as the wake-up can be spurious.
+    * Only one coroutine can wait for each direction of a socket. */
+   ReadinessAwaiter WaitReadable(const ASocket::Socket Fd) { return ReadinessAwaiter{ *this, Fd, false }; }
+   ReadinessAwaiter WaitWritable(const ASocket::Socket Fd) { return ReadinessAwaiter{ *this, Fd, true }; }
+
+protected:
+   struct Waiters
+   {
+      std::coroutine_handle<> m_Reader;
+      std::coroutine_handle<> m_Writer;
+   };
+
+   // owns a spawned task's frame, destroys itself at the end
+   struct DetachedTask
+   {
+      struct promise_type
+      {
+         DetachedTask get_return_object() { return { std::coroutine_handle<promise_type>::from_promise(*this) }; }
+         std::suspend_always initial_suspend() const noexcept { return {}; }
+         std::suspend_never final_suspend() const noexcept { return {}; }
+         void return_void() const noexcept {}
+         void unhandled_exception() const noexcept {}
+      };
+
+      std::coroutine_handle<promise_type> m_Handle;
+   };
+
+   static DetachedTask RunDetached(CCoroReactor* pReactor, CCoroTask<void> Task);
+
+   void Post(std::coroutine_handle<> Handle);
+   void ResumePosted();
+
+   // resumes every waiting coroutine until none is left, after Run's loop
+   void ResumeAllWaiters();
+
+   ASocket::LogFnCallback  m_oLog;
+   ASocket::SettingsFlag   m_eSettingsFlags;
+   int                     m_EpollFd;
+   int                     m_WakeFd;
+   std::vector<Waiters>    m_vecWaiters; // indexed by descriptor
+   std::atomic<bool>       m_bStopRequested;
+   bool                    m_bStopping;
+   std::atomic<size_t>     m_uTaskCount;
+
+   std::mutex                           m_mtxPosted;
+   std::vector<std::coroutine_handle<>> m_vecPosted;
+   std::vector<std::coroutine_handle<>> m_vecResuming;
+};
+
+class CCoroReactorPool
+{
+public:
+   // starts uThreads reactors, each one on its own thread
+   explicit CCoroReactorPool(const ASocket::LogFnCallback oLogger,
+                             const size_t uThreads,
+                             const ASocket::SettingsFlag eSettings = ASocket::ALL_FLAGS);
+   ~CCoroReactorPool();
+
+   CCoroReactorPool(const CCoroReactorPool&) = delete;
+   CCoroReactorPool& operator=(const CCoroReactorPool&) = delete;
+
+   // round-robin, e.g. to spread the accepted connections
+   CCoroReactor& GetNext();
+   CCoroReactor& GetReactor(const size_t uIndex) { return *m_vecReactors[uIndex]; }
+   size_t GetSize() const { return m_vecReactors.size(); }
+
+   // stops the reactors and joins their threads
+   void Stop();
+
+protected:
+   std::vector<std::unique_ptr<CCoroReactor>> m_vecReactors;
+   std::vector<std::thread>                   m_vecThreads;
+   std::atomic<size_t>                        m_uNext;
+};
+
+#endif
+#endif
+
+#endif
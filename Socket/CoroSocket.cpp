@@ -0,0 +1,233 @@
+/**
+* @file CoroSocket.cpp
+* @brief implementation of the coroutine socket operations
+*/
+
+#ifdef COROUTINES
+#ifdef LINUX
+#include "CoroSocket.h"
+
+#include <cerrno>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "DnsCache.h"
+
+CCoroSocket::CCoroSocket(CCoroReactor& Reactor, const ASocket::Socket Sock, const bool bOwned /*= true*/) :
+   m_Reactor(Reactor),
+   m_Socket(Sock),
+   m_bOwned(bOwned),
+   m_iSavedFlags(-1)
+{
+   if (m_Socket == INVALID_SOCKET)
+      return;
+
+   m_iSavedFlags = fcntl(m_Socket, F_GETFL, 0);
+   if (m_iSavedFlags < 0 ||
+       (!(m_iSavedFlags & O_NONBLOCK) && fcntl(m_Socket, F_SETFL, m_iSavedFlags | O_NONBLOCK) < 0) ||
+       !m_Reactor.Register(m_Socket))
+   {
+      if (m_bOwned)
+         close(m_Socket);
+      else if (m_iSavedFlags >= 0)
+         fcntl(m_Socket, F_SETFL, m_iSavedFlags);
+
+      m_Socket = INVALID_SOCKET;
+   }
+}
+
+CCoroSocket::~CCoroSocket()
+{
+   Close();
+}
+
+void CCoroSocket::Close()
+{
+   if (m_Socket == INVALID_SOCKET)
+      return;
+
+   m_Reactor.Unregister(m_Socket);
+
+   if (m_bOwned)
+      close(m_Socket);
+   else
+      fcntl(m_Socket, F_SETFL, m_iSavedFlags);
+
+   m_Socket = INVALID_SOCKET;
+}
+
+CCoroTask<int> CCoroSocket::Receive(char* pData, const size_t uSize)
+{
+   for (;;)
+   {
+      if (m_Socket == INVALID_SOCKET)
+         co_return -1;
+
+      const ssize_t iRead = recv(m_Socket, pData, uSize, 0);
+      if (iRead >= 0)
+         co_return static_cast<int>(iRead);
+
+      if (errno == EINTR)
+         continue;
+
+      if ((errno != EAGAIN && errno != EWOULDBLOCK) || m_Reactor.IsStopping())
+         co_return -1;
+
+      co_await m_Reactor.WaitReadable(m_Socket);
+   }
+}
+
+CCoroTask<int> CCoroSocket::ReceiveExactly(char* pData, const size_t uSize)
+{
+   size_t uTotal = 0;
+   while (uTotal < uSize)
+   {
+      if (m_Socket == INVALID_SOCKET)
+         co_return -1;
+
+      const ssize_t iRead = recv(m_Socket, pData + uTotal, uSize - uTotal, 0);
+      if (iRead > 0)
+      {
+         uTotal += static_cast<size_t>(iRead);
+         continue;
+      }
+
+      // the peer disconnected : what was received so far
+      if (iRead == 0)
+         break;
+
+      if (errno == EINTR)
+         continue;
+
+      if ((errno != EAGAIN && errno != EWOULDBLOCK) || m_Reactor.IsStopping())
+         co_return -1;
+
+      co_await m_Reactor.WaitReadable(m_Socket);
+   }
+
+   co_return static_cast<int>(uTotal);
+}
+
+CCoroTask<bool> CCoroSocket::Send(const char* pData, const size_t uSize)
+{
+   size_t uTotal = 0;
+   while (uTotal < uSize)
+   {
+      if (m_Socket == INVALID_SOCKET)
+         co_return false;
+
+      const ssize_t iSent = send(m_Socket, pData + uTotal, uSize - uTotal, MSG_NOSIGNAL);
+      if (iSent >= 0)
+      {
+         uTotal += static_cast<size_t>(iSent);
+         continue;
+      }
+
+      if (errno == EINTR)
+         continue;
+
+      if ((errno != EAGAIN && errno != EWOULDBLOCK) || m_Reactor.IsStopping())
+         co_return false;
+
+      co_await m_Reactor.WaitWritable(m_Socket);
+   }
+
+   co_return true;
+}
+
+#ifdef OPENSSL
+CCoroTask<bool> CCoroSocket::Handshake(std::function<ASecureSocket::HandshakeStatus()> fnStep)
+{
+   for (;;)
+   {
+      if (m_Socket == INVALID_SOCKET || !fnStep)
+         co_return false;
+
+      switch (fnStep())
+      {
+         case ASecureSocket::HandshakeStatus::DONE:
+            co_return true;
+
+         case ASecureSocket::HandshakeStatus::WANT_READ:
+            if (m_Reactor.IsStopping())
+               co_return false;
+            co_await m_Reactor.WaitReadable(m_Socket);
+            break;
+
+         case ASecureSocket::HandshakeStatus::WANT_WRITE:
+            if (m_Reactor.IsStopping())
+               co_return false;
+            co_await m_Reactor.WaitWritable(m_Socket);
+            break;
+
+         default:
+            co_return false;
+      }
+   }
+}
+#endif
+
+CCoroTask<ASocket::Socket> CCoroSocket::Accept(CCoroReactor& Reactor, CTCPServer& Server)
+{
+   std::vector<ASocket::Socket> vecClients;
+   for (;;)
+   {
+      // the listen socket is made non-blocking by AcceptBatch
+      const int iAccepted = Server.AcceptBatch(vecClients, 1);
+      if (iAccepted > 0)
+         co_return vecClients.front();
+
+      if (iAccepted < 0 || Reactor.IsStopping())
+         co_return INVALID_SOCKET;
+
+      // registered only while waiting : a client queued in between is reported by epoll_ctl
+      const ASocket::Socket ListenSocket = Server.GetListenSocket();
+      if (!Reactor.Register(ListenSocket))
+         co_return INVALID_SOCKET;
+
+      co_await Reactor.WaitReadable(ListenSocket);
+      Reactor.Unregister(ListenSocket);
+   }
+}
+
+CCoroTask<ASocket::Socket> CCoroSocket::Connect(CCoroReactor& Reactor,
+                                                const std::string strServer,
+                                                const std::string strPort)
+{
+   std::vector<CDnsCache::Address> vecAddresses;
+   if (CDnsCache::Resolve(strServer, strPort, AF_INET, vecAddresses) != 0)
+      co_return INVALID_SOCKET;
+
+   for (const CDnsCache::Address& oAddress : vecAddresses)
+   {
+      const ASocket::Socket NewSocket = socket(oAddress.m_iFamily, oAddress.m_iSockType | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                                               oAddress.m_iProtocol);
+      if (NewSocket < 0)
+         continue;
+
+      int iConRet = connect(NewSocket, oAddress.GetSockAddr(), oAddress.m_uSockAddrLen);
+      if (iConRet < 0 && errno == EINPROGRESS && Reactor.Register(NewSocket))
+      {
+         co_await Reactor.WaitWritable(NewSocket);
+         Reactor.Unregister(NewSocket);
+
+         int iError = 0;
+         socklen_t uErrorLen = sizeof(iError);
+         if (!Reactor.IsStopping() &&
+             getsockopt(NewSocket, SOL_SOCKET, SO_ERROR, &iError, &uErrorLen) == 0 && iError == 0)
+            iConRet = 0;
+      }
+
+      if (iConRet == 0)
+         co_return NewSocket;
+
+      close(NewSocket);
+   }
+
+   co_return INVALID_SOCKET;
+}
+
+#endif
+#endif
@@ -0,0 +1,85 @@
+/*
+* @file CoroSocket.h
+* @brief co_await-able Accept, Connect, Receive, Send and TLS handshake on a CCoroReactor (Linux, C++20)
+* @date 2026-10-17
+*
+* Built with SOCKET_CPP_WITH_COROUTINES. A CCoroSocket puts a connected socket in
+* non-blocking mode and registers it on a reactor : its operations are tried right away
+* and only suspend the calling coroutine when the kernel would block, so that protocol
+* code reads sequentially like with CTCPClient while the thread serves other connections.
+* Results follow CTCPClient's : Receive returns 0 once the peer disconnected, -1 on error
+* (also when the reactor stops). A CCoroSocket must be created, used and destroyed on its
+* reactor's thread, e.g. in the task spawned for the connection.
+*/
+
+#ifndef INCLUDE_COROSOCKET_H_
+#define INCLUDE_COROSOCKET_H_
+
+#ifdef COROUTINES
+#ifdef LINUX
+
+#include <functional>
+#include <string>
+
+#include "CoroReactor.h"
+#include "TCPServer.h"
+
+#ifdef OPENSSL
+#include "SecureSocket.h"
+#endif
+
+class CCoroSocket
+{
+public:
+   /* with bOwned, the socket is closed with this object, otherwise its previous mode is
+    * restored (e.g. an SSLSocket which is only handshaked here) */
+   CCoroSocket(CCoroReactor& Reactor, const ASocket::Socket Sock, const bool bOwned = true);
+   ~CCoroSocket();
+
+   CCoroSocket(const CCoroSocket&) = delete;
+   CCoroSocket& operator=(const CCoroSocket&) = delete;
+
+   // some of the received bytes, or all uSize of them (unless the peer disconnects first)
+   CCoroTask<int>  Receive(char* pData, const size_t uSize);
+   CCoroTask<int>  ReceiveExactly(char* pData, const size_t uSize);
+
+   // completes once everything was handed to the kernel
+   CCoroTask<bool> Send(const char* pData, const size_t uSize);
+   CCoroTask<bool> Send(const std::string& strData) { return Send(strData.data(), strData.size()); }
+
+#ifdef OPENSSL
+   /* runs a non-blocking TLS handshake on this socket : fnStep is e.g. CTCPSSLServer::ContinueAccept
+    * after BeginAccept, or CTCPSSLClient::ContinueConnect after BeginConnect */
+   CCoroTask<bool> Handshake(std::function<ASecureSocket::HandshakeStatus()> fnStep);
+#endif
+
+   /* a client of Server (which starts listening if needed), in non-blocking mode and with the
+    * server's socket options, to be wrapped in a CCoroSocket. INVALID_SOCKET on error. Only one
+    * coroutine at a time should accept on a server. */
+   static CCoroTask<ASocket::Socket> Accept(CCoroReactor& Reactor, CTCPServer& Server);
+
+   /* resolves strServer (CDnsCache : a name not cached yet is resolved synchronously) and
+    * connects to the first address answering. INVALID_SOCKET on error. The strings are copied
+    * into the coroutine's frame, they can be temporaries. */
+   static CCoroTask<ASocket::Socket> Connect(CCoroReactor& Reactor,
+                                             const std::string strServer,
+                                             const std::string strPort);
+
+   // unregisters and closes (or gives back) the socket, the next operations fail
+   void Close();
+
+   ASocket::Socket GetSocket() const { return m_Socket; }
+   bool IsOpen() const { return m_Socket != INVALID_SOCKET; }
+   CCoroReactor& GetReactor() const { return m_Reactor; }
+
+protected:
+   CCoroReactor&   m_Reactor;
+   ASocket::Socket m_Socket;
+   const bool      m_bOwned;
+   int             m_iSavedFlags;
+};
+
+#endif
+#endif
+
+#endif
@@ -0,0 +1,156 @@
+/*
+* @file CoroTask.h
+* @brief lazily started C++20 coroutine returning a value to the coroutine awaiting it
+* @date 2026-10-17
+*
+* Built with SOCKET_CPP_WITH_COROUTINES (C++20). A CCoroTask starts when it's co_awaited
+* and resumes its awaiter when it completes (symmetric transfer : a chain of tasks doesn't
+* grow the stack). It owns its frame. A task can also be started, detached, on a reactor
+* with CCoroReactor::Spawn. An exception escaping the coroutine is rethrown to its awaiter.
+*/
+
+#ifndef INCLUDE_COROTASK_H_
+#define INCLUDE_COROTASK_H_
+
+#ifdef COROUTINES
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+template <typename T>
+class CCoroTask;
+
+namespace CoroTaskDetail
+{
+   struct FinalAwaiter
+   {
+      bool await_ready() const noexcept { return false; }
+
+      template <typename Promise>
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> Handle) const noexcept
+      {
+         std::coroutine_handle<> Continuation = Handle.promise().m_Continuation;
+         return Continuation ? Continuation : std::noop_coroutine();
+      }
+
+      void await_resume() const noexcept {}
+   };
+
+   struct PromiseBase
+   {
+      std::coroutine_handle<> m_Continuation;
+      std::exception_ptr      m_pException;
+
+      std::suspend_always initial_suspend() const noexcept { return {}; }
+      FinalAwaiter final_suspend() const noexcept { return {}; }
+      void unhandled_exception() noexcept { m_pException = std::current_exception(); }
+   };
+}
+
+template <typename T>
+class CCoroTask
+{
+public:
+   struct promise_type : CoroTaskDetail::PromiseBase
+   {
+      T m_Value{};
+
+      CCoroTask get_return_object() { return CCoroTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+      void return_value(T Value) { m_Value = std::move(Value); }
+   };
+
+   CCoroTask(CCoroTask&& Other) noexcept : m_Handle(std::exchange(Other.m_Handle, nullptr)) {}
+   CCoroTask& operator=(CCoroTask&& Other) noexcept
+   {
+      if (this != &Other)
+      {
+         if (m_Handle)
+            m_Handle.destroy();
+         m_Handle = std::exchange(Other.m_Handle, nullptr);
+      }
+      return *this;
+   }
+   CCoroTask(const CCoroTask&) = delete;
+   CCoroTask& operator=(const CCoroTask&) = delete;
+
+   ~CCoroTask()
+   {
+      if (m_Handle)
+         m_Handle.destroy();
+   }
+
+   bool await_ready() const noexcept { return !m_Handle || m_Handle.done(); }
+
+   std::coroutine_handle<> await_suspend(std::coroutine_handle<> Awaiter) noexcept
+   {
+      m_Handle.promise().m_Continuation = Awaiter;
+      return m_Handle;
+   }
+
+   T await_resume()
+   {
+      if (m_Handle.promise().m_pException)
+         std::rethrow_exception(m_Handle.promise().m_pException);
+      return std::move(m_Handle.promise().m_Value);
+   }
+
+private:
+   explicit CCoroTask(std::coroutine_handle<promise_type> Handle) : m_Handle(Handle) {}
+
+   std::coroutine_handle<promise_type> m_Handle;
+};
+
+template <>
+class CCoroTask<void>
+{
+public:
+   struct promise_type : CoroTaskDetail::PromiseBase
+   {
+      CCoroTask get_return_object() { return CCoroTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+      void return_void() const noexcept {}
+   };
+
+   CCoroTask(CCoroTask&& Other) noexcept : m_Handle(std::exchange(Other.m_Handle, nullptr)) {}
+   CCoroTask& operator=(CCoroTask&& Other) noexcept
+   {
+      if (this != &Other)
+      {
+         if (m_Handle)
+            m_Handle.destroy();
+         m_Handle = std::exchange(Other.m_Handle, nullptr);
+      }
+      return *this;
+   }
+   CCoroTask(const CCoroTask&) = delete;
+   CCoroTask& operator=(const CCoroTask&) = delete;
+
+   ~CCoroTask()
+   {
+      if (m_Handle)
+         m_Handle.destroy();
+   }
+
+   bool await_ready() const noexcept { return !m_Handle || m_Handle.done(); }
+
+   std::coroutine_handle<> await_suspend(std::coroutine_handle<> Awaiter) noexcept
+   {
+      m_Handle.promise().m_Continuation = Awaiter;
+      return m_Handle;
+   }
+
+   void await_resume()
+   {
+      if (m_Handle.promise().m_pException)
+         std::rethrow_exception(m_Handle.promise().m_pException);
+   }
+
+private:
+   explicit CCoroTask(std::coroutine_handle<promise_type> Handle) : m_Handle(Handle) {}
+
+   std::coroutine_handle<promise_type> m_Handle;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,259 @@
+/**
+* @file DnsCache.cpp
+* @brief implementation of the resolved addresses cache
+*/
+
+#include "DnsCache.h"
+
+#include <chrono>
+#include <cstddef>   // offsetof
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+   std::atomic<unsigned long long> s_uLookups(0);
+   std::atomic<unsigned long long> s_uNumericHits(0);
+   std::atomic<unsigned long long> s_uCacheHits(0);
+   std::atomic<unsigned long long> s_uNegativeHits(0);
+   std::atomic<unsigned long long> s_uResolverCalls(0);
+}
+
+struct CDnsCache::Shard
+{
+   struct Entry
+   {
+      std::vector<Address>                  m_vecAddresses;
+      int                                   m_iError; // != 0 : negative entry
+      std::chrono::steady_clock::time_point m_Expiry;
+   };
+
+   std::mutex                             m_mtxEntries;
+   std::unordered_map<std::string, Entry> m_mapEntries;
+};
+
+const size_t CDnsCache::DEFAULT_TTL_MS;
+const size_t CDnsCache::DEFAULT_NEGATIVE_TTL_MS;
+const size_t CDnsCache::SHARD_COUNT;
+
+std::atomic<size_t> CDnsCache::s_uTtlMs(CDnsCache::DEFAULT_TTL_MS);
+std::atomic<size_t> CDnsCache::s_uNegativeTtlMs(CDnsCache::DEFAULT_NEGATIVE_TTL_MS);
+
+std::string CDnsCache::Address::ToString() const
+{
+   char szHost[INET6_ADDRSTRLEN] = {};
+
+   if (m_iFamily == AF_INET)
+   {
+      const struct sockaddr_in* pAddr4 = reinterpret_cast<const struct sockaddr_in*>(&m_SockAddr);
+      if (inet_ntop(AF_INET, const_cast<struct in_addr*>(&pAddr4->sin_addr), szHost, sizeof(szHost)) == nullptr)
+         return std::string();
+      return std::string(szHost) + ':' + std::to_string(ntohs(pAddr4->sin_port));
+   }
+
+   if (m_iFamily == AF_INET6)
+   {
+      const struct sockaddr_in6* pAddr6 = reinterpret_cast<const struct sockaddr_in6*>(&m_SockAddr);
+      if (inet_ntop(AF_INET6, const_cast<struct in6_addr*>(&pAddr6->sin6_addr), szHost, sizeof(szHost)) == nullptr)
+         return std::string();
+      return '[' + std::string(szHost) + "]:" + std::to_string(ntohs(pAddr6->sin6_port));
+   }
+
+#ifndef WINDOWS
+   // a Unix domain socket's path, '@' for an abstract name's leading null byte
+   if (m_iFamily == AF_UNIX)
+   {
+      const struct sockaddr_un* pAddrUn = reinterpret_cast<const struct sockaddr_un*>(&m_SockAddr);
+      const size_t uOffset = offsetof(struct sockaddr_un, sun_path);
+      if (m_uSockAddrLen <= uOffset)
+         return std::string();
+
+      std::string strPath(pAddrUn->sun_path, m_uSockAddrLen - uOffset);
+      if (strPath[0] == '\0')
+         strPath[0] = '@';
+      else
+         strPath.resize(strnlen(strPath.c_str(), strPath.size()));
+      return strPath;
+   }
+#endif
+
+   return std::string();
+}
+
+CDnsCache::Shard* CDnsCache::GetShards()
+{
+   static Shard s_Shards[SHARD_COUNT];
+   return s_Shards;
+}
+
+CDnsCache::Shard& CDnsCache::GetShard(const std::string& strKey)
+{
+   return GetShards()[std::hash<std::string>()(strKey) % SHARD_COUNT];
+}
+
+std::string CDnsCache::MakeKey(const std::string& strHost, const std::string& strPort, const int iFamily)
+{
+   return strHost + '|' + strPort + '|' + std::to_string(iFamily);
+}
+
+bool CDnsCache::ParseNumeric(const std::string& strHost, const std::string& strPort, const int iFamily,
+                             Address& oAddress)
+{
+   if (strPort.empty() || strPort.size() > 5 || strPort.find_first_not_of("0123456789") != std::string::npos)
+      return false;
+
+   const unsigned long ulPort = std::stoul(strPort);
+   if (ulPort > 65535)
+      return false;
+
+   memset(&oAddress, 0, sizeof(oAddress));
+   oAddress.m_iSockType = SOCK_STREAM;
+   oAddress.m_iProtocol = IPPROTO_TCP;
+
+   if (iFamily != AF_INET6)
+   {
+      struct sockaddr_in* pAddr4 = reinterpret_cast<struct sockaddr_in*>(&oAddress.m_SockAddr);
+      if (inet_pton(AF_INET, strHost.c_str(), &pAddr4->sin_addr) == 1)
+      {
+         pAddr4->sin_family = AF_INET;
+         pAddr4->sin_port = htons(static_cast<unsigned short>(ulPort));
+         oAddress.m_uSockAddrLen = sizeof(struct sockaddr_in);
+         oAddress.m_iFamily = AF_INET;
+         return true;
+      }
+   }
+
+   if (iFamily != AF_INET)
+   {
+      struct sockaddr_in6* pAddr6 = reinterpret_cast<struct sockaddr_in6*>(&oAddress.m_SockAddr);
+      if (inet_pton(AF_INET6, strHost.c_str(), &pAddr6->sin6_addr) == 1)
+      {
+         pAddr6->sin6_family = AF_INET6;
+         pAddr6->sin6_port = htons(static_cast<unsigned short>(ulPort));
+         oAddress.m_uSockAddrLen = sizeof(struct sockaddr_in6);
+         oAddress.m_iFamily = AF_INET6;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+int CDnsCache::Resolve(const std::string& strHost, const std::string& strPort, const int iFamily,
+                       std::vector<Address>& vecAddresses)
+{
+   s_uLookups.fetch_add(1, std::memory_order_relaxed);
+   vecAddresses.clear();
+
+   Address oNumeric;
+   if (ParseNumeric(strHost, strPort, iFamily, oNumeric))
+   {
+      s_uNumericHits.fetch_add(1, std::memory_order_relaxed);
+      vecAddresses.push_back(oNumeric);
+      return 0;
+   }
+
+   const std::string strKey = MakeKey(strHost, strPort, iFamily);
+   Shard& oShard = GetShard(strKey);
+   const auto Now = std::chrono::steady_clock::now();
+
+   {
+      std::lock_guard<std::mutex> Lock(oShard.m_mtxEntries);
+      auto it = oShard.m_mapEntries.find(strKey);
+      if (it != oShard.m_mapEntries.end())
+      {
+         if (Now < it->second.m_Expiry)
+         {
+            if (it->second.m_iError != 0)
+            {
+               s_uNegativeHits.fetch_add(1, std::memory_order_relaxed);
+               return it->second.m_iError;
+            }
+
+            s_uCacheHits.fetch_add(1, std::memory_order_relaxed);
+            vecAddresses = it->second.m_vecAddresses;
+            return 0;
+         }
+         oShard.m_mapEntries.erase(it);
+      }
+   }
+
+   // resolved without holding the lock : concurrent misses on the same server may both ask
+   struct addrinfo Hints;
+   memset(&Hints, 0, sizeof(Hints));
+   Hints.ai_family = iFamily;
+   Hints.ai_socktype = SOCK_STREAM;
+   Hints.ai_protocol = IPPROTO_TCP;
+
+   struct addrinfo* pResult = nullptr;
+   s_uResolverCalls.fetch_add(1, std::memory_order_relaxed);
+   const int iResult = getaddrinfo(strHost.c_str(), strPort.c_str(), &Hints, &pResult);
+
+   if (iResult == 0)
+   {
+      for (struct addrinfo* pInfo = pResult; pInfo != nullptr; pInfo = pInfo->ai_next)
+      {
+         if (pInfo->ai_addrlen > sizeof(struct sockaddr_storage))
+            continue;
+
+         Address oAddress;
+         memset(&oAddress, 0, sizeof(oAddress));
+         memcpy(&oAddress.m_SockAddr, pInfo->ai_addr, pInfo->ai_addrlen);
+         oAddress.m_uSockAddrLen = static_cast<socklen_t>(pInfo->ai_addrlen);
+         oAddress.m_iFamily = pInfo->ai_family;
+         oAddress.m_iSockType = pInfo->ai_socktype;
+         oAddress.m_iProtocol = pInfo->ai_protocol;
+         vecAddresses.push_back(oAddress);
+      }
+   }
+   if (pResult != nullptr)
+      freeaddrinfo(pResult);
+
+   // a temporary resolver failure isn't cached
+   const bool bCacheable = (iResult == 0) ? !vecAddresses.empty() : (iResult != EAI_AGAIN);
+   const size_t uTtlMs = (iResult == 0) ? GetTtl() : GetNegativeTtl();
+   if (bCacheable && uTtlMs > 0)
+   {
+      Shard::Entry oEntry;
+      oEntry.m_vecAddresses = vecAddresses;
+      oEntry.m_iError = iResult;
+      oEntry.m_Expiry = std::chrono::steady_clock::now() + std::chrono::milliseconds(uTtlMs);
+
+      std::lock_guard<std::mutex> Lock(oShard.m_mtxEntries);
+      oShard.m_mapEntries[strKey] = std::move(oEntry);
+   }
+
+   return iResult;
+}
+
+void CDnsCache::Invalidate(const std::string& strHost, const std::string& strPort, const int iFamily)
+{
+   const std::string strKey = MakeKey(strHost, strPort, iFamily);
+   Shard& oShard = GetShard(strKey);
+
+   std::lock_guard<std::mutex> Lock(oShard.m_mtxEntries);
+   oShard.m_mapEntries.erase(strKey);
+}
+
+void CDnsCache::Clear()
+{
+   Shard* pShards = GetShards();
+   for (size_t i = 0; i < SHARD_COUNT; ++i)
+   {
+      std::lock_guard<std::mutex> Lock(pShards[i].m_mtxEntries);
+      pShards[i].m_mapEntries.clear();
+   }
+}
+
+CDnsCache::Stats CDnsCache::GetStats()
+{
+   Stats oStats;
+   oStats.m_uLookups = s_uLookups.load(std::memory_order_relaxed);
+   oStats.m_uNumericHits = s_uNumericHits.load(std::memory_order_relaxed);
+   oStats.m_uCacheHits = s_uCacheHits.load(std::memory_order_relaxed);
+   oStats.m_uNegativeHits = s_uNegativeHits.load(std::memory_order_relaxed);
+   oStats.m_uResolverCalls = s_uResolverCalls.load(std::memory_order_relaxed);
+   return oStats;
+}
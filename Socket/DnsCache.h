@@ -0,0 +1,87 @@
+/*
+* @file DnsCache.h
+* @brief process-wide cache of resolved server addresses, used by CTCPClient::Connect
+* @date 2026-10-17
+*
+* getaddrinfo blocks, often for milliseconds, on each call. The addresses resolved for
+* a (host, port, family) are kept for a TTL, failures too (for a shorter one) so that an
+* unknown host isn't asked again on each reconnection attempt. Literal IPv4/IPv6
+* addresses with a numeric port are converted directly, without calling getaddrinfo.
+* The cache is split in shards, each with its own lock, so that concurrent Connect
+* calls to different servers don't contend.
+*/
+
+#ifndef INCLUDE_DNSCACHE_H_
+#define INCLUDE_DNSCACHE_H_
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "Socket.h"
+
+class CDnsCache
+{
+public:
+   struct Address
+   {
+      struct sockaddr_storage m_SockAddr;
+      socklen_t               m_uSockAddrLen;
+      int                     m_iFamily;
+      int                     m_iSockType;
+      int                     m_iProtocol;
+
+      const struct sockaddr* GetSockAddr() const { return reinterpret_cast<const struct sockaddr*>(&m_SockAddr); }
+
+      // "127.0.0.1:80", "[::1]:80", "/run/app.sock" or "@app" (Unix domain sockets)
+      std::string ToString() const;
+   };
+
+   struct Stats
+   {
+      unsigned long long m_uLookups;
+      unsigned long long m_uNumericHits;  // literal addresses, never sent to the resolver
+      unsigned long long m_uCacheHits;
+      unsigned long long m_uNegativeHits; // cached failures
+      unsigned long long m_uResolverCalls;
+
+      unsigned long long GetResolverCallsAvoided() const { return m_uNumericHits + m_uCacheHits + m_uNegativeHits; }
+   };
+
+   static const size_t DEFAULT_TTL_MS = 30000;
+   static const size_t DEFAULT_NEGATIVE_TTL_MS = 5000;
+
+   /* the addresses of strHost:strPort for a stream socket of the family (AF_INET, AF_INET6 or
+    * AF_UNSPEC). Returns 0 or the getaddrinfo error code (see gai_strerror). */
+   static int Resolve(const std::string& strHost, const std::string& strPort, const int iFamily,
+                      std::vector<Address>& vecAddresses);
+
+   /* a TTL of 0 disables caching (the numeric fast path remains) */
+   static void SetTtl(const size_t uTtlMs) { s_uTtlMs.store(uTtlMs, std::memory_order_relaxed); }
+   static void SetNegativeTtl(const size_t uTtlMs) { s_uNegativeTtlMs.store(uTtlMs, std::memory_order_relaxed); }
+   static size_t GetTtl() { return s_uTtlMs.load(std::memory_order_relaxed); }
+   static size_t GetNegativeTtl() { return s_uNegativeTtlMs.load(std::memory_order_relaxed); }
+
+   /* forgets one server, or every one */
+   static void Invalidate(const std::string& strHost, const std::string& strPort, const int iFamily);
+   static void Clear();
+
+   static Stats GetStats();
+
+   /* a literal address with a numeric port, without the resolver : false if it isn't one */
+   static bool ParseNumeric(const std::string& strHost, const std::string& strPort, const int iFamily,
+                            Address& oAddress);
+
+private:
+   struct Shard;
+   static const size_t SHARD_COUNT = 16;
+
+   static Shard* GetShards();
+   static Shard& GetShard(const std::string& strKey);
+   static std::string MakeKey(const std::string& strHost, const std::string& strPort, const int iFamily);
+
+   static std::atomic<size_t> s_uTtlMs;
+   static std::atomic<size_t> s_uNegativeTtlMs;
+};
+
+#endif
@@ -0,0 +1,263 @@
+/**
+* @file IoUring.cpp
+* @brief implementation of the io_uring wrapper class
+*/
+
+#ifdef IO_URING
+#include "IoUring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+CIoUring::CIoUring() :
+   m_RingFd(-1),
+   m_pSqRing(MAP_FAILED),
+   m_uSqRingSize(0),
+   m_pCqRing(MAP_FAILED),
+   m_uCqRingSize(0),
+   m_pSqHead(nullptr),
+   m_pSqTail(nullptr),
+   m_pSqArray(nullptr),
+   m_uSqMask(0),
+   m_uSqeTail(0),
+   m_pSqes(static_cast<struct io_uring_sqe*>(MAP_FAILED)),
+   m_pCqHead(nullptr),
+   m_pCqTail(nullptr),
+   m_uCqMask(0),
+   m_pCqes(nullptr),
+   m_pBufRing(static_cast<struct io_uring_buf_ring*>(MAP_FAILED)),
+   m_uBufRingSize(0),
+   m_uBufRingMask(0),
+   m_uBufferSize(0),
+   m_uEnterCount(0)
+{
+   memset(&m_Params, 0, sizeof(m_Params));
+}
+
+bool CIoUring::Init(const unsigned uEntries)
+{
+   Release();
+
+   memset(&m_Params, 0, sizeof(m_Params));
+   // multishot requests post many completions per submission
+   m_Params.flags = IORING_SETUP_CQSIZE;
+   m_Params.cq_entries = uEntries * 4;
+
+   m_RingFd = static_cast<int>(syscall(__NR_io_uring_setup, uEntries, &m_Params));
+   if (m_RingFd < 0)
+   {
+      m_RingFd = -1;
+      return false;
+   }
+
+   // timed waits need IORING_ENTER_EXT_ARG (Linux 5.11)
+   if (!(m_Params.features & IORING_FEAT_EXT_ARG))
+   {
+      Release();
+      errno = ENOSYS;
+      return false;
+   }
+
+   m_uSqRingSize = m_Params.sq_off.array + m_Params.sq_entries * sizeof(unsigned);
+   m_uCqRingSize = m_Params.cq_off.cqes + m_Params.cq_entries * sizeof(struct io_uring_cqe);
+
+   const bool bSingleMmap = (m_Params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+   if (bSingleMmap)
+      m_uSqRingSize = m_uCqRingSize = std::max(m_uSqRingSize, m_uCqRingSize);
+
+   m_pSqRing = mmap(nullptr, m_uSqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    m_RingFd, IORING_OFF_SQ_RING);
+   if (m_pSqRing == MAP_FAILED)
+   {
+      Release();
+      return false;
+   }
+
+   if (bSingleMmap)
+   {
+      m_pCqRing = m_pSqRing;
+   }
+   else
+   {
+      m_pCqRing = mmap(nullptr, m_uCqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       m_RingFd, IORING_OFF_CQ_RING);
+      if (m_pCqRing == MAP_FAILED)
+      {
+         Release();
+         return false;
+      }
+   }
+
+   m_pSqes = static_cast<struct io_uring_sqe*>(mmap(nullptr, m_Params.sq_entries * sizeof(struct io_uring_sqe),
+                                                    PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                                    m_RingFd, IORING_OFF_SQES));
+   if (m_pSqes == MAP_FAILED)
+   {
+      Release();
+      return false;
+   }
+
+   char* pSq = static_cast<char*>(m_pSqRing);
+   m_pSqHead  = reinterpret_cast<unsigned*>(pSq + m_Params.sq_off.head);
+   m_pSqTail  = reinterpret_cast<unsigned*>(pSq + m_Params.sq_off.tail);
+   m_pSqArray = reinterpret_cast<unsigned*>(pSq + m_Params.sq_off.array);
+   m_uSqMask  = *reinterpret_cast<unsigned*>(pSq + m_Params.sq_off.ring_mask);
+   m_uSqeTail = *m_pSqTail;
+
+   char* pCq = static_cast<char*>(m_pCqRing);
+   m_pCqHead = reinterpret_cast<unsigned*>(pCq + m_Params.cq_off.head);
+   m_pCqTail = reinterpret_cast<unsigned*>(pCq + m_Params.cq_off.tail);
+   m_uCqMask = *reinterpret_cast<unsigned*>(pCq + m_Params.cq_off.ring_mask);
+   m_pCqes   = reinterpret_cast<struct io_uring_cqe*>(pCq + m_Params.cq_off.cqes);
+
+   return true;
+}
+
+struct io_uring_sqe* CIoUring::GetSqe()
+{
+   if (m_RingFd < 0)
+      return nullptr;
+
+   const unsigned uHead = __atomic_load_n(m_pSqHead, __ATOMIC_ACQUIRE);
+   if (m_uSqeTail - uHead >= m_Params.sq_entries)
+      return nullptr;
+
+   const unsigned uIndex = m_uSqeTail & m_uSqMask;
+   m_pSqArray[uIndex] = uIndex;
+   ++m_uSqeTail;
+
+   struct io_uring_sqe* pSqe = &m_pSqes[uIndex];
+   memset(pSqe, 0, sizeof(*pSqe));
+
+   return pSqe;
+}
+
+int CIoUring::Submit(const unsigned uWaitNr /*= 0*/, const int iTimeoutMsec /*= -1*/)
+{
+   if (m_RingFd < 0)
+      return -1;
+
+   __atomic_store_n(m_pSqTail, m_uSqeTail, __ATOMIC_RELEASE);
+   const unsigned uToSubmit = m_uSqeTail - __atomic_load_n(m_pSqHead, __ATOMIC_ACQUIRE);
+
+   if (uToSubmit == 0 && uWaitNr == 0)
+      return 0;
+
+   unsigned uFlags = 0;
+   struct io_uring_getevents_arg Arg;
+   struct __kernel_timespec Timeout;
+   memset(&Arg, 0, sizeof(Arg));
+
+   if (uWaitNr > 0)
+   {
+      uFlags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+
+      if (iTimeoutMsec >= 0)
+      {
+         Timeout.tv_sec = iTimeoutMsec / 1000;
+         Timeout.tv_nsec = (iTimeoutMsec % 1000) * 1000000LL;
+         Arg.ts = reinterpret_cast<uint64_t>(&Timeout);
+      }
+   }
+
+   ++m_uEnterCount;
+   int iRet = static_cast<int>(syscall(__NR_io_uring_enter, m_RingFd, uToSubmit, uWaitNr, uFlags,
+                                       (uFlags & IORING_ENTER_EXT_ARG) ? &Arg : nullptr,
+                                       (uFlags & IORING_ENTER_EXT_ARG) ? sizeof(Arg) : 0));
+   if (iRet < 0)
+   {
+      // a timeout or a signal isn't an error
+      if (errno == ETIME || errno == EINTR || errno == EAGAIN || errno == EBUSY)
+         return 0;
+
+      return -1;
+   }
+
+   return iRet;
+}
+
+bool CIoUring::SetUpBufferRing(const uint16_t uGroupId, const unsigned uCount, const unsigned uSize)
+{
+   if (m_RingFd < 0 || uCount == 0 || (uCount & (uCount - 1)) != 0 || uCount > 32768)
+   {
+      errno = EINVAL;
+      return false;
+   }
+
+   m_uBufRingSize = uCount * sizeof(struct io_uring_buf);
+   m_pBufRing = static_cast<struct io_uring_buf_ring*>(mmap(nullptr, m_uBufRingSize, PROT_READ | PROT_WRITE,
+                                                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0));
+   if (m_pBufRing == MAP_FAILED)
+      return false;
+
+   struct io_uring_buf_reg Reg;
+   memset(&Reg, 0, sizeof(Reg));
+   Reg.ring_addr = reinterpret_cast<uint64_t>(m_pBufRing);
+   Reg.ring_entries = uCount;
+   Reg.bgid = uGroupId;
+
+   if (syscall(__NR_io_uring_register, m_RingFd, IORING_REGISTER_PBUF_RING, &Reg, 1) < 0)
+   {
+      munmap(m_pBufRing, m_uBufRingSize);
+      m_pBufRing = static_cast<struct io_uring_buf_ring*>(MAP_FAILED);
+      return false;
+   }
+
+   m_uBufRingMask = uCount - 1;
+   m_uBufferSize = uSize;
+   m_vecBuffers.assign(static_cast<size_t>(uCount) * uSize, 0);
+
+   m_pBufRing->tail = 0;
+   for (unsigned uId = 0; uId < uCount; ++uId)
+      RecycleBuffer(static_cast<uint16_t>(uId));
+
+   return true;
+}
+
+void CIoUring::RecycleBuffer(const uint16_t uBufferId)
+{
+   const uint16_t uTail = m_pBufRing->tail;
+   // not m_pBufRing->bufs : in C++ the kernel header's flexible array member
+   // is shifted by the empty struct __DECLARE_FLEX_ARRAY wraps it in
+   struct io_uring_buf& Buf = reinterpret_cast<struct io_uring_buf*>(m_pBufRing)[uTail & m_uBufRingMask];
+
+   Buf.addr = reinterpret_cast<uint64_t>(GetBuffer(uBufferId));
+   Buf.len = m_uBufferSize;
+   Buf.bid = uBufferId;
+
+   __atomic_store_n(&m_pBufRing->tail, static_cast<uint16_t>(uTail + 1), __ATOMIC_RELEASE);
+}
+
+void CIoUring::Release()
+{
+   if (m_pBufRing != MAP_FAILED)
+      munmap(m_pBufRing, m_uBufRingSize);
+   m_pBufRing = static_cast<struct io_uring_buf_ring*>(MAP_FAILED);
+
+   if (m_pSqes != MAP_FAILED)
+      munmap(m_pSqes, m_Params.sq_entries * sizeof(struct io_uring_sqe));
+   m_pSqes = static_cast<struct io_uring_sqe*>(MAP_FAILED);
+
+   if (m_pCqRing != MAP_FAILED && m_pCqRing != m_pSqRing)
+      munmap(m_pCqRing, m_uCqRingSize);
+   m_pCqRing = MAP_FAILED;
+
+   if (m_pSqRing != MAP_FAILED)
+      munmap(m_pSqRing, m_uSqRingSize);
+   m_pSqRing = MAP_FAILED;
+
+   if (m_RingFd >= 0)
+      close(m_RingFd);
+   m_RingFd = -1;
+}
+
+CIoUring::~CIoUring()
+{
+   Release();
+}
+#endif
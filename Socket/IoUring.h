@@ -0,0 +1,101 @@
+/*
+* @file IoUring.h
+* @brief minimal io_uring wrapper (raw system calls, no liburing dependency)
+* @date 2026-10-17
+*
+* Only what the event-driven servers need : a submission/completion ring with
+* timed waits and a provided buffer ring for multishot receives.
+*/
+
+#ifdef IO_URING
+#ifndef INCLUDE_IOURING_H_
+#define INCLUDE_IOURING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <linux/io_uring.h>
+
+class CIoUring
+{
+public:
+   CIoUring();
+   ~CIoUring();
+
+   CIoUring(const CIoUring&) = delete;
+   CIoUring& operator=(const CIoUring&) = delete;
+
+   /* returns false (errno is set) if the running kernel can't provide the ring */
+   bool Init(const unsigned uEntries);
+
+   /* returns nullptr when the submission queue is full, Submit() must be called then */
+   struct io_uring_sqe* GetSqe();
+
+   /* submits the queued entries and waits for at least uWaitNr completions or
+    * iTimeoutMsec milliseconds (-1 waits indefinitely). Returns -1 on error. */
+   int Submit(const unsigned uWaitNr = 0, const int iTimeoutMsec = -1);
+
+   /* calls fnHandler(const io_uring_cqe&) for each available completion */
+   template <typename Handler>
+   unsigned ForEachCompletion(Handler fnHandler)
+   {
+      unsigned uHead = *m_pCqHead;
+      unsigned uCount = 0;
+
+      while (uHead != __atomic_load_n(m_pCqTail, __ATOMIC_ACQUIRE))
+      {
+         // copy : the slot is given back to the kernel before the handler returns
+         const struct io_uring_cqe Cqe = m_pCqes[uHead & m_uCqMask];
+         __atomic_store_n(m_pCqHead, ++uHead, __ATOMIC_RELEASE);
+
+         fnHandler(Cqe);
+         ++uCount;
+      }
+
+      return uCount;
+   }
+
+   /* provided buffers : uCount (power of 2) buffers of uSize bytes for group uGroupId */
+   bool SetUpBufferRing(const uint16_t uGroupId, const unsigned uCount, const unsigned uSize);
+   char* GetBuffer(const uint16_t uBufferId) { return m_vecBuffers.data() + uBufferId * m_uBufferSize; }
+   void RecycleBuffer(const uint16_t uBufferId);
+
+   /* number of io_uring_enter calls issued so far */
+   unsigned long long GetEnterCount() const { return m_uEnterCount; }
+
+protected:
+   void Release();
+
+   int m_RingFd;
+
+   struct io_uring_params m_Params;
+
+   void*  m_pSqRing;
+   size_t m_uSqRingSize;
+   void*  m_pCqRing;
+   size_t m_uCqRingSize;
+
+   unsigned*             m_pSqHead;
+   unsigned*             m_pSqTail;
+   unsigned*             m_pSqArray;
+   unsigned              m_uSqMask;
+   unsigned              m_uSqeTail; // local tail, published by Submit()
+   struct io_uring_sqe*  m_pSqes;
+
+   unsigned*             m_pCqHead;
+   unsigned*             m_pCqTail;
+   unsigned              m_uCqMask;
+   struct io_uring_cqe*  m_pCqes;
+
+   struct io_uring_buf_ring* m_pBufRing;
+   size_t                    m_uBufRingSize;
+   unsigned                  m_uBufRingMask;
+   unsigned                  m_uBufferSize;
+   std::vector<char>         m_vecBuffers;
+
+   unsigned long long m_uEnterCount;
+};
+
+#endif
+#endif
@@ -0,0 +1,343 @@
+/**
+* @file MessageFramer.cpp
+* @brief implementation of the length-prefixed message framing
+*/
+
+#include "MessageFramer.h"
+
+namespace
+{
+   const size_t UINT16_MAX_LENGTH = 0xFFFF;
+   const size_t VARINT_MAX_BYTES = 10; // 64 bits, 7 per byte
+}
+
+const size_t CMessageFramer::DEFAULT_MAX_FRAME_SIZE;
+const size_t CMessageFramer::DEFAULT_READ_SIZE;
+const size_t CMessageFramer::MAX_HEADER_SIZE;
+const int    CMessageFramer::PEER_SHUTDOWN;
+const int    CMessageFramer::RECEIVE_ERROR;
+const int    CMessageFramer::FRAME_TOO_LARGE;
+
+CMessageFramer::CMessageFramer(const ReceiveFnCallback& fnReceive,
+                               const SendFnCallback& fnSend,
+                               const PrefixType ePrefix /*= PREFIX_UINT32*/,
+                               const size_t uMaxFrameSize /*= DEFAULT_MAX_FRAME_SIZE*/,
+                               const size_t uReadSize /*= DEFAULT_READ_SIZE*/) :
+   m_fnReceive(fnReceive),
+   m_fnSend(fnSend),
+   m_ePrefix(ePrefix),
+   m_uMaxFrameSize(ePrefix == PREFIX_UINT16 ? std::min(uMaxFrameSize, UINT16_MAX_LENGTH) : uMaxFrameSize),
+   m_uReadSize(std::max<size_t>(uReadSize, MAX_HEADER_SIZE)),
+   m_uInBegin(0),
+   m_uInEnd(0),
+   m_uReceiveCalls(0),
+   m_uSendCalls(0)
+{
+}
+
+CMessageFramer CMessageFramer::ForClient(const CTCPClient& Client, const PrefixType ePrefix /*= PREFIX_UINT32*/,
+                                         const size_t uMaxFrameSize /*= DEFAULT_MAX_FRAME_SIZE*/)
+{
+   return CMessageFramer(
+      [&Client](char* pData, const size_t uSize) { return Client.Receive(pData, uSize, false); },
+      [&Client](const ASocket::ConstBuffer* pBuffers, const size_t uCount) { return Client.Send(pBuffers, uCount); },
+      ePrefix, uMaxFrameSize);
+}
+
+CMessageFramer CMessageFramer::ForServer(const CTCPServer& Server, const ASocket::Socket ClientSocket,
+                                         const PrefixType ePrefix /*= PREFIX_UINT32*/,
+                                         const size_t uMaxFrameSize /*= DEFAULT_MAX_FRAME_SIZE*/)
+{
+   return CMessageFramer(
+      [&Server, ClientSocket](char* pData, const size_t uSize)
+      {
+         return Server.Receive(ClientSocket, pData, uSize, false);
+      },
+      [&Server, ClientSocket](const ASocket::ConstBuffer* pBuffers, const size_t uCount)
+      {
+         return Server.Send(ClientSocket, pBuffers, uCount);
+      },
+      ePrefix, uMaxFrameSize);
+}
+
+#ifdef OPENSSL
+namespace
+{
+   /* there is no vectored SSL_write : the buffers are joined so that they make full records
+    * instead of one record (and one write) per buffer */
+   class CJoinedSend
+   {
+   public:
+      typedef std::function<bool(const char*, const size_t)> SendFn;
+
+      explicit CJoinedSend(const SendFn& fnSend) : m_fnSend(fnSend) {}
+
+      bool operator()(const ASocket::ConstBuffer* pBuffers, const size_t uCount)
+      {
+         if (uCount == 1)
+            return m_fnSend(pBuffers[0].m_pData, pBuffers[0].m_uSize);
+
+         m_vecJoined.clear();
+         for (size_t i = 0; i < uCount; ++i)
+            m_vecJoined.insert(m_vecJoined.end(), pBuffers[i].m_pData, pBuffers[i].m_pData + pBuffers[i].m_uSize);
+
+         return m_fnSend(m_vecJoined.data(), m_vecJoined.size());
+      }
+
+   private:
+      SendFn            m_fnSend;
+      std::vector<char> m_vecJoined; // kept between flushes
+   };
+}
+
+CMessageFramer CMessageFramer::ForClient(const CTCPSSLClient& Client, const PrefixType ePrefix /*= PREFIX_UINT32*/,
+                                         const size_t uMaxFrameSize /*= DEFAULT_MAX_FRAME_SIZE*/)
+{
+   return CMessageFramer(
+      [&Client](char* pData, const size_t uSize) { return Client.Receive(pData, uSize, false); },
+      CJoinedSend([&Client](const char* pData, const size_t uSize) { return Client.Send(pData, uSize); }),
+      ePrefix, uMaxFrameSize);
+}
+
+CMessageFramer CMessageFramer::ForServer(const CTCPSSLServer& Server, const ASecureSocket::SSLSocket& ClientSocket,
+                                         const PrefixType ePrefix /*= PREFIX_UINT32*/,
+                                         const size_t uMaxFrameSize /*= DEFAULT_MAX_FRAME_SIZE*/)
+{
+   return CMessageFramer(
+      [&Server, &ClientSocket](char* pData, const size_t uSize)
+      {
+         return Server.Receive(ClientSocket, pData, uSize, false);
+      },
+      CJoinedSend([&Server, &ClientSocket](const char* pData, const size_t uSize)
+      {
+         return Server.Send(ClientSocket, pData, uSize);
+      }),
+      ePrefix, uMaxFrameSize);
+}
+#endif
+
+size_t CMessageFramer::EncodeLength(const PrefixType ePrefix, size_t uLength, char* pHeader)
+{
+   unsigned char* pBytes = reinterpret_cast<unsigned char*>(pHeader);
+
+   switch (ePrefix)
+   {
+   case PREFIX_UINT16:
+      pBytes[0] = static_cast<unsigned char>(uLength >> 8);
+      pBytes[1] = static_cast<unsigned char>(uLength);
+      return 2;
+
+   case PREFIX_UINT32:
+      pBytes[0] = static_cast<unsigned char>(uLength >> 24);
+      pBytes[1] = static_cast<unsigned char>(uLength >> 16);
+      pBytes[2] = static_cast<unsigned char>(uLength >> 8);
+      pBytes[3] = static_cast<unsigned char>(uLength);
+      return 4;
+
+   case PREFIX_VARINT:
+   default:
+   {
+      size_t uBytes = 0;
+      do
+      {
+         unsigned char ucByte = static_cast<unsigned char>(uLength & 0x7F);
+         uLength >>= 7;
+         if (uLength != 0)
+            ucByte |= 0x80;
+         pBytes[uBytes++] = ucByte;
+      } while (uLength != 0);
+      return uBytes;
+   }
+   }
+}
+
+CMessageFramer::ParseResult CMessageFramer::ParseFrame(FrameView& Frame, size_t& uNeeded)
+{
+   const unsigned char* pBytes = reinterpret_cast<const unsigned char*>(m_vecIn.data() + m_uInBegin);
+   const size_t uAvailable = m_uInEnd - m_uInBegin;
+
+   uNeeded = 0;
+   size_t uHeaderSize = 0;
+   unsigned long long ullLength = 0;
+
+   switch (m_ePrefix)
+   {
+   case PREFIX_UINT16:
+      uHeaderSize = 2;
+      if (uAvailable < uHeaderSize)
+         return PARSE_INCOMPLETE;
+      ullLength = (static_cast<unsigned long long>(pBytes[0]) << 8) | pBytes[1];
+      break;
+
+   case PREFIX_UINT32:
+      uHeaderSize = 4;
+      if (uAvailable < uHeaderSize)
+         return PARSE_INCOMPLETE;
+      ullLength = (static_cast<unsigned long long>(pBytes[0]) << 24) |
+                  (static_cast<unsigned long long>(pBytes[1]) << 16) |
+                  (static_cast<unsigned long long>(pBytes[2]) << 8) |
+                   static_cast<unsigned long long>(pBytes[3]);
+      break;
+
+   case PREFIX_VARINT:
+   default:
+   {
+      bool bComplete = false;
+      for (unsigned uShift = 0; uHeaderSize < VARINT_MAX_BYTES; uShift += 7)
+      {
+         if (uHeaderSize == uAvailable)
+            return PARSE_INCOMPLETE;
+
+         const unsigned char ucByte = pBytes[uHeaderSize++];
+         ullLength |= static_cast<unsigned long long>(ucByte & 0x7F) << uShift;
+
+         // checked as we go so that a corrupted header doesn't overflow
+         if (ullLength > m_uMaxFrameSize)
+            return PARSE_TOO_LARGE;
+
+         if (!(ucByte & 0x80))
+         {
+            bComplete = true;
+            break;
+         }
+      }
+      if (!bComplete)
+         return PARSE_TOO_LARGE;
+      break;
+   }
+   }
+
+   if (ullLength > m_uMaxFrameSize)
+      return PARSE_TOO_LARGE;
+
+   const size_t uFrameSize = uHeaderSize + static_cast<size_t>(ullLength);
+   if (uAvailable < uFrameSize)
+   {
+      uNeeded = uFrameSize;
+      return PARSE_INCOMPLETE;
+   }
+
+   Frame.m_pData = m_vecIn.data() + m_uInBegin + uHeaderSize;
+   Frame.m_uSize = static_cast<size_t>(ullLength);
+   m_uInBegin += uFrameSize;
+
+   return PARSE_FRAME;
+}
+
+int CMessageFramer::FillBuffer(const size_t uNeeded)
+{
+   // the views handed out are no longer valid : the partial frame moves to the front
+   const size_t uPending = m_uInEnd - m_uInBegin;
+   if (m_uInBegin > 0)
+   {
+      if (uPending > 0)
+         memmove(m_vecIn.data(), m_vecIn.data() + m_uInBegin, uPending);
+      m_uInBegin = 0;
+      m_uInEnd = uPending;
+   }
+
+   // room for a whole read, or for the rest of a large frame in as few reads as possible
+   const size_t uWanted = std::max(uNeeded, uPending + m_uReadSize);
+   if (m_vecIn.size() < uWanted)
+      m_vecIn.resize(uWanted);
+
+   ++m_uReceiveCalls;
+   int nRecvd = m_fnReceive(m_vecIn.data() + m_uInEnd, m_vecIn.size() - m_uInEnd);
+   if (nRecvd > 0)
+      m_uInEnd += static_cast<size_t>(nRecvd);
+
+   return nRecvd;
+}
+
+int CMessageFramer::Receive(std::vector<FrameView>& vecFrames)
+{
+   vecFrames.clear();
+
+   for (;;)
+   {
+      FrameView Frame;
+      size_t uNeeded = 0;
+      ParseResult eResult;
+
+      while ((eResult = ParseFrame(Frame, uNeeded)) == PARSE_FRAME)
+         vecFrames.push_back(Frame);
+
+      if (!vecFrames.empty())
+         return static_cast<int>(vecFrames.size());
+
+      if (eResult == PARSE_TOO_LARGE)
+         return FRAME_TOO_LARGE;
+
+      int nRecvd = FillBuffer(uNeeded);
+      if (nRecvd == 0)
+         return PEER_SHUTDOWN;
+      if (nRecvd < 0)
+         return RECEIVE_ERROR;
+   }
+}
+
+int CMessageFramer::Receive(FrameView& Frame)
+{
+   for (;;)
+   {
+      size_t uNeeded = 0;
+      ParseResult eResult = ParseFrame(Frame, uNeeded);
+
+      if (eResult == PARSE_FRAME)
+         return 1;
+
+      if (eResult == PARSE_TOO_LARGE)
+         return FRAME_TOO_LARGE;
+
+      int nRecvd = FillBuffer(uNeeded);
+      if (nRecvd == 0)
+         return PEER_SHUTDOWN;
+      if (nRecvd < 0)
+         return RECEIVE_ERROR;
+   }
+}
+
+bool CMessageFramer::Queue(const char* pData, const size_t uSize)
+{
+   if ((!pData && uSize) || uSize > m_uMaxFrameSize)
+      return false;
+
+   OutFrame Frame;
+   Frame.m_uHeaderOffset = m_vecOutHeaders.size();
+   m_vecOutHeaders.resize(Frame.m_uHeaderOffset + MAX_HEADER_SIZE);
+   Frame.m_uHeaderSize = EncodeLength(m_ePrefix, uSize, m_vecOutHeaders.data() + Frame.m_uHeaderOffset);
+   m_vecOutHeaders.resize(Frame.m_uHeaderOffset + Frame.m_uHeaderSize);
+   Frame.m_pData = pData;
+   Frame.m_uSize = uSize;
+
+   m_vecOutFrames.push_back(Frame);
+   return true;
+}
+
+bool CMessageFramer::Flush()
+{
+   if (m_vecOutFrames.empty())
+      return true;
+
+   // the headers are addressed once they can't move anymore
+   m_vecOutBuffers.clear();
+   for (const OutFrame& Frame : m_vecOutFrames)
+   {
+      m_vecOutBuffers.push_back({ m_vecOutHeaders.data() + Frame.m_uHeaderOffset, Frame.m_uHeaderSize });
+      if (Frame.m_uSize > 0)
+         m_vecOutBuffers.push_back({ Frame.m_pData, Frame.m_uSize });
+   }
+
+   ++m_uSendCalls;
+   bool bSent = m_fnSend(m_vecOutBuffers.data(), m_vecOutBuffers.size());
+
+   m_vecOutFrames.clear();
+   m_vecOutHeaders.clear();
+
+   return bSent;
+}
+
+bool CMessageFramer::Send(const char* pData, const size_t uSize)
+{
+   return Queue(pData, uSize) && Flush();
+}
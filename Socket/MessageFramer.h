@@ -0,0 +1,142 @@
+/*
+* @file MessageFramer.h
+* @brief length-prefixed message framing over a connected TCP or TCP/SSL socket
+* @date 2026-10-17
+*
+* Each frame is its payload preceded by its length : a 16 or 32 bits big endian
+* integer or a varint (LEB128, 7 bits per byte). Incoming bytes are read with large
+* recv calls into a stream buffer, every complete frame it holds is returned at once
+* as a view on that buffer (no copy). Queued frames leave in a single write, the
+* payloads aren't copied either on plain TCP (vectored send).
+*/
+
+#ifndef INCLUDE_MESSAGEFRAMER_H_
+#define INCLUDE_MESSAGEFRAMER_H_
+
+#include <functional>
+#include <vector>
+
+#include "TCPClient.h"
+#include "TCPServer.h"
+
+#ifdef OPENSSL
+#include "TCPSSLClient.h"
+#include "TCPSSLServer.h"
+#endif
+
+class CMessageFramer
+{
+public:
+   enum PrefixType
+   {
+      PREFIX_UINT16,
+      PREFIX_UINT32,
+      PREFIX_VARINT
+   };
+
+   /* reads what is available, like Receive with bReadFully = false : > 0 bytes read,
+    * 0 peer shut down, < 0 error */
+   typedef std::function<int(char*, const size_t)> ReceiveFnCallback;
+   /* writes all the buffers in order */
+   typedef std::function<bool(const ASocket::ConstBuffer*, const size_t)> SendFnCallback;
+
+   /* a received frame : points into the stream buffer, valid until the next Receive */
+   struct FrameView
+   {
+      const char* m_pData;
+      size_t      m_uSize;
+   };
+
+   static const size_t DEFAULT_MAX_FRAME_SIZE = 16 * 1024 * 1024;
+   static const size_t DEFAULT_READ_SIZE = 64 * 1024;
+
+   // Receive return values (besides the frame count)
+   static const int PEER_SHUTDOWN = 0;
+   static const int RECEIVE_ERROR = -1;
+   static const int FRAME_TOO_LARGE = -2; // the stream can't be resynchronized, close it
+
+   CMessageFramer(const ReceiveFnCallback& fnReceive,
+                  const SendFnCallback& fnSend,
+                  const PrefixType ePrefix = PREFIX_UINT32,
+                  const size_t uMaxFrameSize = DEFAULT_MAX_FRAME_SIZE,
+                  const size_t uReadSize = DEFAULT_READ_SIZE);
+
+   /* framers bound to a connected client or to a client of a server, which must outlive them */
+   static CMessageFramer ForClient(const CTCPClient& Client, const PrefixType ePrefix = PREFIX_UINT32,
+                                   const size_t uMaxFrameSize = DEFAULT_MAX_FRAME_SIZE);
+   static CMessageFramer ForServer(const CTCPServer& Server, const ASocket::Socket ClientSocket,
+                                   const PrefixType ePrefix = PREFIX_UINT32,
+                                   const size_t uMaxFrameSize = DEFAULT_MAX_FRAME_SIZE);
+#ifdef OPENSSL
+   static CMessageFramer ForClient(const CTCPSSLClient& Client, const PrefixType ePrefix = PREFIX_UINT32,
+                                   const size_t uMaxFrameSize = DEFAULT_MAX_FRAME_SIZE);
+   static CMessageFramer ForServer(const CTCPSSLServer& Server, const ASecureSocket::SSLSocket& ClientSocket,
+                                   const PrefixType ePrefix = PREFIX_UINT32,
+                                   const size_t uMaxFrameSize = DEFAULT_MAX_FRAME_SIZE);
+#endif
+
+   /* returns the frames already buffered, reading (once) only if there is none. Blocks until
+    * one frame is complete. Returns the frame count or one of the values above. */
+   int Receive(std::vector<FrameView>& vecFrames);
+
+   /* one frame at a time, from the same stream buffer */
+   int Receive(FrameView& Frame);
+
+   /* the payload isn't copied : it must stay valid until Flush */
+   bool Queue(const char* pData, const size_t uSize);
+
+   /* sends the queued frames with a single write */
+   bool Flush();
+
+   bool Send(const char* pData, const size_t uSize);
+   bool Send(const std::string& strData) { return Send(strData.data(), strData.size()); }
+
+   size_t GetQueuedCount() const { return m_vecOutFrames.size(); }
+   size_t GetBufferedBytes() const { return m_uInEnd - m_uInBegin; }
+
+   /* transport calls issued so far, to compare with the frame counts */
+   unsigned long long GetReceiveCalls() const { return m_uReceiveCalls; }
+   unsigned long long GetSendCalls() const { return m_uSendCalls; }
+
+   static size_t EncodeLength(const PrefixType ePrefix, const size_t uLength, char* pHeader);
+   static const size_t MAX_HEADER_SIZE = 10;
+
+protected:
+   enum ParseResult
+   {
+      PARSE_FRAME,
+      PARSE_INCOMPLETE,
+      PARSE_TOO_LARGE
+   };
+
+   struct OutFrame
+   {
+      size_t      m_uHeaderOffset; // in m_vecOutHeaders, which may grow until Flush
+      size_t      m_uHeaderSize;
+      const char* m_pData;
+      size_t      m_uSize;
+   };
+
+   /* uNeeded : when incomplete, the bytes the whole frame takes if its header is complete */
+   ParseResult ParseFrame(FrameView& Frame, size_t& uNeeded);
+   int FillBuffer(const size_t uNeeded);
+
+   ReceiveFnCallback m_fnReceive;
+   SendFnCallback    m_fnSend;
+   PrefixType        m_ePrefix;
+   size_t            m_uMaxFrameSize;
+   size_t            m_uReadSize;
+
+   std::vector<char> m_vecIn;
+   size_t            m_uInBegin; // first byte not parsed yet
+   size_t            m_uInEnd;
+
+   std::vector<char>                  m_vecOutHeaders;
+   std::vector<OutFrame>              m_vecOutFrames;
+   std::vector<ASocket::ConstBuffer>  m_vecOutBuffers;
+
+   unsigned long long m_uReceiveCalls;
+   unsigned long long m_uSendCalls;
+};
+
+#endif
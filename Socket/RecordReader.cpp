@@ -0,0 +1,400 @@
+/**
+* @file RecordReader.cpp
+* @brief implementation of the delimiter-terminated record reader and its scan kernels
+*/
+
+#include "RecordReader.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RECORD_READER_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace
+{
+   /* memchr finds the first delimiter byte, the rest is compared */
+   size_t FindScalar(const char* pData, const size_t uSize, const char* pDelimiter, const size_t uDelimiterSize)
+   {
+      if (uDelimiterSize == 0 || uSize < uDelimiterSize)
+         return CRecordReader::NOT_FOUND;
+
+      const char* pCursor = pData;
+      const char* pLastStart = pData + uSize - uDelimiterSize;
+      while (pCursor <= pLastStart)
+      {
+         const char* pFound = static_cast<const char*>(memchr(pCursor, pDelimiter[0], pLastStart - pCursor + 1));
+         if (pFound == nullptr)
+            break;
+
+         if (memcmp(pFound + 1, pDelimiter + 1, uDelimiterSize - 1) == 0)
+            return static_cast<size_t>(pFound - pData);
+
+         pCursor = pFound + 1;
+      }
+      return CRecordReader::NOT_FOUND;
+   }
+
+#ifdef RECORD_READER_X86_KERNELS
+   /* each lane compares its byte with the first delimiter byte and the byte at the
+    * delimiter's end with its last byte : only the lanes matching both are verified.
+    * The main loops test 4 aligned blocks at once, text between delimiters rarely matches. */
+   inline bool VerifyCandidate(const char* pCandidate, const char* pDelimiter, const size_t uDelimiterSize)
+   {
+      return uDelimiterSize <= 2 || memcmp(pCandidate + 1, pDelimiter + 1, uDelimiterSize - 2) == 0;
+   }
+
+   template <bool bSingleByte>
+   __attribute__((target("sse2")))
+   inline __m128i MatchSSE2(const char* pData, const size_t uLast, const __m128i First, const __m128i Last)
+   {
+      const __m128i BlockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pData));
+      if (bSingleByte)
+         return _mm_cmpeq_epi8(BlockFirst, First);
+
+      const __m128i BlockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pData + uLast));
+      return _mm_and_si128(_mm_cmpeq_epi8(BlockFirst, First), _mm_cmpeq_epi8(BlockLast, Last));
+   }
+
+   template <bool bSingleByte>
+   __attribute__((target("sse2")))
+   size_t FindSSE2(const char* pData, const size_t uSize, const char* pDelimiter, const size_t uDelimiterSize)
+   {
+      const size_t uLast = uDelimiterSize - 1;
+      const __m128i First = _mm_set1_epi8(pDelimiter[0]);
+      const __m128i Last = _mm_set1_epi8(pDelimiter[uLast]);
+
+      size_t i = 0;
+      // one unaligned block, then the main loop loads aligned blocks (a few bytes are scanned twice)
+      if (uLast + 16 <= uSize)
+      {
+         unsigned uMask = static_cast<unsigned>(_mm_movemask_epi8(MatchSSE2<bSingleByte>(pData, uLast, First, Last)));
+         while (uMask != 0)
+         {
+            const size_t uBit = static_cast<size_t>(__builtin_ctz(uMask));
+            if (VerifyCandidate(pData + uBit, pDelimiter, uDelimiterSize))
+               return uBit;
+            uMask &= uMask - 1;
+         }
+         i = 16 - (reinterpret_cast<uintptr_t>(pData) & 15);
+      }
+
+      // the 4 blocks are only tested against the first delimiter byte, the last byte is checked
+      // in the blocks where it occurs
+      for (; i + uLast + 64 <= uSize; i += 64)
+      {
+         const __m128i Blocks[] = { _mm_cmpeq_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(pData + i)), First),
+                                    _mm_cmpeq_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(pData + i + 16)), First),
+                                    _mm_cmpeq_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(pData + i + 32)), First),
+                                    _mm_cmpeq_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(pData + i + 48)), First) };
+         const __m128i Any = _mm_or_si128(_mm_or_si128(Blocks[0], Blocks[1]), _mm_or_si128(Blocks[2], Blocks[3]));
+         if (_mm_movemask_epi8(Any) == 0)
+            continue;
+
+         for (size_t uBlock = 0; uBlock < 4; ++uBlock)
+         {
+            __m128i Match = Blocks[uBlock];
+            if (!bSingleByte)
+               Match = _mm_and_si128(Match, _mm_cmpeq_epi8(
+                  _mm_loadu_si128(reinterpret_cast<const __m128i*>(pData + i + uBlock * 16 + uLast)), Last));
+
+            unsigned uMask = static_cast<unsigned>(_mm_movemask_epi8(Match));
+            while (uMask != 0)
+            {
+               const size_t uAt = i + uBlock * 16 + static_cast<size_t>(__builtin_ctz(uMask));
+               if (VerifyCandidate(pData + uAt, pDelimiter, uDelimiterSize))
+                  return uAt;
+               uMask &= uMask - 1;
+            }
+         }
+      }
+
+      for (; i + uLast + 16 <= uSize; i += 16)
+      {
+         unsigned uMask = static_cast<unsigned>(_mm_movemask_epi8(MatchSSE2<bSingleByte>(pData + i, uLast, First, Last)));
+         while (uMask != 0)
+         {
+            const size_t uBit = static_cast<size_t>(__builtin_ctz(uMask));
+            if (VerifyCandidate(pData + i + uBit, pDelimiter, uDelimiterSize))
+               return i + uBit;
+            uMask &= uMask - 1;
+         }
+      }
+
+      const size_t uTail = FindScalar(pData + i, uSize - i, pDelimiter, uDelimiterSize);
+      return (uTail == CRecordReader::NOT_FOUND) ? uTail : i + uTail;
+   }
+
+   template <bool bSingleByte>
+   __attribute__((target("avx2")))
+   inline __m256i MatchAVX2(const char* pData, const size_t uLast, const __m256i First, const __m256i Last)
+   {
+      const __m256i BlockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pData));
+      if (bSingleByte)
+         return _mm256_cmpeq_epi8(BlockFirst, First);
+
+      const __m256i BlockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pData + uLast));
+      return _mm256_and_si256(_mm256_cmpeq_epi8(BlockFirst, First), _mm256_cmpeq_epi8(BlockLast, Last));
+   }
+
+   template <bool bSingleByte>
+   __attribute__((target("avx2")))
+   size_t FindAVX2(const char* pData, const size_t uSize, const char* pDelimiter, const size_t uDelimiterSize)
+   {
+      const size_t uLast = uDelimiterSize - 1;
+      const __m256i First = _mm256_set1_epi8(pDelimiter[0]);
+      const __m256i Last = _mm256_set1_epi8(pDelimiter[uLast]);
+
+      size_t i = 0;
+
+      // one unaligned block, then the main loop loads aligned blocks (a few bytes are scanned twice)
+      if (uLast + 32 <= uSize)
+      {
+         unsigned uMask = static_cast<unsigned>(_mm256_movemask_epi8(MatchAVX2<bSingleByte>(pData, uLast, First, Last)));
+         while (uMask != 0)
+         {
+            const size_t uBit = static_cast<size_t>(__builtin_ctz(uMask));
+            if (VerifyCandidate(pData + uBit, pDelimiter, uDelimiterSize))
+               return uBit;
+            uMask &= uMask - 1;
+         }
+         i = 32 - (reinterpret_cast<uintptr_t>(pData) & 31);
+      }
+
+      // the 4 blocks are only tested against the first delimiter byte, the last byte is checked
+      // in the blocks where it occurs
+      for (; i + uLast + 128 <= uSize; i += 128)
+      {
+         const __m256i Blocks[] = { _mm256_cmpeq_epi8(_mm256_load_si256(reinterpret_cast<const __m256i*>(pData + i)), First),
+                                    _mm256_cmpeq_epi8(_mm256_load_si256(reinterpret_cast<const __m256i*>(pData + i + 32)), First),
+                                    _mm256_cmpeq_epi8(_mm256_load_si256(reinterpret_cast<const __m256i*>(pData + i + 64)), First),
+                                    _mm256_cmpeq_epi8(_mm256_load_si256(reinterpret_cast<const __m256i*>(pData + i + 96)), First) };
+         const __m256i Any = _mm256_or_si256(_mm256_or_si256(Blocks[0], Blocks[1]), _mm256_or_si256(Blocks[2], Blocks[3]));
+         if (_mm256_testz_si256(Any, Any))
+            continue;
+
+         for (size_t uBlock = 0; uBlock < 4; ++uBlock)
+         {
+            __m256i Match = Blocks[uBlock];
+            if (!bSingleByte)
+               Match = _mm256_and_si256(Match, _mm256_cmpeq_epi8(
+                  _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pData + i + uBlock * 32 + uLast)), Last));
+
+            unsigned uMask = static_cast<unsigned>(_mm256_movemask_epi8(Match));
+            while (uMask != 0)
+            {
+               const size_t uAt = i + uBlock * 32 + static_cast<size_t>(__builtin_ctz(uMask));
+               if (VerifyCandidate(pData + uAt, pDelimiter, uDelimiterSize))
+                  return uAt;
+               uMask &= uMask - 1;
+            }
+         }
+      }
+
+      // the rest is shorter than 4 blocks
+      const size_t uTail = FindSSE2<bSingleByte>(pData + i, uSize - i, pDelimiter, uDelimiterSize);
+      return (uTail == CRecordReader::NOT_FOUND) ? uTail : i + uTail;
+   }
+#endif
+
+   CRecordReader::ScanKernel DetectScanKernel()
+   {
+#ifdef RECORD_READER_X86_KERNELS
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx2"))
+         return CRecordReader::SCAN_AVX2;
+      if (__builtin_cpu_supports("sse2"))
+         return CRecordReader::SCAN_SSE2;
+#endif
+      return CRecordReader::SCAN_SCALAR;
+   }
+
+   // chosen once, at startup
+   const CRecordReader::ScanKernel s_eScanKernel = DetectScanKernel();
+}
+
+const size_t CRecordReader::NOT_FOUND;
+const size_t CRecordReader::DEFAULT_MAX_RECORD_SIZE;
+const size_t CRecordReader::DEFAULT_READ_SIZE;
+const int    CRecordReader::PEER_SHUTDOWN;
+const int    CRecordReader::RECEIVE_ERROR;
+const int    CRecordReader::RECORD_TOO_LARGE;
+
+CRecordReader::CRecordReader(const ReceiveFnCallback& fnReceive,
+                             const std::string& strDelimiter /*= "\r\n"*/,
+                             const size_t uMaxRecordSize /*= DEFAULT_MAX_RECORD_SIZE*/,
+                             const size_t uReadSize /*= DEFAULT_READ_SIZE*/) :
+   m_fnReceive(fnReceive),
+   m_strDelimiter(strDelimiter.empty() ? std::string("\n") : strDelimiter),
+   m_uMaxRecordSize(uMaxRecordSize),
+   m_uReadSize(std::max<size_t>(uReadSize, 1)),
+   m_uBegin(0),
+   m_uScanned(0),
+   m_uEnd(0),
+   m_uReceiveCalls(0)
+{
+}
+
+CRecordReader CRecordReader::ForClient(const CTCPClient& Client, const std::string& strDelimiter /*= "\r\n"*/,
+                                       const size_t uMaxRecordSize /*= DEFAULT_MAX_RECORD_SIZE*/)
+{
+   return CRecordReader([&Client](char* pData, const size_t uSize) { return Client.Receive(pData, uSize, false); },
+                        strDelimiter, uMaxRecordSize);
+}
+
+CRecordReader CRecordReader::ForServer(const CTCPServer& Server, const ASocket::Socket ClientSocket,
+                                       const std::string& strDelimiter /*= "\r\n"*/,
+                                       const size_t uMaxRecordSize /*= DEFAULT_MAX_RECORD_SIZE*/)
+{
+   return CRecordReader([&Server, ClientSocket](char* pData, const size_t uSize)
+                        {
+                           return Server.Receive(ClientSocket, pData, uSize, false);
+                        },
+                        strDelimiter, uMaxRecordSize);
+}
+
+#ifdef OPENSSL
+CRecordReader CRecordReader::ForClient(const CTCPSSLClient& Client, const std::string& strDelimiter /*= "\r\n"*/,
+                                       const size_t uMaxRecordSize /*= DEFAULT_MAX_RECORD_SIZE*/)
+{
+   return CRecordReader([&Client](char* pData, const size_t uSize) { return Client.Receive(pData, uSize, false); },
+                        strDelimiter, uMaxRecordSize);
+}
+
+CRecordReader CRecordReader::ForServer(const CTCPSSLServer& Server, const ASecureSocket::SSLSocket& ClientSocket,
+                                       const std::string& strDelimiter /*= "\r\n"*/,
+                                       const size_t uMaxRecordSize /*= DEFAULT_MAX_RECORD_SIZE*/)
+{
+   return CRecordReader([&Server, &ClientSocket](char* pData, const size_t uSize)
+                        {
+                           return Server.Receive(ClientSocket, pData, uSize, false);
+                        },
+                        strDelimiter, uMaxRecordSize);
+}
+#endif
+
+CRecordReader::ScanKernel CRecordReader::GetScanKernel()
+{
+   return s_eScanKernel;
+}
+
+bool CRecordReader::IsScanKernelSupported(const ScanKernel eKernel)
+{
+   return eKernel <= s_eScanKernel;
+}
+
+size_t CRecordReader::Find(const char* pData, const size_t uSize, const char* pDelimiter, const size_t uDelimiterSize)
+{
+   // the C library's memchr is already vectorized : the kernels only pay off when the
+   // last delimiter byte filters out the false candidates
+   if (uDelimiterSize == 1)
+      return FindScalar(pData, uSize, pDelimiter, uDelimiterSize);
+
+   return Find(s_eScanKernel, pData, uSize, pDelimiter, uDelimiterSize);
+}
+
+size_t CRecordReader::Find(const ScanKernel eKernel, const char* pData, const size_t uSize,
+                           const char* pDelimiter, const size_t uDelimiterSize)
+{
+#ifdef RECORD_READER_X86_KERNELS
+   if (eKernel != SCAN_SCALAR && uDelimiterSize > 0 && uSize >= uDelimiterSize)
+   {
+      const bool bSingleByte = (uDelimiterSize == 1);
+      if (eKernel == SCAN_AVX2)
+         return bSingleByte ? FindAVX2<true>(pData, uSize, pDelimiter, uDelimiterSize)
+                            : FindAVX2<false>(pData, uSize, pDelimiter, uDelimiterSize);
+
+      return bSingleByte ? FindSSE2<true>(pData, uSize, pDelimiter, uDelimiterSize)
+                         : FindSSE2<false>(pData, uSize, pDelimiter, uDelimiterSize);
+   }
+#else
+   (void) eKernel;
+#endif
+   return FindScalar(pData, uSize, pDelimiter, uDelimiterSize);
+}
+
+void CRecordReader::SetDelimiter(const std::string& strDelimiter)
+{
+   if (strDelimiter.empty())
+      return;
+
+   m_strDelimiter = strDelimiter;
+   m_uScanned = 0;
+}
+
+int CRecordReader::FillBuffer()
+{
+   // the records handed out are no longer valid : the partial one moves to the front
+   const size_t uPending = m_uEnd - m_uBegin;
+   if (m_uBegin > 0)
+   {
+      if (uPending > 0)
+         memmove(m_vecBuffer.data(), m_vecBuffer.data() + m_uBegin, uPending);
+      m_uBegin = 0;
+      m_uEnd = uPending;
+   }
+
+   if (m_vecBuffer.size() < uPending + m_uReadSize)
+      m_vecBuffer.resize(uPending + m_uReadSize);
+
+   ++m_uReceiveCalls;
+   int nRecvd = m_fnReceive(m_vecBuffer.data() + m_uEnd, m_vecBuffer.size() - m_uEnd);
+   if (nRecvd > 0)
+      m_uEnd += static_cast<size_t>(nRecvd);
+
+   return nRecvd;
+}
+
+int CRecordReader::ReadUntil(RecordView& Record)
+{
+   const size_t uDelimiterSize = m_strDelimiter.size();
+
+   for (;;)
+   {
+      const size_t uFound = Find(m_vecBuffer.data() + m_uBegin + m_uScanned, m_uEnd - m_uBegin - m_uScanned,
+                                 m_strDelimiter.data(), uDelimiterSize);
+      if (uFound != NOT_FOUND)
+      {
+         Record.m_pData = m_vecBuffer.data() + m_uBegin;
+         Record.m_uSize = m_uScanned + uFound;
+         m_uBegin += Record.m_uSize + uDelimiterSize;
+         m_uScanned = 0;
+
+         if (Record.m_uSize > m_uMaxRecordSize)
+            return RECORD_TOO_LARGE;
+
+         return 1;
+      }
+
+      // the last bytes may be the beginning of a delimiter split across reads
+      const size_t uPending = m_uEnd - m_uBegin;
+      m_uScanned = (uPending >= uDelimiterSize) ? uPending - uDelimiterSize + 1 : 0;
+
+      if (m_uScanned > m_uMaxRecordSize)
+         return RECORD_TOO_LARGE;
+
+      int nRecvd = FillBuffer();
+      if (nRecvd == 0)
+         return PEER_SHUTDOWN;
+      if (nRecvd < 0)
+         return RECEIVE_ERROR;
+   }
+}
+
+int CRecordReader::Read(char* pData, const size_t uSize)
+{
+   if (!pData || !uSize)
+      return -2;
+
+   if (m_uEnd == m_uBegin)
+   {
+      ++m_uReceiveCalls;
+      return m_fnReceive(pData, uSize);
+   }
+
+   const size_t uCopied = std::min(uSize, m_uEnd - m_uBegin);
+   memcpy(pData, m_vecBuffer.data() + m_uBegin, uCopied);
+   m_uBegin += uCopied;
+   m_uScanned = 0;
+
+   return static_cast<int>(uCopied);
+}
@@ -0,0 +1,118 @@
+/*
+* @file RecordReader.h
+* @brief buffered delimiter-terminated record reader (text protocols, lines...)
+* @date 2026-10-17
+*
+* Incoming bytes are read with large recv calls into a buffer which is scanned for
+* the delimiter. Multi-byte delimiters are searched with SSE2 or AVX2 kernels, chosen
+* at runtime from what the CPU supports, or a memchr based scalar loop elsewhere.
+* Records are returned as views on the buffer (no copy), a partial record is only
+* scanned once.
+*/
+
+#ifndef INCLUDE_RECORDREADER_H_
+#define INCLUDE_RECORDREADER_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "TCPClient.h"
+#include "TCPServer.h"
+
+#ifdef OPENSSL
+#include "TCPSSLClient.h"
+#include "TCPSSLServer.h"
+#endif
+
+class CRecordReader
+{
+public:
+   /* reads what is available, like Receive with bReadFully = false : > 0 bytes read,
+    * 0 peer shut down, < 0 error */
+   typedef std::function<int(char*, const size_t)> ReceiveFnCallback;
+
+   /* a record without its delimiter : points into the buffer, valid until the next read */
+   struct RecordView
+   {
+      const char* m_pData;
+      size_t      m_uSize;
+   };
+
+   enum ScanKernel
+   {
+      SCAN_SCALAR,
+      SCAN_SSE2,
+      SCAN_AVX2
+   };
+
+   static const size_t NOT_FOUND = static_cast<size_t>(-1);
+   static const size_t DEFAULT_MAX_RECORD_SIZE = 64 * 1024;
+   static const size_t DEFAULT_READ_SIZE = 64 * 1024;
+
+   // ReadUntil return values (besides 1 : a record was read)
+   static const int PEER_SHUTDOWN = 0; // the bytes after the last delimiter are still buffered
+   static const int RECEIVE_ERROR = -1;
+   static const int RECORD_TOO_LARGE = -2;
+
+   explicit CRecordReader(const ReceiveFnCallback& fnReceive,
+                          const std::string& strDelimiter = "\r\n",
+                          const size_t uMaxRecordSize = DEFAULT_MAX_RECORD_SIZE,
+                          const size_t uReadSize = DEFAULT_READ_SIZE);
+
+   /* readers bound to a connected client or to a client of a server, which must outlive them */
+   static CRecordReader ForClient(const CTCPClient& Client, const std::string& strDelimiter = "\r\n",
+                                  const size_t uMaxRecordSize = DEFAULT_MAX_RECORD_SIZE);
+   static CRecordReader ForServer(const CTCPServer& Server, const ASocket::Socket ClientSocket,
+                                  const std::string& strDelimiter = "\r\n",
+                                  const size_t uMaxRecordSize = DEFAULT_MAX_RECORD_SIZE);
+#ifdef OPENSSL
+   static CRecordReader ForClient(const CTCPSSLClient& Client, const std::string& strDelimiter = "\r\n",
+                                  const size_t uMaxRecordSize = DEFAULT_MAX_RECORD_SIZE);
+   static CRecordReader ForServer(const CTCPSSLServer& Server, const ASecureSocket::SSLSocket& ClientSocket,
+                                  const std::string& strDelimiter = "\r\n",
+                                  const size_t uMaxRecordSize = DEFAULT_MAX_RECORD_SIZE);
+#endif
+
+   /* returns the next record, reading only when the buffer doesn't hold a complete one.
+    * Returns 1 or one of the values above. */
+   int ReadUntil(RecordView& Record);
+
+   /* the delimiter of the next records, the buffered bytes are kept */
+   void SetDelimiter(const std::string& strDelimiter);
+   const std::string& GetDelimiter() const { return m_strDelimiter; }
+
+   /* raw bytes after the records (e.g. a body announced in a header) : the buffered bytes
+    * first, then one Receive if there are none. Same return values as Receive. */
+   int Read(char* pData, const size_t uSize);
+
+   size_t GetBufferedBytes() const { return m_uEnd - m_uBegin; }
+   unsigned long long GetReceiveCalls() const { return m_uReceiveCalls; }
+
+   /* position of the first occurrence of a delimiter, or NOT_FOUND. The first overload uses
+    * memchr for a single byte and the best kernel the CPU supports otherwise, the second one
+    * a given kernel (it must be supported). */
+   static size_t Find(const char* pData, const size_t uSize, const char* pDelimiter, const size_t uDelimiterSize);
+   static size_t Find(const ScanKernel eKernel, const char* pData, const size_t uSize,
+                      const char* pDelimiter, const size_t uDelimiterSize);
+
+   static ScanKernel GetScanKernel();
+   static bool IsScanKernelSupported(const ScanKernel eKernel);
+
+protected:
+   int FillBuffer();
+
+   ReceiveFnCallback m_fnReceive;
+   std::string       m_strDelimiter;
+   size_t            m_uMaxRecordSize;
+   size_t            m_uReadSize;
+
+   std::vector<char> m_vecBuffer;
+   size_t            m_uBegin;   // start of the next record
+   size_t            m_uScanned; // bytes after m_uBegin known not to start a delimiter
+   size_t            m_uEnd;
+
+   unsigned long long m_uReceiveCalls;
+};
+
+#endif
@@ -0,0 +1,195 @@
+/**
+* @file SSLHandshakeDriver.cpp
+* @brief implementation of the non-blocking TLS handshake driver
+*/
+
+#ifdef OPENSSL
+#ifdef LINUX
+#include "SSLHandshakeDriver.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+   const size_t EVENTS_PER_WAIT = 1024;
+}
+
+CSSLHandshakeDriver::CSSLHandshakeDriver(const ASocket::LogFnCallback oLogger,
+                                         const ASocket::SettingsFlag eSettings /*= ASocket::ALL_FLAGS*/) :
+   m_oLog(oLogger),
+   m_eSettingsFlags(eSettings),
+   m_EpollFd(epoll_create1(EPOLL_CLOEXEC)),
+   m_vecEvents(EVENTS_PER_WAIT),
+   m_uTimeoutCount(0)
+{
+   if (m_EpollFd < 0 && (m_eSettingsFlags & ASocket::ENABLE_LOG))
+      m_oLog(ASocket::StringFormat("[SSLHandshakeDriver][Error] epoll_create1 failed : %s", strerror(errno)));
+}
+
+bool CSSLHandshakeDriver::Add(const ASocket::Socket Fd,
+                              const StepFnCallback& fnStep,
+                              const DoneFnCallback& fnDone,
+                              const size_t uTimeoutMsec)
+{
+   if (m_EpollFd < 0 || Fd == INVALID_SOCKET || !fnStep || m_mapHandshakes.count(Fd) != 0)
+      return false;
+
+   const int iFlags = fcntl(Fd, F_GETFL, 0);
+   if (iFlags < 0 || fcntl(Fd, F_SETFL, iFlags | O_NONBLOCK) < 0)
+   {
+      if (m_eSettingsFlags & ASocket::ENABLE_LOG)
+         m_oLog(ASocket::StringFormat("[SSLHandshakeDriver][Error] fcntl failed : %s", strerror(errno)));
+
+      return false;
+   }
+
+   // a client has its first flight to send and a server has to wait for it :
+   // both interests are polled until the first step tells which one matters
+   struct epoll_event Event;
+   memset(&Event, 0, sizeof(Event));
+   Event.events = EPOLLIN | EPOLLOUT;
+   Event.data.fd = Fd;
+
+   if (epoll_ctl(m_EpollFd, EPOLL_CTL_ADD, Fd, &Event) < 0)
+   {
+      if (m_eSettingsFlags & ASocket::ENABLE_LOG)
+         m_oLog(ASocket::StringFormat("[SSLHandshakeDriver][Error] epoll_ctl failed : %s", strerror(errno)));
+
+      fcntl(Fd, F_SETFL, iFlags);
+      return false;
+   }
+
+   Handshake& NewHandshake = m_mapHandshakes[Fd];
+   NewHandshake.m_fnStep = fnStep;
+   NewHandshake.m_fnDone = fnDone;
+   NewHandshake.m_iSavedFlags = iFlags;
+   NewHandshake.m_uEvents = Event.events;
+   NewHandshake.m_uDeadline = m_Deadlines.Arm(uTimeoutMsec, static_cast<uint64_t>(Fd));
+
+   return true;
+}
+
+int CSSLHandshakeDriver::Poll(const size_t msec)
+{
+   if (m_EpollFd < 0)
+      return -1;
+
+   // don't sleep past the nearest deadline
+   int iTimeout = (msec == ACCEPT_WAIT_INF_DELAY) ? -1 : static_cast<int>(msec);
+   if (m_Deadlines.GetCount() > 0)
+   {
+      const int iUntilDeadline = m_Deadlines.GetTimeoutMs();
+      if (iTimeout < 0 || iUntilDeadline < iTimeout)
+         iTimeout = iUntilDeadline;
+   }
+
+   int nEvents = epoll_wait(m_EpollFd, m_vecEvents.data(), static_cast<int>(m_vecEvents.size()), iTimeout);
+   if (nEvents < 0)
+   {
+      if (errno == EINTR)
+         return 0;
+
+      if (m_eSettingsFlags & ASocket::ENABLE_LOG)
+         m_oLog(ASocket::StringFormat("[SSLHandshakeDriver][Error] epoll_wait failed : %s", strerror(errno)));
+
+      return -1;
+   }
+
+   int nEnded = 0;
+   for (int i = 0; i < nEvents; ++i)
+   {
+      // an earlier callback of this batch may have removed it
+      const ASocket::Socket Fd = m_vecEvents[i].data.fd;
+      if (m_mapHandshakes.find(Fd) != m_mapHandshakes.end() && Step(Fd))
+         ++nEnded;
+   }
+
+   nEnded += static_cast<int>(m_Deadlines.Advance(CTimerWheel::Clock::now(),
+      [this](const CTimerWheel::TimerId, const uint64_t uFd)
+   {
+      const ASocket::Socket Fd = static_cast<ASocket::Socket>(uFd);
+
+      if (m_eSettingsFlags & ASocket::ENABLE_LOG)
+         m_oLog(ASocket::StringFormat("[SSLHandshakeDriver][Error] handshake on socket %d timed out.", Fd));
+
+      ++m_uTimeoutCount;
+      Finish(Fd, false);
+   }));
+
+   return nEnded;
+}
+
+bool CSSLHandshakeDriver::Step(const ASocket::Socket Fd)
+{
+   Handshake& Current = m_mapHandshakes[Fd];
+
+   uint32_t uWanted;
+   switch (Current.m_fnStep())
+   {
+      case ASecureSocket::HandshakeStatus::DONE:
+         Finish(Fd, true);
+         return true;
+
+      case ASecureSocket::HandshakeStatus::WANT_READ:
+         uWanted = EPOLLIN;
+         break;
+
+      case ASecureSocket::HandshakeStatus::WANT_WRITE:
+         uWanted = EPOLLOUT;
+         break;
+
+      default:
+         Finish(Fd, false);
+         return true;
+   }
+
+   if (uWanted != Current.m_uEvents)
+   {
+      struct epoll_event Event;
+      memset(&Event, 0, sizeof(Event));
+      Event.events = uWanted;
+      Event.data.fd = Fd;
+
+      if (epoll_ctl(m_EpollFd, EPOLL_CTL_MOD, Fd, &Event) < 0)
+      {
+         if (m_eSettingsFlags & ASocket::ENABLE_LOG)
+            m_oLog(ASocket::StringFormat("[SSLHandshakeDriver][Error] epoll_ctl failed : %s", strerror(errno)));
+
+         Finish(Fd, false);
+         return true;
+      }
+      Current.m_uEvents = uWanted;
+   }
+
+   return false;
+}
+
+void CSSLHandshakeDriver::Finish(const ASocket::Socket Fd, const bool bSuccess)
+{
+   auto it = m_mapHandshakes.find(Fd);
+   if (it == m_mapHandshakes.end())
+      return;
+
+   epoll_ctl(m_EpollFd, EPOLL_CTL_DEL, Fd, nullptr);
+   fcntl(Fd, F_SETFL, it->second.m_iSavedFlags);
+   m_Deadlines.Cancel(it->second.m_uDeadline); // a no-op when it's the one expiring
+
+   // the callback may add a new handshake (or close Fd) : forget this one first
+   DoneFnCallback fnDone = std::move(it->second.m_fnDone);
+   m_mapHandshakes.erase(it);
+
+   if (fnDone)
+      fnDone(bSuccess);
+}
+
+CSSLHandshakeDriver::~CSSLHandshakeDriver()
+{
+   if (m_EpollFd >= 0)
+      close(m_EpollFd);
+}
+#endif
+#endif
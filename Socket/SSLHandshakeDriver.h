@@ -0,0 +1,80 @@
+/*
+* @file SSLHandshakeDriver.h
+* @brief runs many non-blocking TLS handshakes on a single thread (epoll readiness loop)
+* @date 2026-10-17
+*
+* A handshake is registered with the socket it runs on and a step function
+* (e.g. CTCPSSLServer::ContinueAccept or CTCPSSLClient::ContinueConnect) that
+* the driver calls whenever the socket is ready for what the previous step
+* asked for (WANT_READ/WANT_WRITE). Each handshake has its own deadline, a
+* slow or silent peer only costs a file descriptor until it expires.
+*/
+
+#ifdef OPENSSL
+#ifdef LINUX
+#ifndef INCLUDE_SSLHANDSHAKEDRIVER_H_
+#define INCLUDE_SSLHANDSHAKEDRIVER_H_
+
+#include <unordered_map>
+#include <vector>
+
+#include <sys/epoll.h>
+
+#include "SecureSocket.h"
+#include "TimerWheel.h"
+
+class CSSLHandshakeDriver
+{
+public:
+   typedef std::function<ASecureSocket::HandshakeStatus()> StepFnCallback;
+   typedef std::function<void(const bool bSuccess)>         DoneFnCallback;
+
+   explicit CSSLHandshakeDriver(const ASocket::LogFnCallback oLogger,
+                                const ASocket::SettingsFlag eSettings = ASocket::ALL_FLAGS);
+   ~CSSLHandshakeDriver();
+
+   CSSLHandshakeDriver(const CSSLHandshakeDriver&) = delete;
+   CSSLHandshakeDriver& operator=(const CSSLHandshakeDriver&) = delete;
+
+   /* the socket is switched to non-blocking mode until the handshake ends, its previous
+    * mode is then restored and fnDone is called (from Poll) : on failure or timeout, closing
+    * the connection is up to the caller. uTimeoutMsec covers the whole handshake. */
+   bool Add(const ASocket::Socket Fd,
+            const StepFnCallback& fnStep,
+            const DoneFnCallback& fnDone,
+            const size_t uTimeoutMsec);
+
+   /* waits at most msec milliseconds for ready sockets, advances their handshakes and
+    * expires the late ones. Returns the number of ended handshakes or -1 on error. */
+   int Poll(const size_t msec);
+
+   size_t GetPendingCount() const { return m_mapHandshakes.size(); }
+   unsigned long long GetTimeoutCount() const { return m_uTimeoutCount; }
+
+protected:
+   struct Handshake
+   {
+      StepFnCallback        m_fnStep;
+      DoneFnCallback        m_fnDone;
+      int                   m_iSavedFlags;
+      uint32_t              m_uEvents; // what the socket is polled for
+      CTimerWheel::TimerId  m_uDeadline;
+   };
+
+   /* returns true when the handshake has ended (Finish was called) */
+   bool Step(const ASocket::Socket Fd);
+   void Finish(const ASocket::Socket Fd, const bool bSuccess);
+
+   ASocket::LogFnCallback m_oLog;
+   ASocket::SettingsFlag  m_eSettingsFlags;
+
+   int                                           m_EpollFd;
+   std::unordered_map<ASocket::Socket, Handshake> m_mapHandshakes;
+   CTimerWheel                                   m_Deadlines;
+   std::vector<struct epoll_event>               m_vecEvents;
+   unsigned long long                            m_uTimeoutCount;
+};
+
+#endif
+#endif
+#endif
@@ -8,8 +8,13 @@
 
 #include "SecureSocket.h"
 
+#include <algorithm>
 #include <iostream>
 
+#ifndef WINDOWS
+#include <unistd.h>
+#endif
+
 #ifndef LINUX
 // to avoid link problems in prod/test program
 // Update : with the newer versions of OpenSSL, there's no need to include it
@@ -44,6 +49,7 @@ ASecureSocket::ASecureSocket(const LogFnCallback& oLogger,
                              const SettingsFlag eSettings /*= ALL_FLAGS*/) :
    ASocket(oLogger, eSettings),
    m_eOpenSSLProtocol(eSSLVersion),
+   m_bKernelTLS(false),
    m_globalInitializer(SecureSocketGlobalInitializer::instance())
 {
 }
@@ -92,35 +98,35 @@ void ASecureSocket::SetUpCtxClient(SSLSocket& Socket)
 }
 
 void ASecureSocket::SetUpCtxServer(SSLSocket& Socket)
+{
+   Socket.m_pMTHDSSL = const_cast<SSL_METHOD*>(GetServerMethod());
+   Socket.m_pCTXSSL = SSL_CTX_new(Socket.m_pMTHDSSL);
+}
+
+const SSL_METHOD* ASecureSocket::GetServerMethod() const
 {
    switch (m_eOpenSSLProtocol)
    {
       default:
       case OpenSSLProtocol::TLS:
          // Standard Protocol as of 11/2018, OpenSSL will choose highest possible TLS standard between peers
-         Socket.m_pMTHDSSL = const_cast<SSL_METHOD*>(TLS_server_method());
-         break;
+         return TLS_server_method();
 
       #ifndef LINUX
       //case OpenSSLProtocol::SSL_V2:
-         //Socket.m_pMTHDSSL = const_cast<SSL_METHOD*>(SSLv2_server_method());
-         //break;
+         //return SSLv2_server_method();
       #endif
 
       // deprecated
       /*case OpenSSLProtocol::SSL_V3:
-         Socket.m_pMTHDSSL = const_cast<SSL_METHOD*>(SSLv3_server_method());
-         break;*/
+         return SSLv3_server_method();*/
 
       case OpenSSLProtocol::TLS_V1:
-         Socket.m_pMTHDSSL = const_cast<SSL_METHOD*>(TLSv1_server_method());
-         break;
+         return TLSv1_server_method();
 
       case OpenSSLProtocol::SSL_V23:
-         Socket.m_pMTHDSSL = const_cast<SSL_METHOD*>(SSLv23_server_method());
-         break;
+         return SSLv23_server_method();
    }
-   Socket.m_pCTXSSL = SSL_CTX_new(Socket.m_pMTHDSSL);
 }
 
 void ASecureSocket::InitializeSSL()
@@ -160,6 +166,98 @@ void ASecureSocket::ShutdownSSL(SSLSocket& SSLSock)
    }
 }
 
+/* maps the result of an SSL_do_handshake, SSL_accept or SSL_connect call that didn't succeed */
+ASecureSocket::HandshakeStatus ASecureSocket::GetHandshakeStatus(const SSLSocket& SSLSock, const int iResult)
+{
+   switch (SSL_get_error(SSLSock.m_pSSL, iResult))
+   {
+      case SSL_ERROR_WANT_READ:
+         return HandshakeStatus::WANT_READ;
+
+      case SSL_ERROR_WANT_WRITE:
+         return HandshakeStatus::WANT_WRITE;
+
+      default:
+         return HandshakeStatus::FAILED;
+   }
+}
+
+void ASecureSocket::RequestKernelTLS(SSLSocket& SSLSock) const
+{
+   // OpenSSL 3 : the offload is set up at the end of the handshake, if the kernel accepts it
+   #ifdef SSL_OP_ENABLE_KTLS
+   if (m_bKernelTLS)
+      SSL_set_options(SSLSock.m_pSSL, SSL_OP_ENABLE_KTLS);
+   #else
+   (void) SSLSock;
+   #endif
+}
+
+bool ASecureSocket::IsKernelTLSSendActive(const SSLSocket& SSLSock)
+{
+   // BIO_get_ktls_send only exists in the OpenSSL versions knowing about kTLS
+   #ifdef SSL_OP_ENABLE_KTLS
+   return SSLSock.m_pSSL != nullptr && BIO_get_ktls_send(SSL_get_wbio(SSLSock.m_pSSL));
+   #else
+   (void) SSLSock;
+   return false;
+   #endif
+}
+
+bool ASecureSocket::IsKernelTLSRecvActive(const SSLSocket& SSLSock)
+{
+   #ifdef SSL_OP_ENABLE_KTLS
+   return SSLSock.m_pSSL != nullptr && BIO_get_ktls_recv(SSL_get_rbio(SSLSock.m_pSSL));
+   #else
+   (void) SSLSock;
+   return false;
+   #endif
+}
+
+#ifndef WINDOWS
+bool ASecureSocket::SendFileSSL(const SSLSocket& SSLSock, const int iFileFd, off_t Offset, size_t uSize)
+{
+   #ifdef SSL_OP_ENABLE_KTLS
+   if (IsKernelTLSSendActive(SSLSock))
+   {
+      // the file pages go straight from the page cache to the kernel TLS socket
+      while (uSize > 0)
+      {
+         ossl_ssize_t nSent = SSL_sendfile(SSLSock.m_pSSL, iFileFd, Offset, uSize, 0);
+         if (nSent <= 0)
+            return false;
+
+         Offset += nSent;
+         uSize -= static_cast<size_t>(nSent);
+      }
+      return true;
+   }
+   #endif
+
+   // one chunk fills a maximum size TLS record
+   char szChunk[16 * 1024];
+   while (uSize > 0)
+   {
+      ssize_t nRead = pread(iFileFd, szChunk, std::min(uSize, sizeof(szChunk)), Offset);
+      if (nRead <= 0)
+         return false;
+
+      for (ssize_t nWritten = 0; nWritten < nRead; )
+      {
+         int nSent = SSL_write(SSLSock.m_pSSL, szChunk + nWritten, static_cast<int>(nRead - nWritten));
+         if (nSent <= 0)
+            return false;
+
+         nWritten += nSent;
+      }
+
+      Offset += nRead;
+      uSize -= static_cast<size_t>(nRead);
+   }
+   return true;
+}
+#endif
+
 const char* ASecureSocket::GetSSLErrorString(int iErrorCode)
 {
    switch (iErrorCode)
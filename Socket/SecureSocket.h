@@ -33,6 +33,15 @@ public:
       TLS // Standard Protocol as of 11/2018, OpenSSL will choose highest possible TLS standard between peers
    };
 
+   /* progress of a handshake driven on a non-blocking socket */
+   enum class HandshakeStatus
+   {
+      DONE,
+      WANT_READ,  // call again when the socket is readable
+      WANT_WRITE, // call again when the socket is writable
+      FAILED
+   };
+
    struct SSLSocket
    {
       SSLSocket() :
@@ -113,23 +122,46 @@ public:
    //void SetSSLKeyPassword(const std::string& strPwd) { m_strSSLKeyPwd = strPwd; }
    //const std::string& GetSSLKeyPwd() const { return m_strSSLKeyPwd; }
 
+   /* kernel TLS (Linux "tls" module and an OpenSSL 3 built with KTLS support) : after the
+    * handshake, the records are encrypted by the kernel and SendFile uses sendfile().
+    * It's a request applied to the next handshakes : OpenSSL silently keeps encrypting in
+    * user space if the kernel, the cipher or the protocol version doesn't allow it. */
+   inline void SetKernelTLS(const bool bEnable) { m_bKernelTLS = bEnable; }
+   inline bool IsKernelTLSEnabled() const { return m_bKernelTLS; }
+
+   /* whether the kernel encrypts the sent (resp. decrypts the received) data of a connection */
+   static bool IsKernelTLSSendActive(const SSLSocket& SSLSock);
+   static bool IsKernelTLSRecvActive(const SSLSocket& SSLSock);
+
 protected:
    // object methods
    void SetUpCtxClient(SSLSocket& Socket);
    void SetUpCtxServer(SSLSocket& Socket);
+   const SSL_METHOD* GetServerMethod() const;
    //void SetUpCtxCombined(SSLSocket& Socket);
 
    // class methods
    static void ShutdownSSL(SSLSocket& SSLSocket);
    static const char* GetSSLErrorString(int iErrorCode);
+   static HandshakeStatus GetHandshakeStatus(const SSLSocket& SSLSock, const int iResult);
    static int AlwaysTrueCallback(X509_STORE_CTX* pCTX, void* pArg);
 
+   // to be called between SSL_new and the handshake
+   void RequestKernelTLS(SSLSocket& SSLSock) const;
+
+#ifndef WINDOWS
+   /* sends uSize bytes of a file from Offset : SSL_sendfile when kTLS is active on the
+    * connection, otherwise the file is read in record-sized chunks given to SSL_write */
+   static bool SendFileSSL(const SSLSocket& SSLSock, const int iFileFd, off_t Offset, size_t uSize);
+#endif
+
    // non-static/object members
    OpenSSLProtocol      m_eOpenSSLProtocol;
    std::string          m_strCAFile;
    std::string          m_strSSLCertFile;
    std::string          m_strSSLKeyFile;
    //std::string          m_strSSLKeyPwd;
+   bool                 m_bKernelTLS;
 
 private:
    friend class SecureSocketGlobalInitializer;
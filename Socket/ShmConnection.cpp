@@ -0,0 +1,316 @@
+/**
+* @file ShmConnection.cpp
+* @brief implementation of the shared-memory connection
+*/
+
+#include "ShmConnection.h"
+
+#ifdef LINUX
+
+#include <new>
+#include <thread>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+const unsigned int CShmConnection::DEFAULT_SPIN_COUNT;
+const int CShmConnection::PEER_CHECK_MS;
+const int CShmConnection::HANDSHAKE_TIMEOUT_MS;
+const uint32_t CShmConnection::SHM_MAGIC;
+const uint32_t CShmConnection::SHM_VERSION;
+
+CShmConnection::CShmConnection(const LogFnCallback oLogger, const SettingsFlag eSettings /*= ALL_FLAGS*/) :
+   ASocket(oLogger, eSettings),
+   m_ControlSocket(INVALID_SOCKET),
+   m_pMapping(nullptr),
+   m_uMappingSize(0),
+   m_pShared(nullptr),
+   m_uSpinCount(0)
+{
+   SetSpinCount(DEFAULT_SPIN_COUNT);
+}
+
+CShmConnection::~CShmConnection()
+{
+   if (IsConnected())
+      Disconnect();
+}
+
+void CShmConnection::SetSpinCount(const unsigned int uSpinCount)
+{
+   m_uSpinCount = (std::thread::hardware_concurrency() > 1) ? uSpinCount : 0;
+}
+
+void CShmConnection::Attach(const Socket ControlSocket, void* pMapping, const size_t uRingCapacity,
+                            const bool bServer)
+{
+   m_ControlSocket = ControlSocket;
+   m_pMapping = pMapping;
+   m_uMappingSize = GetMappingSize(uRingCapacity);
+
+   if (bServer)
+   {
+      m_pShared = new (pMapping) SharedHeader();
+      m_pShared->m_uMagic = SHM_MAGIC;
+      m_pShared->m_uVersion = SHM_VERSION;
+      m_pShared->m_uRingCapacity = uRingCapacity;
+      m_pShared->m_uClosed.store(0, std::memory_order_relaxed);
+   }
+   else
+      m_pShared = static_cast<SharedHeader*>(pMapping);
+
+   char* pClientToServer = static_cast<char*>(pMapping) + sizeof(SharedHeader);
+   char* pServerToClient = pClientToServer + CShmRing::GetMappingSize(uRingCapacity);
+   m_Out.Attach(bServer ? pServerToClient : pClientToServer, uRingCapacity, bServer);
+   m_In.Attach(bServer ? pClientToServer : pServerToClient, uRingCapacity, bServer);
+}
+
+bool CShmConnection::Connect(const std::string& strPath)
+{
+   if (IsConnected())
+   {
+      Disconnect();
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog("[ShmConnection][Warning] Opening a new connexion. The last one was automatically closed.");
+   }
+
+   struct sockaddr_un Addr;
+   socklen_t uAddrLen;
+   if (!MakeUnixAddress(strPath, Addr, uAddrLen))
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[ShmConnection][Error] invalid path '%s'", strPath.c_str()));
+
+      return false;
+   }
+
+   Socket ControlSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+   if (ControlSocket < 0)
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[ShmConnection][Error] socket failed : %s", strerror(errno)));
+
+      return false;
+   }
+
+   if (connect(ControlSocket, reinterpret_cast<struct sockaddr*>(&Addr), uAddrLen) < 0)
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[ShmConnection][Error] Unable to connect to '%s' : %s", strPath.c_str(), strerror(errno)));
+
+      close(ControlSocket);
+      return false;
+   }
+
+   // the server answers with the memfd, a server of another kind wouldn't
+   struct timeval Timeout = TimevalFromMsec(HANDSHAKE_TIMEOUT_MS);
+   setsockopt(ControlSocket, SOL_SOCKET, SO_RCVTIMEO, &Timeout, sizeof(Timeout));
+
+   HandshakeMessage Hello;
+   memset(&Hello, 0, sizeof(Hello));
+   struct iovec Iov;
+   Iov.iov_base = &Hello;
+   Iov.iov_len = sizeof(Hello);
+
+   union
+   {
+      char           m_szBuffer[CMSG_SPACE(sizeof(int))];
+      struct cmsghdr m_Align;
+   } Control;
+
+   struct msghdr Msg;
+   memset(&Msg, 0, sizeof(Msg));
+   Msg.msg_iov = &Iov;
+   Msg.msg_iovlen = 1;
+   Msg.msg_control = Control.m_szBuffer;
+   Msg.msg_controllen = sizeof(Control.m_szBuffer);
+
+   ssize_t nReceived;
+   do
+   {
+      nReceived = recvmsg(ControlSocket, &Msg, MSG_WAITALL | MSG_CMSG_CLOEXEC);
+   } while (nReceived < 0 && errno == EINTR);
+
+   int iMemFd = -1;
+   struct cmsghdr* pCmsg = (nReceived > 0) ? CMSG_FIRSTHDR(&Msg) : nullptr;
+   if (pCmsg != nullptr && pCmsg->cmsg_level == SOL_SOCKET && pCmsg->cmsg_type == SCM_RIGHTS &&
+       pCmsg->cmsg_len == CMSG_LEN(sizeof(int)))
+      memcpy(&iMemFd, CMSG_DATA(pCmsg), sizeof(int));
+
+   const uint64_t uCapacity = Hello.m_uRingCapacity;
+   struct stat FileStat;
+   if (nReceived != static_cast<ssize_t>(sizeof(Hello)) || iMemFd < 0 ||
+       Hello.m_uMagic != SHM_MAGIC || Hello.m_uVersion != SHM_VERSION ||
+       uCapacity == 0 || (uCapacity & (uCapacity - 1)) != 0 ||
+       fstat(iMemFd, &FileStat) < 0 || static_cast<uint64_t>(FileStat.st_size) < GetMappingSize(uCapacity))
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[ShmConnection][Error] invalid handshake from '%s'", strPath.c_str()));
+
+      if (iMemFd >= 0)
+         close(iMemFd);
+      close(ControlSocket);
+      return false;
+   }
+
+   void* pMapping = mmap(nullptr, GetMappingSize(uCapacity), PROT_READ | PROT_WRITE, MAP_SHARED, iMemFd, 0);
+   close(iMemFd); // the mapping keeps the memory
+   if (pMapping == MAP_FAILED)
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[ShmConnection][Error] mmap failed : %s", strerror(errno)));
+
+      close(ControlSocket);
+      return false;
+   }
+
+   Attach(ControlSocket, pMapping, uCapacity, false);
+   return true;
+}
+
+bool CShmConnection::Disconnect()
+{
+   if (!IsConnected())
+      return false;
+
+   // the peer sees it at once if it's in a ring wait, through the control socket otherwise
+   m_pShared->m_uClosed.store(1, std::memory_order_release);
+   m_Out.Wake();
+   m_In.Wake();
+
+   munmap(m_pMapping, m_uMappingSize);
+   m_pMapping = nullptr;
+   m_pShared = nullptr;
+
+   close(m_ControlSocket);
+   m_ControlSocket = INVALID_SOCKET;
+   return true;
+}
+
+bool CShmConnection::IsPeerGone()
+{
+   if (m_pShared->m_uClosed.load(std::memory_order_acquire) != 0)
+      return true;
+
+   // a dead peer didn't set the flag : it's set here so that the next calls don't wait again
+   const ConnectionState eState = ProbeConnection(m_ControlSocket);
+   if (eState != CONNECTION_CLOSED && eState != CONNECTION_ERROR)
+      return false;
+
+   m_pShared->m_uClosed.store(1, std::memory_order_release);
+   return true;
+}
+
+bool CShmConnection::CheckCorruption(const CShmRing& Ring)
+{
+   if (!Ring.IsCorrupted())
+      return false;
+
+   if (m_eSettingsFlags & ENABLE_LOG)
+      m_oLog("[ShmConnection][Error] corrupted ring indexes, closing the link.");
+
+   m_pShared->m_uClosed.store(1, std::memory_order_release);
+   return true;
+}
+
+bool CShmConnection::Send(const char* pData, const size_t uSize)
+{
+   if (!IsConnected())
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog("[ShmConnection][Error] send failed : not connected.");
+
+      return false;
+   }
+
+   size_t uSent = 0;
+   while (uSent < uSize)
+   {
+      if (m_pShared->m_uClosed.load(std::memory_order_acquire) != 0)
+      {
+         if (m_eSettingsFlags & ENABLE_LOG)
+            m_oLog("[ShmConnection][Error] send failed : the peer disconnected.");
+
+         return false;
+      }
+
+      const size_t uWritten = m_Out.Write(pData + uSent, uSize - uSent);
+      if (uWritten > 0)
+      {
+         uSent += uWritten;
+         continue;
+      }
+
+      if (CheckCorruption(m_Out))
+         return false;
+
+      // the ring is full : the peer is slow, or gone
+      if (!m_Out.WaitWritable(m_uSpinCount, PEER_CHECK_MS) && IsPeerGone())
+      {
+         if (m_eSettingsFlags & ENABLE_LOG)
+            m_oLog("[ShmConnection][Error] send failed : the peer disconnected.");
+
+         return false;
+      }
+   }
+
+   return true;
+}
+
+bool CShmConnection::Send(const std::string& strData)
+{
+   return Send(strData.c_str(), strData.length());
+}
+
+bool CShmConnection::Send(const std::vector<char>& Data)
+{
+   return Send(Data.data(), Data.size());
+}
+
+int CShmConnection::Receive(char* pData, const size_t uSize, bool bReadFully /*= true*/)
+{
+   if (!IsConnected())
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog("[ShmConnection][Error] recv failed : not connected.");
+
+      return -1;
+   }
+
+   size_t uTotal = 0;
+   while (uTotal < uSize)
+   {
+      const size_t uRead = m_In.Read(pData + uTotal, uSize - uTotal);
+      if (uRead > 0)
+      {
+         uTotal += uRead;
+         if (!bReadFully)
+            break;
+         continue;
+      }
+
+      if (CheckCorruption(m_In))
+         return -1;
+
+      /* the peer's last bytes are published before its closed flag : once the flag is seen,
+       * one more read gets them all */
+      if (m_pShared->m_uClosed.load(std::memory_order_acquire) != 0)
+      {
+         const size_t uLast = m_In.Read(pData + uTotal, uSize - uTotal);
+         uTotal += uLast;
+         if (uLast == 0 || !bReadFully || uTotal == uSize)
+            break;
+         continue;
+      }
+
+      if (!m_In.WaitReadable(m_uSpinCount, PEER_CHECK_MS) && IsPeerGone())
+      {
+         uTotal += m_In.Read(pData + uTotal, uSize - uTotal);
+         break;
+      }
+   }
+
+   return static_cast<int>(uTotal);
+}
+
+#endif
@@ -0,0 +1,110 @@
+/*
+* @file ShmConnection.h
+* @brief same-host link through shared memory : two SPSC rings in a memfd (Linux)
+* @date 2026-10-17
+*
+* Even over AF_UNIX, each message costs a send and a recv syscall and a wake-up of the
+* peer. A CShmConnection exchanges bytes through two CShmRing (one per direction) in a
+* memfd mapped by both processes : while the peer is busy or spinning, a message is just
+* two memcpy. The connection is set up over a Unix domain socket (see CShmServer), which
+* passes the memfd with SCM_RIGHTS and then only serves to notice the peer's death.
+* Send and Receive behave like CTCPClient's : Send blocks until everything is in the ring,
+* Receive returns 0 once the peer disconnected and the ring is drained.
+*/
+
+#ifndef INCLUDE_SHMCONNECTION_H_
+#define INCLUDE_SHMCONNECTION_H_
+
+#ifdef LINUX
+
+#include <string>
+#include <vector>
+
+#include "ShmRing.h"
+#include "Socket.h"
+
+class CShmServer;
+
+class CShmConnection : public ASocket
+{
+   friend class CShmServer;
+
+public:
+   explicit CShmConnection(const LogFnCallback oLogger, const SettingsFlag eSettings = ALL_FLAGS);
+   ~CShmConnection() override;
+
+   // copy constructor and assignment operator are disabled
+   CShmConnection(const CShmConnection&) = delete;
+   CShmConnection& operator=(const CShmConnection&) = delete;
+
+   // connects to the CShmServer listening on strPath (a Unix domain socket path, '@' : abstract)
+   bool Connect(const std::string& strPath);
+   bool Disconnect();
+
+   bool Send(const char* pData, const size_t uSize);
+   bool Send(const std::string& strData);
+   bool Send(const std::vector<char>& Data);
+   int  Receive(char* pData, const size_t uSize, bool bReadFully = true);
+
+   /* polls of an empty (or full) ring before sleeping on its futex : spinning saves the
+    * wake-up latency as long as the peer answers quickly, at the cost of a busy core. There
+    * is no spinning on a single-CPU host, it would only delay the peer. */
+   void SetSpinCount(const unsigned int uSpinCount);
+   unsigned int GetSpinCount() const { return m_uSpinCount; }
+
+   bool IsConnected() const { return m_pShared != nullptr; }
+   size_t GetRingCapacity() const { return m_Out.GetCapacity(); }
+   Socket GetControlSocket() const { return m_ControlSocket; }
+
+   static const unsigned int DEFAULT_SPIN_COUNT = 2000;
+   static const int PEER_CHECK_MS = 100;       // sleeps are cut to check the peer is still there
+   static const int HANDSHAKE_TIMEOUT_MS = 5000;
+
+protected:
+   static const uint32_t SHM_MAGIC = 0x52484D53; // "SMHR"
+   static const uint32_t SHM_VERSION = 1;
+
+   // sent along with the memfd
+   struct HandshakeMessage
+   {
+      uint32_t m_uMagic;
+      uint32_t m_uVersion;
+      uint64_t m_uRingCapacity;
+   };
+
+   // start of the mapping, followed by the client to server ring then the server to client one
+   struct SharedHeader
+   {
+      uint32_t                          m_uMagic;
+      uint32_t                          m_uVersion;
+      uint64_t                          m_uRingCapacity;
+      alignas(64) std::atomic<uint32_t> m_uClosed; // set by the first side which disconnects
+   };
+
+   static size_t GetMappingSize(const size_t uRingCapacity)
+   {
+      return sizeof(SharedHeader) + 2 * CShmRing::GetMappingSize(uRingCapacity);
+   }
+
+   /* takes ownership of the control socket and of the mapping, the server initializes it */
+   void Attach(const Socket ControlSocket, void* pMapping, const size_t uRingCapacity, const bool bServer);
+
+   // the peer disconnected (or died : its end of the control socket is closed)
+   bool IsPeerGone();
+
+   /* a ring's indexes were overwritten with values it can't hold : the link is closed,
+    * nothing more is read from or written to the mapping */
+   bool CheckCorruption(const CShmRing& Ring);
+
+   Socket        m_ControlSocket;
+   void*         m_pMapping;
+   size_t        m_uMappingSize;
+   SharedHeader* m_pShared;
+   CShmRing      m_Out;
+   CShmRing      m_In;
+   unsigned int  m_uSpinCount;
+};
+
+#endif
+
+#endif
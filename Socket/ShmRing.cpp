@@ -0,0 +1,223 @@
+/**
+* @file ShmRing.cpp
+* @brief implementation of the shared-memory SPSC ring
+*/
+
+#include "ShmRing.h"
+
+#ifdef LINUX
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <new>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace
+{
+   inline void CpuRelax()
+   {
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#elif defined(__aarch64__)
+      asm volatile("yield");
+#endif
+   }
+
+   // not FUTEX_PRIVATE_FLAG : the word is shared with another process
+   bool FutexWait(std::atomic<uint32_t>& Word, const uint32_t uExpected, const int iTimeoutMs)
+   {
+      struct timespec Timeout;
+      Timeout.tv_sec = iTimeoutMs / 1000;
+      Timeout.tv_nsec = static_cast<long>(iTimeoutMs % 1000) * 1000000L;
+
+      const long lRet = syscall(SYS_futex, reinterpret_cast<uint32_t*>(&Word), FUTEX_WAIT, uExpected,
+                                (iTimeoutMs < 0) ? nullptr : &Timeout, nullptr, 0);
+      return lRet == 0 || errno != ETIMEDOUT;
+   }
+
+   void FutexWake(std::atomic<uint32_t>& Word)
+   {
+      Word.fetch_add(1, std::memory_order_release);
+      syscall(SYS_futex, reinterpret_cast<uint32_t*>(&Word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+   }
+
+   /* the sleeping side announces itself (Waiting) then checks the condition, the other side
+    * publishes its index then checks Waiting : with a full fence on both sides, at least one
+    * of them sees the other's store, no wake-up is lost. */
+   template <typename ReadyFn>
+   bool Wait(ReadyFn IsReady, std::atomic<uint32_t>& Waiting, std::atomic<uint32_t>& Seq,
+             const unsigned int uSpinCount, const int iTimeoutMs)
+   {
+      for (unsigned int i = 0; i < uSpinCount; ++i)
+      {
+         if (IsReady())
+            return true;
+         CpuRelax();
+      }
+
+      Waiting.store(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      const uint32_t uSeq = Seq.load(std::memory_order_acquire);
+
+      bool bWoken = true;
+      if (!IsReady())
+         bWoken = FutexWait(Seq, uSeq, iTimeoutMs);
+
+      Waiting.store(0, std::memory_order_relaxed);
+      return bWoken || IsReady();
+   }
+}
+
+CShmRing::CShmRing() :
+   m_pHeader(nullptr),
+   m_pData(nullptr),
+   m_uCapacity(0),
+   m_uCachedTail(0),
+   m_uCachedHead(0),
+   m_bCorrupted(false)
+{
+
+}
+
+void CShmRing::Attach(void* pMemory, const size_t uCapacity, const bool bInitialize)
+{
+   m_pHeader = bInitialize ? new (pMemory) Header() : static_cast<Header*>(pMemory);
+   m_pData = static_cast<char*>(pMemory) + sizeof(Header);
+   m_uCapacity = uCapacity;
+   m_bCorrupted = false;
+
+   if (bInitialize)
+   {
+      m_pHeader->m_uHead.store(0, std::memory_order_relaxed);
+      m_pHeader->m_uTail.store(0, std::memory_order_relaxed);
+      m_pHeader->m_uDataSeq.store(0, std::memory_order_relaxed);
+      m_pHeader->m_uConsumerWaiting.store(0, std::memory_order_relaxed);
+      m_pHeader->m_uSpaceSeq.store(0, std::memory_order_relaxed);
+      m_pHeader->m_uProducerWaiting.store(0, std::memory_order_relaxed);
+   }
+
+   m_uCachedTail = m_pHeader->m_uTail.load(std::memory_order_acquire);
+   m_uCachedHead = m_pHeader->m_uHead.load(std::memory_order_acquire);
+}
+
+size_t CShmRing::Write(const char* pData, const size_t uSize)
+{
+   if (m_bCorrupted)
+      return 0;
+
+   const uint64_t uHead = m_pHeader->m_uHead.load(std::memory_order_relaxed);
+   uint64_t uUsed = uHead - m_uCachedTail;
+   if (uUsed > m_uCapacity || m_uCapacity - uUsed < uSize)
+   {
+      m_uCachedTail = m_pHeader->m_uTail.load(std::memory_order_acquire);
+      uUsed = uHead - m_uCachedTail;
+
+      // the tail is ahead of the head, or too far behind : not a ring anymore
+      if (uUsed > m_uCapacity)
+      {
+         m_bCorrupted = true;
+         return 0;
+      }
+   }
+   const size_t uFree = m_uCapacity - static_cast<size_t>(uUsed);
+
+   const size_t uCount = std::min(uSize, uFree);
+   if (uCount == 0)
+      return 0;
+
+   // the free space may wrap around the end of the data
+   const size_t uOffset = static_cast<size_t>(uHead) & (m_uCapacity - 1);
+   const size_t uFirst = std::min(uCount, m_uCapacity - uOffset);
+   memcpy(m_pData + uOffset, pData, uFirst);
+   memcpy(m_pData, pData + uFirst, uCount - uFirst);
+
+   m_pHeader->m_uHead.store(uHead + uCount, std::memory_order_release);
+
+   std::atomic_thread_fence(std::memory_order_seq_cst);
+   if (m_pHeader->m_uConsumerWaiting.load(std::memory_order_relaxed) != 0)
+      FutexWake(m_pHeader->m_uDataSeq);
+
+   return uCount;
+}
+
+size_t CShmRing::Read(char* pData, const size_t uSize)
+{
+   if (m_bCorrupted)
+      return 0;
+
+   const uint64_t uTail = m_pHeader->m_uTail.load(std::memory_order_relaxed);
+   uint64_t uAvailable = m_uCachedHead - uTail;
+   if (uAvailable > m_uCapacity || uAvailable < uSize)
+   {
+      m_uCachedHead = m_pHeader->m_uHead.load(std::memory_order_acquire);
+      uAvailable = m_uCachedHead - uTail;
+
+      // more than the ring can hold : copying it would read past the mapping
+      if (uAvailable > m_uCapacity)
+      {
+         m_bCorrupted = true;
+         return 0;
+      }
+   }
+
+   const size_t uCount = std::min(uSize, static_cast<size_t>(uAvailable));
+   if (uCount == 0)
+      return 0;
+
+   const size_t uOffset = static_cast<size_t>(uTail) & (m_uCapacity - 1);
+   const size_t uFirst = std::min(uCount, m_uCapacity - uOffset);
+   memcpy(pData, m_pData + uOffset, uFirst);
+   memcpy(pData + uFirst, m_pData, uCount - uFirst);
+
+   m_pHeader->m_uTail.store(uTail + uCount, std::memory_order_release);
+
+   std::atomic_thread_fence(std::memory_order_seq_cst);
+   if (m_pHeader->m_uProducerWaiting.load(std::memory_order_relaxed) != 0)
+      FutexWake(m_pHeader->m_uSpaceSeq);
+
+   return uCount;
+}
+
+bool CShmRing::WaitReadable(const unsigned int uSpinCount, const int iTimeoutMs)
+{
+   // the caller has to notice it, not sleep on it
+   if (m_bCorrupted)
+      return true;
+
+   Header* pHeader = m_pHeader;
+   return Wait([pHeader]
+               {
+                  return pHeader->m_uHead.load(std::memory_order_acquire) !=
+                         pHeader->m_uTail.load(std::memory_order_relaxed);
+               },
+               pHeader->m_uConsumerWaiting, pHeader->m_uDataSeq, uSpinCount, iTimeoutMs);
+}
+
+bool CShmRing::WaitWritable(const unsigned int uSpinCount, const int iTimeoutMs)
+{
+   if (m_bCorrupted)
+      return true;
+
+   Header* pHeader = m_pHeader;
+   const size_t uCapacity = m_uCapacity;
+   return Wait([pHeader, uCapacity]
+               {
+                  return pHeader->m_uHead.load(std::memory_order_relaxed) -
+                         pHeader->m_uTail.load(std::memory_order_acquire) < uCapacity;
+               },
+               pHeader->m_uProducerWaiting, pHeader->m_uSpaceSeq, uSpinCount, iTimeoutMs);
+}
+
+void CShmRing::Wake()
+{
+   FutexWake(m_pHeader->m_uDataSeq);
+   FutexWake(m_pHeader->m_uSpaceSeq);
+}
+
+#endif
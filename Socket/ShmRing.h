@@ -0,0 +1,81 @@
+/*
+* @file ShmRing.h
+* @brief single-producer single-consumer byte ring in memory shared between processes
+* @date 2026-10-17
+*
+* The producer and the consumer each own one index (bytes written, bytes read), on its own
+* cache line, and only read the other's : no lock and no atomic read-modify-write on the
+* data path. A side waiting for data (or room) spins for a while, then sleeps on a futex
+* word of the ring. The other side only makes a syscall to wake it if it announced it was
+* sleeping, so a busy link exchanges bytes without entering the kernel.
+*/
+
+#ifndef INCLUDE_SHMRING_H_
+#define INCLUDE_SHMRING_H_
+
+#ifdef LINUX
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+class CShmRing
+{
+public:
+   // placed at the start of the ring's shared memory, followed by the data
+   struct Header
+   {
+      alignas(64) std::atomic<uint64_t> m_uHead; // bytes written, owned by the producer
+      alignas(64) std::atomic<uint64_t> m_uTail; // bytes read, owned by the consumer
+
+      // futex words, bumped to wake a sleeping side, and whether it's sleeping
+      alignas(64) std::atomic<uint32_t> m_uDataSeq;
+      std::atomic<uint32_t>             m_uConsumerWaiting;
+      alignas(64) std::atomic<uint32_t> m_uSpaceSeq;
+      std::atomic<uint32_t>             m_uProducerWaiting;
+   };
+
+   // uCapacity must be a power of two
+   static size_t GetMappingSize(const size_t uCapacity) { return sizeof(Header) + uCapacity; }
+
+   CShmRing();
+
+   /* uses the ring mapped at pMemory (GetMappingSize(uCapacity) bytes). One of the two
+    * processes initializes it before the other attaches. */
+   void Attach(void* pMemory, const size_t uCapacity, const bool bInitialize);
+
+   /* producer side : copies what fits (0 if full) and wakes the consumer if it sleeps.
+    * Also 0 once the ring is corrupted, see IsCorrupted. */
+   size_t Write(const char* pData, const size_t uSize);
+
+   // consumer side : copies what's there (0 if empty) and wakes the producer if it sleeps
+   size_t Read(char* pData, const size_t uSize);
+
+   /* the indexes live in memory the peer can write : when they are more than the capacity
+    * apart, the ring is unusable (and Read/Write don't touch the data anymore) */
+   bool IsCorrupted() const { return m_bCorrupted; }
+
+   /* wait until the ring isn't empty (consumer) or full (producer) : uSpinCount polls, then
+    * the futex. True when it's ready or after a wake-up (e.g. Wake), false on timeout. */
+   bool WaitReadable(const unsigned int uSpinCount, const int iTimeoutMs);
+   bool WaitWritable(const unsigned int uSpinCount, const int iTimeoutMs);
+
+   // wakes both sides, e.g. to have them notice the link was closed
+   void Wake();
+
+   size_t GetCapacity() const { return m_uCapacity; }
+
+protected:
+   Header* m_pHeader;
+   char*   m_pData;
+   size_t  m_uCapacity;
+
+   // last seen values of the other side's index, refreshed only when they don't suffice
+   uint64_t m_uCachedTail; // producer
+   uint64_t m_uCachedHead; // consumer
+   bool     m_bCorrupted;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,125 @@
+/**
+* @file ShmServer.cpp
+* @brief implementation of the shared-memory connections server
+*/
+
+#include "ShmServer.h"
+
+#ifdef LINUX
+
+#include <sys/mman.h>
+
+const size_t CShmServer::DEFAULT_RING_CAPACITY;
+const size_t CShmServer::MIN_RING_CAPACITY;
+
+CShmServer::CShmServer(const LogFnCallback oLogger,
+                       const std::string& strPath,
+                       const SettingsFlag eSettings /*= ALL_FLAGS*/) :
+   ASocket(oLogger, eSettings),
+   m_UnixServer(oLogger, strPath, eSettings),
+   m_uRingCapacity(DEFAULT_RING_CAPACITY)
+{
+
+}
+
+CShmServer::~CShmServer()
+{
+
+}
+
+void CShmServer::SetRingCapacity(const size_t uCapacity)
+{
+   size_t uRounded = MIN_RING_CAPACITY;
+   while (uRounded < uCapacity)
+      uRounded <<= 1;
+   m_uRingCapacity = uRounded;
+}
+
+bool CShmServer::Listen(CShmConnection& Connection, size_t msec /*= ACCEPT_WAIT_INF_DELAY*/)
+{
+   if (Connection.IsConnected())
+      Connection.Disconnect();
+
+   Socket ControlSocket;
+   if (!m_UnixServer.Listen(ControlSocket, msec))
+      return false;
+
+   const size_t uRingCapacity = m_uRingCapacity;
+   const size_t uMappingSize = CShmConnection::GetMappingSize(uRingCapacity);
+
+   const int iMemFd = memfd_create("socket-cpp-shm", MFD_CLOEXEC);
+   if (iMemFd < 0 || ftruncate(iMemFd, static_cast<off_t>(uMappingSize)) < 0)
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[ShmServer][Error] memfd setup failed : %s", strerror(errno)));
+
+      if (iMemFd >= 0)
+         close(iMemFd);
+      close(ControlSocket);
+      return false;
+   }
+
+   void* pMapping = mmap(nullptr, uMappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, iMemFd, 0);
+   if (pMapping == MAP_FAILED)
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[ShmServer][Error] mmap failed : %s", strerror(errno)));
+
+      close(iMemFd);
+      close(ControlSocket);
+      return false;
+   }
+
+   // the rings are ready before the client can map them
+   Connection.Attach(ControlSocket, pMapping, uRingCapacity, true);
+
+   CShmConnection::HandshakeMessage Hello;
+   memset(&Hello, 0, sizeof(Hello));
+   Hello.m_uMagic = CShmConnection::SHM_MAGIC;
+   Hello.m_uVersion = CShmConnection::SHM_VERSION;
+   Hello.m_uRingCapacity = uRingCapacity;
+
+   struct iovec Iov;
+   Iov.iov_base = &Hello;
+   Iov.iov_len = sizeof(Hello);
+
+   union
+   {
+      char           m_szBuffer[CMSG_SPACE(sizeof(int))];
+      struct cmsghdr m_Align;
+   } Control;
+   memset(&Control, 0, sizeof(Control));
+
+   struct msghdr Msg;
+   memset(&Msg, 0, sizeof(Msg));
+   Msg.msg_iov = &Iov;
+   Msg.msg_iovlen = 1;
+   Msg.msg_control = Control.m_szBuffer;
+   Msg.msg_controllen = sizeof(Control.m_szBuffer);
+
+   struct cmsghdr* pCmsg = CMSG_FIRSTHDR(&Msg);
+   pCmsg->cmsg_level = SOL_SOCKET;
+   pCmsg->cmsg_type = SCM_RIGHTS;
+   pCmsg->cmsg_len = CMSG_LEN(sizeof(int));
+   memcpy(CMSG_DATA(pCmsg), &iMemFd, sizeof(int));
+
+   ssize_t nSent;
+   do
+   {
+      nSent = sendmsg(ControlSocket, &Msg, MSG_NOSIGNAL);
+   } while (nSent < 0 && errno == EINTR);
+
+   close(iMemFd); // the client got its own descriptor
+   if (nSent != static_cast<ssize_t>(sizeof(Hello)))
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[ShmServer][Error] sending the memfd failed : %s", strerror(errno)));
+
+      Connection.Disconnect();
+      return false;
+   }
+
+   return true;
+}
+
+#endif
@@ -0,0 +1,52 @@
+/*
+* @file ShmServer.h
+* @brief accepts shared-memory connections (see CShmConnection) on a Unix domain socket (Linux)
+* @date 2026-10-17
+*
+* Each accepted client gets its own memfd, sized for two rings of the configured capacity,
+* passed to it with SCM_RIGHTS. The Unix domain socket is then only kept to notice the
+* peer's death.
+*/
+
+#ifndef INCLUDE_SHMSERVER_H_
+#define INCLUDE_SHMSERVER_H_
+
+#ifdef LINUX
+
+#include "ShmConnection.h"
+#include "UnixServer.h"
+
+class CShmServer : public ASocket
+{
+public:
+   explicit CShmServer(const LogFnCallback oLogger,
+                       const std::string& strPath,
+                       const SettingsFlag eSettings = ALL_FLAGS);
+   ~CShmServer() override;
+
+   // copy constructor and assignment operator are disabled
+   CShmServer(const CShmServer&) = delete;
+   CShmServer& operator=(const CShmServer&) = delete;
+
+   /* waits (up to msec) for a client, then sets up Connection for it : the previous link of
+    * Connection, if any, is closed */
+   bool Listen(CShmConnection& Connection, size_t msec = ACCEPT_WAIT_INF_DELAY);
+
+   /* bytes of each ring (one per direction), rounded up to a power of two, for the next
+    * connections. A full ring blocks Send until the peer reads. */
+   void SetRingCapacity(const size_t uCapacity);
+   size_t GetRingCapacity() const { return m_uRingCapacity; }
+
+   const std::string& GetPath() const { return m_UnixServer.GetPath(); }
+
+   static const size_t DEFAULT_RING_CAPACITY = 1 << 20;
+   static const size_t MIN_RING_CAPACITY = 4096;
+
+protected:
+   CUnixServer m_UnixServer;
+   size_t      m_uRingCapacity;
+};
+
+#endif
+
+#endif
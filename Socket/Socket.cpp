@@ -6,13 +6,130 @@
 
 #include "Socket.h"
 
+#include <algorithm>
 #include <iostream>
 #include <vector>
 
+#ifndef WINDOWS
+#include <climits>   // IOV_MAX
+#include <cstddef>   // offsetof
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef LINUX
+#include <netinet/tcp.h>
+#include <sys/sendfile.h>
+#endif
+
 #ifdef WINDOWS
 WSADATA ASocket::s_wsaData;
 #endif
 
+namespace
+{
+#ifndef WINDOWS
+   // 0 (no timeout) becomes -1, the longest waits are clamped
+   int PollTimeoutFromMsec(const size_t msec)
+   {
+      if (msec == 0)
+         return -1;
+      return static_cast<int>(std::min<size_t>(msec, INT_MAX));
+   }
+#endif
+
+#ifdef WINDOWS
+   typedef WSABUF NativeBuffer;
+
+   inline void SetNativeBuffer(NativeBuffer& Buffer, char* pData, const size_t uSize)
+   {
+      Buffer.buf = pData;
+      Buffer.len = static_cast<ULONG>(uSize);
+   }
+   inline char* NativeData(const NativeBuffer& Buffer) { return Buffer.buf; }
+   inline size_t NativeSize(const NativeBuffer& Buffer) { return Buffer.len; }
+
+   const size_t MAX_BUFFERS_PER_CALL = 1024;
+#else
+   typedef struct iovec NativeBuffer;
+
+   inline void SetNativeBuffer(NativeBuffer& Buffer, char* pData, const size_t uSize)
+   {
+      Buffer.iov_base = pData;
+      Buffer.iov_len = uSize;
+   }
+   inline char* NativeData(const NativeBuffer& Buffer) { return static_cast<char*>(Buffer.iov_base); }
+   inline size_t NativeSize(const NativeBuffer& Buffer) { return Buffer.iov_len; }
+
+   const size_t MAX_BUFFERS_PER_CALL = IOV_MAX;
+#endif
+
+   /* skips the uBytes transferred by the last call : the fully transferred buffers are
+    * passed and the partially transferred one is shrunk to its remaining part */
+   void ConsumeBuffers(std::vector<NativeBuffer>& vecBuffers, size_t& uFirst, size_t uBytes)
+   {
+      while (uFirst < vecBuffers.size() && uBytes >= NativeSize(vecBuffers[uFirst]))
+      {
+         uBytes -= NativeSize(vecBuffers[uFirst]);
+         ++uFirst;
+      }
+
+      if (uBytes > 0)
+      {
+         NativeBuffer& Partial = vecBuffers[uFirst];
+         SetNativeBuffer(Partial, NativeData(Partial) + uBytes, NativeSize(Partial) - uBytes);
+      }
+   }
+
+   // vectored transfer of up to MAX_BUFFERS_PER_CALL buffers, returns -1 on error
+   long long TransferBuffers(const ASocket::Socket sd, NativeBuffer* pBuffers, const size_t uCount, const bool bSend)
+   {
+      const size_t uBatch = std::min(uCount, MAX_BUFFERS_PER_CALL);
+
+   #ifdef WINDOWS
+      DWORD dwBytes = 0;
+      DWORD dwFlags = 0;
+      int iResult = bSend ? WSASend(sd, pBuffers, static_cast<DWORD>(uBatch), &dwBytes, 0, nullptr, nullptr)
+                          : WSARecv(sd, pBuffers, static_cast<DWORD>(uBatch), &dwBytes, &dwFlags, nullptr, nullptr);
+
+      return (iResult == SOCKET_ERROR) ? -1 : static_cast<long long>(dwBytes);
+   #else
+      struct msghdr Msg;
+      memset(&Msg, 0, sizeof(Msg));
+      Msg.msg_iov = pBuffers;
+      Msg.msg_iovlen = uBatch;
+
+      ssize_t nResult;
+      do
+      {
+         nResult = bSend ? sendmsg(sd, &Msg, 0) : recvmsg(sd, &Msg, 0);
+      } while (nResult < 0 && errno == EINTR);
+
+      return nResult;
+   #endif
+   }
+
+   template <typename TBuffer>
+   std::vector<NativeBuffer> ToNativeBuffers(const TBuffer* pBuffers, const size_t uCount)
+   {
+      std::vector<NativeBuffer> vecBuffers;
+      vecBuffers.reserve(uCount);
+
+      for (size_t i = 0; i < uCount; ++i)
+      {
+         // empty buffers would end a receive loop early (a 0 return means "peer shut down")
+         if (pBuffers[i].m_uSize == 0)
+            continue;
+
+         NativeBuffer Buffer;
+         SetNativeBuffer(Buffer, const_cast<char*>(pBuffers[i].m_pData), pBuffers[i].m_uSize);
+         vecBuffers.push_back(Buffer);
+      }
+      return vecBuffers;
+   }
+}
+
 ASocket::SocketGlobalInitializer& ASocket::SocketGlobalInitializer::instance()
 {
    static SocketGlobalInitializer inst{};
@@ -103,6 +220,25 @@ int ASocket::SelectSocket(const ASocket::Socket sd, const size_t msec)
       return -1;
    }
 
+   #ifndef WINDOWS
+   // poll : select can't watch descriptors above FD_SETSIZE
+   struct pollfd pfd;
+   pfd.fd = sd;
+   pfd.events = POLLIN;
+   pfd.revents = 0;
+
+   // block until socket is readable.
+   int res = poll(&pfd, 1, PollTimeoutFromMsec(msec));
+
+   if (res <= 0)
+      return res;
+
+   // a closed or failed socket is readable (recv reports it)
+   if (!(pfd.revents & (POLLIN | POLLERR | POLLHUP)))
+      return -1;
+
+   return 1;
+   #else
    struct timeval tval;
    struct timeval* tvalptr = nullptr;
    fd_set rset;
@@ -128,6 +264,51 @@ int ASocket::SelectSocket(const ASocket::Socket sd, const size_t msec)
       return -1;
 
    return 1;
+   #endif
+}
+
+/**
+* @brief checks whether an idle connected socket is still usable, without blocking
+*
+* @param [in] sd socket descriptor to be probed
+*
+* @retval ConnectionState CONNECTION_ALIVE if nothing is pending, CONNECTION_CLOSED if the
+* peer shut down, CONNECTION_READABLE if data is pending and CONNECTION_ERROR otherwise.
+*/
+ASocket::ConnectionState ASocket::ProbeConnection(const ASocket::Socket sd)
+{
+   if (sd == INVALID_SOCKET)
+      return CONNECTION_ERROR;
+
+   #ifndef WINDOWS
+   struct pollfd pfd;
+   pfd.fd = sd;
+   pfd.events = POLLIN;
+   pfd.revents = 0;
+
+   int res = poll(&pfd, 1, 0);
+   if (res > 0 && (pfd.revents & POLLNVAL))
+      return CONNECTION_ERROR;
+   #else
+   struct timeval tval = { 0, 0 };
+   fd_set rset;
+   FD_ZERO(&rset);
+   FD_SET(sd, &rset);
+
+   int res = select(sd + 1, &rset, nullptr, nullptr, &tval);
+   #endif
+   if (res < 0)
+      return CONNECTION_ERROR;
+   if (res == 0)
+      return CONNECTION_ALIVE;
+
+   // readable : the socket won't block
+   char cByte;
+   int nPeeked = recv(sd, &cByte, 1, MSG_PEEK);
+   if (nPeeked > 0)
+      return CONNECTION_READABLE;
+
+   return (nPeeked == 0) ? CONNECTION_CLOSED : CONNECTION_ERROR;
 }
 
 /**
@@ -138,6 +319,9 @@ int ASocket::SelectSocket(const ASocket::Socket sd, const size_t msec)
 * @param [in] msec waiting period in milliseconds, a value of 0 implies no timeout
 * @param [out] selectedIndex index of the socket that is ready to be read
 *
+* Only the first ready socket is reported : CSocketMultiplexer returns all of them and
+* doesn't need the set to be passed again on each call.
+*
 * @retval int 0 on timeout, -1 on error and 1 on success.
 */
 int ASocket::SelectSockets(const ASocket::Socket* pSocketsToSelect, const size_t count,
@@ -148,6 +332,34 @@ int ASocket::SelectSockets(const ASocket::Socket* pSocketsToSelect, const size_t
       return -1;
    }
 
+   #ifndef WINDOWS
+   // poll : select can't watch descriptors above FD_SETSIZE
+   std::vector<struct pollfd> vecPollFds(count);
+   for (size_t i = 0; i < count; i++)
+   {
+      vecPollFds[i].fd = pSocketsToSelect[i];
+      vecPollFds[i].events = POLLIN;
+      vecPollFds[i].revents = 0;
+   }
+
+   // block until one socket is ready to read.
+   int res = poll(vecPollFds.data(), static_cast<nfds_t>(count), PollTimeoutFromMsec(msec));
+
+   if (res <= 0)
+      return res;
+
+   // find the first socket which has some activity.
+   for (size_t i = 0; i < count; i++)
+   {
+      if (vecPollFds[i].revents & (POLLIN | POLLERR | POLLHUP))
+      {
+         selectedIndex = i;
+         return 1;
+      }
+   }
+
+   return -1;
+   #else
    fd_set rset;
    int res = -1;
 
@@ -190,8 +402,151 @@ int ASocket::SelectSockets(const ASocket::Socket* pSocketsToSelect, const size_t
    }
 
    return -1;
+   #endif
 }
 
+/**
+* @brief gather-write : sends the buffers in order, as if they were concatenated
+*
+* @param [in] sd connected socket descriptor
+* @param [in] pBuffers array of uCount buffers (empty ones are skipped)
+*
+* @retval bool false if the socket failed before everything was sent
+*/
+bool ASocket::SendBuffers(const ASocket::Socket sd, const ConstBuffer* pBuffers, const size_t uCount)
+{
+   std::vector<NativeBuffer> vecBuffers = ToNativeBuffers(pBuffers, uCount);
+
+   size_t uFirst = 0;
+   while (uFirst < vecBuffers.size())
+   {
+      long long nSent = TransferBuffers(sd, &vecBuffers[uFirst], vecBuffers.size() - uFirst, true);
+      if (nSent < 0)
+         return false;
+
+      ConsumeBuffers(vecBuffers, uFirst, static_cast<size_t>(nSent));
+   }
+
+   return true;
+}
+
+/**
+* @brief scatter-read : fills the buffers in order from the received stream
+*
+* @param [in] sd connected socket descriptor
+* @param [in] pBuffers array of uCount destination buffers (empty ones are skipped)
+* @param [in] bReadFully keep on receiving until all the buffers are filled
+*
+* @retval int received bytes count, 0 if the peer shut down first and -1 on error.
+*/
+int ASocket::ReceiveBuffers(const ASocket::Socket sd, const MutableBuffer* pBuffers, const size_t uCount,
+                            const bool bReadFully)
+{
+   std::vector<NativeBuffer> vecBuffers = ToNativeBuffers(pBuffers, uCount);
+
+   size_t uReceived = 0;
+   size_t uFirst = 0;
+   while (uFirst < vecBuffers.size())
+   {
+      long long nRecvd = TransferBuffers(sd, &vecBuffers[uFirst], vecBuffers.size() - uFirst, false);
+      if (nRecvd < 0)
+         return (uReceived > 0) ? static_cast<int>(uReceived) : -1;
+
+      // peer shut down
+      if (nRecvd == 0)
+         break;
+
+      uReceived += static_cast<size_t>(nRecvd);
+      ConsumeBuffers(vecBuffers, uFirst, static_cast<size_t>(nRecvd));
+
+      if (!bReadFully)
+         break;
+   }
+
+   return static_cast<int>(uReceived);
+}
+
+#ifndef WINDOWS
+/**
+* @brief sends a part of a file
+*
+* @param [in] sd connected socket descriptor (blocking)
+* @param [in] iFileFd file descriptor opened for reading, its offset isn't changed
+* @param [in] Offset position of the first byte to send
+* @param [in] uSize count of bytes to send
+*
+* @retval bool false on error (errno is set, EAGAIN after a send timeout) or if the file is too short
+*/
+bool ASocket::SendFileRange(const ASocket::Socket sd, const int iFileFd, off_t Offset, size_t uSize)
+{
+   while (uSize > 0)
+   {
+   #ifdef LINUX
+      // sendfile advances Offset by the sent bytes, a partial transfer is simply resumed
+      ssize_t nSent = sendfile(sd, iFileFd, &Offset, uSize);
+      if (nSent < 0 && errno == EINTR)
+         continue;
+      if (nSent < 0)
+         return false;
+      if (nSent == 0)
+      {
+         // the file ended before uSize bytes
+         errno = EINVAL;
+         return false;
+      }
+   #else
+      char szChunk[64 * 1024];
+      ssize_t nRead = pread(iFileFd, szChunk, std::min(uSize, sizeof(szChunk)), Offset);
+      if (nRead < 0 && errno == EINTR)
+         continue;
+      if (nRead <= 0)
+      {
+         if (nRead == 0)
+            errno = EINVAL;
+         return false;
+      }
+
+      ssize_t nSent = 0;
+      while (nSent < nRead)
+      {
+         ssize_t nResult = send(sd, szChunk + nSent, nRead - nSent, 0);
+         if (nResult < 0 && errno == EINTR)
+            continue;
+         if (nResult < 0)
+            return false;
+         nSent += nResult;
+      }
+      Offset += nSent;
+   #endif
+
+      uSize -= static_cast<size_t>(nSent);
+   }
+
+   return true;
+}
+
+int ASocket::OpenFile(const std::string& strPath, const off_t Offset, size_t& uSize)
+{
+   int iFileFd = open(strPath.c_str(), O_RDONLY | O_CLOEXEC);
+   if (iFileFd < 0)
+      return -1;
+
+   if (uSize == 0)
+   {
+      struct stat FileStat;
+      if (fstat(iFileFd, &FileStat) < 0 || FileStat.st_size < Offset)
+      {
+         close(iFileFd);
+         errno = EINVAL;
+         return -1;
+      }
+      uSize = static_cast<size_t>(FileStat.st_size - Offset);
+   }
+
+   return iFileFd;
+}
+#endif
+
 /**
 * @brief converts a value representing milliseconds into a struct timeval
 *
@@ -207,3 +562,64 @@ struct timeval ASocket::TimevalFromMsec(unsigned int time_msec){
 
    return t;
 }
+
+#ifndef WINDOWS
+/**
+* @brief builds the address of a Unix domain socket
+*
+* @param [in] strPath file path, or abstract name (Linux) when it starts with '@' or '\0'
+* @param [out] Addr filled address
+* @param [out] uAddrLen length to give to bind/connect : an abstract name isn't null-terminated
+*
+* @retval bool false if strPath is empty or too long for sun_path
+*/
+bool ASocket::MakeUnixAddress(const std::string& strPath, struct sockaddr_un& Addr, socklen_t& uAddrLen)
+{
+   memset(&Addr, 0, sizeof(Addr));
+   Addr.sun_family = AF_UNIX;
+
+   if (strPath.empty())
+      return false;
+
+#ifdef LINUX
+   if (strPath[0] == '@' || strPath[0] == '\0')
+   {
+      // the name is all the bytes after the leading null one, trailing nulls included
+      if (strPath.size() > sizeof(Addr.sun_path))
+         return false;
+
+      memcpy(Addr.sun_path + 1, strPath.data() + 1, strPath.size() - 1);
+      uAddrLen = static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + strPath.size());
+      return true;
+   }
+#endif
+
+   // room for the terminating null
+   if (strPath.size() >= sizeof(Addr.sun_path))
+      return false;
+
+   memcpy(Addr.sun_path, strPath.c_str(), strPath.size());
+   uAddrLen = static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + strPath.size() + 1);
+   return true;
+}
+#endif
+
+#ifdef LINUX
+/**
+* @brief tells whether a connection was fast opened
+*
+* @param [in] sd connected socket descriptor (client side or accepted)
+*
+* @retval bool true if the SYN carried data acknowledged by the SYN-ACK (TCP_INFO's TCPI_OPT_SYN_DATA)
+*/
+bool ASocket::IsSynDataAcked(const ASocket::Socket sd)
+{
+   struct tcp_info Info;
+   socklen_t uInfoLen = sizeof(Info);
+   memset(&Info, 0, sizeof(Info));
+   if (getsockopt(sd, IPPROTO_TCP, TCP_INFO, &Info, &uInfoLen) < 0)
+      return false;
+
+   return (Info.tcpi_options & TCPI_OPT_SYN_DATA) != 0;
+}
+#endif
@@ -34,6 +34,8 @@
 #include <string.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 #include <unistd.h>
 #endif
 
@@ -55,6 +57,29 @@ public:
    #define INVALID_SOCKET -1
    #endif
 
+   /* a (pointer, length) pair of a vectored Send/Receive : the buffers of one call are
+    * gathered into (or scattered from) the stream in order, with as few syscalls as possible */
+   struct ConstBuffer
+   {
+      const char* m_pData;
+      size_t      m_uSize;
+   };
+
+   struct MutableBuffer
+   {
+      char*  m_pData;
+      size_t m_uSize;
+   };
+
+   /* ProbeConnection results */
+   enum ConnectionState
+   {
+      CONNECTION_ALIVE,
+      CONNECTION_CLOSED,   // the peer shut down or reset the connection
+      CONNECTION_READABLE, // bytes nobody asked for are waiting (e.g. an error message)
+      CONNECTION_ERROR
+   };
+
    enum SettingsFlag
    {
       NO_FLAGS = 0x00,
@@ -73,12 +98,43 @@ public:
 
    static int SelectSocket(const Socket sd, const size_t msec);
 
+   /* checks, without waiting nor consuming anything, whether an idle connection can still
+    * be used : a closed connection is readable and a peeked recv returns 0 */
+   static ConnectionState ProbeConnection(const Socket sd);
+
    static struct timeval TimevalFromMsec(unsigned int time_msec);
 
    // String Helpers
    static std::string StringFormat(const std::string strFormat, ...);
 
 protected:
+   /* sendmsg/recvmsg (WSASend/WSARecv) loops resuming after partial transfers.
+    * SendBuffers returns false on error, ReceiveBuffers returns like recv : the count
+    * of received bytes (which can be less than asked if the peer shut down), 0 if the
+    * peer shut down before anything was received and -1 on error. */
+   static bool SendBuffers(const Socket sd, const ConstBuffer* pBuffers, const size_t uCount);
+   static int ReceiveBuffers(const Socket sd, const MutableBuffer* pBuffers, const size_t uCount,
+                             const bool bReadFully);
+
+#ifndef WINDOWS
+   /* sends uSize bytes of a file from Offset : sendfile() under Linux (the pages go from
+    * the page cache to the socket without a user space copy), pread/send elsewhere.
+    * Returns false with errno set on error, a send timeout (SetSndTimeout) gives EAGAIN.
+    * OpenFile returns -1 if strPath can't be opened and sets uSize, if it's 0, to the
+    * bytes following Offset. */
+   static bool SendFileRange(const Socket sd, const int iFileFd, off_t Offset, size_t uSize);
+   static int OpenFile(const std::string& strPath, const off_t Offset, size_t& uSize);
+
+   /* the AF_UNIX address of strPath : a file path or, under Linux, an abstract name (starting
+    * with '@' or '\0', not bound to a file). False if it's empty or doesn't fit in sun_path. */
+   static bool MakeUnixAddress(const std::string& strPath, struct sockaddr_un& Addr, socklen_t& uAddrLen);
+#endif
+
+#ifdef LINUX
+   /* whether the connection's SYN carried data which the server acknowledged (TCP Fast Open) */
+   static bool IsSynDataAcked(const Socket sd);
+#endif
+
    // Log printer callback
    /*mutable*/const LogFnCallback         m_oLog;
 
@@ -0,0 +1,224 @@
+/**
+* @file SocketMultiplexer.cpp
+* @brief implementation of the multi-socket wait
+*/
+
+#include "SocketMultiplexer.h"
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#ifdef WINDOWS
+#define poll WSAPoll
+#endif
+
+namespace
+{
+#ifdef LINUX
+   uint32_t ToNativeEvents(const unsigned int uInterest)
+   {
+      return ((uInterest & CSocketMultiplexer::EVENT_READ) ? static_cast<uint32_t>(EPOLLIN) : 0u) |
+             ((uInterest & CSocketMultiplexer::EVENT_WRITE) ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+   }
+
+   unsigned int FromNativeEvents(const uint32_t uEvents)
+   {
+      return ((uEvents & EPOLLIN) ? static_cast<unsigned int>(CSocketMultiplexer::EVENT_READ) : 0u) |
+             ((uEvents & EPOLLOUT) ? static_cast<unsigned int>(CSocketMultiplexer::EVENT_WRITE) : 0u) |
+             ((uEvents & (EPOLLERR | EPOLLHUP)) ? static_cast<unsigned int>(CSocketMultiplexer::EVENT_ERROR) : 0u);
+   }
+#else
+   short ToNativeEvents(const unsigned int uInterest)
+   {
+      return ((uInterest & CSocketMultiplexer::EVENT_READ) ? POLLIN : 0) |
+             ((uInterest & CSocketMultiplexer::EVENT_WRITE) ? POLLOUT : 0);
+   }
+
+   unsigned int FromNativeEvents(const short iEvents)
+   {
+      return ((iEvents & POLLIN) ? static_cast<unsigned int>(CSocketMultiplexer::EVENT_READ) : 0u) |
+             ((iEvents & POLLOUT) ? static_cast<unsigned int>(CSocketMultiplexer::EVENT_WRITE) : 0u) |
+             ((iEvents & (POLLERR | POLLHUP | POLLNVAL)) ? static_cast<unsigned int>(CSocketMultiplexer::EVENT_ERROR) : 0u);
+   }
+#endif
+}
+
+CSocketMultiplexer::CSocketMultiplexer(const ASocket::LogFnCallback& oLogger,
+                                       const ASocket::SettingsFlag eSettings /*= ASocket::ALL_FLAGS*/) :
+   m_oLog(oLogger),
+   m_eSettingsFlags(eSettings)
+#ifdef LINUX
+   , m_iEpollFd(epoll_create1(EPOLL_CLOEXEC))
+#endif
+{
+#ifdef LINUX
+   if (m_iEpollFd < 0 && (m_eSettingsFlags & ASocket::ENABLE_LOG))
+      m_oLog(ASocket::StringFormat("[SocketMultiplexer][Error] epoll_create1 failed : %s", strerror(errno)));
+#endif
+}
+
+CSocketMultiplexer::~CSocketMultiplexer()
+{
+#ifdef LINUX
+   if (m_iEpollFd >= 0)
+      close(m_iEpollFd);
+#endif
+}
+
+bool CSocketMultiplexer::IsValid() const
+{
+#ifdef LINUX
+   return m_iEpollFd >= 0;
+#else
+   return true;
+#endif
+}
+
+bool CSocketMultiplexer::Add(const ASocket::Socket Sock, const unsigned int uInterest /*= EVENT_READ*/)
+{
+   if (Sock == INVALID_SOCKET || !IsValid() || m_mapInterests.count(Sock) != 0)
+      return false;
+
+#ifdef LINUX
+   struct epoll_event Event;
+   memset(&Event, 0, sizeof(Event));
+   Event.events = ToNativeEvents(uInterest);
+   Event.data.fd = Sock;
+   if (epoll_ctl(m_iEpollFd, EPOLL_CTL_ADD, Sock, &Event) < 0)
+   {
+      if (m_eSettingsFlags & ASocket::ENABLE_LOG)
+         m_oLog(ASocket::StringFormat("[SocketMultiplexer][Error] epoll_ctl(ADD) failed : %s", strerror(errno)));
+
+      return false;
+   }
+#else
+   struct pollfd PollFd;
+   PollFd.fd = Sock;
+   PollFd.events = ToNativeEvents(uInterest);
+   PollFd.revents = 0;
+   m_mapIndexes[Sock] = m_vecPollFds.size();
+   m_vecPollFds.push_back(PollFd);
+#endif
+
+   m_mapInterests[Sock] = uInterest;
+   return true;
+}
+
+bool CSocketMultiplexer::Modify(const ASocket::Socket Sock, const unsigned int uInterest)
+{
+   auto it = m_mapInterests.find(Sock);
+   if (it == m_mapInterests.end())
+      return false;
+
+#ifdef LINUX
+   struct epoll_event Event;
+   memset(&Event, 0, sizeof(Event));
+   Event.events = ToNativeEvents(uInterest);
+   Event.data.fd = Sock;
+   if (epoll_ctl(m_iEpollFd, EPOLL_CTL_MOD, Sock, &Event) < 0)
+   {
+      if (m_eSettingsFlags & ASocket::ENABLE_LOG)
+         m_oLog(ASocket::StringFormat("[SocketMultiplexer][Error] epoll_ctl(MOD) failed : %s", strerror(errno)));
+
+      return false;
+   }
+#else
+   m_vecPollFds[m_mapIndexes[Sock]].events = ToNativeEvents(uInterest);
+#endif
+
+   it->second = uInterest;
+   return true;
+}
+
+bool CSocketMultiplexer::Remove(const ASocket::Socket Sock)
+{
+   auto it = m_mapInterests.find(Sock);
+   if (it == m_mapInterests.end())
+      return false;
+
+   m_mapInterests.erase(it);
+
+#ifdef LINUX
+   // the event argument is ignored but must not be null before Linux 2.6.9
+   struct epoll_event Event;
+   memset(&Event, 0, sizeof(Event));
+   return epoll_ctl(m_iEpollFd, EPOLL_CTL_DEL, Sock, &Event) == 0;
+#else
+   // the last entry takes the place of the removed one
+   auto itIndex = m_mapIndexes.find(Sock);
+   const size_t uIndex = itIndex->second;
+   m_mapIndexes.erase(itIndex);
+   if (uIndex + 1 != m_vecPollFds.size())
+   {
+      m_vecPollFds[uIndex] = m_vecPollFds.back();
+      m_mapIndexes[m_vecPollFds[uIndex].fd] = uIndex;
+   }
+   m_vecPollFds.pop_back();
+   return true;
+#endif
+}
+
+int CSocketMultiplexer::Wait(std::vector<Event>& vecReady, const int iTimeoutMs)
+{
+   vecReady.clear();
+   if (!IsValid())
+      return -1;
+
+#ifdef LINUX
+   // room for every socket : all the ready ones are returned by a single call
+   if (m_vecEvents.size() < m_mapInterests.size() || m_vecEvents.empty())
+      m_vecEvents.resize(m_mapInterests.empty() ? 1 : m_mapInterests.size());
+
+   int iReady;
+   do
+   {
+      iReady = epoll_wait(m_iEpollFd, m_vecEvents.data(), static_cast<int>(m_vecEvents.size()), iTimeoutMs);
+   } while (iReady < 0 && errno == EINTR);
+
+   if (iReady < 0)
+   {
+      if (m_eSettingsFlags & ASocket::ENABLE_LOG)
+         m_oLog(ASocket::StringFormat("[SocketMultiplexer][Error] epoll_wait failed : %s", strerror(errno)));
+
+      return -1;
+   }
+
+   vecReady.reserve(iReady);
+   for (int i = 0; i < iReady; ++i)
+      vecReady.push_back(Event{ m_vecEvents[i].data.fd, FromNativeEvents(m_vecEvents[i].events) });
+
+   return iReady;
+#else
+   // like epoll_wait on an empty set : nothing becomes ready before the timeout
+   if (m_vecPollFds.empty())
+   {
+      if (iTimeoutMs > 0)
+         std::this_thread::sleep_for(std::chrono::milliseconds(iTimeoutMs));
+      return 0;
+   }
+
+   int iReady = poll(m_vecPollFds.data(), static_cast<unsigned long>(m_vecPollFds.size()), iTimeoutMs);
+   #ifndef WINDOWS
+   while (iReady < 0 && errno == EINTR)
+      iReady = poll(m_vecPollFds.data(), static_cast<nfds_t>(m_vecPollFds.size()), iTimeoutMs);
+   #endif
+
+   if (iReady < 0)
+   {
+      if (m_eSettingsFlags & ASocket::ENABLE_LOG)
+         m_oLog("[SocketMultiplexer][Error] poll failed.");
+
+      return -1;
+   }
+
+   vecReady.reserve(iReady);
+   for (size_t i = 0; i < m_vecPollFds.size() && vecReady.size() < static_cast<size_t>(iReady); ++i)
+   {
+      if (m_vecPollFds[i].revents != 0)
+         vecReady.push_back(Event{ m_vecPollFds[i].fd, FromNativeEvents(m_vecPollFds[i].revents) });
+   }
+
+   return static_cast<int>(vecReady.size());
+#endif
+}
@@ -0,0 +1,79 @@
+/*
+* @file SocketMultiplexer.h
+* @brief waits on many sockets at once : epoll under Linux, poll (WSAPoll) elsewhere
+* @date 2026-10-17
+*
+* ASocket::SelectSockets rebuilds an fd_set on each call, can't watch descriptors above
+* FD_SETSIZE and only reports the first ready socket. A CSocketMultiplexer registers its
+* sockets once, with the events they are watched for, and each Wait returns every ready
+* socket with its read/write/error flags. Readiness is level-triggered, like select : a
+* socket is reported again as long as it has unread data (or room to write).
+*/
+
+#ifndef INCLUDE_SOCKETMULTIPLEXER_H_
+#define INCLUDE_SOCKETMULTIPLEXER_H_
+
+#include <unordered_map>
+#include <vector>
+
+#include "Socket.h"
+
+#ifdef LINUX
+#include <sys/epoll.h>
+#elif !defined(WINDOWS)
+#include <poll.h>
+#endif
+
+class CSocketMultiplexer
+{
+public:
+   enum EventFlag
+   {
+      EVENT_NONE  = 0x00,
+      EVENT_READ  = 0x01, // data, a pending connection (listen socket) or the peer's shutdown
+      EVENT_WRITE = 0x02,
+      EVENT_ERROR = 0x04  // error or hang-up, reported even if not asked for
+   };
+
+   struct Event
+   {
+      ASocket::Socket m_Socket;
+      unsigned int    m_uFlags; // EventFlag values
+   };
+
+   explicit CSocketMultiplexer(const ASocket::LogFnCallback& oLogger,
+                               const ASocket::SettingsFlag eSettings = ASocket::ALL_FLAGS);
+   ~CSocketMultiplexer();
+
+   CSocketMultiplexer(const CSocketMultiplexer&) = delete;
+   CSocketMultiplexer& operator=(const CSocketMultiplexer&) = delete;
+
+   /* uInterest is a combination of EVENT_READ and EVENT_WRITE. The sockets must be removed
+    * before being closed. */
+   bool Add(const ASocket::Socket Sock, const unsigned int uInterest = EVENT_READ);
+   bool Modify(const ASocket::Socket Sock, const unsigned int uInterest);
+   bool Remove(const ASocket::Socket Sock);
+
+   /* waits up to iTimeoutMs (-1 : no timeout, 0 : doesn't block) and fills vecReady with
+    * all the ready sockets. Returns their count, 0 on timeout and -1 on error. */
+   int Wait(std::vector<Event>& vecReady, const int iTimeoutMs);
+
+   size_t GetSocketCount() const { return m_mapInterests.size(); }
+   bool IsValid() const;
+
+protected:
+   ASocket::LogFnCallback m_oLog;
+   ASocket::SettingsFlag  m_eSettingsFlags;
+
+   std::unordered_map<ASocket::Socket, unsigned int> m_mapInterests;
+
+#ifdef LINUX
+   int m_iEpollFd;
+   std::vector<struct epoll_event> m_vecEvents; // as large as the socket count
+#else
+   std::vector<struct pollfd> m_vecPollFds;
+   std::unordered_map<ASocket::Socket, size_t> m_mapIndexes; // position in m_vecPollFds
+#endif
+};
+
+#endif
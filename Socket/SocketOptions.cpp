@@ -0,0 +1,198 @@
+/**
+* @file SocketOptions.cpp
+* @brief implementation of the typed socket options
+*/
+
+#include "SocketOptions.h"
+
+#include <cstring>
+
+#ifndef WINDOWS
+#include <netinet/ip.h>
+#include <netinet/tcp.h>
+#endif
+
+namespace
+{
+   bool SetIntOption(const ASocket::Socket sd, const int iLevel, const int iName, const int iValue,
+                     const char* szName, const ASocket::LogFnCallback& oLog)
+   {
+      if (setsockopt(sd, iLevel, iName, reinterpret_cast<const char*>(&iValue), sizeof(iValue)) == 0)
+         return true;
+
+      if (oLog)
+      {
+#ifdef WINDOWS
+         oLog(ASocket::StringFormat("[SocketOptions][Error] %s : setsockopt failed : %d", szName, WSAGetLastError()));
+#else
+         oLog(ASocket::StringFormat("[SocketOptions][Error] %s : setsockopt failed : %s", szName, strerror(errno)));
+#endif
+      }
+      return false;
+   }
+
+   template <typename T>
+   bool GetIntOption(const ASocket::Socket sd, const int iLevel, const int iName, CSocketOptions::Option<T>& Value)
+   {
+      int iValue = 0;
+      socklen_t uLen = sizeof(iValue);
+      if (getsockopt(sd, iLevel, iName, reinterpret_cast<char*>(&iValue), &uLen) != 0)
+      {
+         Value.Reset();
+         return false;
+      }
+
+      Value.Set(static_cast<T>(iValue));
+      return true;
+   }
+
+   // IP_TOS only applies to IPv4, the same bits are the traffic class for IPv6
+   bool IsIPv6(const ASocket::Socket sd)
+   {
+      struct sockaddr_storage Addr;
+      socklen_t uLen = sizeof(Addr);
+      memset(&Addr, 0, sizeof(Addr));
+      return getsockname(sd, reinterpret_cast<struct sockaddr*>(&Addr), &uLen) == 0 && Addr.ss_family == AF_INET6;
+   }
+}
+
+bool CSocketOptions::IsEmpty() const
+{
+   return !m_SendBufferSize.m_bSet && !m_ReceiveBufferSize.m_bSet && !m_NoDelay.m_bSet &&
+          !m_TypeOfService.m_bSet && !m_Linger.m_bSet && !m_Cork.m_bSet && !m_NotSentLowAt.m_bSet && !m_QuickAck.m_bSet &&
+          !m_CongestionControl.m_bSet && !m_Priority.m_bSet;
+}
+
+bool CSocketOptions::Apply(const ASocket::Socket sd, const ASocket::LogFnCallback& oLog /*= LogFnCallback()*/) const
+{
+   if (sd == INVALID_SOCKET)
+      return false;
+
+   bool bOk = true;
+
+   if (m_SendBufferSize.m_bSet)
+      bOk &= SetIntOption(sd, SOL_SOCKET, SO_SNDBUF, m_SendBufferSize.m_Value, "SO_SNDBUF", oLog);
+
+   if (m_ReceiveBufferSize.m_bSet)
+      bOk &= SetIntOption(sd, SOL_SOCKET, SO_RCVBUF, m_ReceiveBufferSize.m_Value, "SO_RCVBUF", oLog);
+
+   if (m_NoDelay.m_bSet)
+      bOk &= SetIntOption(sd, IPPROTO_TCP, TCP_NODELAY, m_NoDelay.m_Value ? 1 : 0, "TCP_NODELAY", oLog);
+
+   if (m_TypeOfService.m_bSet)
+   {
+      if (IsIPv6(sd))
+         bOk &= SetIntOption(sd, IPPROTO_IPV6, IPV6_TCLASS, m_TypeOfService.m_Value, "IPV6_TCLASS", oLog);
+      else
+         bOk &= SetIntOption(sd, IPPROTO_IP, IP_TOS, m_TypeOfService.m_Value, "IP_TOS", oLog);
+   }
+
+   if (m_Linger.m_bSet)
+   {
+      struct linger Linger;
+      Linger.l_onoff = (m_Linger.m_Value >= 0) ? 1 : 0;
+      Linger.l_linger = (m_Linger.m_Value >= 0) ? m_Linger.m_Value : 0;
+
+      if (setsockopt(sd, SOL_SOCKET, SO_LINGER, reinterpret_cast<const char*>(&Linger), sizeof(Linger)) != 0)
+      {
+         if (oLog)
+         {
+#ifdef WINDOWS
+            oLog(ASocket::StringFormat("[SocketOptions][Error] SO_LINGER : setsockopt failed : %d", WSAGetLastError()));
+#else
+            oLog(ASocket::StringFormat("[SocketOptions][Error] SO_LINGER : setsockopt failed : %s", strerror(errno)));
+#endif
+         }
+         bOk = false;
+      }
+   }
+
+#ifdef LINUX
+   if (m_Cork.m_bSet)
+      bOk &= SetIntOption(sd, IPPROTO_TCP, TCP_CORK, m_Cork.m_Value ? 1 : 0, "TCP_CORK", oLog);
+
+   if (m_NotSentLowAt.m_bSet)
+      bOk &= SetIntOption(sd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, static_cast<int>(m_NotSentLowAt.m_Value),
+                          "TCP_NOTSENT_LOWAT", oLog);
+
+   if (m_QuickAck.m_bSet)
+      bOk &= SetIntOption(sd, IPPROTO_TCP, TCP_QUICKACK, m_QuickAck.m_Value ? 1 : 0, "TCP_QUICKACK", oLog);
+
+   if (m_Priority.m_bSet)
+      bOk &= SetIntOption(sd, SOL_SOCKET, SO_PRIORITY, m_Priority.m_Value, "SO_PRIORITY", oLog);
+
+   if (m_CongestionControl.m_bSet &&
+       setsockopt(sd, IPPROTO_TCP, TCP_CONGESTION, m_CongestionControl.m_Value.c_str(),
+                  static_cast<socklen_t>(m_CongestionControl.m_Value.size())) != 0)
+   {
+      // ENOENT : not built in nor loadable, EPERM : not in net.ipv4.tcp_allowed_congestion_control
+      if (oLog)
+         oLog(ASocket::StringFormat("[SocketOptions][Error] TCP_CONGESTION '%s' : setsockopt failed : %s",
+                                    m_CongestionControl.m_Value.c_str(), strerror(errno)));
+      bOk = false;
+   }
+#endif
+
+   return bOk;
+}
+
+bool CSocketOptions::Read(const ASocket::Socket sd, CSocketOptions& Options)
+{
+   Options = CSocketOptions();
+   if (sd == INVALID_SOCKET)
+      return false;
+
+   bool bOk = true;
+   bOk &= GetIntOption(sd, SOL_SOCKET, SO_SNDBUF, Options.m_SendBufferSize);
+   bOk &= GetIntOption(sd, SOL_SOCKET, SO_RCVBUF, Options.m_ReceiveBufferSize);
+   bOk &= GetIntOption(sd, IPPROTO_TCP, TCP_NODELAY, Options.m_NoDelay);
+
+   if (IsIPv6(sd))
+      bOk &= GetIntOption(sd, IPPROTO_IPV6, IPV6_TCLASS, Options.m_TypeOfService);
+   else
+      bOk &= GetIntOption(sd, IPPROTO_IP, IP_TOS, Options.m_TypeOfService);
+
+   struct linger Linger;
+   socklen_t uLingerLen = sizeof(Linger);
+   memset(&Linger, 0, sizeof(Linger));
+   if (getsockopt(sd, SOL_SOCKET, SO_LINGER, reinterpret_cast<char*>(&Linger), &uLingerLen) == 0)
+      Options.m_Linger.Set(Linger.l_onoff ? Linger.l_linger : -1);
+   else
+      bOk = false;
+
+#ifdef LINUX
+   bOk &= GetIntOption(sd, IPPROTO_TCP, TCP_CORK, Options.m_Cork);
+   bOk &= GetIntOption(sd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, Options.m_NotSentLowAt);
+   bOk &= GetIntOption(sd, IPPROTO_TCP, TCP_QUICKACK, Options.m_QuickAck);
+   bOk &= GetIntOption(sd, SOL_SOCKET, SO_PRIORITY, Options.m_Priority);
+
+   char szAlgorithm[16] = {}; // TCP_CA_NAME_MAX
+   socklen_t uLen = sizeof(szAlgorithm);
+   if (getsockopt(sd, IPPROTO_TCP, TCP_CONGESTION, szAlgorithm, &uLen) == 0)
+      Options.m_CongestionControl.Set(std::string(szAlgorithm, strnlen(szAlgorithm, uLen)));
+   else
+      bOk = false;
+#endif
+
+   return bOk;
+}
+
+bool CSocketOptions::Flush(const ASocket::Socket sd)
+{
+#ifdef LINUX
+   int iCorked = 0;
+   socklen_t uLen = sizeof(iCorked);
+   if (getsockopt(sd, IPPROTO_TCP, TCP_CORK, &iCorked, &uLen) != 0)
+      return false;
+   if (iCorked == 0)
+      return true;
+
+   // removing the cork pushes the pending partial frame out
+   const int iOff = 0;
+   const int iOn = 1;
+   return setsockopt(sd, IPPROTO_TCP, TCP_CORK, &iOff, sizeof(iOff)) == 0 &&
+          setsockopt(sd, IPPROTO_TCP, TCP_CORK, &iOn, sizeof(iOn)) == 0;
+#else
+   return sd != INVALID_SOCKET;
+#endif
+}
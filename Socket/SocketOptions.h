@@ -0,0 +1,95 @@
+/*
+* @file SocketOptions.h
+* @brief typed per-socket tuning : buffer sizes, Nagle, corking, queuing, congestion control, QoS
+* @date 2026-10-17
+*
+* Apart from SO_REUSEADDR, keep-alive and the timeouts, the sockets are left with the kernel's
+* defaults. A CSocketOptions holds the options to change, each one being left untouched by
+* Apply unless it was set, and is given to a client (applied on each Connect) or to a server
+* (applied to its listen socket and to every accepted client), or applied directly to any
+* socket. Read fills one with the values in effect on a socket, which may differ from the
+* requested ones : Linux doubles SO_SNDBUF/SO_RCVBUF for its bookkeeping and caps them with
+* net.core.wmem_max/rmem_max.
+*/
+
+#ifndef INCLUDE_SOCKETOPTIONS_H_
+#define INCLUDE_SOCKETOPTIONS_H_
+
+#include <string>
+
+#include "Socket.h"
+
+class CSocketOptions
+{
+public:
+   template <typename T>
+   struct Option
+   {
+      bool m_bSet = false;
+      T    m_Value = T();
+
+      void Set(const T& Value) { m_Value = Value; m_bSet = true; }
+      void Reset() { m_bSet = false; m_Value = T(); }
+   };
+
+   // the setters can be chained : CSocketOptions().SetNoDelay(true).SetSendBufferSize(1 << 20)
+   CSocketOptions& SetSendBufferSize(const int iBytes) { m_SendBufferSize.Set(iBytes); return *this; }
+   CSocketOptions& SetReceiveBufferSize(const int iBytes) { m_ReceiveBufferSize.Set(iBytes); return *this; }
+
+   // TCP_NODELAY : disables Nagle's algorithm, small writes are sent right away
+   CSocketOptions& SetNoDelay(const bool bNoDelay) { m_NoDelay.Set(bNoDelay); return *this; }
+
+   // IP_TOS (IPV6_TCLASS for IPv6 sockets) : DSCP and ECN bits of the outgoing packets
+   CSocketOptions& SetTypeOfService(const int iTos) { m_TypeOfService.Set(iTos); return *this; }
+
+   /* SO_LINGER : close() waits up to iSeconds for the unsent bytes. 0 resets the connection
+    * instead (RST, the unsent bytes are dropped and no TIME_WAIT is left), -1 : the default */
+   CSocketOptions& SetLinger(const int iSeconds) { m_Linger.Set(iSeconds); return *this; }
+
+#ifdef LINUX
+   /* TCP_CORK : partial frames are held until the cork is removed (see Flush), at most 200 ms,
+    * so that a header and its body written separately leave in full-sized segments */
+   CSocketOptions& SetCork(const bool bCork) { m_Cork.Set(bCork); return *this; }
+
+   /* TCP_NOTSENT_LOWAT : the socket is reported writable only while fewer than uBytes wait
+    * unsent, bounding what's queued in the kernel (and its latency) without shrinking SO_SNDBUF */
+   CSocketOptions& SetNotSentLowAt(const unsigned int uBytes) { m_NotSentLowAt.Set(uBytes); return *this; }
+
+   /* TCP_QUICKACK : ACKs are sent immediately instead of being delayed. The kernel clears it
+    * by itself, it has to be set again after receiving to stay in effect. */
+   CSocketOptions& SetQuickAck(const bool bQuickAck) { m_QuickAck.Set(bQuickAck); return *this; }
+
+   // TCP_CONGESTION : "cubic", "bbr"... one of net.ipv4.tcp_available_congestion_control
+   CSocketOptions& SetCongestionControl(const std::string& strAlgorithm) { m_CongestionControl.Set(strAlgorithm); return *this; }
+
+   // SO_PRIORITY : queuing priority of the packets (0 to 6 without CAP_NET_ADMIN)
+   CSocketOptions& SetPriority(const int iPriority) { m_Priority.Set(iPriority); return *this; }
+#endif
+
+   bool IsEmpty() const;
+
+   /* sets every option which was set on sd. An option the kernel refuses is logged (if oLog
+    * is given) and doesn't prevent the others from being applied : returns false if any failed. */
+   bool Apply(const ASocket::Socket sd, const ASocket::LogFnCallback& oLog = ASocket::LogFnCallback()) const;
+
+   /* the values in effect on sd : all the options are set on return. False if one of them
+    * couldn't be read (it's then left unset). */
+   static bool Read(const ASocket::Socket sd, CSocketOptions& Options);
+
+   /* sends the frames held by TCP_CORK now, the socket stays corked for the next writes.
+    * Does nothing if sd isn't corked. */
+   static bool Flush(const ASocket::Socket sd);
+
+   Option<int>          m_SendBufferSize;
+   Option<int>          m_ReceiveBufferSize;
+   Option<bool>         m_NoDelay;
+   Option<int>          m_TypeOfService;
+   Option<int>          m_Linger;
+   Option<bool>         m_Cork;
+   Option<unsigned int> m_NotSentLowAt;
+   Option<bool>         m_QuickAck;
+   Option<std::string>  m_CongestionControl;
+   Option<int>          m_Priority;
+};
+
+#endif
@@ -6,12 +6,26 @@
 
 #include "TCPClient.h"
 
+#include <chrono>
+
+#ifndef WINDOWS
+#include <fcntl.h>
+#include <poll.h>
+#endif
+
+const unsigned int CTCPClient::DEFAULT_CONNECTION_ATTEMPT_DELAY_MS;
+
 CTCPClient::CTCPClient(const LogFnCallback oLogger,
                        const SettingsFlag eSettings /*= ALL_FLAGS*/) :
    ASocket(oLogger, eSettings),
    m_eStatus(DISCONNECTED),
-   m_pResultAddrInfo(nullptr),
-   m_ConnectSocket(INVALID_SOCKET)
+   m_ConnectSocket(INVALID_SOCKET),
+   m_ConnectedAddress(),
+   m_uAttemptDelayMs(DEFAULT_CONNECTION_ATTEMPT_DELAY_MS),
+   m_SocketOptions()
+#ifdef LINUX
+   , m_bFastOpenUsed(false)
+#endif
    //m_uRetryCount(0),
    //m_uRetryPeriod(0)
 {
@@ -104,43 +118,35 @@ bool CTCPClient::Connect(const std::string& strServer, const std::string& strPor
          m_oLog("[TCPClient][Warning] Opening a new connexion. The last one was automatically closed.");
    }
 
-   #ifdef WINDOWS
-   ZeroMemory(&m_HintsAddrInfo, sizeof(m_HintsAddrInfo));
-   /* AF_INET is used to specify the IPv4 address family. */
-   m_HintsAddrInfo.ai_family = AF_INET;			
-   /* SOCK_STREAM is used to specify a stream socket. */
-   m_HintsAddrInfo.ai_socktype = SOCK_STREAM;
-   /* IPPROTO_TCP is used to specify the TCP protocol. */
-   m_HintsAddrInfo.ai_protocol = IPPROTO_TCP;
-
-   /* Resolve the server address and port */
-   int iResult = getaddrinfo(strServer.c_str(), strPort.c_str(), &m_HintsAddrInfo, &m_pResultAddrInfo);
-   if (iResult != 0)
+   /* Resolve the server address and port : literal addresses and recently resolved
+    * servers don't go through getaddrinfo (see CDnsCache) */
+   std::vector<CDnsCache::Address> vecAddresses;
+   int iAddrInfoRet = CDnsCache::Resolve(strServer, strPort, AF_INET, vecAddresses);
+   if (iAddrInfoRet != 0)
    {
       if (m_eSettingsFlags & ENABLE_LOG)
-         m_oLog(StringFormat("[TCPClient][Error] getaddrinfo failed : %d", iResult));
-
-      if (m_pResultAddrInfo != nullptr)
-      {
-         freeaddrinfo(m_pResultAddrInfo);
-         m_pResultAddrInfo = nullptr;
-      }
+      #ifdef WINDOWS
+         m_oLog(StringFormat("[TCPClient][Error] getaddrinfo failed : %d", iAddrInfoRet));
+      #else
+         m_oLog(StringFormat("[TCPClient][Error] getaddrinfo failed : %s", gai_strerror(iAddrInfoRet)));
+      #endif
 
       return false;
    }
 
+   #ifdef WINDOWS
+   const CDnsCache::Address& oAddress = vecAddresses.front();
+
    // socket creation
-   m_ConnectSocket = socket(m_pResultAddrInfo->ai_family,   // AF_INET
-                            m_pResultAddrInfo->ai_socktype, // SOCK_STREAM
-                            m_pResultAddrInfo->ai_protocol);// IPPROTO_TCP
+   m_ConnectSocket = socket(oAddress.m_iFamily,   // AF_INET
+                            oAddress.m_iSockType, // SOCK_STREAM
+                            oAddress.m_iProtocol);// IPPROTO_TCP
 
    if (m_ConnectSocket == INVALID_SOCKET)
    {
       if (m_eSettingsFlags & ENABLE_LOG)
          m_oLog(StringFormat("[TCPClient][Error] socket failed : %d", WSAGetLastError()));
 
-      freeaddrinfo(m_pResultAddrInfo);
-      m_pResultAddrInfo = nullptr;
       return false;
    }
 
@@ -155,132 +161,353 @@ bool CTCPClient::Connect(const std::string& strServer, const std::string& strPor
          m_oLog("[TCPClient][Error] Socket error in call to setsockopt");
 
       closesocket(m_ConnectSocket);
-      freeaddrinfo(m_pResultAddrInfo); m_pResultAddrInfo = nullptr;
 
       return false;
    }
-   
-   /*
-   SOCKET ConnectSocket = INVALID_SOCKET;
-   struct sockaddr_in clientService; 
 
-   ConnectSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-   if (ConnectSocket == INVALID_SOCKET) {
-      printf("Error at socket(): %ld\n", WSAGetLastError());
-      WSACleanup();
-      return 1;
-   }
-
-   // The sockaddr_in structure specifies the address family,
-   // IP address, and port of the server to be connected to.
-   clientService.sin_family = AF_INET;
-   clientService.sin_addr.s_addr = inet_addr("127.0.0.1");
-   clientService.sin_port = htons(27015);
-   */
+   ApplyConnectOptions(m_ConnectSocket);
 
    // connexion to the server
-   //unsigned uRetry = 0;
-   //do
-   //{
-      iResult = connect(m_ConnectSocket,
-                        m_pResultAddrInfo->ai_addr,
-                        static_cast<int>(m_pResultAddrInfo->ai_addrlen));
-//iResult = connect(m_ConnectSocket, (SOCKADDR*)&clientService, sizeof(clientService));
-
-      //if (iResult != SOCKET_ERROR)
-         //break;
-
-      // retry mechanism
-      //if (uRetry < m_uRetryCount)
-         //if (m_eSettingsFlags & ENABLE_LOG)
-            /*m_oLog(StringFormat("[TCPClient][Error] connect retry %u after %u second(s)",
-            m_uRetryCount + 1, m_uRetryPeriod));*/
-
-      //if (m_uRetryPeriod > 0)
-      //{
-         //for (unsigned uSec = 0; uSec < m_uRetryPeriod; uSec++)
-            //Sleep(1000);
-      //}
-   //} while (iResult == SOCKET_ERROR && ++uRetry < m_uRetryCount);
-   
-   freeaddrinfo(m_pResultAddrInfo);
-   m_pResultAddrInfo = nullptr;
+   int iResult = connect(m_ConnectSocket,
+                         oAddress.GetSockAddr(),
+                         static_cast<int>(oAddress.m_uSockAddrLen));
 
    if (iResult != SOCKET_ERROR)
    {
       m_eStatus = CONNECTED;
+      m_ConnectedAddress = oAddress;
       return true;
    }
    if (m_eSettingsFlags & ENABLE_LOG)
       m_oLog(StringFormat("[TCPClient][Error] Unable to connect to server : %d", WSAGetLastError()));
 
    #else
-   memset(&m_HintsAddrInfo, 0, sizeof m_HintsAddrInfo);
-   m_HintsAddrInfo.ai_family = AF_INET; // AF_INET or AF_INET6 to force version or use AF_UNSPEC
-   m_HintsAddrInfo.ai_socktype = SOCK_STREAM;
-   //m_HintsAddrInfo.ai_flags = 0;
-   //m_HintsAddrInfo.ai_protocol = 0; /* Any protocol */
+   /* Try each address until we successfully connect(2).
+    * If socket(2) (or connect(2)) fails, we (close the socket
+    * and) try the next address. */
+   for (const CDnsCache::Address& oAddress : vecAddresses)
+   {
+      // create socket
+      m_ConnectSocket = socket(oAddress.m_iFamily, oAddress.m_iSockType, oAddress.m_iProtocol);
+      if (m_ConnectSocket < 0) // or == -1
+         continue;
+
+      ApplyConnectOptions(m_ConnectSocket);
 
-   int iAddrInfoRet = getaddrinfo(strServer.c_str(), strPort.c_str(), &m_HintsAddrInfo, &m_pResultAddrInfo);
+      // connexion to the server
+      int iConRet = connect(m_ConnectSocket, oAddress.GetSockAddr(), oAddress.m_uSockAddrLen);
+      if (iConRet >= 0) // or != -1
+      {
+         /* Success */
+         m_eStatus = CONNECTED;
+         m_ConnectedAddress = oAddress;
+         return true;
+      }
+
+      close(m_ConnectSocket);
+   }
+
+   /* No address succeeded */
+   if (m_eSettingsFlags & ENABLE_LOG)
+      m_oLog("[TCPClient][Error] no such host.");
+
+   #endif
+
+   return false;
+}
+
+#ifndef WINDOWS
+namespace
+{
+   // RFC 8305 section 4 : the families alternate, starting with the preferred one (the first result)
+   std::vector<CDnsCache::Address> InterleaveFamilies(const std::vector<CDnsCache::Address>& vecAddresses)
+   {
+      std::vector<const CDnsCache::Address*> vecPreferred;
+      std::vector<const CDnsCache::Address*> vecOthers;
+      for (const CDnsCache::Address& oAddress : vecAddresses)
+      {
+         if (oAddress.m_iFamily == vecAddresses.front().m_iFamily)
+            vecPreferred.push_back(&oAddress);
+         else
+            vecOthers.push_back(&oAddress);
+      }
+
+      std::vector<CDnsCache::Address> vecOrdered;
+      vecOrdered.reserve(vecAddresses.size());
+      for (size_t i = 0; i < vecPreferred.size() || i < vecOthers.size(); ++i)
+      {
+         if (i < vecPreferred.size())
+            vecOrdered.push_back(*vecPreferred[i]);
+         if (i < vecOthers.size())
+            vecOrdered.push_back(*vecOthers[i]);
+      }
+      return vecOrdered;
+   }
+}
+
+bool CTCPClient::Connect(const std::string& strServer, const std::string& strPort, const unsigned int uTimeoutMs)
+{
+   // both families, the race falls back on the other one
+   std::vector<CDnsCache::Address> vecAddresses;
+   int iAddrInfoRet = CDnsCache::Resolve(strServer, strPort, AF_UNSPEC, vecAddresses);
    if (iAddrInfoRet != 0)
    {
       if (m_eSettingsFlags & ENABLE_LOG)
          m_oLog(StringFormat("[TCPClient][Error] getaddrinfo failed : %s", gai_strerror(iAddrInfoRet)));
 
-      if (m_pResultAddrInfo != nullptr)
-      {
-         freeaddrinfo(m_pResultAddrInfo);
-         m_pResultAddrInfo = nullptr;
-      }
+      return false;
+   }
+
+   return Connect(vecAddresses, uTimeoutMs);
+}
+
+bool CTCPClient::Connect(const std::vector<CDnsCache::Address>& vecAddresses, const unsigned int uTimeoutMs)
+{
+   if (m_eStatus == CONNECTED)
+   {
+      Disconnect();
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog("[TCPClient][Warning] Opening a new connexion. The last one was automatically closed.");
+   }
+
+   if (vecAddresses.empty())
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog("[TCPClient][Error] no such host.");
 
       return false;
    }
 
-   /* getaddrinfo() returns a list of address structures.
-    * Try each address until we successfully connect(2).
-    * If socket(2) (or connect(2)) fails, we (close the socket
-    * and) try the next address. */
-   struct addrinfo* pResPtr = m_pResultAddrInfo;
-   for (pResPtr = m_pResultAddrInfo; pResPtr != nullptr; pResPtr = pResPtr->ai_next)
+   typedef std::chrono::steady_clock Clock;
+   const Clock::time_point StartTime = Clock::now();
+   const Clock::time_point Deadline = StartTime + std::chrono::milliseconds(uTimeoutMs);
+
+   const std::vector<CDnsCache::Address> vecOrdered = InterleaveFamilies(vecAddresses);
+   std::vector<struct pollfd> vecPending; // attempts in progress
+   std::vector<size_t> vecPendingIndex;   // their address in vecOrdered
+   size_t uNextAddress = 0;
+   Clock::time_point NextAttempt = StartTime;
+
+   Socket Winner = INVALID_SOCKET;
+   size_t uWinnerIndex = 0;
+   int iLastError = 0;
+
+   while (Winner == INVALID_SOCKET)
    {
-      // create socket
-      m_ConnectSocket = socket(pResPtr->ai_family, pResPtr->ai_socktype, pResPtr->ai_protocol);
-      if (m_ConnectSocket < 0) // or == -1
+      const Clock::time_point Now = Clock::now();
+      if (uTimeoutMs > 0 && Now >= Deadline)
+      {
+         iLastError = ETIMEDOUT;
+         break;
+      }
+
+      // a new attempt when none is in progress or when the last one has been pending for too long
+      if (uNextAddress < vecOrdered.size() && (vecPending.empty() || Now >= NextAttempt))
+      {
+         const CDnsCache::Address& oAddress = vecOrdered[uNextAddress++];
+         NextAttempt = Now + std::chrono::milliseconds(m_uAttemptDelayMs);
+
+         Socket Sock = socket(oAddress.m_iFamily, oAddress.m_iSockType, oAddress.m_iProtocol);
+         if (Sock < 0)
+         {
+            iLastError = errno;
+            continue;
+         }
+
+         const int iFlags = fcntl(Sock, F_GETFL, 0);
+         if (iFlags < 0 || fcntl(Sock, F_SETFL, iFlags | O_NONBLOCK) < 0)
+         {
+            iLastError = errno;
+            close(Sock);
+            continue;
+         }
+
+         ApplyConnectOptions(Sock);
+
+         if (connect(Sock, oAddress.GetSockAddr(), oAddress.m_uSockAddrLen) == 0)
+         {
+            Winner = Sock;
+            uWinnerIndex = uNextAddress - 1;
+            break;
+         }
+         if (errno != EINPROGRESS)
+         {
+            iLastError = errno;
+            close(Sock);
+            continue;
+         }
+
+         struct pollfd PollFd;
+         PollFd.fd = Sock;
+         PollFd.events = POLLOUT;
+         PollFd.revents = 0;
+         vecPending.push_back(PollFd);
+         vecPendingIndex.push_back(uNextAddress - 1);
          continue;
+      }
 
-      // connexion to the server
-      int iConRet = connect(m_ConnectSocket, pResPtr->ai_addr, pResPtr->ai_addrlen);
-      if (iConRet >= 0) // or != -1
+      if (vecPending.empty())
+         break; // every address failed
+
+      // wait for an attempt to complete, the next one to start or the deadline
+      Clock::time_point WakeUp = (uNextAddress < vecOrdered.size()) ? NextAttempt : Clock::time_point::max();
+      if (uTimeoutMs > 0 && Deadline < WakeUp)
+         WakeUp = Deadline;
+
+      int iWaitMs = -1;
+      if (WakeUp != Clock::time_point::max())
       {
-         /* Success */
-         m_eStatus = CONNECTED;
-         
-         if (m_pResultAddrInfo != nullptr)
+         const long long llWaitUs = std::chrono::duration_cast<std::chrono::microseconds>(WakeUp - Now).count();
+         iWaitMs = static_cast<int>(std::max(0LL, (llWaitUs + 999) / 1000));
+      }
+
+      if (poll(vecPending.data(), vecPending.size(), iWaitMs) < 0)
+      {
+         if (errno == EINTR)
+            continue;
+
+         iLastError = errno;
+         break;
+      }
+
+      for (size_t i = 0; i < vecPending.size(); )
+      {
+         if (vecPending[i].revents == 0)
          {
-            freeaddrinfo(m_pResultAddrInfo);
-            m_pResultAddrInfo = nullptr;
+            ++i;
+            continue;
          }
 
-         return true;
+         int iError = 0;
+         socklen_t ErrorLen = sizeof(iError);
+         if (getsockopt(vecPending[i].fd, SOL_SOCKET, SO_ERROR, &iError, &ErrorLen) < 0)
+            iError = errno;
+
+         if (iError == 0)
+         {
+            Winner = vecPending[i].fd;
+            uWinnerIndex = vecPendingIndex[i];
+         }
+         else
+         {
+            // a failed attempt lets the next one start right away
+            iLastError = iError;
+            close(vecPending[i].fd);
+            NextAttempt = Now;
+         }
+
+         vecPending.erase(vecPending.begin() + i);
+         vecPendingIndex.erase(vecPendingIndex.begin() + i);
+
+         if (Winner != INVALID_SOCKET)
+            break;
       }
+   }
 
-      close(m_ConnectSocket);
+   // the losers are abandoned
+   for (const struct pollfd& PollFd : vecPending)
+      close(PollFd.fd);
+
+   if (Winner == INVALID_SOCKET)
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+      {
+         if (iLastError == ETIMEDOUT)
+            m_oLog(StringFormat("[TCPClient][Error] Unable to connect to server within %u ms.", uTimeoutMs));
+         else
+            m_oLog(StringFormat("[TCPClient][Error] Unable to connect to server : %s", strerror(iLastError)));
+      }
+
+      return false;
    }
 
-   if (m_pResultAddrInfo != nullptr)
+   // back to blocking mode, like the connections opened by Connect(strServer, strPort)
+   const int iFlags = fcntl(Winner, F_GETFL, 0);
+   if (iFlags < 0 || fcntl(Winner, F_SETFL, iFlags & ~O_NONBLOCK) < 0)
    {
-      freeaddrinfo(m_pResultAddrInfo); /* No longer needed */
-      m_pResultAddrInfo = nullptr;
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[TCPClient][Error] fcntl failed : %s", strerror(errno)));
+
+      close(Winner);
+      return false;
+   }
+
+   m_ConnectSocket = Winner;
+   m_ConnectedAddress = vecOrdered[uWinnerIndex];
+   m_eStatus = CONNECTED;
+   return true;
+}
+#endif
+
+#ifdef LINUX
+bool CTCPClient::ConnectAndSend(const std::string& strServer, const std::string& strPort,
+                                const char* pData, const size_t uSize)
+{
+   if (!pData || !uSize)
+      return false;
+
+   if (m_eStatus == CONNECTED)
+   {
+      Disconnect();
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog("[TCPClient][Warning] Opening a new connexion. The last one was automatically closed.");
+   }
+   m_bFastOpenUsed = false;
+
+   std::vector<CDnsCache::Address> vecAddresses;
+   int iAddrInfoRet = CDnsCache::Resolve(strServer, strPort, AF_INET, vecAddresses);
+   if (iAddrInfoRet != 0)
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[TCPClient][Error] getaddrinfo failed : %s", gai_strerror(iAddrInfoRet)));
+
+      return false;
+   }
+
+   for (const CDnsCache::Address& oAddress : vecAddresses)
+   {
+      m_ConnectSocket = socket(oAddress.m_iFamily, oAddress.m_iSockType, oAddress.m_iProtocol);
+      if (m_ConnectSocket < 0)
+         continue;
+
+      ApplyConnectOptions(m_ConnectSocket);
+
+      /* sendto with MSG_FASTOPEN connects : the data is put in the SYN when a cookie is
+       * cached, it returns once the connection is established */
+      ssize_t nSent = sendto(m_ConnectSocket, pData, uSize, MSG_FASTOPEN | MSG_NOSIGNAL,
+                             oAddress.GetSockAddr(), oAddress.m_uSockAddrLen);
+      if (nSent < 0 && errno == EOPNOTSUPP)
+      {
+         // client side TFO disabled (net.ipv4.tcp_fastopen)
+         nSent = (connect(m_ConnectSocket, oAddress.GetSockAddr(), oAddress.m_uSockAddrLen) == 0) ? 0 : -1;
+      }
+      if (nSent < 0)
+      {
+         close(m_ConnectSocket);
+         m_ConnectSocket = INVALID_SOCKET;
+         continue;
+      }
+
+      m_eStatus = CONNECTED;
+      m_ConnectedAddress = oAddress;
+      m_bFastOpenUsed = nSent > 0 && IsSynDataAcked(m_ConnectSocket);
+
+      const size_t uSent = static_cast<size_t>(nSent);
+      if (uSent < uSize && !Send(pData + uSent, uSize - uSent))
+      {
+         Disconnect();
+         return false;
+      }
+
+      return true;
    }
 
-   /* No address succeeded */
    if (m_eSettingsFlags & ENABLE_LOG)
       m_oLog("[TCPClient][Error] no such host.");
 
-   #endif
-
    return false;
 }
+#endif
 
 bool CTCPClient::Send(const char* pData, const size_t uSize) const
 {
@@ -383,6 +610,225 @@ int CTCPClient::Receive(char* pData, const size_t uSize, bool bReadFully /*= tru
    return total;
 }
 
+bool CTCPClient::Send(const ConstBuffer* pBuffers, const size_t uCount) const
+{
+   if (!pBuffers || !uCount)
+      return false;
+
+   if (m_eStatus != CONNECTED)
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog("[TCPClient][Error] send failed : not connected to a server.");
+
+      return false;
+   }
+
+   if (!SendBuffers(m_ConnectSocket, pBuffers, uCount))
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog("[TCPClient][Error] Socket error in call to sendmsg.");
+
+      return false;
+   }
+
+   return true;
+}
+
+/* same return values as the single buffer Receive, the buffers are filled in order */
+int CTCPClient::Receive(const MutableBuffer* pBuffers, const size_t uCount, bool bReadFully /*= true*/) const
+{
+   if (!pBuffers || !uCount)
+      return -2;
+
+   if (m_eStatus != CONNECTED)
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog("[TCPClient][Error] recv failed : not connected to a server.");
+
+      return -1;
+   }
+
+   int nRecvd = ReceiveBuffers(m_ConnectSocket, pBuffers, uCount, bReadFully);
+   if (nRecvd < 0 && (m_eSettingsFlags & ENABLE_LOG))
+      m_oLog("[TCPClient][Error] Socket error in call to recvmsg.");
+
+   return nRecvd;
+}
+
+bool CTCPClient::Send(const CPooledBuffer& Buffer) const
+{
+   return Send(Buffer.Data(), Buffer.Size());
+}
+
+int CTCPClient::Receive(CPooledBuffer& Buffer, const size_t uSize, bool bReadFully /*= true*/) const
+{
+   if (!uSize)
+      return -2;
+
+   // a shared block may still be read elsewhere, it's never overwritten
+   if (!Buffer || Buffer.UseCount() > 1 || Buffer.Capacity() < uSize)
+      Buffer = CBufferPool::Acquire(uSize);
+   else
+      Buffer.Resize(uSize);
+
+   int nRecvd = Receive(Buffer.Data(), uSize, bReadFully);
+   Buffer.Resize(nRecvd > 0 ? static_cast<size_t>(nRecvd) : 0);
+
+   return nRecvd;
+}
+
+#ifndef WINDOWS
+bool CTCPClient::SendFile(const int iFileFd, const off_t Offset, const size_t uSize) const
+{
+   if (iFileFd < 0 || !uSize)
+      return false;
+
+   if (m_eStatus != CONNECTED)
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog("[TCPClient][Error] send failed : not connected to a server.");
+
+      return false;
+   }
+
+   if (!SendFileRange(m_ConnectSocket, iFileFd, Offset, uSize))
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[TCPClient][Error] Socket error in call to sendfile : %s",
+            (errno == EAGAIN || errno == EWOULDBLOCK) ? "send timeout reached" : strerror(errno)));
+
+      return false;
+   }
+
+   return true;
+}
+
+bool CTCPClient::SendFile(const std::string& strPath, const off_t Offset /*= 0*/, const size_t uSize /*= 0*/) const
+{
+   size_t uFileSize = uSize;
+   int iFileFd = OpenFile(strPath, Offset, uFileSize);
+   if (iFileFd < 0)
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[TCPClient][Error] Unable to open file '%s' : %s", strPath.c_str(), strerror(errno)));
+
+      return false;
+   }
+
+   // nothing to send after Offset
+   bool bSent = (uFileSize == 0) || SendFile(iFileFd, Offset, uFileSize);
+   close(iFileFd);
+
+   return bSent;
+}
+#endif
+
+#ifdef LINUX
+bool CTCPClient::EnableZeroCopy(const size_t uThreshold /*= CZeroCopySender::DEFAULT_THRESHOLD*/)
+{
+   if (m_eStatus != CONNECTED)
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog("[TCPClient][Error] zero-copy can't be enabled : not connected to a server.");
+
+      return false;
+   }
+
+   m_pZeroCopy.reset(new CZeroCopySender(m_ConnectSocket, uThreshold));
+   if (!m_pZeroCopy->Enable())
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[TCPClient][Warning] SO_ZEROCOPY unavailable (%s), sends will be copied.",
+                             strerror(errno)));
+
+      return false;
+   }
+
+   return true;
+}
+
+bool CTCPClient::SendZeroCopy(const char* pData, const size_t uSize,
+                              const CZeroCopySender::ReleaseFnCallback& fnReleased)
+{
+   if (!m_pZeroCopy)
+   {
+      if (!Send(pData, uSize))
+         return false;
+
+      if (fnReleased)
+         fnReleased();
+
+      return true;
+   }
+
+   if (!pData || !uSize)
+      return false;
+
+   if (m_eStatus != CONNECTED)
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog("[TCPClient][Error] send failed : not connected to a server.");
+
+      return false;
+   }
+
+   if (!m_pZeroCopy->Send(pData, uSize, fnReleased))
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[TCPClient][Error] Socket error in zero-copy send : %s", strerror(errno)));
+
+      return false;
+   }
+
+   return true;
+}
+
+int CTCPClient::PollZeroCopy(const size_t msec /*= 0*/)
+{
+   if (!m_pZeroCopy)
+      return 0;
+
+   int nReleased = m_pZeroCopy->Reap(msec);
+   if (nReleased < 0 && (m_eSettingsFlags & ENABLE_LOG))
+      m_oLog(StringFormat("[TCPClient][Error] Socket error while reading zero-copy completions : %s",
+                          strerror(errno)));
+
+   return nReleased;
+}
+#endif
+
+void CTCPClient::ApplyConnectOptions(const Socket Sock) const
+{
+   if (!m_SocketOptions.IsEmpty())
+      m_SocketOptions.Apply(Sock, (m_eSettingsFlags & ENABLE_LOG) ? m_oLog : LogFnCallback());
+}
+
+bool CTCPClient::ApplySocketOptions(const CSocketOptions& Options)
+{
+   if (m_eStatus != CONNECTED)
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog("[TCPClient][Error] ApplySocketOptions failed : not connected to a server.");
+
+      return false;
+   }
+
+   return Options.Apply(m_ConnectSocket, (m_eSettingsFlags & ENABLE_LOG) ? m_oLog : LogFnCallback());
+}
+
+bool CTCPClient::Flush()
+{
+   if (m_eStatus != CONNECTED)
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog("[TCPClient][Error] Flush failed : not connected to a server.");
+
+      return false;
+   }
+
+   return CSocketOptions::Flush(m_ConnectSocket);
+}
+
 bool CTCPClient::Disconnect()
 {
    if (m_eStatus != CONNECTED)
@@ -390,6 +836,15 @@ bool CTCPClient::Disconnect()
 
    m_eStatus = DISCONNECTED;
 
+   #ifdef LINUX
+   // the callbacks of the buffers still pending won't be called
+   if (m_pZeroCopy)
+   {
+      m_pZeroCopy->Reap(0);
+      m_pZeroCopy.reset();
+   }
+   #endif
+
    #ifdef WINDOWS
    // shutdown the connection since no more data will be sent
    int iResult = shutdown(m_ConnectSocket, SD_SEND);
@@ -401,12 +856,6 @@ bool CTCPClient::Disconnect()
       return false;
    }
    closesocket(m_ConnectSocket);
-
-   if (m_pResultAddrInfo != nullptr)
-   {
-      freeaddrinfo(m_pResultAddrInfo);
-      m_pResultAddrInfo = nullptr;
-   }
    #else
    close(m_ConnectSocket);
    #endif
@@ -20,7 +20,14 @@
 #include <string>
 #include <vector>
 
+#include "BufferPool.h"
+#include "DnsCache.h"
 #include "Socket.h"
+#include "SocketOptions.h"
+
+#ifdef LINUX
+#include "ZeroCopySender.h"
+#endif
 
 class CTCPSSLClient;
 
@@ -49,12 +56,61 @@ public:
 
 	// Session
    bool Connect(const std::string& strServer, const std::string& strPort); // connect to a TCP server
+#ifndef WINDOWS
+   /* connects within uTimeoutMs (0 : no limit) with non-blocking sockets. The IPv6 and IPv4
+    * addresses of the server are raced Happy Eyeballs style (RFC 8305) : the next address is
+    * tried when the previous attempt failed or is still pending after the attempt delay, the
+    * first one connected wins and the others are abandoned. */
+   bool Connect(const std::string& strServer, const std::string& strPort, const unsigned int uTimeoutMs);
+   bool Connect(const std::vector<CDnsCache::Address>& vecAddresses, const unsigned int uTimeoutMs);
+   void SetConnectionAttemptDelay(const unsigned int uDelayMs) { m_uAttemptDelayMs = uDelayMs; }
+#endif
+
+#ifdef LINUX
+   /* connects and sends the first bytes of the request at once : with TCP Fast Open they ride
+    * on the SYN once this host has a cookie from the server (the first connection fetches it),
+    * saving a round trip. Otherwise (TFO disabled in the kernel, by the server or dropped on
+    * the way) they are sent after the handshake, like Connect then Send. */
+   bool ConnectAndSend(const std::string& strServer, const std::string& strPort,
+                       const char* pData, const size_t uSize);
+
+   // whether the last ConnectAndSend's bytes were carried by the SYN and accepted by the server
+   bool IsFastOpenUsed() const { return m_bFastOpenUsed; }
+#endif
    bool Disconnect(); // disconnect from the TCP server
    bool Send(const char* pData, const size_t uSize) const; // send data to a TCP server
    bool Send(const std::string& strData) const;
    bool Send(const std::vector<char>& Data) const;
    int  Receive(char* pData, const size_t uSize, bool bReadFully = true) const;
 
+   // vectored I/O (e.g. a header and its payload in a single syscall, without concatenating them)
+   bool Send(const ConstBuffer* pBuffers, const size_t uCount) const;
+   int  Receive(const MutableBuffer* pBuffers, const size_t uCount, bool bReadFully = true) const;
+
+   /* pooled buffers (see CBufferPool) : Receive reuses Buffer if it's the only handle to a block
+    * large enough, otherwise it acquires a new one. Its size is set to the received count. */
+   bool Send(const CPooledBuffer& Buffer) const;
+   int  Receive(CPooledBuffer& Buffer, const size_t uSize, bool bReadFully = true) const;
+
+#ifndef WINDOWS
+   /* sends uSize bytes of a file from Offset without copying them through user space
+    * (sendfile under Linux). With a path, uSize = 0 sends everything after Offset. */
+   bool SendFile(const int iFileFd, const off_t Offset, const size_t uSize) const;
+   bool SendFile(const std::string& strPath, const off_t Offset = 0, const size_t uSize = 0) const;
+#endif
+
+#ifdef LINUX
+   /* opt-in MSG_ZEROCOPY sends (see CZeroCopySender), once connected : returns false if the
+    * kernel doesn't support it, SendZeroCopy then copies like Send. fnReleased is called from
+    * SendZeroCopy or PollZeroCopy when pData can be reused, sends below uThreshold bytes are
+    * copied and released right away. Pending buffers must be polled before Disconnect. */
+   bool EnableZeroCopy(const size_t uThreshold = CZeroCopySender::DEFAULT_THRESHOLD);
+   bool SendZeroCopy(const char* pData, const size_t uSize, const CZeroCopySender::ReleaseFnCallback& fnReleased);
+   int  PollZeroCopy(const size_t msec = 0);
+   size_t GetZeroCopyPending() const { return m_pZeroCopy ? m_pZeroCopy->GetPendingCount() : 0; }
+   const CZeroCopySender* GetZeroCopySender() const { return m_pZeroCopy.get(); }
+#endif
+
    // To disable timeout, set msec_timeout to 0.
    bool SetRcvTimeout(unsigned int msec_timeout);
    bool SetSndTimeout(unsigned int msec_timeout);
@@ -64,11 +120,31 @@ public:
    bool SetSndTimeout(struct timeval Timeout);
 #endif
 
+   /* options applied to the socket of each new connection, before connecting (buffer sizes
+    * then take part in the window scale negotiation). An option the kernel refuses is logged
+    * and doesn't fail the connection. */
+   void SetSocketOptions(const CSocketOptions& Options) { m_SocketOptions = Options; }
+   const CSocketOptions& GetSocketOptions() const { return m_SocketOptions; }
+
+   // applies options to the current connection, Read them back with CSocketOptions::Read
+   bool ApplySocketOptions(const CSocketOptions& Options);
+
+   // sends the frames held by TCP_CORK (see CSocketOptions::SetCork)
+   bool Flush();
+
    bool IsConnected() const { return m_eStatus == CONNECTED; }
 
    Socket GetSocketDescriptor() const { return m_ConnectSocket; }
 
+   // the address of the server, the one which won the race with a timeout
+   const CDnsCache::Address& GetConnectedAddress() const { return m_ConnectedAddress; }
+
+   static const unsigned int DEFAULT_CONNECTION_ATTEMPT_DELAY_MS = 250;
+
 protected:
+   // applies m_SocketOptions to a new socket
+   void ApplyConnectOptions(const Socket Sock) const;
+
    enum SocketStatus
    {
       CONNECTED,
@@ -77,11 +153,16 @@ protected:
 
    SocketStatus m_eStatus;
    Socket m_ConnectSocket; // ConnectSocket
+   CDnsCache::Address m_ConnectedAddress;
+   unsigned int m_uAttemptDelayMs;
+   CSocketOptions m_SocketOptions;
    //unsigned m_uRetryCount;
    //unsigned m_uRetryPeriod;
 
-   struct addrinfo* m_pResultAddrInfo;
-   struct addrinfo  m_HintsAddrInfo;
+#ifdef LINUX
+   std::unique_ptr<CZeroCopySender> m_pZeroCopy;
+   bool m_bFastOpenUsed;
+#endif
 };
 
 #endif
@@ -0,0 +1,939 @@
+/**
+* @file TCPEventServer.cpp
+* @brief implementation of the reactor-driven TCP server class
+*/
+
+#ifdef LINUX
+#include "TCPEventServer.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+
+namespace
+{
+   const size_t EVENTS_PER_WAIT = 1024;
+   const size_t READ_BUFFER_SIZE = 64 * 1024;
+
+   // timer cookies : the client socket, flagged for the end of its transfer rate window
+   const uint64_t RATE_CHECK_TIMER = 1ULL << 32;
+
+   inline uint64_t MakeTimerCookie(const int Fd, const uint64_t uKind = 0)
+   {
+      return static_cast<uint32_t>(Fd) | uKind;
+   }
+
+   #ifdef IO_URING
+   const unsigned RING_ENTRIES = 4096;
+   const uint16_t RING_BUFFER_GROUP = 0;
+   const unsigned RING_BUFFER_COUNT = 1024;
+   const unsigned RING_BUFFER_SIZE = 16 * 1024;
+
+   // user_data layout : operation (8 bits) | connection generation (24 bits) | fd (32 bits)
+   inline uint64_t MakeUserData(const unsigned uOperation, const uint32_t uGeneration, const int Fd)
+   {
+      return (static_cast<uint64_t>(uOperation) << 56) |
+             (static_cast<uint64_t>(uGeneration & 0xFFFFFF) << 32) |
+             static_cast<uint32_t>(Fd);
+   }
+   #endif
+}
+
+CTCPEventServer::CTCPEventServer(const LogFnCallback oLogger,
+                                 const std::string& strPort,
+                                 const SettingsFlag eSettings /*= ALL_FLAGS*/) :
+   CTCPServer(oLogger, strPort, eSettings),
+#ifdef IO_URING
+   m_bIoUringAllowed(true),
+   m_uNextGeneration(0),
+#endif
+   m_EpollFd(-1),
+   m_WakeUpFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+   m_bStopRequested(false),
+   m_uSyscallCount(0),
+   m_uAcceptCount(0),
+   m_uIdleTimeoutMs(0),
+   m_uTimeoutCount(0),
+   m_uMinRateBytes(0),
+   m_uRateWindowMs(0),
+   m_uMaxConnections(0),
+   m_bResetOnReap(false),
+   m_vecEvents(EVENTS_PER_WAIT),
+   m_vecReadBuffer(READ_BUFFER_SIZE)
+{
+   memset(m_arrReapCounts, 0, sizeof(m_arrReapCounts));
+
+   if (m_WakeUpFd < 0 && (m_eSettingsFlags & ENABLE_LOG))
+      m_oLog(StringFormat("[TCPEventServer][Error] eventfd failed : %s", strerror(errno)));
+}
+
+bool CTCPEventServer::SetNonBlocking(const Socket Sock)
+{
+   int iFlags = fcntl(Sock, F_GETFL, 0);
+   if (iFlags < 0)
+      return false;
+
+   return fcntl(Sock, F_SETFL, iFlags | O_NONBLOCK) == 0;
+}
+
+bool CTCPEventServer::SetUpEventLoop()
+{
+#ifdef IO_URING
+   if (m_pRing)
+      return true;
+#endif
+   if (m_EpollFd >= 0)
+      return true;
+
+   if (m_WakeUpFd < 0)
+      return false;
+
+   if (!StartListening())
+      return false;
+
+#ifdef IO_URING
+   if (m_bIoUringAllowed && SetUpIoUring())
+      return true;
+#endif
+
+   return SetUpEpoll();
+}
+
+bool CTCPEventServer::SetUpEpoll()
+{
+   // accept() must never block the loop
+   if (!SetNonBlocking(m_ListenSocket))
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[TCPEventServer][Error] fcntl failed : %s", strerror(errno)));
+
+      return false;
+   }
+
+   m_EpollFd = epoll_create1(EPOLL_CLOEXEC);
+   if (m_EpollFd < 0)
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[TCPEventServer][Error] epoll_create1 failed : %s", strerror(errno)));
+
+      return false;
+   }
+
+   struct epoll_event ListenEvent;
+   memset(&ListenEvent, 0, sizeof(ListenEvent));
+   ListenEvent.events = EPOLLIN | EPOLLET;
+   ListenEvent.data.fd = m_ListenSocket;
+
+   struct epoll_event WakeUpEvent;
+   memset(&WakeUpEvent, 0, sizeof(WakeUpEvent));
+   WakeUpEvent.events = EPOLLIN;
+   WakeUpEvent.data.fd = m_WakeUpFd;
+
+   if (epoll_ctl(m_EpollFd, EPOLL_CTL_ADD, m_ListenSocket, &ListenEvent) < 0 ||
+       epoll_ctl(m_EpollFd, EPOLL_CTL_ADD, m_WakeUpFd, &WakeUpEvent) < 0)
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[TCPEventServer][Error] epoll_ctl failed : %s", strerror(errno)));
+
+      close(m_EpollFd);
+      m_EpollFd = -1;
+      return false;
+   }
+
+   return true;
+}
+
+bool CTCPEventServer::Run()
+{
+   if (!SetUpEventLoop())
+      return false;
+
+   while (!m_bStopRequested.load())
+   {
+      if (Poll(ACCEPT_WAIT_INF_DELAY) < 0)
+         return false;
+   }
+   m_bStopRequested = false;
+
+   return true;
+}
+
+void CTCPEventServer::Stop()
+{
+   m_bStopRequested = true;
+
+   if (m_WakeUpFd >= 0)
+   {
+      uint64_t uOne = 1;
+      ssize_t iRet = write(m_WakeUpFd, &uOne, sizeof(uOne));
+      (void) iRet;
+   }
+}
+
+int CTCPEventServer::Poll(size_t msec)
+{
+   if (!SetUpEventLoop())
+      return -1;
+
+   // don't sleep past the nearest client deadline
+   if (m_Deadlines.GetCount() > 0)
+   {
+      const int iUntilDeadline = m_Deadlines.GetTimeoutMs();
+      if (msec == ACCEPT_WAIT_INF_DELAY || static_cast<size_t>(iUntilDeadline) < msec)
+         msec = static_cast<size_t>(iUntilDeadline);
+   }
+
+#ifdef IO_URING
+   if (m_pRing)
+   {
+      int nHandled = PollIoUring(msec);
+      if (nHandled >= 0)
+         nHandled += static_cast<int>(ExpireDeadlines());
+      return nHandled;
+   }
+#endif
+
+   int iTimeout = (msec == ACCEPT_WAIT_INF_DELAY) ? -1 : static_cast<int>(msec);
+
+   ++m_uSyscallCount;
+   int nEvents = epoll_wait(m_EpollFd, m_vecEvents.data(), static_cast<int>(m_vecEvents.size()), iTimeout);
+   if (nEvents < 0)
+   {
+      if (errno == EINTR)
+         return 0;
+
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[TCPEventServer][Error] epoll_wait failed : %s", strerror(errno)));
+
+      return -1;
+   }
+
+   for (int i = 0; i < nEvents; ++i)
+   {
+      const Socket Fd = m_vecEvents[i].data.fd;
+      const uint32_t uEvents = m_vecEvents[i].events;
+
+      if (Fd == m_ListenSocket)
+      {
+         HandleAccept();
+      }
+      else if (Fd == m_WakeUpFd)
+      {
+         uint64_t uCount;
+         ssize_t iRet = read(m_WakeUpFd, &uCount, sizeof(uCount));
+         (void) iRet;
+      }
+      else
+      {
+         // an earlier callback of this batch may have closed the client
+         if (m_mapConnections.find(Fd) == m_mapConnections.end())
+            continue;
+
+         if (uEvents & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+            HandleRead(Fd);
+
+         if ((uEvents & EPOLLOUT) && m_mapConnections.find(Fd) != m_mapConnections.end())
+            HandleWrite(Fd);
+      }
+   }
+
+   return nEvents + static_cast<int>(ExpireDeadlines());
+}
+
+void CTCPEventServer::ArmDeadline(const Socket ClientSocket, Connection& Conn, const size_t msec)
+{
+   if (!Conn.m_uDeadline || !m_Deadlines.Rearm(Conn.m_uDeadline, msec))
+      Conn.m_uDeadline = m_Deadlines.Arm(msec, MakeTimerCookie(ClientSocket));
+}
+
+bool CTCPEventServer::SetDeadline(const Socket ClientSocket, const size_t msec)
+{
+   auto it = m_mapConnections.find(ClientSocket);
+   if (it == m_mapConnections.end())
+      return false;
+
+   if (msec > 0)
+      ArmDeadline(ClientSocket, it->second, msec);
+   else if (it->second.m_uDeadline)
+   {
+      m_Deadlines.Cancel(it->second.m_uDeadline);
+      it->second.m_uDeadline = 0;
+   }
+
+   return true;
+}
+
+size_t CTCPEventServer::ExpireDeadlines()
+{
+   if (m_Deadlines.GetCount() == 0)
+      return 0;
+
+   // a closed client's deadline is cancelled : the socket can't be a newer client's
+   return m_Deadlines.Advance(CTimerWheel::Clock::now(), [this](const CTimerWheel::TimerId, const uint64_t uCookie)
+   {
+      const Socket ClientSocket = static_cast<Socket>(static_cast<uint32_t>(uCookie));
+      auto it = m_mapConnections.find(ClientSocket);
+      if (it == m_mapConnections.end())
+         return;
+
+      if (uCookie & RATE_CHECK_TIMER)
+      {
+         it->second.m_uRateCheck = 0;
+         CheckTransferRate(ClientSocket, it->second);
+         return;
+      }
+
+      it->second.m_uDeadline = 0;
+      ++m_uTimeoutCount;
+
+      if (m_fnOnTimeout)
+         m_fnOnTimeout(ClientSocket);
+      else
+         Reap(ClientSocket, REAP_TIMEOUT);
+   });
+}
+
+void CTCPEventServer::CheckTransferRate(const Socket ClientSocket, Connection& Conn)
+{
+   // a client with nothing to send nor to read is idle, not slow
+   const bool bActive = (Conn.m_uWindowBytes > 0) || (PendingBytes(ClientSocket) > 0);
+   if (bActive && Conn.m_uWindowBytes < m_uMinRateBytes)
+   {
+      Reap(ClientSocket, REAP_SLOW_CLIENT);
+      return;
+   }
+
+   Conn.m_uWindowBytes = 0;
+   Conn.m_uRateCheck = m_Deadlines.Arm(m_uRateWindowMs, MakeTimerCookie(ClientSocket, RATE_CHECK_TIMER));
+}
+
+bool CTCPEventServer::RefuseOverLimit(const Socket ClientSocket)
+{
+   if (m_uMaxConnections == 0 || m_mapConnections.size() < m_uMaxConnections)
+      return false;
+
+   ++m_arrReapCounts[REAP_CONNECTION_LIMIT];
+
+   if (m_bResetOnReap)
+   {
+      ++m_uSyscallCount;
+      ApplySocketOptions(ClientSocket, CSocketOptions().SetLinger(0));
+   }
+
+   ++m_uSyscallCount;
+   close(ClientSocket);
+
+   return true;
+}
+
+void CTCPEventServer::Reap(const Socket ClientSocket, const ReapReason eReason)
+{
+   ++m_arrReapCounts[eReason];
+
+   // close() then sends a RST : nothing lingers, neither the unsent bytes nor a TIME_WAIT
+   if (m_bResetOnReap)
+   {
+      ++m_uSyscallCount;
+      ApplySocketOptions(ClientSocket, CSocketOptions().SetLinger(0));
+   }
+
+   Close(ClientSocket);
+}
+
+void CTCPEventServer::AddConnection(const Socket ClientSocket)
+{
+   ApplyAcceptOptions(ClientSocket);
+
+   Connection& Conn = m_mapConnections[ClientSocket];
+   m_uAcceptCount.fetch_add(1, std::memory_order_relaxed);
+
+   if (m_uIdleTimeoutMs > 0)
+      ArmDeadline(ClientSocket, Conn, m_uIdleTimeoutMs);
+
+   if (m_uMinRateBytes > 0 && m_uRateWindowMs > 0)
+      Conn.m_uRateCheck = m_Deadlines.Arm(m_uRateWindowMs, MakeTimerCookie(ClientSocket, RATE_CHECK_TIMER));
+
+#ifdef IO_URING
+   if (m_pRing)
+   {
+      Conn.m_uGeneration = ++m_uNextGeneration & 0xFFFFFF;
+      ArmRecv(ClientSocket, Conn.m_uGeneration);
+   }
+#endif
+
+   if (m_fnOnAccept)
+      m_fnOnAccept(ClientSocket);
+}
+
+void CTCPEventServer::HandleAccept()
+{
+   // edge-triggered : drain the backlog until EAGAIN
+   for (;;)
+   {
+      struct sockaddr_in ClientAddr;
+      socklen_t uClientLen = sizeof(ClientAddr);
+
+      ++m_uSyscallCount;
+      Socket ClientSocket = accept4(m_ListenSocket,
+                                    reinterpret_cast<struct sockaddr*>(&ClientAddr),
+                                    &uClientLen,
+                                    SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (ClientSocket < 0)
+      {
+         if (errno == EINTR || errno == ECONNABORTED)
+            continue;
+
+         if (errno != EAGAIN && errno != EWOULDBLOCK && (m_eSettingsFlags & ENABLE_LOG))
+            m_oLog(StringFormat("[TCPEventServer][Error] accept failed : %s", strerror(errno)));
+
+         return;
+      }
+
+      if (RefuseOverLimit(ClientSocket))
+         continue;
+
+      struct epoll_event Event;
+      memset(&Event, 0, sizeof(Event));
+      Event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+      Event.data.fd = ClientSocket;
+
+      ++m_uSyscallCount;
+      if (epoll_ctl(m_EpollFd, EPOLL_CTL_ADD, ClientSocket, &Event) < 0)
+      {
+         if (m_eSettingsFlags & ENABLE_LOG)
+            m_oLog(StringFormat("[TCPEventServer][Error] epoll_ctl failed : %s", strerror(errno)));
+
+         close(ClientSocket);
+         continue;
+      }
+
+      AddConnection(ClientSocket);
+   }
+}
+
+void CTCPEventServer::HandleRead(const Socket ClientSocket)
+{
+   bool bIdleDeadlineMoved = (m_uIdleTimeoutMs == 0);
+
+   // edge-triggered : read until EAGAIN, otherwise the remaining bytes won't be signaled again
+   for (;;)
+   {
+      char* pBuffer = m_vecReadBuffer.data();
+      if (m_fnOnBuffer)
+      {
+         // the previous block was kept by the callback
+         if (!m_ReadBuffer || m_ReadBuffer.UseCount() > 1 || m_ReadBuffer.Capacity() < READ_BUFFER_SIZE)
+            m_ReadBuffer = CBufferPool::Acquire(READ_BUFFER_SIZE);
+         pBuffer = m_ReadBuffer.Data();
+      }
+
+      ++m_uSyscallCount;
+      ssize_t nRecvd = recv(ClientSocket, pBuffer, READ_BUFFER_SIZE, 0);
+
+      if (nRecvd > 0)
+      {
+         if (!bIdleDeadlineMoved || m_uMinRateBytes > 0)
+         {
+            Connection& Conn = m_mapConnections.find(ClientSocket)->second;
+            Conn.m_uWindowBytes += static_cast<size_t>(nRecvd);
+
+            if (!bIdleDeadlineMoved)
+            {
+               ArmDeadline(ClientSocket, Conn, m_uIdleTimeoutMs);
+               bIdleDeadlineMoved = true;
+            }
+         }
+
+         if (m_fnOnData || m_fnOnBuffer)
+         {
+            DeliverData(ClientSocket, pBuffer, static_cast<size_t>(nRecvd));
+
+            // the callback may have closed the connection
+            if (m_mapConnections.find(ClientSocket) == m_mapConnections.end())
+               return;
+         }
+         continue;
+      }
+
+      if (nRecvd < 0)
+      {
+         if (errno == EINTR)
+            continue;
+
+         if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return;
+      }
+
+      // peer shut down (nRecvd == 0) or socket error
+      Close(ClientSocket);
+      return;
+   }
+}
+
+void CTCPEventServer::DeliverData(const Socket ClientSocket, const char* pData, const size_t uSize)
+{
+   if (!m_fnOnBuffer)
+   {
+      if (m_fnOnData)
+         m_fnOnData(ClientSocket, pData, uSize);
+      return;
+   }
+
+   // io_uring provided buffers are recycled right after : copied into a pooled block
+   if (pData != m_ReadBuffer.Data())
+   {
+      if (!m_ReadBuffer || m_ReadBuffer.UseCount() > 1 || m_ReadBuffer.Capacity() < uSize)
+         m_ReadBuffer = CBufferPool::Acquire(uSize);
+      memcpy(m_ReadBuffer.Data(), pData, uSize);
+   }
+
+   m_ReadBuffer.Resize(uSize);
+   m_fnOnBuffer(ClientSocket, m_ReadBuffer);
+}
+
+void CTCPEventServer::HandleWrite(const Socket ClientSocket)
+{
+   auto it = m_mapConnections.find(ClientSocket);
+   if (it == m_mapConnections.end() || !it->second.m_bWantWrite)
+      return;
+
+   if (!Flush(ClientSocket, it->second))
+   {
+      Close(ClientSocket);
+      return;
+   }
+
+   if (it->second.m_uOutOffset == it->second.m_OutBuffer.size())
+   {
+      it->second.m_bWantWrite = false;
+
+      if (m_fnOnWritable)
+         m_fnOnWritable(ClientSocket);
+   }
+}
+
+bool CTCPEventServer::Flush(const Socket ClientSocket, Connection& Conn)
+{
+   while (Conn.m_uOutOffset < Conn.m_OutBuffer.size())
+   {
+      ++m_uSyscallCount;
+      ssize_t nSent = send(ClientSocket,
+                           Conn.m_OutBuffer.data() + Conn.m_uOutOffset,
+                           Conn.m_OutBuffer.size() - Conn.m_uOutOffset,
+                           MSG_NOSIGNAL);
+      if (nSent < 0)
+      {
+         if (errno == EINTR)
+            continue;
+
+         if (errno == EAGAIN || errno == EWOULDBLOCK)
+         {
+            Conn.m_bWantWrite = true;
+            return true;
+         }
+
+         if (m_eSettingsFlags & ENABLE_LOG)
+            m_oLog(StringFormat("[TCPEventServer][Error] send failed : %s", strerror(errno)));
+
+         return false;
+      }
+
+      Conn.m_uOutOffset += static_cast<size_t>(nSent);
+      Conn.m_uWindowBytes += static_cast<size_t>(nSent);
+   }
+
+   Conn.m_OutBuffer.clear();
+   Conn.m_uOutOffset = 0;
+
+   return true;
+}
+
+bool CTCPEventServer::Write(const Socket ClientSocket, const char* pData, const size_t uSize)
+{
+   if (!pData || !uSize)
+      return false;
+
+   auto it = m_mapConnections.find(ClientSocket);
+   if (it == m_mapConnections.end())
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog("[TCPEventServer][Error] write failed : unknown client socket.");
+
+      return false;
+   }
+
+   Connection& Conn = it->second;
+
+   // keep the ordering : append behind the bytes which are still queued
+   Conn.m_OutBuffer.insert(Conn.m_OutBuffer.end(), pData, pData + uSize);
+
+#ifdef IO_URING
+   if (m_pRing)
+   {
+      // one send in flight per client, the writes issued meanwhile are coalesced into the next one
+      if (Conn.m_bSendInFlight)
+         Conn.m_bWantWrite = true;
+      else
+         SubmitSend(ClientSocket, Conn);
+
+      return true;
+   }
+#endif
+
+   if (Conn.m_bWantWrite)
+      return true;
+
+   if (!Flush(ClientSocket, Conn))
+   {
+      Close(ClientSocket);
+      return false;
+   }
+
+   return true;
+}
+
+bool CTCPEventServer::Write(const Socket ClientSocket, const std::string& strData)
+{
+   return Write(ClientSocket, strData.c_str(), strData.length());
+}
+
+bool CTCPEventServer::Write(const Socket ClientSocket, const std::vector<char>& Data)
+{
+   return Write(ClientSocket, Data.data(), Data.size());
+}
+
+size_t CTCPEventServer::PendingBytes(const Socket ClientSocket) const
+{
+   auto it = m_mapConnections.find(ClientSocket);
+   if (it == m_mapConnections.end())
+      return 0;
+
+   size_t uPending = it->second.m_OutBuffer.size() - it->second.m_uOutOffset;
+#ifdef IO_URING
+   uPending += it->second.m_InFlight.size() - it->second.m_uInFlightOffset;
+#endif
+
+   return uPending;
+}
+
+void CTCPEventServer::Close(const Socket ClientSocket)
+{
+   auto it = m_mapConnections.find(ClientSocket);
+   if (it == m_mapConnections.end())
+      return;
+
+#ifdef IO_URING
+   if (m_pRing)
+   {
+      // the kernel still reads the in-flight buffer : keep it until the send completes
+      if (it->second.m_bSendInFlight)
+      {
+         m_mapOrphanSends[MakeUserData(RING_SEND, it->second.m_uGeneration, ClientSocket)].swap(it->second.m_InFlight);
+
+         // a send queued just before (e.g. a goodbye) must reach the socket before the shutdown
+         ++m_uSyscallCount;
+         m_pRing->Submit();
+      }
+
+      // closing the fd isn't enough : the ring holds a reference on the socket,
+      // shutdown() terminates the pending multishot recv and send
+      ++m_uSyscallCount;
+      shutdown(ClientSocket, SHUT_RDWR);
+   }
+#endif
+
+   if (it->second.m_uDeadline)
+      m_Deadlines.Cancel(it->second.m_uDeadline);
+   if (it->second.m_uRateCheck)
+      m_Deadlines.Cancel(it->second.m_uRateCheck);
+
+   m_mapConnections.erase(it);
+   if (m_EpollFd >= 0)
+   {
+      ++m_uSyscallCount;
+      epoll_ctl(m_EpollFd, EPOLL_CTL_DEL, ClientSocket, nullptr);
+   }
+
+   if (m_fnOnClose)
+      m_fnOnClose(ClientSocket);
+
+   ++m_uSyscallCount;
+   close(ClientSocket);
+}
+
+#ifdef IO_URING
+bool CTCPEventServer::SetUpIoUring()
+{
+   m_pRing.reset(new CIoUring());
+
+   if (!m_pRing->Init(RING_ENTRIES) ||
+       !m_pRing->SetUpBufferRing(RING_BUFFER_GROUP, RING_BUFFER_COUNT, RING_BUFFER_SIZE))
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[TCPEventServer][Info] io_uring unavailable (%s), falling back to epoll.",
+                             strerror(errno)));
+
+      m_pRing.reset();
+      return false;
+   }
+
+   ArmAccept();
+   ArmWakeUp();
+
+   return true;
+}
+
+struct io_uring_sqe* CTCPEventServer::NextSqe()
+{
+   struct io_uring_sqe* pSqe = m_pRing->GetSqe();
+   if (pSqe == nullptr)
+   {
+      // submission queue full : hand the batch to the kernel and retry
+      ++m_uSyscallCount;
+      m_pRing->Submit();
+      pSqe = m_pRing->GetSqe();
+   }
+
+   return pSqe;
+}
+
+void CTCPEventServer::ArmAccept()
+{
+   struct io_uring_sqe* pSqe = NextSqe();
+   if (pSqe == nullptr)
+      return;
+
+   pSqe->opcode = IORING_OP_ACCEPT;
+   pSqe->fd = m_ListenSocket;
+   pSqe->ioprio = IORING_ACCEPT_MULTISHOT;
+   pSqe->accept_flags = SOCK_CLOEXEC;
+   pSqe->user_data = MakeUserData(RING_ACCEPT, 0, m_ListenSocket);
+}
+
+void CTCPEventServer::ArmWakeUp()
+{
+   struct io_uring_sqe* pSqe = NextSqe();
+   if (pSqe == nullptr)
+      return;
+
+   // the eventfd is non-blocking, a multishot poll is used instead of a read
+   pSqe->opcode = IORING_OP_POLL_ADD;
+   pSqe->fd = m_WakeUpFd;
+   pSqe->len = IORING_POLL_ADD_MULTI;
+   pSqe->poll32_events = POLLIN;
+   pSqe->user_data = MakeUserData(RING_WAKEUP, 0, m_WakeUpFd);
+}
+
+void CTCPEventServer::ArmRecv(const Socket ClientSocket, const uint32_t uGeneration)
+{
+   struct io_uring_sqe* pSqe = NextSqe();
+   if (pSqe == nullptr)
+      return;
+
+   pSqe->opcode = IORING_OP_RECV;
+   pSqe->fd = ClientSocket;
+   pSqe->flags = IOSQE_BUFFER_SELECT;
+   pSqe->buf_group = RING_BUFFER_GROUP;
+   pSqe->ioprio = IORING_RECV_MULTISHOT;
+   pSqe->user_data = MakeUserData(RING_RECV, uGeneration, ClientSocket);
+}
+
+void CTCPEventServer::SubmitSend(const Socket ClientSocket, Connection& Conn)
+{
+   if (Conn.m_uInFlightOffset == Conn.m_InFlight.size())
+   {
+      if (Conn.m_OutBuffer.empty())
+         return;
+
+      Conn.m_InFlight.clear();
+      Conn.m_InFlight.swap(Conn.m_OutBuffer);
+      Conn.m_uInFlightOffset = 0;
+   }
+
+   struct io_uring_sqe* pSqe = NextSqe();
+   if (pSqe == nullptr)
+      return;
+
+   pSqe->opcode = IORING_OP_SEND;
+   pSqe->fd = ClientSocket;
+   pSqe->addr = reinterpret_cast<uint64_t>(Conn.m_InFlight.data() + Conn.m_uInFlightOffset);
+   pSqe->len = static_cast<uint32_t>(Conn.m_InFlight.size() - Conn.m_uInFlightOffset);
+   pSqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+   pSqe->user_data = MakeUserData(RING_SEND, Conn.m_uGeneration, ClientSocket);
+
+   Conn.m_bSendInFlight = true;
+}
+
+int CTCPEventServer::PollIoUring(size_t msec)
+{
+   int iTimeout = (msec == ACCEPT_WAIT_INF_DELAY) ? -1 : static_cast<int>(msec);
+
+   // one system call submits everything queued since the last iteration and waits
+   ++m_uSyscallCount;
+   if (m_pRing->Submit(1, iTimeout) < 0)
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[TCPEventServer][Error] io_uring_enter failed : %s", strerror(errno)));
+
+      return -1;
+   }
+
+   return static_cast<int>(m_pRing->ForEachCompletion([this](const struct io_uring_cqe& Cqe)
+   {
+      HandleCompletion(Cqe);
+   }));
+}
+
+void CTCPEventServer::HandleCompletion(const struct io_uring_cqe& Cqe)
+{
+   const unsigned uOperation = static_cast<unsigned>(Cqe.user_data >> 56);
+   const uint32_t uGeneration = static_cast<uint32_t>(Cqe.user_data >> 32) & 0xFFFFFF;
+   const Socket Fd = static_cast<Socket>(Cqe.user_data & 0xFFFFFFFF);
+   const bool bMore = (Cqe.flags & IORING_CQE_F_MORE) != 0;
+
+   switch (uOperation)
+   {
+      case RING_ACCEPT:
+         if (Cqe.res >= 0)
+         {
+            if (!RefuseOverLimit(Cqe.res))
+               AddConnection(Cqe.res);
+         }
+         else if (m_eSettingsFlags & ENABLE_LOG)
+            m_oLog(StringFormat("[TCPEventServer][Error] accept failed : %s", strerror(-Cqe.res)));
+
+         if (!bMore)
+            ArmAccept();
+         break;
+
+      case RING_WAKEUP:
+      {
+         uint64_t uCount;
+         ++m_uSyscallCount;
+         ssize_t iRet = read(m_WakeUpFd, &uCount, sizeof(uCount));
+         (void) iRet;
+
+         if (!bMore)
+            ArmWakeUp();
+         break;
+      }
+
+      case RING_RECV:
+      {
+         auto it = m_mapConnections.find(Fd);
+         bool bLive = (it != m_mapConnections.end() && it->second.m_uGeneration == uGeneration);
+
+         if (Cqe.flags & IORING_CQE_F_BUFFER)
+         {
+            const uint16_t uBufferId = static_cast<uint16_t>(Cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+
+            if (bLive && Cqe.res > 0)
+            {
+               it->second.m_uWindowBytes += static_cast<size_t>(Cqe.res);
+
+               if (m_uIdleTimeoutMs > 0)
+                  ArmDeadline(Fd, it->second, m_uIdleTimeoutMs);
+            }
+
+            if (bLive && Cqe.res > 0 && (m_fnOnData || m_fnOnBuffer))
+            {
+               DeliverData(Fd, m_pRing->GetBuffer(uBufferId), static_cast<size_t>(Cqe.res));
+
+               // the callback may have closed the connection
+               it = m_mapConnections.find(Fd);
+               bLive = (it != m_mapConnections.end() && it->second.m_uGeneration == uGeneration);
+            }
+            m_pRing->RecycleBuffer(uBufferId);
+         }
+
+         if (!bLive)
+            break;
+
+         // -ENOBUFS : every provided buffer was in use, the recv is simply re-armed
+         if (Cqe.res == 0 || (Cqe.res < 0 && Cqe.res != -ENOBUFS))
+            Close(Fd);
+         else if (!bMore)
+            ArmRecv(Fd, uGeneration);
+         break;
+      }
+
+      case RING_SEND:
+      {
+         auto it = m_mapConnections.find(Fd);
+         if (it == m_mapConnections.end() || it->second.m_uGeneration != uGeneration)
+         {
+            m_mapOrphanSends.erase(Cqe.user_data);
+            break;
+         }
+
+         Connection& Conn = it->second;
+         Conn.m_bSendInFlight = false;
+
+         if (Cqe.res < 0)
+         {
+            if (m_eSettingsFlags & ENABLE_LOG)
+               m_oLog(StringFormat("[TCPEventServer][Error] send failed : %s", strerror(-Cqe.res)));
+
+            Close(Fd);
+            break;
+         }
+
+         Conn.m_uInFlightOffset += static_cast<size_t>(Cqe.res);
+         Conn.m_uWindowBytes += static_cast<size_t>(Cqe.res);
+
+         if (Conn.m_uInFlightOffset < Conn.m_InFlight.size() || !Conn.m_OutBuffer.empty())
+         {
+            SubmitSend(Fd, Conn);
+         }
+         else if (Conn.m_bWantWrite)
+         {
+            Conn.m_bWantWrite = false;
+
+            if (m_fnOnWritable)
+               m_fnOnWritable(Fd);
+         }
+         break;
+      }
+
+      default:
+         break;
+   }
+}
+#endif
+
+CTCPEventServer::~CTCPEventServer()
+{
+#ifdef IO_URING
+   if (m_pRing)
+   {
+      m_fnOnAccept = nullptr;
+      m_fnOnData = nullptr;
+      m_fnOnBuffer = nullptr;
+      m_fnOnWritable = nullptr;
+      m_fnOnClose = nullptr;
+
+      while (!m_mapConnections.empty())
+         Close(m_mapConnections.begin()->first);
+
+      // wait (bounded) for the kernel to give back the buffers of the pending sends
+      for (int iTry = 0; iTry < 50 && !m_mapOrphanSends.empty(); ++iTry)
+         PollIoUring(20);
+
+      // the multishot accept holds the listen socket until the ring is torn down,
+      // which the kernel does asynchronously : stop listening now so the port can
+      // be bound again as soon as we return
+      if (m_ListenSocket != INVALID_SOCKET)
+         shutdown(m_ListenSocket, SHUT_RDWR);
+   }
+#endif
+
+   for (const auto& Conn : m_mapConnections)
+      close(Conn.first);
+
+   if (m_WakeUpFd >= 0)
+      close(m_WakeUpFd);
+
+   if (m_EpollFd >= 0)
+      close(m_EpollFd);
+}
+#endif
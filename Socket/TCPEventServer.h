@@ -0,0 +1,256 @@
+/*
+* @file TCPEventServer.h
+* @brief reactor-driven TCP server (edge-triggered epoll, non-blocking client sockets)
+* @date 2026-10-17
+*
+* A single thread running Run() serves all the accepted clients : incoming
+* connections, received bytes, writability and peer closures are reported
+* through callbacks instead of one blocking Listen/Receive call per client.
+*
+* When the library is built with IO_URING (CMake option SOCKET_CPP_WITH_IO_URING),
+* the loop uses io_uring (multishot accept, multishot recv into provided buffers,
+* batched sends) and falls back to epoll if the running kernel doesn't support it.
+*/
+
+#ifdef LINUX
+#ifndef INCLUDE_TCPEVENTSERVER_H_
+#define INCLUDE_TCPEVENTSERVER_H_
+
+#include <atomic>
+#include <unordered_map>
+
+#include <sys/epoll.h>
+
+#include "TCPServer.h"
+#include "TimerWheel.h"
+
+#ifdef IO_URING
+#include "IoUring.h"
+#endif
+
+class CTCPEventServer : public CTCPServer
+{
+public:
+   typedef std::function<void(const Socket)>                            AcceptFnCallback;
+   typedef std::function<void(const Socket, const char*, const size_t)> DataFnCallback;
+   typedef std::function<void(const Socket, CPooledBuffer&)>             BufferFnCallback;
+   typedef std::function<void(const Socket)>                            WritableFnCallback;
+   typedef std::function<void(const Socket)>                            CloseFnCallback;
+   typedef std::function<void(const Socket)>                            TimeoutFnCallback;
+
+   // why the server closed a client by itself
+   enum ReapReason
+   {
+      REAP_TIMEOUT,          // its deadline (e.g. the idle timeout) expired without OnTimeout
+      REAP_SLOW_CLIENT,      // below the minimum transfer rate
+      REAP_CONNECTION_LIMIT, // refused at accept, the server was full
+      REAP_REASON_COUNT
+   };
+
+   explicit CTCPEventServer(const LogFnCallback oLogger,
+                            const std::string& strPort,
+                            const SettingsFlag eSettings = ALL_FLAGS);
+
+   ~CTCPEventServer() override;
+
+   CTCPEventServer(const CTCPEventServer&) = delete;
+   CTCPEventServer& operator=(const CTCPEventServer&) = delete;
+
+   /* callbacks are invoked from the thread running the loop */
+   inline void SetOnAccept(const AcceptFnCallback& fnCallback) { m_fnOnAccept = fnCallback; }
+   inline void SetOnData(const DataFnCallback& fnCallback) { m_fnOnData = fnCallback; }
+   inline void SetOnWritable(const WritableFnCallback& fnCallback) { m_fnOnWritable = fnCallback; }
+   inline void SetOnClose(const CloseFnCallback& fnCallback) { m_fnOnClose = fnCallback; }
+
+   /* invoked when a client's deadline expires, the client is closed when it's not set */
+   inline void SetOnTimeout(const TimeoutFnCallback& fnCallback) { m_fnOnTimeout = fnCallback; }
+
+   /* replaces OnData : the received bytes are handed over in a pooled buffer the callback
+    * may keep (copy or move it) past the call, a new block is then taken for the next read.
+    * Blocks it doesn't keep are reused, the steady state doesn't allocate. */
+   inline void SetOnBuffer(const BufferFnCallback& fnCallback) { m_fnOnBuffer = fnCallback; }
+
+   /* creates the listen socket and the event loop, Run() and Poll() do it on their
+    * first call otherwise */
+   inline bool Open() { return SetUpEventLoop(); }
+
+   /* runs the event loop until Stop() is called */
+   bool Run();
+
+   /* runs one loop iteration, waits at most msec milliseconds for events
+    * (ACCEPT_WAIT_INF_DELAY to wait indefinitely). Returns the number of handled
+    * events or -1 on error. */
+   int Poll(size_t msec);
+
+   /* can be called from any thread : wakes up the loop and makes Run() return */
+   void Stop();
+
+   /* queues data to a client, what the kernel doesn't take right away is flushed
+    * when the socket becomes writable again (OnWritable is then invoked).
+    * Must be called from the loop thread (e.g. inside a callback). */
+   bool Write(const Socket ClientSocket, const char* pData, const size_t uSize);
+   bool Write(const Socket ClientSocket, const std::string& strData);
+   bool Write(const Socket ClientSocket, const std::vector<char>& Data);
+
+   /* bytes queued for a client and not yet accepted by the kernel */
+   size_t PendingBytes(const Socket ClientSocket) const;
+
+   /* closes a client managed by the loop, OnClose is invoked. Loop thread only. */
+   void Close(const Socket ClientSocket);
+
+   /* one deadline per client (read or handshake deadline, idle timeout...) kept on a timer
+    * wheel : setting, moving and cancelling it cost O(1), whatever the number of clients.
+    * msec = 0 cancels it. Returns false for an unknown client. Loop thread only. */
+   bool SetDeadline(const Socket ClientSocket, const size_t msec);
+
+   /* sets every client's deadline msec after its accept and pushes it back each time
+    * bytes are received from it (0, the default, disables it). Set it before Run/Poll. */
+   inline void SetIdleTimeout(const size_t msec) { m_uIdleTimeoutMs = msec; }
+
+   /* slowloris protection : a client which, over a window of uWindowMs, transferred (received
+    * and sent) fewer than uMinBytes while it was active (it sent something, or bytes were waiting
+    * to be sent to it) is closed. A silent client is left to the idle timeout. 0 disables it
+    * (the default). Set it before Run/Poll. */
+   inline void SetMinTransferRate(const size_t uMinBytes, const size_t uWindowMs)
+   {
+      m_uMinRateBytes = uMinBytes;
+      m_uRateWindowMs = uWindowMs;
+   }
+
+   /* the clients accepted above uMaxConnections are closed right away (0, the default : no limit) */
+   inline void SetMaxConnections(const size_t uMaxConnections) { m_uMaxConnections = uMaxConnections; }
+
+   /* the clients closed by the policies above are reset (SO_LINGER 0) : no goodbye is flushed
+    * and no TIME_WAIT is left behind */
+   inline void SetResetOnReap(const bool bReset) { m_bResetOnReap = bReset; }
+
+   /* clients closed by the server itself, per reason */
+   unsigned long long GetReapCount(const ReapReason eReason) const { return m_arrReapCounts[eReason]; }
+
+   size_t GetConnectionCount() const { return m_mapConnections.size(); }
+
+   /* deadlines which expired so far */
+   unsigned long long GetTimeoutCount() const { return m_uTimeoutCount; }
+
+   /* connections accepted so far, can be read from any thread */
+   unsigned long long GetAcceptCount() const { return m_uAcceptCount.load(std::memory_order_relaxed); }
+
+   /* system calls issued by the loop so far (accept, recv, send, epoll_wait, io_uring_enter...) */
+   unsigned long long GetSyscallCount() const { return m_uSyscallCount; }
+
+#ifdef IO_URING
+   /* to be called before Run()/Poll() to force the epoll backend */
+   inline void DisableIoUring() { m_bIoUringAllowed = false; }
+   inline bool IsUsingIoUring() const { return m_pRing != nullptr; }
+#endif
+
+   static bool SetNonBlocking(const Socket Sock);
+
+protected:
+   struct Connection
+   {
+      Connection() :
+         m_uOutOffset(0),
+         m_bWantWrite(false),
+         m_uDeadline(0),
+         m_uRateCheck(0),
+         m_uWindowBytes(0)
+      #ifdef IO_URING
+         , m_uGeneration(0),
+         m_uInFlightOffset(0),
+         m_bSendInFlight(false)
+      #endif
+      {}
+
+      std::vector<char> m_OutBuffer; // bytes waiting for the socket to become writable
+      size_t            m_uOutOffset;
+      bool              m_bWantWrite; // a previous write hit EAGAIN
+      CTimerWheel::TimerId m_uDeadline; // 0 : none
+      CTimerWheel::TimerId m_uRateCheck; // end of the current transfer rate window
+      size_t            m_uWindowBytes; // received and sent during that window
+      #ifdef IO_URING
+      uint32_t          m_uGeneration; // tells stale completions of a reused fd apart
+      std::vector<char> m_InFlight;    // bytes owned by the kernel until the send completes
+      size_t            m_uInFlightOffset;
+      bool              m_bSendInFlight;
+      #endif
+   };
+
+   bool SetUpEventLoop();
+   bool SetUpEpoll();
+   void AddConnection(const Socket ClientSocket);
+   void HandleAccept();
+   void HandleRead(const Socket ClientSocket);
+   void DeliverData(const Socket ClientSocket, const char* pData, const size_t uSize);
+   void HandleWrite(const Socket ClientSocket);
+   bool Flush(const Socket ClientSocket, Connection& Conn);
+
+   void ArmDeadline(const Socket ClientSocket, Connection& Conn, const size_t msec);
+
+   // invokes OnTimeout (or closes) for the clients whose deadline passed, returns their count
+   size_t ExpireDeadlines();
+
+   // closes a client whose rate window ended below the minimum, or starts its next window
+   void CheckTransferRate(const Socket ClientSocket, Connection& Conn);
+
+   // closes a new client when the server is full, returns true if it was refused
+   bool RefuseOverLimit(const Socket ClientSocket);
+
+   void Reap(const Socket ClientSocket, const ReapReason eReason);
+
+#ifdef IO_URING
+   enum RingOperation
+   {
+      RING_ACCEPT = 1,
+      RING_RECV,
+      RING_SEND,
+      RING_WAKEUP
+   };
+
+   bool SetUpIoUring();
+   int  PollIoUring(size_t msec);
+   void HandleCompletion(const struct io_uring_cqe& Cqe);
+   struct io_uring_sqe* NextSqe();
+   void ArmAccept();
+   void ArmWakeUp();
+   void ArmRecv(const Socket ClientSocket, const uint32_t uGeneration);
+   void SubmitSend(const Socket ClientSocket, Connection& Conn);
+
+   std::unique_ptr<CIoUring> m_pRing;
+   bool                      m_bIoUringAllowed;
+   uint32_t                  m_uNextGeneration;
+
+   // send buffers of closed connections, released when their completion arrives
+   std::unordered_map<uint64_t, std::vector<char>> m_mapOrphanSends;
+#endif
+
+   int                m_EpollFd;
+   int                m_WakeUpFd; // eventfd used by Stop()
+   std::atomic<bool>  m_bStopRequested;
+   unsigned long long m_uSyscallCount;
+   std::atomic<unsigned long long> m_uAcceptCount;
+
+   CTimerWheel        m_Deadlines;
+   size_t             m_uIdleTimeoutMs;
+   unsigned long long m_uTimeoutCount;
+   size_t             m_uMinRateBytes;
+   size_t             m_uRateWindowMs;
+   size_t             m_uMaxConnections;
+   bool               m_bResetOnReap;
+   unsigned long long m_arrReapCounts[REAP_REASON_COUNT];
+
+   std::unordered_map<Socket, Connection> m_mapConnections;
+   std::vector<struct epoll_event>        m_vecEvents;
+   std::vector<char>                      m_vecReadBuffer;
+   CPooledBuffer                          m_ReadBuffer; // used instead when OnBuffer is set
+
+   AcceptFnCallback   m_fnOnAccept;
+   DataFnCallback     m_fnOnData;
+   BufferFnCallback   m_fnOnBuffer;
+   WritableFnCallback m_fnOnWritable;
+   CloseFnCallback    m_fnOnClose;
+   TimeoutFnCallback  m_fnOnTimeout;
+};
+
+#endif
+#endif
@@ -0,0 +1,137 @@
+/**
+* @file TCPMultiServer.cpp
+* @brief implementation of the multi-acceptor TCP server class
+*/
+
+#ifdef LINUX
+#include "TCPMultiServer.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+CTCPMultiServer::CTCPMultiServer(const ASocket::LogFnCallback oLogger,
+                                 const std::string& strPort,
+                                 const size_t uWorkers /*= 0*/,
+                                 const std::vector<int>& vecCPUs /*= std::vector<int>()*/,
+                                 const ASocket::SettingsFlag eSettings /*= ASocket::ALL_FLAGS*/) :
+   m_oLog(oLogger),
+   m_eSettingsFlags(eSettings),
+   m_strPort(strPort)
+{
+   long lOnlineCPUs = sysconf(_SC_NPROCESSORS_ONLN);
+   if (lOnlineCPUs < 1)
+      lOnlineCPUs = 1;
+
+   const size_t uCount = (uWorkers > 0) ? uWorkers : static_cast<size_t>(lOnlineCPUs);
+
+   for (size_t i = 0; i < uCount; ++i)
+   {
+      m_vecCPUs.push_back(vecCPUs.empty() ? static_cast<int>(i % static_cast<size_t>(lOnlineCPUs))
+                                          : vecCPUs[i % vecCPUs.size()]);
+
+      m_vecWorkers.push_back(NewWorker());
+   }
+}
+
+std::unique_ptr<CTCPEventServer> CTCPMultiServer::NewWorker() const
+{
+   std::unique_ptr<CTCPEventServer> pWorker(new CTCPEventServer(m_oLog, m_strPort, m_eSettingsFlags));
+   pWorker->SetReusePort(true);
+   return pWorker;
+}
+
+bool CTCPMultiServer::Start()
+{
+   if (IsRunning())
+      return true;
+
+   // all the sockets are bound before any worker runs, so a busy port is reported here
+   for (size_t i = 0; i < m_vecWorkers.size(); ++i)
+   {
+      CTCPEventServer& Worker = *m_vecWorkers[i];
+
+      if (m_fnOnAccept)
+         Worker.SetOnAccept([this, &Worker](const ASocket::Socket Client) { m_fnOnAccept(Worker, Client); });
+      if (m_fnOnData)
+         Worker.SetOnData([this, &Worker](const ASocket::Socket Client, const char* pData, const size_t uSize)
+                          { m_fnOnData(Worker, Client, pData, uSize); });
+      if (m_fnOnWritable)
+         Worker.SetOnWritable([this, &Worker](const ASocket::Socket Client) { m_fnOnWritable(Worker, Client); });
+      if (m_fnOnClose)
+         Worker.SetOnClose([this, &Worker](const ASocket::Socket Client) { m_fnOnClose(Worker, Client); });
+
+      if (!Worker.Open())
+      {
+         if (m_eSettingsFlags & ASocket::ENABLE_LOG)
+            m_oLog("[TCPMultiServer][Error] a worker couldn't open its listen socket.");
+
+         /* the kernel would keep handing connections to the sockets already bound, with no
+          * thread to serve them : the opened workers are replaced by new, closed ones (destroyed
+          * first, their descriptors are released before the new ones are created) */
+         for (size_t j = 0; j < i; ++j)
+         {
+            m_vecWorkers[j].reset();
+            m_vecWorkers[j] = NewWorker();
+         }
+
+         return false;
+      }
+   }
+
+   for (size_t i = 0; i < m_vecWorkers.size(); ++i)
+   {
+      CTCPEventServer* pWorker = m_vecWorkers[i].get();
+      m_vecThreads.emplace_back([pWorker] { pWorker->Run(); });
+
+      // a failed pinning only costs locality, the worker still runs
+      if (!PinThread(m_vecThreads.back(), m_vecCPUs[i]) && (m_eSettingsFlags & ASocket::ENABLE_LOG))
+         m_oLog(ASocket::StringFormat("[TCPMultiServer][Warning] worker %zu couldn't be pinned to CPU %d.",
+                                      i, m_vecCPUs[i]));
+   }
+
+   return true;
+}
+
+void CTCPMultiServer::Stop()
+{
+   if (!IsRunning())
+      return;
+
+   for (auto& pWorker : m_vecWorkers)
+      pWorker->Stop();
+
+   for (auto& Thread : m_vecThreads)
+      Thread.join();
+
+   m_vecThreads.clear();
+}
+
+bool CTCPMultiServer::PinThread(std::thread& Thread, const int iCPU)
+{
+   if (iCPU < 0 || iCPU >= CPU_SETSIZE)
+      return false;
+
+   cpu_set_t CPUSet;
+   CPU_ZERO(&CPUSet);
+   CPU_SET(iCPU, &CPUSet);
+
+   return pthread_setaffinity_np(Thread.native_handle(), sizeof(CPUSet), &CPUSet) == 0;
+}
+
+std::vector<unsigned long long> CTCPMultiServer::GetAcceptCounts() const
+{
+   std::vector<unsigned long long> vecCounts;
+   vecCounts.reserve(m_vecWorkers.size());
+
+   for (const auto& pWorker : m_vecWorkers)
+      vecCounts.push_back(pWorker->GetAcceptCount());
+
+   return vecCounts;
+}
+
+CTCPMultiServer::~CTCPMultiServer()
+{
+   Stop();
+}
+#endif
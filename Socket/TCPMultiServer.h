@@ -0,0 +1,84 @@
+/*
+* @file TCPMultiServer.h
+* @brief multi-acceptor TCP server (SO_REUSEPORT, one event loop per worker thread)
+* @date 2026-10-17
+*
+* Every worker owns its own listen socket bound to the same port with SO_REUSEPORT
+* and runs a CTCPEventServer loop on a thread pinned to a CPU. The kernel spreads
+* the incoming connections across the listen sockets, there is no shared accept
+* lock and a client is served by the worker that accepted it until it's closed.
+*/
+
+#ifdef LINUX
+#ifndef INCLUDE_TCPMULTISERVER_H_
+#define INCLUDE_TCPMULTISERVER_H_
+
+#include <memory>
+#include <thread>
+
+#include "TCPEventServer.h"
+
+class CTCPMultiServer
+{
+public:
+   /* the worker owning the client is given to the callbacks (e.g. to call Write/Close) */
+   typedef std::function<void(CTCPEventServer&, const ASocket::Socket)>                            AcceptFnCallback;
+   typedef std::function<void(CTCPEventServer&, const ASocket::Socket, const char*, const size_t)> DataFnCallback;
+   typedef std::function<void(CTCPEventServer&, const ASocket::Socket)>                            WritableFnCallback;
+   typedef std::function<void(CTCPEventServer&, const ASocket::Socket)>                            CloseFnCallback;
+
+   /* uWorkers = 0 starts one worker per online CPU. Worker i is pinned to
+    * vecCPUs[i % vecCPUs.size()], or to CPU i (modulo the CPU count) if vecCPUs is empty. */
+   explicit CTCPMultiServer(const ASocket::LogFnCallback oLogger,
+                            const std::string& strPort,
+                            const size_t uWorkers = 0,
+                            const std::vector<int>& vecCPUs = std::vector<int>(),
+                            const ASocket::SettingsFlag eSettings = ASocket::ALL_FLAGS);
+
+   ~CTCPMultiServer();
+
+   CTCPMultiServer(const CTCPMultiServer&) = delete;
+   CTCPMultiServer& operator=(const CTCPMultiServer&) = delete;
+
+   /* callbacks are invoked from the worker threads, they must be set before Start() */
+   inline void SetOnAccept(const AcceptFnCallback& fnCallback) { m_fnOnAccept = fnCallback; }
+   inline void SetOnData(const DataFnCallback& fnCallback) { m_fnOnData = fnCallback; }
+   inline void SetOnWritable(const WritableFnCallback& fnCallback) { m_fnOnWritable = fnCallback; }
+   inline void SetOnClose(const CloseFnCallback& fnCallback) { m_fnOnClose = fnCallback; }
+
+   /* binds every listen socket then starts the worker threads, returns false if
+    * one of the sockets couldn't be set up (nothing is started and no socket stays bound then) */
+   bool Start();
+
+   /* stops and joins the worker threads. The listen sockets and the clients stay
+    * open until the server is destroyed, Start() can resume serving them. */
+   void Stop();
+
+   bool IsRunning() const { return !m_vecThreads.empty(); }
+
+   size_t GetWorkerCount() const { return m_vecWorkers.size(); }
+   int GetWorkerCPU(const size_t uWorker) const { return m_vecCPUs[uWorker]; }
+
+   /* connections accepted by each worker, to check how the kernel balances the load */
+   std::vector<unsigned long long> GetAcceptCounts() const;
+
+protected:
+   bool PinThread(std::thread& Thread, const int iCPU);
+   std::unique_ptr<CTCPEventServer> NewWorker() const;
+
+   ASocket::LogFnCallback  m_oLog;
+   ASocket::SettingsFlag   m_eSettingsFlags;
+   std::string             m_strPort;
+
+   std::vector<int>                              m_vecCPUs;
+   std::vector<std::unique_ptr<CTCPEventServer>> m_vecWorkers;
+   std::vector<std::thread>                      m_vecThreads;
+
+   AcceptFnCallback   m_fnOnAccept;
+   DataFnCallback     m_fnOnData;
+   WritableFnCallback m_fnOnWritable;
+   CloseFnCallback    m_fnOnClose;
+};
+
+#endif
+#endif
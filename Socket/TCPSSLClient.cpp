@@ -7,13 +7,113 @@
 #ifdef OPENSSL
 #include "TCPSSLClient.h"
 
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+#ifndef WINDOWS
+#include <fcntl.h>
+#endif
+
+namespace
+{
+   // process-wide : "host:port" and client settings (see MakeSessionKey) -> latest session received
+   struct SessionCache
+   {
+      SessionCache() : m_uHits(0), m_uMisses(0) {}
+
+      ~SessionCache()
+      {
+         for (auto& Entry : m_mapSessions)
+            SSL_SESSION_free(Entry.second);
+      }
+
+      std::mutex                                    m_mtxSessions;
+      std::unordered_map<std::string, SSL_SESSION*> m_mapSessions;
+      std::atomic<unsigned long long>               m_uHits;
+      std::atomic<unsigned long long>               m_uMisses;
+   };
+
+   // created on the first Connect, after OpenSSL's initialization, and thus destroyed before its cleanup
+   SessionCache& GetSessionCache()
+   {
+      static SessionCache Cache;
+      return Cache;
+   }
+}
+
 CTCPSSLClient::CTCPSSLClient(const LogFnCallback oLogger,
                              const OpenSSLProtocol eSSLVersion,
                              const SettingsFlag eSettings /*= ALL_FLAGS*/) :
    ASecureSocket(oLogger, eSSLVersion, eSettings),
-   m_TCPClient(oLogger, eSettings)
+   m_TCPClient(oLogger, eSettings),
+   m_bSessionResumption(true),
+   m_bSessionResumed(false)
+{
+
+}
+
+unsigned long long CTCPSSLClient::GetSessionCacheHits()
+{
+   return GetSessionCache().m_uHits.load();
+}
+
+unsigned long long CTCPSSLClient::GetSessionCacheMisses()
+{
+   return GetSessionCache().m_uMisses.load();
+}
+
+void CTCPSSLClient::ClearSessionCache()
+{
+   SessionCache& Cache = GetSessionCache();
+   std::lock_guard<std::mutex> Lock(Cache.m_mtxSessions);
+
+   for (auto& Entry : Cache.m_mapSessions)
+      SSL_SESSION_free(Entry.second);
+   Cache.m_mapSessions.clear();
+}
+
+/* called by OpenSSL when the server issues a session : during the handshake for TLS 1.2,
+ * with the first read following it for TLS 1.3 (NewSessionTicket messages) */
+int CTCPSSLClient::OnNewSession(SSL* pSSL, SSL_SESSION* pSession)
 {
+   const CTCPSSLClient* pClient = static_cast<const CTCPSSLClient*>(SSL_get_app_data(pSSL));
+   if (pClient == nullptr || !SSL_SESSION_is_resumable(pSession))
+      return 0;
+
+   SessionCache& Cache = GetSessionCache();
+   std::lock_guard<std::mutex> Lock(Cache.m_mtxSessions);
+
+   SSL_SESSION*& pCached = Cache.m_mapSessions[pClient->m_strSessionKey];
+   if (pCached != nullptr)
+      SSL_SESSION_free(pCached);
+   pCached = pSession;
 
+   // returning 1 : we keep the reference OpenSSL gave us
+   return 1;
+}
+
+/* a resumed session skips the certificate exchange : it's only offered again to a client
+ * verifying the server like the one which received it. The client's SSL_CTX is created for
+ * each connection, its settings are part of the key instead (NUL separated). */
+std::string CTCPSSLClient::MakeSessionKey(const std::string& strServer, const std::string& strPort) const
+{
+   std::string strKey = strServer + ":" + strPort;
+   const std::string arrSettings[] = {
+      std::to_string(static_cast<int>(m_eOpenSSLProtocol)),
+      std::to_string(SSL_CTX_get_verify_mode(m_SSLConnectSocket.m_pCTXSSL)),
+      std::to_string(SSL_CTX_get_verify_depth(m_SSLConnectSocket.m_pCTXSSL)),
+      m_strCAFile,
+      m_strSSLCertFile,
+      m_strSSLKeyFile
+   };
+
+   for (const std::string& strSetting : arrSettings)
+   {
+      strKey += '\0';
+      strKey += strSetting;
+   }
+   return strKey;
 }
 
 bool CTCPSSLClient::SetRcvTimeout(unsigned int msec_timeout){
@@ -36,6 +136,16 @@ bool CTCPSSLClient::SetSndTimeout(struct timeval timeout){
 
 // Connexion au serveur
 bool CTCPSSLClient::Connect(const std::string& strServer, const std::string& strPort)
+{
+   if (!BeginConnect(strServer, strPort))
+      return false;
+
+   /* initiate the TLS/SSL handshake with an TLS/SSL server, the socket is blocking :
+    * the whole handshake is done by this call */
+   return ContinueConnect() == HandshakeStatus::DONE;
+}
+
+bool CTCPSSLClient::BeginConnect(const std::string& strServer, const std::string& strPort)
 {
    if (m_TCPClient.Connect(strServer, strPort))
    {
@@ -101,49 +211,36 @@ bool CTCPSSLClient::Connect(const std::string& strServer, const std::string& str
       }
       //SSL_CTX_set_cert_verify_callback(m_SSLConnectSocket.m_pCTXSSL, AlwaysTrueCallback, nullptr);
 
+      /* the sessions are kept in our process-wide cache, not in this short-lived context */
+      if (m_bSessionResumption)
+      {
+         SSL_CTX_set_session_cache_mode(m_SSLConnectSocket.m_pCTXSSL,
+                                        SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+         SSL_CTX_sess_set_new_cb(m_SSLConnectSocket.m_pCTXSSL, OnNewSession);
+      }
+
       /* create new SSL connection state */
       m_SSLConnectSocket.m_pSSL = SSL_new(m_SSLConnectSocket.m_pCTXSSL);
       SSL_set_fd(m_SSLConnectSocket.m_pSSL, m_SSLConnectSocket.m_SockFd);
 
-      /* initiate the TLS/SSL handshake with an TLS/SSL server */
-      int iResult = SSL_connect(m_SSLConnectSocket.m_pSSL);
-      if (iResult > 0)
+      m_bSessionResumed = false;
+      if (m_bSessionResumption)
       {
-         /* The data can now be transmitted securely over this connection. */
-         if (m_eSettingsFlags & ENABLE_LOG)
-            m_oLog(StringFormat("[TCPSSLClient][Info] Connected with '%s' encryption.",
-                             SSL_get_cipher(m_SSLConnectSocket.m_pSSL)));
-         
-         /*if (SSL_get_peer_certificate(m_SSLConnectSocket.m_pSSL) != nullptr)
-         {
-            if (SSL_get_verify_result(m_SSLConnectSocket.m_pSSL) == X509_V_OK)
-            {
-               if (m_eSettingsFlags & ENABLE_LOG)
-                  m_oLog("client verification with SSL_get_verify_result() succeeded.");
-            }
-            else
-            {
-               if (m_eSettingsFlags & ENABLE_LOG)
-                  m_oLog("client verification with SSL_get_verify_result() failed.\n");
-
-               return false;
-            }
-         }
-         else if (m_eSettingsFlags & ENABLE_LOG)
-            m_oLog("the peer certificate was not presented.");*/
+         m_strSessionKey = MakeSessionKey(strServer, strPort);
+         SSL_set_app_data(m_SSLConnectSocket.m_pSSL, this);
 
-         return true;
+         SessionCache& Cache = GetSessionCache();
+         std::lock_guard<std::mutex> Lock(Cache.m_mtxSessions);
+
+         auto it = Cache.m_mapSessions.find(m_strSessionKey);
+         if (it != Cache.m_mapSessions.end())
+            SSL_set_session(m_SSLConnectSocket.m_pSSL, it->second);
       }
-      // under Windows it creates problems
-      #ifdef LINUX
-      ERR_print_errors_fp(stdout);
-      #endif
 
-      if (m_eSettingsFlags & ENABLE_LOG)
-         m_oLog(StringFormat("[TCPSSLClient][Error] SSL_connect failed (Error=%d | %s)",
-            iResult, GetSSLErrorString(SSL_get_error(m_SSLConnectSocket.m_pSSL, iResult))));
+      RequestKernelTLS(m_SSLConnectSocket);
+      SSL_set_connect_state(m_SSLConnectSocket.m_pSSL);
 
-      return false;
+      return true;
    }
 
    if (m_eSettingsFlags & ENABLE_LOG)
@@ -152,6 +249,60 @@ bool CTCPSSLClient::Connect(const std::string& strServer, const std::string& str
    return false;
 }
 
+ASecureSocket::HandshakeStatus CTCPSSLClient::ContinueConnect()
+{
+   int iResult = SSL_do_handshake(m_SSLConnectSocket.m_pSSL);
+   if (iResult > 0)
+   {
+      if (m_bSessionResumption)
+      {
+         // an abbreviated handshake : no certificate exchange nor asymmetric crypto
+         m_bSessionResumed = SSL_session_reused(m_SSLConnectSocket.m_pSSL) == 1;
+         ++(m_bSessionResumed ? GetSessionCache().m_uHits : GetSessionCache().m_uMisses);
+      }
+
+      /* The data can now be transmitted securely over this connection. */
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[TCPSSLClient][Info] Connected with '%s' encryption.",
+                          SSL_get_cipher(m_SSLConnectSocket.m_pSSL)));
+
+      /*if (SSL_get_peer_certificate(m_SSLConnectSocket.m_pSSL) != nullptr)
+      {
+         if (SSL_get_verify_result(m_SSLConnectSocket.m_pSSL) == X509_V_OK)
+         {
+            if (m_eSettingsFlags & ENABLE_LOG)
+               m_oLog("client verification with SSL_get_verify_result() succeeded.");
+         }
+         else
+         {
+            if (m_eSettingsFlags & ENABLE_LOG)
+               m_oLog("client verification with SSL_get_verify_result() failed.\n");
+
+            return HandshakeStatus::FAILED;
+         }
+      }
+      else if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog("the peer certificate was not presented.");*/
+
+      return HandshakeStatus::DONE;
+   }
+
+   const HandshakeStatus eStatus = GetHandshakeStatus(m_SSLConnectSocket, iResult);
+   if (eStatus != HandshakeStatus::FAILED)
+      return eStatus;
+
+   // under Windows it creates problems
+   #ifdef LINUX
+   ERR_print_errors_fp(stdout);
+   #endif
+
+   if (m_eSettingsFlags & ENABLE_LOG)
+      m_oLog(StringFormat("[TCPSSLClient][Error] SSL_connect failed (Error=%d | %s)",
+         iResult, GetSSLErrorString(SSL_get_error(m_SSLConnectSocket.m_pSSL, iResult))));
+
+   return HandshakeStatus::FAILED;
+}
+
 bool CTCPSSLClient::Send(const char* pData, const size_t uSize) const
 {
    if (m_TCPClient.m_eStatus != CTCPClient::CONNECTED)
@@ -192,6 +343,30 @@ bool CTCPSSLClient::Send(const std::vector<char>& Data) const
    return Send(Data.data(), Data.size());
 }
 
+#ifndef WINDOWS
+bool CTCPSSLClient::SendFile(const int iFileFd, const off_t Offset, const size_t uSize) const
+{
+   if (m_TCPClient.m_eStatus != CTCPClient::CONNECTED)
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog("[TCPSSLClient][Error] SSL send failed : not connected to an SSL server.");
+
+      return false;
+   }
+
+   if (!SendFileSSL(m_SSLConnectSocket, iFileFd, Offset, uSize))
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[TCPSSLClient][Error] SendFile failed (kTLS %s).",
+                             IsKernelTLSSendActive() ? "active" : "inactive"));
+
+      return false;
+   }
+
+   return true;
+}
+#endif
+
 bool CTCPSSLClient::HasPending()
 {
    int pend;
@@ -210,6 +385,63 @@ int CTCPSSLClient::PendingBytes()
    return nPend;
 }
 
+ASocket::ConnectionState CTCPSSLClient::ProbeConnection()
+{
+   SSL* pSSL = m_SSLConnectSocket.m_pSSL;
+   if (m_TCPClient.m_eStatus != CTCPClient::CONNECTED || pSSL == nullptr)
+      return CONNECTION_ERROR;
+
+   // application data already decrypted : the socket doesn't see it
+   if (SSL_pending(pSSL) > 0)
+      return CONNECTION_READABLE;
+
+   if (!SSL_has_pending(pSSL))
+   {
+      const ConnectionState eState = ASocket::ProbeConnection(m_SSLConnectSocket.m_SockFd);
+      if (eState != CONNECTION_READABLE)
+         return eState;
+   }
+
+   /* the pending records may only be post-handshake messages (or a close_notify) : let OpenSSL
+    * process them, on a non-blocking socket so that SSL_peek stops when they are consumed */
+   const Socket Sock = m_SSLConnectSocket.m_SockFd;
+   #ifndef WINDOWS
+   const int iFlags = fcntl(Sock, F_GETFL, 0);
+   if (iFlags < 0 || fcntl(Sock, F_SETFL, iFlags | O_NONBLOCK) < 0)
+      return CONNECTION_ERROR;
+   #else
+   u_long ulNonBlocking = 1;
+   if (ioctlsocket(Sock, FIONBIO, &ulNonBlocking) != 0)
+      return CONNECTION_ERROR;
+   #endif
+
+   char cByte;
+   const int iPeeked = SSL_peek(pSSL, &cByte, 1);
+   const int iError = (iPeeked > 0) ? SSL_ERROR_NONE : SSL_get_error(pSSL, iPeeked);
+   ERR_clear_error();
+
+   #ifndef WINDOWS
+   fcntl(Sock, F_SETFL, iFlags);
+   #else
+   ulNonBlocking = 0;
+   ioctlsocket(Sock, FIONBIO, &ulNonBlocking);
+   #endif
+
+   switch (iError)
+   {
+      case SSL_ERROR_NONE:
+         return CONNECTION_READABLE;
+      case SSL_ERROR_WANT_READ:
+      case SSL_ERROR_WANT_WRITE:
+         return CONNECTION_ALIVE;
+      case SSL_ERROR_ZERO_RETURN:
+         return CONNECTION_CLOSED;
+      default:
+         // an EOF without close_notify is reported as a syscall error
+         return (iError == SSL_ERROR_SYSCALL && iPeeked == 0) ? CONNECTION_CLOSED : CONNECTION_ERROR;
+   }
+}
+
 int CTCPSSLClient::Receive(char* pData, const size_t uSize, bool bReadFully /*= true*/) const
 {
    if (m_TCPClient.m_eStatus != CTCPClient::CONNECTED)
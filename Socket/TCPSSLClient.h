@@ -27,6 +27,14 @@ public:
    /* connect to a TCP SSL server */
    bool Connect(const std::string& strServer, const std::string& strPort);
 
+   /* non-blocking handshake : BeginConnect establishes the TCP connection and prepares the
+    * SSL object, then ContinueConnect advances the handshake each time the (non-blocking)
+    * socket is ready, until it returns DONE or FAILED (see CSSLHandshakeDriver). */
+   bool BeginConnect(const std::string& strServer, const std::string& strPort);
+   HandshakeStatus ContinueConnect();
+
+   inline Socket GetSocketDescriptor() const { return m_SSLConnectSocket.m_SockFd; }
+
    bool SetRcvTimeout(unsigned int timeout);
    bool SetSndTimeout(unsigned int timeout);
 
@@ -43,16 +51,50 @@ public:
    bool Send(const std::string& strData) const;
    bool Send(const std::vector<char>& Data) const;
 
+#ifndef WINDOWS
+   /* sends uSize bytes of an open file from Offset, without copying them through
+    * user space when kernel TLS is active on the connection (see SetKernelTLS) */
+   bool SendFile(const int iFileFd, const off_t Offset, const size_t uSize) const;
+#endif
+
    /* receive data from a TCP SSL server */
    bool HasPending();
    int PendingBytes();
 
    int Receive(char* pData, const size_t uSize, bool bReadFully = true) const;
 
+   /* TLS-aware ASocket::ProbeConnection, used by CConnectionPool : the records pending on an idle
+    * connection are processed without blocking, so a TLS 1.3 session ticket or key update doesn't
+    * make it look READABLE, while the data already decrypted by OpenSSL does. */
+   using ASocket::ProbeConnection;
+   ConnectionState ProbeConnection();
+
+   /* TLS session resumption (enabled by default) : the sessions given by a server are
+    * cached per "host:port" for the whole process, so that a later Connect to the same
+    * server, from any client object with the same protocol, CA, certificate and key
+    * settings, resumes it instead of doing a full handshake. */
+   inline void SetSessionResumption(const bool bEnable) { m_bSessionResumption = bEnable; }
+   inline bool IsSessionResumed() const { return m_bSessionResumed; }
+
+   inline bool IsKernelTLSSendActive() const { return ASecureSocket::IsKernelTLSSendActive(m_SSLConnectSocket); }
+   inline bool IsKernelTLSRecvActive() const { return ASecureSocket::IsKernelTLSRecvActive(m_SSLConnectSocket); }
+
+   /* handshakes that resumed a cached session (hits) or were full ones (misses) */
+   static unsigned long long GetSessionCacheHits();
+   static unsigned long long GetSessionCacheMisses();
+   static void ClearSessionCache();
+
 protected:
+   static int OnNewSession(SSL* pSSL, SSL_SESSION* pSession);
+   std::string MakeSessionKey(const std::string& strServer, const std::string& strPort) const;
+
    CTCPClient  m_TCPClient;
    SSLSocket   m_SSLConnectSocket;
 
+   bool        m_bSessionResumption;
+   bool        m_bSessionResumed;
+   std::string m_strSessionKey;
+
 };
 
 #endif
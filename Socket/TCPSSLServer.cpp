@@ -7,13 +7,28 @@
 #ifdef OPENSSL
 #include "TCPSSLServer.h"
 
+#ifdef LINUX
+#include <chrono>
+
+#include <fcntl.h>
+#include <poll.h>
+#endif
+
 CTCPSSLServer::CTCPSSLServer(const LogFnCallback oLogger,
                              const std::string& strPort,
                              const OpenSSLProtocol eSSLVersion,
                              const SettingsFlag eSettings /*= ALL_FLAGS*/)
                              /*throw (EResolveError)*/ :
    ASecureSocket(oLogger, eSSLVersion, eSettings),
-   m_TCPServer(oLogger, strPort, eSettings)
+   m_TCPServer(oLogger, strPort, eSettings),
+   m_pCTXSSL(nullptr),
+   m_uSessionHits(0),
+   m_uSessionMisses(0)
+#ifdef LINUX
+   , m_uHandshakeTimeoutMs(0),
+   m_bResetOnHandshakeTimeout(false),
+   m_uHandshakeTimeouts(0)
+#endif
 {
 
 }
@@ -36,109 +51,278 @@ bool CTCPSSLServer::SetSndTimeout(SSLSocket& ClientSocket, struct timeval timeou
 }
 #endif
 
-// returns the socket of the accepted client
-bool CTCPSSLServer::Listen(SSLSocket& ClientSocket, size_t msec /*= ACCEPT_WAIT_INF_DELAY*/)
+SSL_CTX* CTCPSSLServer::CreateContext() const
 {
-   if (m_TCPServer.Listen(ClientSocket.m_SockFd, msec))
+   SSL_CTX* pCTXSSL = SSL_CTX_new(GetServerMethod());
+   if (pCTXSSL == nullptr)
    {
-      SetUpCtxServer(ClientSocket);
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog("[TCPSSLServer][Error] SSL CTX failed.");
+      //ERR_print_errors_fp(stdout);
+      return nullptr;
+   }
 
-      if (ClientSocket.m_pCTXSSL == nullptr)
+   /* session resumption : stateless tickets, plus the internal session cache for the
+    * clients that only offer a session ID. A reloaded context starts with new ticket
+    * keys and an empty cache, the clients then do one full handshake again. */
+   static const unsigned char SESSION_ID_CONTEXT[] = "socket-cpp";
+   SSL_CTX_set_session_cache_mode(pCTXSSL, SSL_SESS_CACHE_SERVER);
+   SSL_CTX_set_session_id_context(pCTXSSL, SESSION_ID_CONTEXT, sizeof(SESSION_ID_CONTEXT) - 1);
+   SSL_CTX_clear_options(pCTXSSL, SSL_OP_NO_TICKET);
+
+   //SSL_CTX_set_options(pCTXSSL, SSL_OP_SINGLE_DH_USE);
+   //SSL_CTX_set_cert_verify_callback(pCTXSSL, AlwaysTrueCallback, nullptr);
+
+   /* Load server certificate into the SSL context. */
+   if (!m_strSSLCertFile.empty())
+   {
+      if (SSL_CTX_use_certificate_file(pCTXSSL,
+         m_strSSLCertFile.c_str(), SSL_FILETYPE_PEM) <= 0)
       {
          if (m_eSettingsFlags & ENABLE_LOG)
-            m_oLog("[TCPSSLServer][Error] SSL CTX failed.");
+            m_oLog("[TCPSSLServer][Error] Loading cert file failed.");
          //ERR_print_errors_fp(stdout);
-         return false;
+         SSL_CTX_free(pCTXSSL);
+         return nullptr;
       }
+   }
+   /* Load trusted CA file. */
+   if (!m_strCAFile.empty())
+   {
+      if (!SSL_CTX_load_verify_locations(pCTXSSL, m_strCAFile.c_str(), nullptr))
+      {
+         if (m_eSettingsFlags & ENABLE_LOG)
+            m_oLog("[TCPSSLServer][Error] Loading CA file failed.");
 
-      //SSL_CTX_set_options(ClientSocket.m_pCTXSSL, SSL_OP_SINGLE_DH_USE);
-      //SSL_CTX_set_cert_verify_callback(ClientSocket.m_pCTXSSL, AlwaysTrueCallback, nullptr);
-
-      /* Load server certificate into the SSL context. */
-      if (!m_strSSLCertFile.empty())
+         SSL_CTX_free(pCTXSSL);
+         return nullptr;
+      }
+      /* Set to require peer (client) certificate verification. */
+      //SSL_CTX_set_verify(pCTXSSL, SSL_VERIFY_PEER, VerifyCallback);
+      /* Set the verification depth to 1 */
+      SSL_CTX_set_verify_depth(pCTXSSL, 1);
+   }
+   /* Load the server private-key into the SSL context. */
+   if (!m_strSSLKeyFile.empty())
+   {
+      if (SSL_CTX_use_PrivateKey_file(pCTXSSL,
+         m_strSSLKeyFile.c_str(), SSL_FILETYPE_PEM) <= 0)
       {
-         if (SSL_CTX_use_certificate_file(ClientSocket.m_pCTXSSL,
-            m_strSSLCertFile.c_str(), SSL_FILETYPE_PEM) <= 0)
-         {
-            if (m_eSettingsFlags & ENABLE_LOG)
-               m_oLog("[TCPSSLServer][Error] Loading cert file failed.");
-            //ERR_print_errors_fp(stdout);
-            return false;
-         }
+         if (m_eSettingsFlags & ENABLE_LOG)
+            m_oLog("[TCPSSLServer][Error] Loading key file failed.");
+         //ERR_print_errors_fp(stdout);
+         SSL_CTX_free(pCTXSSL);
+         return nullptr;
       }
-      /* Load trusted CA file. */
-      if (!m_strCAFile.empty())
+
+      // verify private key
+      if (!m_strSSLCertFile.empty() && !SSL_CTX_check_private_key(pCTXSSL))
       {
-         if (!SSL_CTX_load_verify_locations(ClientSocket.m_pCTXSSL, m_strCAFile.c_str(), nullptr))
-         {
-            if (m_eSettingsFlags & ENABLE_LOG)
-               m_oLog("[TCPSSLServer][Error] Loading CA file failed.");
+         if (m_eSettingsFlags & ENABLE_LOG)
+            m_oLog("[TCPSSLServer][Error] Private key does not match the public certificate.");
 
-            return false;
-         }
-         /* Set to require peer (client) certificate verification. */
-         //SSL_CTX_set_verify(m_SSLConnectSocket.m_pCTXSSL, SSL_VERIFY_PEER, VerifyCallback);
-         /* Set the verification depth to 1 */
-         SSL_CTX_set_verify_depth(ClientSocket.m_pCTXSSL, 1);
+         SSL_CTX_free(pCTXSSL);
+         return nullptr;
       }
-      /* Load the server private-key into the SSL context. */
-      if (!m_strSSLKeyFile.empty())
+   }
+
+   return pCTXSSL;
+}
+
+SSL_CTX* CTCPSSLServer::AcquireContext()
+{
+   std::lock_guard<std::mutex> Lock(m_mtxCTX);
+
+   // built once : the PEM files aren't parsed again for each accepted client
+   if (m_pCTXSSL == nullptr)
+      m_pCTXSSL = CreateContext();
+
+   if (m_pCTXSSL != nullptr)
+      SSL_CTX_up_ref(m_pCTXSSL);
+
+   return m_pCTXSSL;
+}
+
+bool CTCPSSLServer::ReloadCertificates()
+{
+   // parsing the files is done outside the lock, Listen isn't held up meanwhile
+   SSL_CTX* pNewCTXSSL = CreateContext();
+   if (pNewCTXSSL == nullptr)
+      return false;
+
+   SSL_CTX* pOldCTXSSL;
+   {
+      std::lock_guard<std::mutex> Lock(m_mtxCTX);
+      pOldCTXSSL = m_pCTXSSL;
+      m_pCTXSSL = pNewCTXSSL;
+   }
+
+   // the clients accepted with the old context still hold a reference on it
+   if (pOldCTXSSL != nullptr)
+      SSL_CTX_free(pOldCTXSSL);
+
+   return true;
+}
+
+// returns the socket of the accepted client
+bool CTCPSSLServer::Listen(SSLSocket& ClientSocket, size_t msec /*= ACCEPT_WAIT_INF_DELAY*/)
+{
+   if (!BeginAccept(ClientSocket, msec))
+      return false;
+
+#ifdef LINUX
+   if (m_uHandshakeTimeoutMs > 0)
+   {
+      bool bTimedOut = false;
+      if (AcceptWithDeadline(ClientSocket, bTimedOut) != HandshakeStatus::DONE)
       {
-         if (SSL_CTX_use_PrivateKey_file(ClientSocket.m_pCTXSSL,
-            m_strSSLKeyFile.c_str(), SSL_FILETYPE_PEM) <= 0)
-         {
-            if (m_eSettingsFlags & ENABLE_LOG)
-               m_oLog("[TCPSSLServer][Error] Loading key file failed.");
-            //ERR_print_errors_fp(stdout);
-            return false;
-         }
+         ShutdownSSL(ClientSocket);
 
-         // verify private key
-         /*if (!SSL_CTX_check_private_key(ClientSocket.m_pCTXSSL))
+         if (bTimedOut)
          {
+            ++m_uHandshakeTimeouts;
+
             if (m_eSettingsFlags & ENABLE_LOG)
-               m_oLog("[TCPSSLServer][Error] Private key does not match the public certificate.");
+               m_oLog(StringFormat("[TCPSSLServer][Error] handshake not completed within %zu ms, disconnecting the client.",
+                                   m_uHandshakeTimeoutMs));
+
+            if (m_bResetOnHandshakeTimeout)
+               m_TCPServer.ApplySocketOptions(ClientSocket.m_SockFd, CSocketOptions().SetLinger(0));
 
-            return false;
-         }*/
+            m_TCPServer.Disconnect(ClientSocket.m_SockFd);
+            ClientSocket.m_SockFd = INVALID_SOCKET;
+         }
+
+         return false;
       }
 
-      ClientSocket.m_pSSL = SSL_new(ClientSocket.m_pCTXSSL);
-      // set the socket directly into the SSL structure or we can use a BIO structure
-      SSL_set_fd(ClientSocket.m_pSSL, ClientSocket.m_SockFd);
+      return true;
+   }
+#endif
 
-      /* wait for a TLS/SSL client to initiate a TLS/SSL handshake */
-      int iSSLErr = SSL_accept(ClientSocket.m_pSSL);
-      if (iSSLErr <= 0)
-      {
-         //Error occurred, log and close down ssl
-         if (m_eSettingsFlags & ENABLE_LOG)
-            m_oLog(StringFormat("[TCPSSLServer][Error] accept failed. (Error=%d | %s)",
-                             iSSLErr, GetSSLErrorString(SSL_get_error(ClientSocket.m_pSSL, iSSLErr))));
+   /* wait for a TLS/SSL client to initiate a TLS/SSL handshake, the socket is blocking :
+    * the whole handshake is done by this call */
+   if (ContinueAccept(ClientSocket) != HandshakeStatus::DONE)
+   {
+      ShutdownSSL(ClientSocket);
 
-         //if (iSSLErr < 0)
-         // under Windows it creates problems
-            #ifdef LINUX
-            ERR_print_errors_fp(stdout);
-            #endif
+      return false;
+   }
 
-         ShutdownSSL(ClientSocket);
+   /* The TLS/SSL handshake is successfully completed and  a TLS/SSL connection
+    * has been established. Now all reads and writes must use SSL. */
+   // peer_cert = SSL_get_peer_certificate(ClientSocket.m_pSSL);
+   return true;
+}
 
-         return false;
-      }
+bool CTCPSSLServer::BeginAccept(SSLSocket& ClientSocket, size_t msec /*= ACCEPT_WAIT_INF_DELAY*/)
+{
+   // a context that can't be built is reported before accepting anyone
+   SSL_CTX* pCTXSSL = AcquireContext();
+   if (pCTXSSL == nullptr)
+      return false;
+
+   if (m_TCPServer.Listen(ClientSocket.m_SockFd, msec))
+   {
+      ClientSocket.m_pCTXSSL = pCTXSSL;
+      ClientSocket.m_pMTHDSSL = const_cast<SSL_METHOD*>(GetServerMethod());
+
+      ClientSocket.m_pSSL = SSL_new(ClientSocket.m_pCTXSSL);
+      // set the socket directly into the SSL structure or we can use a BIO structure
+      SSL_set_fd(ClientSocket.m_pSSL, ClientSocket.m_SockFd);
+      RequestKernelTLS(ClientSocket);
+      SSL_set_accept_state(ClientSocket.m_pSSL);
 
-      /* The TLS/SSL handshake is successfully completed and  a TLS/SSL connection
-       * has been established. Now all reads and writes must use SSL. */
-      // peer_cert = SSL_get_peer_certificate(ClientSocket.m_pSSL);
       return true;
    }
 
+   SSL_CTX_free(pCTXSSL);
+
    if (m_eSettingsFlags & ENABLE_LOG)
       m_oLog("[TCPSSLServer][Error] Unable to accept an incoming TCP connection with a client.");
 
    return false;
 }
 
+ASecureSocket::HandshakeStatus CTCPSSLServer::ContinueAccept(SSLSocket& ClientSocket)
+{
+   int iSSLErr = SSL_do_handshake(ClientSocket.m_pSSL);
+   if (iSSLErr <= 0)
+   {
+      const HandshakeStatus eStatus = GetHandshakeStatus(ClientSocket, iSSLErr);
+      if (eStatus != HandshakeStatus::FAILED)
+         return eStatus;
+
+      //Error occurred, log and close down ssl
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[TCPSSLServer][Error] accept failed. (Error=%d | %s)",
+                          iSSLErr, GetSSLErrorString(SSL_get_error(ClientSocket.m_pSSL, iSSLErr))));
+
+      //if (iSSLErr < 0)
+      // under Windows it creates problems
+         #ifdef LINUX
+         ERR_print_errors_fp(stdout);
+         #endif
+
+      return HandshakeStatus::FAILED;
+   }
+
+   ++(SSL_session_reused(ClientSocket.m_pSSL) ? m_uSessionHits : m_uSessionMisses);
+
+   return HandshakeStatus::DONE;
+}
+
+#ifdef LINUX
+ASecureSocket::HandshakeStatus CTCPSSLServer::AcceptWithDeadline(SSLSocket& ClientSocket, bool& bTimedOut)
+{
+   bTimedOut = false;
+
+   const int iFlags = fcntl(ClientSocket.m_SockFd, F_GETFL, 0);
+   if (iFlags < 0 || fcntl(ClientSocket.m_SockFd, F_SETFL, iFlags | O_NONBLOCK) < 0)
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[TCPSSLServer][Error] fcntl failed : %s", strerror(errno)));
+
+      return HandshakeStatus::FAILED;
+   }
+
+   // the deadline covers the whole handshake, however the peer splits its records
+   const auto Deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_uHandshakeTimeoutMs);
+
+   HandshakeStatus eStatus;
+   while ((eStatus = ContinueAccept(ClientSocket)) == HandshakeStatus::WANT_READ ||
+          eStatus == HandshakeStatus::WANT_WRITE)
+   {
+      const long long llRemainingMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+         Deadline - std::chrono::steady_clock::now()).count();
+      if (llRemainingMs <= 0)
+      {
+         bTimedOut = true;
+         eStatus = HandshakeStatus::FAILED;
+         break;
+      }
+
+      struct pollfd PollFd;
+      PollFd.fd = ClientSocket.m_SockFd;
+      PollFd.events = (eStatus == HandshakeStatus::WANT_READ) ? POLLIN : POLLOUT;
+      PollFd.revents = 0;
+
+      if (poll(&PollFd, 1, static_cast<int>(llRemainingMs)) < 0 && errno != EINTR)
+      {
+         if (m_eSettingsFlags & ENABLE_LOG)
+            m_oLog(StringFormat("[TCPSSLServer][Error] poll failed : %s", strerror(errno)));
+
+         eStatus = HandshakeStatus::FAILED;
+         break;
+      }
+   }
+
+   fcntl(ClientSocket.m_SockFd, F_SETFL, iFlags);
+
+   return eStatus;
+}
+#endif
+
 bool CTCPSSLServer::HasPending(const SSLSocket& ClientSocket)
 {
    int pend;
@@ -231,6 +415,23 @@ bool CTCPSSLServer::Send(const SSLSocket& ClientSocket, const std::vector<char>&
    return ret;
 }
 
+#ifndef WINDOWS
+bool CTCPSSLServer::SendFile(const SSLSocket& ClientSocket, const int iFileFd,
+                             const off_t Offset, const size_t uSize) const
+{
+   if (!SendFileSSL(ClientSocket, iFileFd, Offset, uSize))
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[TCPSSLServer][Error] SendFile failed (kTLS %s).",
+                             IsKernelTLSSendActive(ClientSocket) ? "active" : "inactive"));
+
+      return false;
+   }
+
+   return true;
+}
+#endif
+
 bool CTCPSSLServer::Disconnect(SSLSocket& ClientSocket) const
 {
    // send close_notify message to notify peer of the SSL closure.
@@ -241,6 +442,7 @@ bool CTCPSSLServer::Disconnect(SSLSocket& ClientSocket) const
 
 CTCPSSLServer::~CTCPSSLServer()
 {
-
+   if (m_pCTXSSL != nullptr)
+      SSL_CTX_free(m_pCTXSSL);
 }
 #endif
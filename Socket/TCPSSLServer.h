@@ -10,6 +10,9 @@
 #ifndef INCLUDE_TCPSSLSERVER_H_
 #define INCLUDE_TCPSSLSERVER_H_
 
+#include <atomic>
+#include <mutex>
+
 #include "SecureSocket.h"
 #include "TCPServer.h"
 
@@ -32,6 +35,43 @@ public:
 
    bool Listen(SSLSocket& ClientSocket, size_t msec = ACCEPT_WAIT_INF_DELAY);
 
+   // see CTCPServer::SetBacklog
+   inline void SetBacklog(const int iBacklog) { m_TCPServer.SetBacklog(iBacklog); }
+
+   // see CTCPServer::SetSocketOptions
+   inline void SetSocketOptions(const CSocketOptions& Options) { m_TCPServer.SetSocketOptions(Options); }
+
+   /* non-blocking accept, so a slow peer can't stall the acceptor : BeginAccept accepts the
+    * TCP client and prepares its SSL object, then ContinueAccept advances the handshake each
+    * time the (non-blocking) socket is ready, until it returns DONE or FAILED.
+    * CSSLHandshakeDriver runs many of them on a single thread. */
+   bool BeginAccept(SSLSocket& ClientSocket, size_t msec = ACCEPT_WAIT_INF_DELAY);
+   HandshakeStatus ContinueAccept(SSLSocket& ClientSocket);
+
+   /* re-reads the certificate, CA and key files into a new SSL context used by the
+    * next accepted clients, the connected ones keep the previous one. On failure,
+    * the current context is left untouched. Can be called while Listen is running. */
+   bool ReloadCertificates();
+
+#ifdef LINUX
+   /* bounds the whole handshake done by Listen (0, the default : no limit), so that a client
+    * trickling its handshake can't hold the acceptor : past msec, Listen disconnects it (with a
+    * reset if bReset, see CSocketOptions::SetLinger) and returns false. The socket is only
+    * non-blocking during the handshake. */
+   inline void SetHandshakeTimeout(const size_t msec, const bool bReset = false)
+   {
+      m_uHandshakeTimeoutMs = msec;
+      m_bResetOnHandshakeTimeout = bReset;
+   }
+
+   /* clients disconnected by Listen because of the handshake timeout */
+   unsigned long long GetHandshakeTimeoutCount() const { return m_uHandshakeTimeouts.load(); }
+#endif
+
+   /* accepted handshakes that resumed a session (ticket or cached session ID) or were full ones */
+   unsigned long long GetSessionHits() const { return m_uSessionHits.load(); }
+   unsigned long long GetSessionMisses() const { return m_uSessionMisses.load(); }
+
    bool SetRcvTimeout(SSLSocket& ClientSocket, unsigned int msec_timeout);
    bool SetSndTimeout(SSLSocket& ClientSocket, unsigned int timeout);
    
@@ -49,11 +89,41 @@ public:
    bool Send(const SSLSocket& ClientSocket, const std::string& strData) const;
    bool Send(const SSLSocket& ClientSocket, const std::vector<char>& Data) const;
 
+#ifndef WINDOWS
+   /* sends uSize bytes of an open file from Offset, without copying them through
+    * user space when kernel TLS is active on the connection (see SetKernelTLS) */
+   bool SendFile(const SSLSocket& ClientSocket, const int iFileFd, const off_t Offset, const size_t uSize) const;
+#endif
+
    bool Disconnect(SSLSocket& ClientSocket) const;
 
 protected:
+   /* builds an SSL context from the current certificate, CA and key files */
+   SSL_CTX* CreateContext() const;
+
+   /* returns a new reference to the shared context (created on first use) */
+   SSL_CTX* AcquireContext();
+
+#ifdef LINUX
+   /* ContinueAccept until the handshake is over or the handshake timeout expires (bTimedOut) */
+   HandshakeStatus AcceptWithDeadline(SSLSocket& ClientSocket, bool& bTimedOut);
+#endif
+
    CTCPServer m_TCPServer;
 
+   // shared by all the accepted clients, each SSLSocket holds a reference on it
+   SSL_CTX*   m_pCTXSSL;
+   std::mutex m_mtxCTX;
+
+   std::atomic<unsigned long long> m_uSessionHits;
+   std::atomic<unsigned long long> m_uSessionMisses;
+
+#ifdef LINUX
+   size_t                          m_uHandshakeTimeoutMs;
+   bool                            m_bResetOnHandshakeTimeout;
+   std::atomic<unsigned long long> m_uHandshakeTimeouts;
+#endif
+
 };
 
 #endif
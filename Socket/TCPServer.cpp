@@ -6,6 +6,13 @@
 
 #include "TCPServer.h"
 
+#ifdef LINUX
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <netinet/tcp.h>
+#endif
+
 CTCPServer::CTCPServer(const LogFnCallback oLogger,
 					   /*const std::string& strAddr,*/
 					   const std::string& strPort,
@@ -13,6 +20,16 @@ CTCPServer::CTCPServer(const LogFnCallback oLogger,
 					   /*throw (EResolveError)*/ :
 		ASocket(oLogger, eSettings),
 		m_ListenSocket(INVALID_SOCKET),
+		m_iBacklog(SOMAXCONN),
+		m_bListening(false),
+		m_SocketOptions(),
+#ifdef LINUX
+		m_bReusePort(false),
+		m_bNonBlockingAccept(false),
+		m_iFastOpenQueue(0),
+		m_ullOverflowsAtListen(0),
+		m_ullDropsAtListen(0),
+#endif
 #ifdef WINDOWS
 		m_pResultAddrInfo(nullptr),
 #endif
@@ -87,7 +104,7 @@ bool CTCPServer::SetSndTimeout(ASocket::Socket& ClientSocket, unsigned int msec_
 #ifndef WINDOWS
 	struct timeval t = ASocket::TimevalFromMsec(msec_timeout);
 
-	return this->SetRcvTimeout(ClientSocket, t);
+	return this->SetSndTimeout(ClientSocket, t);
 #else
 	int iErr;
 
@@ -133,132 +150,146 @@ bool CTCPServer::SetSndTimeout(ASocket::Socket& ClientSocket, struct timeval Tim
 }
 #endif
 
-// returns the socket of the accepted client
-// maxRcvTime and maxSendTime define timeouts in µs for receiving and sending over the socket. Using a negative value
-// will deactivate the timeout. 0 will set a zero timeout.
-bool CTCPServer::Listen(ASocket::Socket& ClientSocket, size_t msec /*= ACCEPT_WAIT_INF_DELAY*/) {
-	ClientSocket = INVALID_SOCKET;
-
-	// creates a socket to listen for incoming client connections if it doesn't already exist
-	if (m_ListenSocket == INVALID_SOCKET) {
+// creates the listen socket and binds it to the server's port, listen() is not called here
+bool CTCPServer::SetUpListenSocket() {
 #ifdef WINDOWS
-		m_ListenSocket = socket(m_pResultAddrInfo->ai_family,
-								m_pResultAddrInfo->ai_socktype,
-								m_pResultAddrInfo->ai_protocol);
+	m_ListenSocket = socket(m_pResultAddrInfo->ai_family,
+							m_pResultAddrInfo->ai_socktype,
+							m_pResultAddrInfo->ai_protocol);
 
-		if (m_ListenSocket == INVALID_SOCKET)
-		{
-		   if (m_eSettingsFlags & ENABLE_LOG)
-			  m_oLog(StringFormat("[TCPServer][Error] socket failed : %d", WSAGetLastError()));
-		   freeaddrinfo(m_pResultAddrInfo);
-		   m_pResultAddrInfo = nullptr;
-		   return false;
-		}
+	if (m_ListenSocket == INVALID_SOCKET)
+	{
+	   if (m_eSettingsFlags & ENABLE_LOG)
+		  m_oLog(StringFormat("[TCPServer][Error] socket failed : %d", WSAGetLastError()));
+	   freeaddrinfo(m_pResultAddrInfo);
+	   m_pResultAddrInfo = nullptr;
+	   return false;
+	}
 
-		// Allow the socket to be bound to an address that is already in use
-		int opt = 1;
-		int iErr = 0;
+	// Allow the socket to be bound to an address that is already in use
+	int opt = 1;
+	int iErr = 0;
 
-		iErr = setsockopt(m_ListenSocket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<char*>(&opt), sizeof(int));
-		if (iErr < 0)
-		{
-		   if (m_eSettingsFlags & ENABLE_LOG)
-			  m_oLog("[TCPServer][Error] CTCPServer::Listen : Socket error in call to setsockopt.");
+	iErr = setsockopt(m_ListenSocket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<char*>(&opt), sizeof(int));
+	if (iErr < 0)
+	{
+	   if (m_eSettingsFlags & ENABLE_LOG)
+		  m_oLog("[TCPServer][Error] CTCPServer::Listen : Socket error in call to setsockopt.");
 
-		   closesocket(m_ListenSocket);
-		   freeaddrinfo(m_pResultAddrInfo); m_pResultAddrInfo = nullptr;
+	   closesocket(m_ListenSocket);
+	   freeaddrinfo(m_pResultAddrInfo); m_pResultAddrInfo = nullptr;
 
-		   m_ListenSocket = INVALID_SOCKET;
+	   m_ListenSocket = INVALID_SOCKET;
 
-		   return false;
-		}
+	   return false;
+	}
 
-		// bind the listen socket to the host address:port
-		int iResult = bind(m_ListenSocket,
-						   m_pResultAddrInfo->ai_addr,
-						   static_cast<int>(m_pResultAddrInfo->ai_addrlen));
+	// bind the listen socket to the host address:port
+	int iResult = bind(m_ListenSocket,
+					   m_pResultAddrInfo->ai_addr,
+					   static_cast<int>(m_pResultAddrInfo->ai_addrlen));
 
-		freeaddrinfo(m_pResultAddrInfo);	// free memory allocated by getaddrinfo
-		m_pResultAddrInfo = nullptr;
+	freeaddrinfo(m_pResultAddrInfo);	// free memory allocated by getaddrinfo
+	m_pResultAddrInfo = nullptr;
 
-		if (iResult == SOCKET_ERROR)
-		{
-		   if (m_eSettingsFlags & ENABLE_LOG)
-			  m_oLog(StringFormat("[TCPServer][Error] bind failed : %d", WSAGetLastError()));
-		   closesocket(m_ListenSocket);
-		   m_ListenSocket = INVALID_SOCKET;
-		   return false;
-		}
+	if (iResult == SOCKET_ERROR)
+	{
+	   if (m_eSettingsFlags & ENABLE_LOG)
+		  m_oLog(StringFormat("[TCPServer][Error] bind failed : %d", WSAGetLastError()));
+	   closesocket(m_ListenSocket);
+	   m_ListenSocket = INVALID_SOCKET;
+	   return false;
+	}
 #else
 
-		// create a socket
-		// socket(int domain, int type, int protocol)
-		m_ListenSocket = socket(AF_INET, SOCK_STREAM, 0/*IPPROTO_TCP*/);
-		if (m_ListenSocket < 0) {
-			if (m_eSettingsFlags & ENABLE_LOG)
-				m_oLog(StringFormat("[TCPServer][Error] opening socket : %s", strerror(errno)));
+	// create a socket
+	// socket(int domain, int type, int protocol)
+	m_ListenSocket = socket(AF_INET, SOCK_STREAM, 0/*IPPROTO_TCP*/);
+	if (m_ListenSocket < 0) {
+		if (m_eSettingsFlags & ENABLE_LOG)
+			m_oLog(StringFormat("[TCPServer][Error] opening socket : %s", strerror(errno)));
 
-			m_ListenSocket = INVALID_SOCKET;
-			return false;
-		}
+		m_ListenSocket = INVALID_SOCKET;
+		return false;
+	}
+
+	// Allow the socket to be bound to an address that is already in use
+	int opt = 1;
+	int iErr = 0;
+
+	iErr = setsockopt(m_ListenSocket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<char*>(&opt), sizeof(int));
+	if (iErr < 0) {
+		if (m_eSettingsFlags & ENABLE_LOG)
+			m_oLog("[TCPServer][Error] CTCPServer::Listen : Socket error in SO_REUSEADDR call to setsockopt.");
+
+		close(m_ListenSocket);
+		m_ListenSocket = INVALID_SOCKET;
 
-		// Allow the socket to be bound to an address that is already in use
-		int opt = 1;
-		int iErr = 0;
+		return false;
+	}
 
-		iErr = setsockopt(m_ListenSocket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<char*>(&opt), sizeof(int));
+#ifdef LINUX
+	if (m_bReusePort) {
+		iErr = setsockopt(m_ListenSocket, SOL_SOCKET, SO_REUSEPORT, reinterpret_cast<char*>(&opt), sizeof(int));
 		if (iErr < 0) {
 			if (m_eSettingsFlags & ENABLE_LOG)
-				m_oLog("[TCPServer][Error] CTCPServer::Listen : Socket error in SO_REUSEADDR call to setsockopt.");
+				m_oLog(StringFormat("[TCPServer][Error] SO_REUSEPORT failed : %s", strerror(errno)));
 
 			close(m_ListenSocket);
 			m_ListenSocket = INVALID_SOCKET;
 
 			return false;
 		}
-
-		/*
-		iErr = setsockopt(m_ListenSocket, SOL_SOCKET, SO_KEEPALIVE, reinterpret_cast<char*>(&opt), sizeof(int));
-		if (iErr < 0)
-		{
-		   if (m_eSettingsFlags & ENABLE_LOG)
-			  m_oLog("[TCPServer][Error] CTCPServer::Listen : Socket error in SO_KEEPALIVE call to setsockopt.");
-
-		   close(m_ListenSocket);
-		   m_ListenSocket = INVALID_SOCKET;
-
-		   return false;
-		}
-		*/
-
-		// bind(int fd, struct sockaddr *local_addr, socklen_t addr_length)
-		// bind() passes file descriptor, the address structure,
-		// and the length of the address structure
-		// This bind() call will bind  the socket to the current IP address on port, portno
-		int iResult = bind(m_ListenSocket,
-						   reinterpret_cast<struct sockaddr*>(&m_ServAddr),
-						   sizeof(m_ServAddr));
-		if (iResult < 0) {
-			if (m_eSettingsFlags & ENABLE_LOG)
-				m_oLog(StringFormat("[TCPServer][Error] bind failed : %s", strerror(errno)));
-			return false;
-		}
-#endif
 	}
+#endif
 
-#ifdef WINDOWS
-	sockaddr addrClient;
-	int iResult;
-	/* SOMAXCONN = allow max number of connexions in waiting */
-	iResult = listen(m_ListenSocket, SOMAXCONN);
-	if (iResult == SOCKET_ERROR)
+	/*
+	iErr = setsockopt(m_ListenSocket, SOL_SOCKET, SO_KEEPALIVE, reinterpret_cast<char*>(&opt), sizeof(int));
+	if (iErr < 0)
 	{
 	   if (m_eSettingsFlags & ENABLE_LOG)
-		  m_oLog(StringFormat("[TCPServer][Error] listen failed : %d", WSAGetLastError()));
-	   closesocket(m_ListenSocket);
+		  m_oLog("[TCPServer][Error] CTCPServer::Listen : Socket error in SO_KEEPALIVE call to setsockopt.");
+
+	   close(m_ListenSocket);
 	   m_ListenSocket = INVALID_SOCKET;
+
 	   return false;
 	}
+	*/
+
+	// bind(int fd, struct sockaddr *local_addr, socklen_t addr_length)
+	// bind() passes file descriptor, the address structure,
+	// and the length of the address structure
+	// This bind() call will bind  the socket to the current IP address on port, portno
+	int iResult = bind(m_ListenSocket,
+					   reinterpret_cast<struct sockaddr*>(&m_ServAddr),
+					   sizeof(m_ServAddr));
+	if (iResult < 0) {
+		if (m_eSettingsFlags & ENABLE_LOG)
+			m_oLog(StringFormat("[TCPServer][Error] bind failed : %s", strerror(errno)));
+
+		close(m_ListenSocket);
+		m_ListenSocket = INVALID_SOCKET;
+
+		return false;
+	}
+#endif
+
+	return true;
+}
+
+// returns the socket of the accepted client
+// maxRcvTime and maxSendTime define timeouts in µs for receiving and sending over the socket. Using a negative value
+// will deactivate the timeout. 0 will set a zero timeout.
+bool CTCPServer::Listen(ASocket::Socket& ClientSocket, size_t msec /*= ACCEPT_WAIT_INF_DELAY*/) {
+	ClientSocket = INVALID_SOCKET;
+
+	// creates a socket to listen for incoming client connections if it doesn't already exist
+	if (!StartListening())
+		return false;
+
+#ifdef WINDOWS
+	sockaddr addrClient;
 
 	if (msec != ACCEPT_WAIT_INF_DELAY)
 	{
@@ -291,6 +322,8 @@ bool CTCPServer::Listen(ASocket::Socket& ClientSocket, size_t msec /*= ACCEPT_WA
 	   return false;
 	}
 
+	ApplyAcceptOptions(ClientSocket);
+
 	{
 	   if (m_eSettingsFlags & ENABLE_LOG)
 		  // TODO : a version that handles IPv6
@@ -306,18 +339,6 @@ bool CTCPServer::Listen(ASocket::Socket& ClientSocket, size_t msec /*= ACCEPT_WA
 		  //m_oLog(StringFormat("[TCPServer][Info] Connection from %s", buf1));
 
 #else
-	// This listen() call tells the socket to listen to the incoming connections.
-	// The listen() function places all incoming connection into a backlog queue
-	// until accept() call accepts the connection.
-	// Here, we set the maximum size for the backlog queue to SOMAXCONN.
-	int iResult = listen(m_ListenSocket, SOMAXCONN);
-	if (iResult < 0) {
-		if (m_eSettingsFlags & ENABLE_LOG)
-			m_oLog(StringFormat("[TCPServer][Error] listen failed : %s", strerror(errno)));
-
-		return false;
-	}
-
 	if (msec != ACCEPT_WAIT_INF_DELAY) {
 		int ret = SelectSocket(m_ListenSocket, msec);
 		if (ret == 0) {
@@ -335,7 +356,7 @@ bool CTCPServer::Listen(ASocket::Socket& ClientSocket, size_t msec /*= ACCEPT_WA
 		}
 	}
 
-	struct sockaddr_in ClientAddr;
+	struct sockaddr_storage ClientAddr;
 	// The accept() call actually accepts an incoming connection
 	socklen_t uClientLen = sizeof(ClientAddr);
 
@@ -345,25 +366,226 @@ bool CTCPServer::Listen(ASocket::Socket& ClientSocket, size_t msec /*= ACCEPT_WA
 	// So, the original socket file descriptor can continue to be used
 	// for accepting new connections while the new socker file descriptor is used for
 	// communicating with the connected client.
-	ClientSocket = accept(m_ListenSocket,
-						  reinterpret_cast<struct sockaddr*>(&ClientAddr),
-						  &uClientLen);
+	for (;;) {
+		ClientSocket = accept(m_ListenSocket,
+							  reinterpret_cast<struct sockaddr*>(&ClientAddr),
+							  &uClientLen);
+		if (ClientSocket >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+			break;
+
+		// the listen socket is non-blocking once AcceptBatch was used : wait for the next client
+		uClientLen = sizeof(ClientAddr);
+		if (SelectSocket(m_ListenSocket, (msec != ACCEPT_WAIT_INF_DELAY) ? msec : 0) <= 0)
+			break;
+	}
 
 	if (ClientSocket < 0) {
 		if (m_eSettingsFlags & ENABLE_LOG)
 			m_oLog(StringFormat("[TCPServer][Error] accept failed : %s", strerror(errno)));
 
+		ClientSocket = INVALID_SOCKET;
 		return false;
 	}
 
-	if (m_eSettingsFlags & ENABLE_LOG)
+	ApplyAcceptOptions(ClientSocket);
+
+	if ((m_eSettingsFlags & ENABLE_LOG) && ClientAddr.ss_family == AF_INET) {
+		// inet_ntoa isn't reentrant
+		const struct sockaddr_in* pClientAddr = reinterpret_cast<const struct sockaddr_in*>(&ClientAddr);
+		char szAddress[INET_ADDRSTRLEN] = {};
+		inet_ntop(AF_INET, &pClientAddr->sin_addr, szAddress, sizeof(szAddress));
 		m_oLog(StringFormat("[TCPServer][Info] Incoming connection from '%s' port '%d'",
-							inet_ntoa(ClientAddr.sin_addr), ntohs(ClientAddr.sin_port)));
+							szAddress, ntohs(pClientAddr->sin_port)));
+	} else if (m_eSettingsFlags & ENABLE_LOG)
+		m_oLog("[TCPServer][Info] Incoming local connection");
 #endif
 
 	return true;
 }
 
+#ifdef LINUX
+namespace
+{
+	// ListenOverflows and ListenDrops from the TcpExt lines of /proc/net/netstat (names, then values)
+	bool ReadListenCounters(unsigned long long& ullOverflows, unsigned long long& ullDrops) {
+		std::ifstream NetStat("/proc/net/netstat");
+		std::string strNames, strValues;
+		while (std::getline(NetStat, strNames)) {
+			if (strNames.compare(0, 7, "TcpExt:") != 0)
+				continue;
+			if (!std::getline(NetStat, strValues))
+				return false;
+
+			std::istringstream Names(strNames), Values(strValues);
+			std::string strName, strValue;
+			int iFound = 0;
+			while (Names >> strName && Values >> strValue) {
+				if (strName == "ListenOverflows") {
+					ullOverflows = std::stoull(strValue);
+					++iFound;
+				} else if (strName == "ListenDrops") {
+					ullDrops = std::stoull(strValue);
+					++iFound;
+				}
+			}
+			return iFound == 2;
+		}
+		return false;
+	}
+}
+#endif
+
+void CTCPServer::ApplyAcceptOptions(const Socket ClientSocket) const {
+	if (!m_SocketOptions.IsEmpty())
+		m_SocketOptions.Apply(ClientSocket, (m_eSettingsFlags & ENABLE_LOG) ? m_oLog : LogFnCallback());
+}
+
+bool CTCPServer::ApplySocketOptions(const Socket ClientSocket, const CSocketOptions& Options) const {
+	return Options.Apply(ClientSocket, (m_eSettingsFlags & ENABLE_LOG) ? m_oLog : LogFnCallback());
+}
+
+bool CTCPServer::Flush(const Socket ClientSocket) const {
+	return CSocketOptions::Flush(ClientSocket);
+}
+
+bool CTCPServer::StartListening() {
+	if (m_bListening)
+		return true;
+
+	if (m_ListenSocket == INVALID_SOCKET && !SetUpListenSocket())
+		return false;
+
+#ifdef LINUX
+	// a listen socket without Fast Open still serves its clients (with a full handshake)
+	if (m_iFastOpenQueue > 0 &&
+		setsockopt(m_ListenSocket, IPPROTO_TCP, TCP_FASTOPEN, &m_iFastOpenQueue, sizeof(m_iFastOpenQueue)) < 0 &&
+		(m_eSettingsFlags & ENABLE_LOG))
+		m_oLog(StringFormat("[TCPServer][Warning] TCP_FASTOPEN failed : %s", strerror(errno)));
+#endif
+
+	// inherited by the accepted sockets for most of them, applied again to each one anyway
+	ApplyAcceptOptions(m_ListenSocket);
+
+	// listen() places the incoming connections into a queue of m_iBacklog entries until
+	// accept() takes them, the kernel drops them when it's full
+#ifdef WINDOWS
+	if (listen(m_ListenSocket, m_iBacklog) == SOCKET_ERROR)
+	{
+	   if (m_eSettingsFlags & ENABLE_LOG)
+		  m_oLog(StringFormat("[TCPServer][Error] listen failed : %d", WSAGetLastError()));
+	   closesocket(m_ListenSocket);
+	   m_ListenSocket = INVALID_SOCKET;
+	   return false;
+	}
+#else
+	if (listen(m_ListenSocket, m_iBacklog) < 0) {
+		if (m_eSettingsFlags & ENABLE_LOG)
+			m_oLog(StringFormat("[TCPServer][Error] listen failed : %s", strerror(errno)));
+
+		return false;
+	}
+#endif
+
+#ifdef LINUX
+	ReadListenCounters(m_ullOverflowsAtListen, m_ullDropsAtListen);
+#endif
+
+	m_bListening = true;
+	return true;
+}
+
+#ifdef LINUX
+int CTCPServer::AcceptBatch(std::vector<Socket>& vecClients, const size_t uMax, const size_t msec /*= 0*/) {
+	if (uMax == 0)
+		return 0;
+
+	if (!StartListening())
+		return -1;
+
+	// accept4 must fail with EAGAIN once the queue is drained
+	if (!m_bNonBlockingAccept) {
+		const int iFlags = fcntl(m_ListenSocket, F_GETFL, 0);
+		if (iFlags < 0 || fcntl(m_ListenSocket, F_SETFL, iFlags | O_NONBLOCK) < 0) {
+			if (m_eSettingsFlags & ENABLE_LOG)
+				m_oLog(StringFormat("[TCPServer][Error] fcntl failed : %s", strerror(errno)));
+
+			return -1;
+		}
+		m_bNonBlockingAccept = true;
+	}
+
+	if (msec > 0) {
+		int ret = SelectSocket(m_ListenSocket, msec);
+		if (ret == 0)
+			return 0;
+
+		if (ret < 0) {
+			if (m_eSettingsFlags & ENABLE_LOG)
+				m_oLog("[TCPServer][Error] CTCPServer::AcceptBatch : Error selecting socket.");
+
+			return -1;
+		}
+	}
+
+	size_t uAccepted = 0;
+	while (uAccepted < uMax) {
+		Socket ClientSocket = accept4(m_ListenSocket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (ClientSocket < 0) {
+			// a client which reset its connection while it was queued
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+
+			// EMFILE, ENOBUFS... : the clients accepted so far are returned
+			if (m_eSettingsFlags & ENABLE_LOG)
+				m_oLog(StringFormat("[TCPServer][Error] accept4 failed : %s", strerror(errno)));
+
+			if (uAccepted == 0)
+				return -1;
+			break;
+		}
+
+		ApplyAcceptOptions(ClientSocket);
+		vecClients.push_back(ClientSocket);
+		++uAccepted;
+	}
+
+	return static_cast<int>(uAccepted);
+}
+
+bool CTCPServer::GetAcceptQueueStats(AcceptQueueStats& Stats) const {
+	if (!m_bListening)
+		return false;
+
+	// for a listen socket, TCP_INFO reports the accept queue's length and capacity
+	struct tcp_info Info;
+	socklen_t uInfoLen = sizeof(Info);
+	memset(&Info, 0, sizeof(Info));
+	if (getsockopt(m_ListenSocket, IPPROTO_TCP, TCP_INFO, &Info, &uInfoLen) < 0) {
+		if (m_eSettingsFlags & ENABLE_LOG)
+			m_oLog(StringFormat("[TCPServer][Error] TCP_INFO failed : %s", strerror(errno)));
+
+		return false;
+	}
+	Stats.m_uQueued = Info.tcpi_unacked;
+	Stats.m_uBacklog = Info.tcpi_sacked;
+
+	unsigned long long ullOverflows = 0;
+	unsigned long long ullDrops = 0;
+	if (ReadListenCounters(ullOverflows, ullDrops)) {
+		Stats.m_ullOverflows = ullOverflows - m_ullOverflowsAtListen;
+		Stats.m_ullDrops = ullDrops - m_ullDropsAtListen;
+	} else {
+		Stats.m_ullOverflows = 0;
+		Stats.m_ullDrops = 0;
+	}
+
+	return true;
+}
+#endif
+
 /* ret > 0   : bytes received
  * ret == 0  : connection closed
  * ret < 0   : recv failed
@@ -444,7 +666,183 @@ bool CTCPServer::Send(const Socket ClientSocket, const std::vector<char>& Data)
 	return Send(ClientSocket, Data.data(), Data.size());
 }
 
+bool CTCPServer::Send(const Socket ClientSocket, const ConstBuffer* pBuffers, const size_t uCount) const {
+	if (ClientSocket < 0 || !pBuffers || !uCount)
+		return false;
+
+	if (!SendBuffers(ClientSocket, pBuffers, uCount)) {
+		if (m_eSettingsFlags & ENABLE_LOG)
+			m_oLog("[TCPServer][Error] Socket error in call to sendmsg.");
+
+		return false;
+	}
+
+	return true;
+}
+
+int CTCPServer::Receive(const Socket ClientSocket,
+						const MutableBuffer* pBuffers,
+						const size_t uCount,
+						bool bReadFully /*= true*/) const {
+	if (ClientSocket < 0 || !pBuffers || !uCount)
+		return -1;
+
+	int nRecvd = ReceiveBuffers(ClientSocket, pBuffers, uCount, bReadFully);
+	if (nRecvd < 0 && (m_eSettingsFlags & ENABLE_LOG))
+		m_oLog("[TCPServer][Error] Socket error in call to recvmsg.");
+
+	return nRecvd;
+}
+
+bool CTCPServer::Send(const Socket ClientSocket, const CPooledBuffer& Buffer) const {
+	return Send(ClientSocket, Buffer.Data(), Buffer.Size());
+}
+
+int CTCPServer::Receive(const Socket ClientSocket, CPooledBuffer& Buffer, const size_t uSize,
+						bool bReadFully /*= true*/) const {
+	if (ClientSocket < 0 || !uSize)
+		return -1;
+
+	// a shared block may still be read elsewhere, it's never overwritten
+	if (!Buffer || Buffer.UseCount() > 1 || Buffer.Capacity() < uSize)
+		Buffer = CBufferPool::Acquire(uSize);
+	else
+		Buffer.Resize(uSize);
+
+	int nRecvd = Receive(ClientSocket, Buffer.Data(), uSize, bReadFully);
+	Buffer.Resize(nRecvd > 0 ? static_cast<size_t>(nRecvd) : 0);
+
+	return nRecvd;
+}
+
+#ifndef WINDOWS
+bool CTCPServer::SendFile(const Socket ClientSocket, const int iFileFd, const off_t Offset, const size_t uSize) const {
+	if (ClientSocket < 0 || iFileFd < 0 || !uSize)
+		return false;
+
+	if (!SendFileRange(ClientSocket, iFileFd, Offset, uSize)) {
+		if (m_eSettingsFlags & ENABLE_LOG)
+			m_oLog(StringFormat("[TCPServer][Error] Socket error in call to sendfile : %s",
+				(errno == EAGAIN || errno == EWOULDBLOCK) ? "send timeout reached" : strerror(errno)));
+
+		return false;
+	}
+
+	return true;
+}
+
+bool CTCPServer::SendFile(const Socket ClientSocket, const std::string& strPath,
+						  const off_t Offset /*= 0*/, const size_t uSize /*= 0*/) const {
+	size_t uFileSize = uSize;
+	int iFileFd = OpenFile(strPath, Offset, uFileSize);
+	if (iFileFd < 0) {
+		if (m_eSettingsFlags & ENABLE_LOG)
+			m_oLog(StringFormat("[TCPServer][Error] Unable to open file '%s' : %s", strPath.c_str(), strerror(errno)));
+
+		return false;
+	}
+
+	// nothing to send after Offset
+	bool bSent = (uFileSize == 0) || SendFile(ClientSocket, iFileFd, Offset, uFileSize);
+	close(iFileFd);
+
+	return bSent;
+}
+#endif
+
+#ifdef LINUX
+bool CTCPServer::EnableZeroCopy(const Socket ClientSocket,
+								const size_t uThreshold /*= CZeroCopySender::DEFAULT_THRESHOLD*/) {
+	if (ClientSocket < 0)
+		return false;
+
+	std::unique_ptr<CZeroCopySender> pSender(new CZeroCopySender(ClientSocket, uThreshold));
+	bool bEnabled = pSender->Enable();
+	if (!bEnabled && (m_eSettingsFlags & ENABLE_LOG))
+		m_oLog(StringFormat("[TCPServer][Warning] SO_ZEROCOPY unavailable (%s), sends will be copied.",
+							strerror(errno)));
+
+	std::lock_guard<std::mutex> Lock(m_mtxZeroCopy);
+	m_mapZeroCopy[ClientSocket] = std::move(pSender);
+
+	return bEnabled;
+}
+
+bool CTCPServer::SendZeroCopy(const Socket ClientSocket, const char* pData, const size_t uSize,
+							  const CZeroCopySender::ReleaseFnCallback& fnReleased) {
+	if (ClientSocket < 0 || !pData || !uSize)
+		return false;
+
+	// the sender itself is only used by the thread serving this client
+	CZeroCopySender* pSender;
+	{
+		std::lock_guard<std::mutex> Lock(m_mtxZeroCopy);
+		auto it = m_mapZeroCopy.find(ClientSocket);
+		pSender = (it != m_mapZeroCopy.end()) ? it->second.get() : nullptr;
+	}
+
+	if (pSender == nullptr) {
+		if (!Send(ClientSocket, pData, uSize))
+			return false;
+
+		if (fnReleased)
+			fnReleased();
+
+		return true;
+	}
+
+	if (!pSender->Send(pData, uSize, fnReleased)) {
+		if (m_eSettingsFlags & ENABLE_LOG)
+			m_oLog(StringFormat("[TCPServer][Error] Socket error in zero-copy send : %s", strerror(errno)));
+
+		return false;
+	}
+
+	return true;
+}
+
+int CTCPServer::PollZeroCopy(const Socket ClientSocket, const size_t msec /*= 0*/) {
+	CZeroCopySender* pSender;
+	{
+		std::lock_guard<std::mutex> Lock(m_mtxZeroCopy);
+		auto it = m_mapZeroCopy.find(ClientSocket);
+		pSender = (it != m_mapZeroCopy.end()) ? it->second.get() : nullptr;
+	}
+
+	if (pSender == nullptr)
+		return 0;
+
+	int nReleased = pSender->Reap(msec);
+	if (nReleased < 0 && (m_eSettingsFlags & ENABLE_LOG))
+		m_oLog(StringFormat("[TCPServer][Error] Socket error while reading zero-copy completions : %s",
+							strerror(errno)));
+
+	return nReleased;
+}
+
+size_t CTCPServer::GetZeroCopyPending(const Socket ClientSocket) const {
+	const CZeroCopySender* pSender = GetZeroCopySender(ClientSocket);
+
+	return (pSender != nullptr) ? pSender->GetPendingCount() : 0;
+}
+
+const CZeroCopySender* CTCPServer::GetZeroCopySender(const Socket ClientSocket) const {
+	std::lock_guard<std::mutex> Lock(m_mtxZeroCopy);
+	auto it = m_mapZeroCopy.find(ClientSocket);
+
+	return (it != m_mapZeroCopy.end()) ? it->second.get() : nullptr;
+}
+#endif
+
 bool CTCPServer::Disconnect(const CTCPServer::Socket ClientSocket) const {
+#ifdef LINUX
+	// the callbacks of the buffers still pending won't be called
+	{
+		std::lock_guard<std::mutex> Lock(m_mtxZeroCopy);
+		m_mapZeroCopy.erase(ClientSocket);
+	}
+#endif
+
 #ifdef WINDOWS
 	// The shutdown function disables sends or receives on a socket.
 	int iResult = shutdown(ClientSocket, SD_RECEIVE);
@@ -20,7 +20,16 @@
 #include <string>
 #include <vector>
 
+#include "BufferPool.h"
 #include "Socket.h"
+#include "SocketOptions.h"
+
+#ifdef LINUX
+#include <mutex>
+#include <unordered_map>
+
+#include "ZeroCopySender.h"
+#endif
 
 #ifdef WINDOWS
 #undef min
@@ -45,6 +54,44 @@ public:
    /* returns the socket of the accepted client, the waiting period can be set */
    bool Listen(Socket& ClientSocket, size_t msec = ACCEPT_WAIT_INF_DELAY);
 
+#ifdef LINUX
+   /* accepts up to uMax queued clients at once (accept4 until EAGAIN) and appends their sockets,
+    * non-blocking and close-on-exec, to vecClients. Waits up to msec for the first one (0 : doesn't
+    * wait). Returns the count of accepted clients, -1 on error. */
+   int AcceptBatch(std::vector<Socket>& vecClients, const size_t uMax, const size_t msec = 0);
+
+   struct AcceptQueueStats
+   {
+      size_t             m_uQueued;      // connections waiting to be accepted
+      size_t             m_uBacklog;     // capacity of the queue (the backlog, capped by net.core.somaxconn)
+      unsigned long long m_ullOverflows; // connections dropped because a queue was full (ListenOverflows)
+      unsigned long long m_ullDrops;     // all the SYNs dropped by listen sockets (ListenDrops)
+   };
+
+   /* the overflow and drop counters are those of the host (network namespace), counted since
+    * this server started listening */
+   bool GetAcceptQueueStats(AcceptQueueStats& Stats) const;
+#endif
+
+   // INVALID_SOCKET until the server listens, e.g. to wait for clients in an event loop
+   Socket GetListenSocket() const { return m_ListenSocket; }
+
+   /* size of the queue of established connections waiting to be accepted, must be set before
+    * the first Listen. SOMAXCONN by default. */
+   inline void SetBacklog(const int iBacklog) { m_iBacklog = iBacklog; }
+
+   /* options applied to the listen socket, before listen() so that the buffer sizes are
+    * those advertised in the handshake, and to every accepted client (Listen, AcceptBatch and
+    * the event-driven servers). An option the kernel refuses is logged and ignored. */
+   inline void SetSocketOptions(const CSocketOptions& Options) { m_SocketOptions = Options; }
+   const CSocketOptions& GetSocketOptions() const { return m_SocketOptions; }
+
+   // applies options to one accepted client, Read them back with CSocketOptions::Read
+   bool ApplySocketOptions(const Socket ClientSocket, const CSocketOptions& Options) const;
+
+   // sends the frames held by TCP_CORK on a client's socket (see CSocketOptions::SetCork)
+   bool Flush(const Socket ClientSocket) const;
+
    int Receive(const Socket ClientSocket,
                char* pData,
                const size_t uSize,
@@ -54,6 +101,39 @@ public:
    bool Send(const Socket ClientSocket, const std::string& strData) const;
    bool Send(const Socket ClientSocket, const std::vector<char>& Data) const;
 
+   // vectored I/O (e.g. a header and its payload in a single syscall, without concatenating them)
+   bool Send(const Socket ClientSocket, const ConstBuffer* pBuffers, const size_t uCount) const;
+   int  Receive(const Socket ClientSocket,
+                const MutableBuffer* pBuffers,
+                const size_t uCount,
+                bool bReadFully = true) const;
+
+   /* pooled buffers (see CBufferPool) : Receive reuses Buffer if it's the only handle to a block
+    * large enough, otherwise it acquires a new one. Its size is set to the received count. */
+   bool Send(const Socket ClientSocket, const CPooledBuffer& Buffer) const;
+   int  Receive(const Socket ClientSocket, CPooledBuffer& Buffer, const size_t uSize, bool bReadFully = true) const;
+
+#ifndef WINDOWS
+   /* sends uSize bytes of a file from Offset without copying them through user space
+    * (sendfile under Linux). With a path, uSize = 0 sends everything after Offset. */
+   bool SendFile(const Socket ClientSocket, const int iFileFd, const off_t Offset, const size_t uSize) const;
+   bool SendFile(const Socket ClientSocket, const std::string& strPath,
+                 const off_t Offset = 0, const size_t uSize = 0) const;
+#endif
+
+#ifdef LINUX
+   /* opt-in MSG_ZEROCOPY sends to a client (see CZeroCopySender) : returns false if the kernel
+    * doesn't support it, SendZeroCopy then copies like Send. fnReleased is called from
+    * SendZeroCopy or PollZeroCopy when pData can be reused, sends below uThreshold bytes are
+    * copied and released right away. Pending buffers must be polled before Disconnect. */
+   bool EnableZeroCopy(const Socket ClientSocket, const size_t uThreshold = CZeroCopySender::DEFAULT_THRESHOLD);
+   bool SendZeroCopy(const Socket ClientSocket, const char* pData, const size_t uSize,
+                     const CZeroCopySender::ReleaseFnCallback& fnReleased);
+   int  PollZeroCopy(const Socket ClientSocket, const size_t msec = 0);
+   size_t GetZeroCopyPending(const Socket ClientSocket) const;
+   const CZeroCopySender* GetZeroCopySender(const Socket ClientSocket) const;
+#endif
+
    bool Disconnect(const Socket ClientSocket) const;
 
    bool SetRcvTimeout(ASocket::Socket& ClientSocket, unsigned int msec_timeout);
@@ -64,8 +144,50 @@ public:
    bool SetSndTimeout(ASocket::Socket& ClientSocket, struct timeval Timeout);
 #endif
 
+#ifdef LINUX
+   /* SO_REUSEPORT : several listen sockets can be bound to the same port and the kernel
+    * spreads the incoming connections across them. Must be set before the first Listen. */
+   inline void SetReusePort(const bool bReusePort) { m_bReusePort = bReusePort; }
+
+   /* TCP Fast Open : clients holding a cookie from this server can send their first bytes in
+    * the SYN, handed to the server before the handshake completes. iQueueLength bounds the
+    * pending fast-open requests (0 disables it). Must be set before the first Listen, the
+    * net.ipv4.tcp_fastopen sysctl must also have its server bit (2). */
+   inline void SetFastOpen(const int iQueueLength) { m_iFastOpenQueue = iQueueLength; }
+
+   // whether an accepted client's connection was fast opened
+   bool IsFastOpenUsed(const Socket ClientSocket) const { return IsSynDataAcked(ClientSocket); }
+#endif
+
 protected:
+   /* creates and binds the listen socket (shared by Listen and the event-driven servers),
+    * overridden for other address families (CUnixServer) */
+   virtual bool SetUpListenSocket();
+
+   /* SetUpListenSocket if needed, then listen(), which is called once */
+   bool StartListening();
+
+   // applies m_SocketOptions to a newly accepted client
+   void ApplyAcceptOptions(const Socket ClientSocket) const;
+
    Socket m_ListenSocket;
+   int    m_iBacklog;
+   bool   m_bListening;
+   CSocketOptions m_SocketOptions;
+
+   #ifdef LINUX
+   bool m_bReusePort;
+   bool m_bNonBlockingAccept; // set by AcceptBatch
+   int  m_iFastOpenQueue;
+
+   // host counters when listen() was called
+   unsigned long long m_ullOverflowsAtListen;
+   unsigned long long m_ullDropsAtListen;
+
+   // zero-copy state of the clients it was enabled on, dropped by Disconnect
+   mutable std::mutex                                                    m_mtxZeroCopy;
+   mutable std::unordered_map<Socket, std::unique_ptr<CZeroCopySender>> m_mapZeroCopy;
+   #endif
 
    //std::string m_strHost;
    std::string m_strPort;
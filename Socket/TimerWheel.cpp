@@ -0,0 +1,311 @@
+/**
+* @file TimerWheel.cpp
+* @brief implementation of the hierarchical timing wheel
+*/
+
+#include "TimerWheel.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+const unsigned CTimerWheel::LEVELS;
+const unsigned CTimerWheel::SLOT_BITS;
+const unsigned CTimerWheel::SLOTS;
+const uint32_t CTimerWheel::NIL;
+const uint32_t CTimerWheel::EXPIRING_LIST;
+const uint32_t CTimerWheel::FREE_LIST;
+
+namespace
+{
+   const uint64_t SLOT_MASK = CTimerWheel::SLOTS - 1;
+   const uint64_t MAX_DELAY_TICKS = (1ULL << (CTimerWheel::LEVELS * CTimerWheel::SLOT_BITS)) - 1;
+
+   inline unsigned CountTrailingZeros(const uint64_t uWord)
+   {
+   #if defined(__GNUC__) || defined(__clang__)
+      return static_cast<unsigned>(__builtin_ctzll(uWord));
+   #else
+      unsigned uBit = 0;
+      while (!(uWord & (1ULL << uBit)))
+         ++uBit;
+      return uBit;
+   #endif
+   }
+}
+
+CTimerWheel::CTimerWheel(const size_t uTickMs /*= 1*/, const TimePoint Start /*= Clock::now()*/) :
+   m_TickDuration(std::chrono::milliseconds((uTickMs > 0) ? uTickMs : 1)),
+   m_Start(Start),
+   m_uCurrentTick(0),
+   m_uCount(0),
+   m_uFreeHead(NIL)
+{
+   std::fill(std::begin(m_arrHeads), std::end(m_arrHeads), NIL);
+   memset(m_arrOccupied, 0, sizeof(m_arrOccupied));
+}
+
+uint64_t CTimerWheel::ToTick(const TimePoint Now) const
+{
+   if (Now <= m_Start)
+      return 0;
+
+   return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(Now - m_Start).count() /
+                                m_TickDuration.count());
+}
+
+uint64_t CTimerWheel::DeadlineTick(const size_t uDelayMs, const TimePoint Now) const
+{
+   // rounded up : a timer never expires before its deadline
+   const uint64_t uElapsedUs = (Now > m_Start) ?
+      static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(Now - m_Start).count()) : 0;
+   const uint64_t uTickUs = static_cast<uint64_t>(m_TickDuration.count());
+   const uint64_t uDelayUs = std::min<uint64_t>(uDelayMs, MAX_DELAY_TICKS * uTickUs / 1000) * 1000;
+
+   uint64_t uExpires = (uElapsedUs + uDelayUs + uTickUs - 1) / uTickUs;
+
+   // past ticks are already processed, and the wheels only reach 2^32 ticks ahead
+   uExpires = std::max(uExpires, m_uCurrentTick + 1);
+   return std::min(uExpires, m_uCurrentTick + MAX_DELAY_TICKS);
+}
+
+CTimerWheel::TimerId CTimerWheel::Arm(const size_t uDelayMs, const uint64_t uCookie,
+                                      const TimePoint Now /*= Clock::now()*/)
+{
+   uint32_t uIndex = m_uFreeHead;
+   if (uIndex != NIL)
+      m_uFreeHead = m_vecNodes[uIndex].m_uNext;
+   else
+   {
+      uIndex = static_cast<uint32_t>(m_vecNodes.size());
+      Node NewNode;
+      NewNode.m_uGeneration = 1;
+      m_vecNodes.push_back(NewNode);
+   }
+
+   Node& Timer = m_vecNodes[uIndex];
+   Timer.m_uExpires = DeadlineTick(uDelayMs, Now);
+   Timer.m_uCookie = uCookie;
+   Place(uIndex);
+   ++m_uCount;
+
+   return (static_cast<TimerId>(Timer.m_uGeneration) << 32) | uIndex;
+}
+
+CTimerWheel::Node* CTimerWheel::Find(const TimerId Id)
+{
+   const uint32_t uIndex = static_cast<uint32_t>(Id & 0xFFFFFFFF);
+   if (uIndex >= m_vecNodes.size())
+      return nullptr;
+
+   Node& Timer = m_vecNodes[uIndex];
+   if (Timer.m_uGeneration != static_cast<uint32_t>(Id >> 32) || Timer.m_uList == FREE_LIST)
+      return nullptr;
+
+   return &Timer;
+}
+
+bool CTimerWheel::IsPending(const TimerId Id) const
+{
+   return const_cast<CTimerWheel*>(this)->Find(Id) != nullptr;
+}
+
+bool CTimerWheel::Rearm(const TimerId Id, const size_t uDelayMs, const TimePoint Now /*= Clock::now()*/)
+{
+   Node* pTimer = Find(Id);
+   if (!pTimer)
+      return false;
+
+   const uint32_t uIndex = static_cast<uint32_t>(Id & 0xFFFFFFFF);
+   Unlink(uIndex);
+   pTimer->m_uExpires = DeadlineTick(uDelayMs, Now);
+   Place(uIndex);
+
+   return true;
+}
+
+bool CTimerWheel::Cancel(const TimerId Id)
+{
+   if (!Find(Id))
+      return false;
+
+   const uint32_t uIndex = static_cast<uint32_t>(Id & 0xFFFFFFFF);
+   Unlink(uIndex);
+   Release(uIndex);
+   --m_uCount;
+
+   return true;
+}
+
+void CTimerWheel::Place(const uint32_t uIndex)
+{
+   // the level whose slots are just wide enough for the remaining ticks
+   const uint64_t uExpires = m_vecNodes[uIndex].m_uExpires;
+   const uint64_t uRemaining = (uExpires > m_uCurrentTick) ? uExpires - m_uCurrentTick : 0;
+
+   unsigned uLevel = 0;
+   while (uLevel + 1 < LEVELS && uRemaining >= (1ULL << (SLOT_BITS * (uLevel + 1))))
+      ++uLevel;
+
+   const unsigned uSlot = static_cast<unsigned>((uExpires >> (SLOT_BITS * uLevel)) & SLOT_MASK);
+   Link(uIndex, uLevel * SLOTS + uSlot);
+}
+
+void CTimerWheel::Link(const uint32_t uIndex, const uint32_t uList)
+{
+   Node& Timer = m_vecNodes[uIndex];
+   Timer.m_uList = uList;
+   Timer.m_uPrev = NIL;
+   Timer.m_uNext = m_arrHeads[uList];
+
+   if (Timer.m_uNext != NIL)
+      m_vecNodes[Timer.m_uNext].m_uPrev = uIndex;
+   else if (uList < EXPIRING_LIST)
+      m_arrOccupied[uList / SLOTS][(uList % SLOTS) / 64] |= 1ULL << (uList % 64);
+
+   m_arrHeads[uList] = uIndex;
+}
+
+void CTimerWheel::Unlink(const uint32_t uIndex)
+{
+   Node& Timer = m_vecNodes[uIndex];
+   const uint32_t uList = Timer.m_uList;
+
+   if (Timer.m_uPrev != NIL)
+      m_vecNodes[Timer.m_uPrev].m_uNext = Timer.m_uNext;
+   else
+      m_arrHeads[uList] = Timer.m_uNext;
+
+   if (Timer.m_uNext != NIL)
+      m_vecNodes[Timer.m_uNext].m_uPrev = Timer.m_uPrev;
+
+   if (m_arrHeads[uList] == NIL && uList < EXPIRING_LIST)
+      m_arrOccupied[uList / SLOTS][(uList % SLOTS) / 64] &= ~(1ULL << (uList % 64));
+}
+
+void CTimerWheel::Release(const uint32_t uIndex)
+{
+   Node& Timer = m_vecNodes[uIndex];
+   Timer.m_uList = FREE_LIST;
+
+   // the ids given out for this node become stale
+   if (++Timer.m_uGeneration == 0)
+      Timer.m_uGeneration = 1;
+
+   Timer.m_uNext = m_uFreeHead;
+   m_uFreeHead = uIndex;
+}
+
+void CTimerWheel::Cascade(const uint32_t uList)
+{
+   uint32_t uIndex = m_arrHeads[uList];
+   m_arrHeads[uList] = NIL;
+   m_arrOccupied[uList / SLOTS][(uList % SLOTS) / 64] &= ~(1ULL << (uList % 64));
+
+   while (uIndex != NIL)
+   {
+      const uint32_t uNext = m_vecNodes[uIndex].m_uNext;
+      Place(uIndex);
+      uIndex = uNext;
+   }
+}
+
+unsigned CTimerWheel::NextOccupied(const unsigned uSlot) const
+{
+   for (unsigned uWord = uSlot / 64; uWord < SLOTS / 64; ++uWord)
+   {
+      uint64_t uBits = m_arrOccupied[0][uWord];
+      if (uWord == uSlot / 64)
+         uBits &= ~0ULL << (uSlot % 64);
+
+      if (uBits)
+         return uWord * 64 + CountTrailingZeros(uBits);
+   }
+
+   return SLOTS;
+}
+
+uint64_t CTimerWheel::NextTick() const
+{
+   // empty level 0 slots are skipped, up to the next cascade
+   const uint64_t uCascadeTick = (m_uCurrentTick | SLOT_MASK) + 1;
+   if (m_uCurrentTick + 1 == uCascadeTick)
+      return uCascadeTick;
+
+   const unsigned uSlot = NextOccupied(static_cast<unsigned>((m_uCurrentTick + 1) & SLOT_MASK));
+   return (uSlot < SLOTS) ? (m_uCurrentTick & ~SLOT_MASK) + uSlot : uCascadeTick;
+}
+
+size_t CTimerWheel::Advance(const TimePoint Now, const ExpiryFnCallback& fnExpired)
+{
+   const uint64_t uTargetTick = ToTick(Now);
+   size_t uExpired = 0;
+
+   while (m_uCurrentTick < uTargetTick)
+   {
+      if (m_uCount == 0)
+      {
+         m_uCurrentTick = uTargetTick;
+         break;
+      }
+
+      const uint64_t uTick = NextTick();
+      if (uTick > uTargetTick)
+      {
+         m_uCurrentTick = uTargetTick;
+         break;
+      }
+      m_uCurrentTick = uTick;
+
+      // level 0 wrapped : the timers of the next slot of level 1 (and above, when they wrap too) move down
+      for (unsigned uLevel = 1; uLevel < LEVELS && !(m_uCurrentTick & ((1ULL << (SLOT_BITS * uLevel)) - 1)); ++uLevel)
+      {
+         const unsigned uSlot = static_cast<unsigned>((m_uCurrentTick >> (SLOT_BITS * uLevel)) & SLOT_MASK);
+         if (m_arrHeads[uLevel * SLOTS + uSlot] != NIL)
+            Cascade(uLevel * SLOTS + uSlot);
+      }
+
+      const uint32_t uList = static_cast<uint32_t>(m_uCurrentTick & SLOT_MASK);
+      if (m_arrHeads[uList] == NIL)
+         continue;
+
+      // the callbacks may cancel timers expiring in the same tick : they're taken one by one
+      m_arrHeads[EXPIRING_LIST] = m_arrHeads[uList];
+      m_arrHeads[uList] = NIL;
+      m_arrOccupied[0][uList / 64] &= ~(1ULL << (uList % 64));
+      for (uint32_t uIndex = m_arrHeads[EXPIRING_LIST]; uIndex != NIL; uIndex = m_vecNodes[uIndex].m_uNext)
+         m_vecNodes[uIndex].m_uList = EXPIRING_LIST;
+
+      while (m_arrHeads[EXPIRING_LIST] != NIL)
+      {
+         const uint32_t uIndex = m_arrHeads[EXPIRING_LIST];
+         const TimerId Id = (static_cast<TimerId>(m_vecNodes[uIndex].m_uGeneration) << 32) | uIndex;
+         const uint64_t uCookie = m_vecNodes[uIndex].m_uCookie;
+
+         Unlink(uIndex);
+         Release(uIndex);
+         --m_uCount;
+         ++uExpired;
+
+         if (fnExpired)
+            fnExpired(Id, uCookie);
+      }
+   }
+
+   return uExpired;
+}
+
+int CTimerWheel::GetTimeoutMs(const TimePoint Now /*= Clock::now()*/) const
+{
+   if (m_uCount == 0)
+      return -1;
+
+   const TimePoint Deadline = m_Start + m_TickDuration * NextTick();
+   if (Deadline <= Now)
+      return 0;
+
+   // rounded up, waking up early would only loop
+   const long long llMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+      Deadline - Now + std::chrono::microseconds(999)).count();
+   return static_cast<int>(std::min<long long>(llMs, INT_MAX));
+}
@@ -0,0 +1,112 @@
+/*
+* @file TimerWheel.h
+* @brief hierarchical timing wheel : O(1) arm, re-arm and cancel of many timers
+* @date 2026-10-17
+*
+* SO_RCVTIMEO/SO_SNDTIMEO and select() only bound blocking calls. An event loop serving
+* many non-blocking sockets needs its own deadlines (idle timeouts, read deadlines,
+* handshake deadlines...), re-armed on every read : with a sorted container, each re-arm
+* costs O(log n) and a node allocation. Here, a timer is linked into the slot of its expiry
+* tick in one of 4 wheels of 256 slots (1, 256, 65536 and 16777216 ticks per slot) : arming,
+* re-arming and cancelling only (un)link it, and a timer is moved down a wheel once per
+* level while its expiry gets closer. Timers live in a slab, identified by an index and a
+* generation, so that an expired or cancelled timer's id can't touch its successor.
+*/
+
+#ifndef INCLUDE_TIMERWHEEL_H_
+#define INCLUDE_TIMERWHEEL_H_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class CTimerWheel
+{
+public:
+   typedef std::chrono::steady_clock Clock;
+   typedef Clock::time_point         TimePoint;
+   typedef uint64_t                  TimerId; // 0 is never a valid timer
+
+   // uCookie is the value given to Arm (e.g. a socket)
+   typedef std::function<void(const TimerId Id, const uint64_t uCookie)> ExpiryFnCallback;
+
+   /* uTickMs is the resolution : a timer expires up to one tick after its deadline.
+    * Delays are clamped to 2^32 ticks (49 days with 1 ms ticks). */
+   explicit CTimerWheel(const size_t uTickMs = 1, const TimePoint Start = Clock::now());
+
+   CTimerWheel(const CTimerWheel&) = delete;
+   CTimerWheel& operator=(const CTimerWheel&) = delete;
+
+   // the timer expires at the first Advance reaching Now + uDelayMs
+   TimerId Arm(const size_t uDelayMs, const uint64_t uCookie, const TimePoint Now = Clock::now());
+
+   // moves the deadline of a pending timer, returns false if it already expired or was cancelled
+   bool Rearm(const TimerId Id, const size_t uDelayMs, const TimePoint Now = Clock::now());
+   bool Cancel(const TimerId Id);
+   bool IsPending(const TimerId Id) const;
+
+   /* calls fnExpired for each timer whose deadline is <= Now, in deadline order (per tick).
+    * The callback may arm, re-arm and cancel timers. Returns the number of expired timers. */
+   size_t Advance(const TimePoint Now, const ExpiryFnCallback& fnExpired);
+
+   /* milliseconds until the next Advance may have work (bounded by the next cascade of the
+    * wheels), to be used as an event loop's wait timeout. -1 without pending timers. */
+   int GetTimeoutMs(const TimePoint Now = Clock::now()) const;
+
+   size_t GetCount() const { return m_uCount; }
+
+   // preallocates the slab for uTimers timers
+   void Reserve(const size_t uTimers) { m_vecNodes.reserve(uTimers); }
+
+   static const unsigned LEVELS = 4;
+   static const unsigned SLOT_BITS = 8;
+   static const unsigned SLOTS = 1 << SLOT_BITS;
+
+protected:
+   static const uint32_t NIL = 0xFFFFFFFF;
+   static const uint32_t EXPIRING_LIST = LEVELS * SLOTS; // timers being expired by Advance
+   static const uint32_t FREE_LIST = EXPIRING_LIST + 1;
+
+   struct Node
+   {
+      uint64_t m_uExpires; // tick
+      uint64_t m_uCookie;
+      uint32_t m_uPrev;
+      uint32_t m_uNext;
+      uint32_t m_uGeneration;
+      uint32_t m_uList;    // level * SLOTS + slot, EXPIRING_LIST or FREE_LIST
+   };
+
+   uint64_t ToTick(const TimePoint Now) const;
+   uint64_t DeadlineTick(const size_t uDelayMs, const TimePoint Now) const;
+
+   // the node of a pending timer, nullptr otherwise
+   Node* Find(const TimerId Id);
+
+   void Place(const uint32_t uIndex);
+   void Link(const uint32_t uIndex, const uint32_t uList);
+   void Unlink(const uint32_t uIndex);
+   void Release(const uint32_t uIndex);
+
+   // places again the timers of a higher level slot, now closer to their expiry
+   void Cascade(const uint32_t uList);
+
+   // first occupied level 0 slot from uSlot on, SLOTS if none
+   unsigned NextOccupied(const unsigned uSlot) const;
+
+   // the next tick with work for Advance : an occupied level 0 slot or a cascade
+   uint64_t NextTick() const;
+
+   const std::chrono::microseconds m_TickDuration;
+   const TimePoint                 m_Start;
+   uint64_t                        m_uCurrentTick; // last tick processed by Advance
+   size_t                          m_uCount;
+
+   std::vector<Node>     m_vecNodes;
+   uint32_t              m_uFreeHead;
+   uint32_t              m_arrHeads[LEVELS * SLOTS + 1]; // + EXPIRING_LIST
+   uint64_t              m_arrOccupied[LEVELS][SLOTS / 64];
+};
+
+#endif
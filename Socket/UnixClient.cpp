@@ -0,0 +1,67 @@
+/**
+* @file UnixClient.cpp
+* @brief implementation of the Unix domain socket client
+*/
+
+#include "UnixClient.h"
+
+#ifndef WINDOWS
+
+CUnixClient::CUnixClient(const LogFnCallback oLogger, const SettingsFlag eSettings /*= ALL_FLAGS*/) :
+   CTCPClient(oLogger, eSettings)
+{
+
+}
+
+bool CUnixClient::Connect(const std::string& strPath)
+{
+   if (m_eStatus == CONNECTED)
+   {
+      Disconnect();
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog("[UnixClient][Warning] Opening a new connexion. The last one was automatically closed.");
+   }
+
+   struct sockaddr_un Addr;
+   socklen_t uAddrLen;
+   if (!MakeUnixAddress(strPath, Addr, uAddrLen))
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[UnixClient][Error] invalid path '%s'", strPath.c_str()));
+
+      return false;
+   }
+
+   m_ConnectSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+   if (m_ConnectSocket < 0)
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[UnixClient][Error] socket failed : %s", strerror(errno)));
+
+      m_ConnectSocket = INVALID_SOCKET;
+      return false;
+   }
+
+   ApplyConnectOptions(m_ConnectSocket);
+
+   if (connect(m_ConnectSocket, reinterpret_cast<struct sockaddr*>(&Addr), uAddrLen) < 0)
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[UnixClient][Error] Unable to connect to '%s' : %s", strPath.c_str(), strerror(errno)));
+
+      close(m_ConnectSocket);
+      m_ConnectSocket = INVALID_SOCKET;
+      return false;
+   }
+
+   memset(&m_ConnectedAddress, 0, sizeof(m_ConnectedAddress));
+   memcpy(&m_ConnectedAddress.m_SockAddr, &Addr, uAddrLen);
+   m_ConnectedAddress.m_uSockAddrLen = uAddrLen;
+   m_ConnectedAddress.m_iFamily = AF_UNIX;
+   m_ConnectedAddress.m_iSockType = SOCK_STREAM;
+
+   m_eStatus = CONNECTED;
+   return true;
+}
+
+#endif
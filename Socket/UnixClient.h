@@ -0,0 +1,29 @@
+/*
+* @file UnixClient.h
+* @brief stream client of a Unix domain socket server (see CUnixServer)
+* @date 2026-10-17
+*
+* A CTCPClient connected to a path instead of a host and a port : Send, Receive, SendFile,
+* the timeouts and Disconnect are the same. The TCP Connect overloads are hidden by the one
+* taking a path, an abstract name starts with '@' (Linux).
+*/
+
+#ifndef INCLUDE_UNIXCLIENT_H_
+#define INCLUDE_UNIXCLIENT_H_
+
+#ifndef WINDOWS
+
+#include "TCPClient.h"
+
+class CUnixClient : public CTCPClient
+{
+public:
+   explicit CUnixClient(const LogFnCallback oLogger, const SettingsFlag eSettings = ALL_FLAGS);
+
+   // connects to the server bound to strPath
+   bool Connect(const std::string& strPath);
+};
+
+#endif
+
+#endif
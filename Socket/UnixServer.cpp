@@ -0,0 +1,95 @@
+/**
+* @file UnixServer.cpp
+* @brief implementation of the Unix domain socket server
+*/
+
+#include "UnixServer.h"
+
+#ifndef WINDOWS
+
+#include <sys/stat.h>
+
+namespace
+{
+   // a socket file nobody listens on anymore : connecting to it is refused
+   bool IsStaleSocketFile(const struct sockaddr_un& Addr, const socklen_t uAddrLen)
+   {
+      struct stat FileStat;
+      if (stat(Addr.sun_path, &FileStat) != 0 || !S_ISSOCK(FileStat.st_mode))
+         return false;
+
+      int iProbe = socket(AF_UNIX, SOCK_STREAM, 0);
+      if (iProbe < 0)
+         return false;
+
+      const bool bStale = connect(iProbe, reinterpret_cast<const struct sockaddr*>(&Addr), uAddrLen) < 0 &&
+                          errno == ECONNREFUSED;
+      close(iProbe);
+      return bStale;
+   }
+}
+
+CUnixServer::CUnixServer(const LogFnCallback oLogger,
+                         const std::string& strPath,
+                         const SettingsFlag eSettings /*= ALL_FLAGS*/) :
+   CTCPServer(oLogger, "", eSettings),
+   m_strPath(strPath),
+   m_bFileCreated(false)
+{
+
+}
+
+CUnixServer::~CUnixServer()
+{
+   if (m_bFileCreated)
+      unlink(m_strPath.c_str());
+}
+
+bool CUnixServer::SetUpListenSocket()
+{
+   struct sockaddr_un Addr;
+   socklen_t uAddrLen;
+   if (!MakeUnixAddress(m_strPath, Addr, uAddrLen))
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[UnixServer][Error] invalid path '%s'", m_strPath.c_str()));
+
+      return false;
+   }
+
+   m_ListenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+   if (m_ListenSocket < 0)
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[UnixServer][Error] opening socket : %s", strerror(errno)));
+
+      m_ListenSocket = INVALID_SOCKET;
+      return false;
+   }
+
+   int iResult = bind(m_ListenSocket, reinterpret_cast<struct sockaddr*>(&Addr), uAddrLen);
+   const bool bAbstract = (Addr.sun_path[0] == '\0');
+   if (iResult < 0 && errno == EADDRINUSE && !bAbstract && IsStaleSocketFile(Addr, uAddrLen))
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[UnixServer][Info] replacing the stale socket file '%s'", m_strPath.c_str()));
+
+      unlink(Addr.sun_path);
+      iResult = bind(m_ListenSocket, reinterpret_cast<struct sockaddr*>(&Addr), uAddrLen);
+   }
+
+   if (iResult < 0)
+   {
+      if (m_eSettingsFlags & ENABLE_LOG)
+         m_oLog(StringFormat("[UnixServer][Error] bind to '%s' failed : %s", m_strPath.c_str(), strerror(errno)));
+
+      close(m_ListenSocket);
+      m_ListenSocket = INVALID_SOCKET;
+      return false;
+   }
+
+   m_bFileCreated = !bAbstract;
+   return true;
+}
+
+#endif
@@ -0,0 +1,45 @@
+/*
+* @file UnixServer.h
+* @brief stream server on a Unix domain socket (AF_UNIX), for clients on the same host
+* @date 2026-10-17
+*
+* On loopback, a TCP connection still goes through the whole TCP/IP stack : segmentation,
+* checksums, ACKs and congestion control. A Unix domain stream socket hands the bytes
+* directly to the peer's receive queue. CUnixServer is a CTCPServer bound to a path
+* instead of a port, so Listen, AcceptBatch, Send, Receive, SendFile... behave the same.
+* The path is a file, created on the first Listen and removed with the server, or under
+* Linux an abstract name (starting with '@'), which needs no file and vanishes with the
+* socket. TCP-only settings (Fast Open, TCP socket options, accept queue stats) don't apply.
+*/
+
+#ifndef INCLUDE_UNIXSERVER_H_
+#define INCLUDE_UNIXSERVER_H_
+
+#ifndef WINDOWS
+
+#include "TCPServer.h"
+
+class CUnixServer : public CTCPServer
+{
+public:
+   explicit CUnixServer(const LogFnCallback oLogger,
+                        const std::string& strPath,
+                        const SettingsFlag eSettings = ALL_FLAGS);
+
+   ~CUnixServer() override;
+
+   const std::string& GetPath() const { return m_strPath; }
+
+protected:
+   /* binds to m_strPath. A socket file left by a server which didn't exit cleanly is
+    * replaced, a live one is not : the file is probed with a connection, refused if nobody
+    * listens on it anymore, which a live server will accept and see closed right away. */
+   bool SetUpListenSocket() override;
+
+   std::string m_strPath;
+   bool        m_bFileCreated; // the socket file is removed by the destructor
+};
+
+#endif
+
+#endif
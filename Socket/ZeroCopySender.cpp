@@ -0,0 +1,238 @@
+/**
+* @file ZeroCopySender.cpp
+* @brief implementation of the MSG_ZEROCOPY sender
+*/
+
+#ifdef LINUX
+#include "ZeroCopySender.h"
+
+#include <chrono>
+#include <cstring>
+
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <poll.h>
+
+namespace
+{
+   // wrap-around safe "uA comes before uB" for the 32 bits notification IDs
+   inline bool IdBefore(const uint32_t uA, const uint32_t uB)
+   {
+      return static_cast<int32_t>(uA - uB) < 0;
+   }
+}
+
+const size_t CZeroCopySender::DEFAULT_THRESHOLD;
+
+CZeroCopySender::CZeroCopySender(const ASocket::Socket Fd, const size_t uThreshold /*= DEFAULT_THRESHOLD*/) :
+   m_Fd(Fd),
+   m_uThreshold(uThreshold),
+   m_bEnabled(false),
+   m_uNextId(0),
+   m_uCompletedBelow(0),
+   m_uZeroCopySends(0),
+   m_uKernelCopies(0),
+   m_uThresholdCopies(0)
+{
+}
+
+bool CZeroCopySender::Enable()
+{
+   int iOne = 1;
+   m_bEnabled = setsockopt(m_Fd, SOL_SOCKET, SO_ZEROCOPY, &iOne, sizeof(iOne)) == 0;
+
+   return m_bEnabled;
+}
+
+bool CZeroCopySender::Send(const char* pData, const size_t uSize, const ReleaseFnCallback& fnReleased)
+{
+   if (!m_bEnabled || uSize < m_uThreshold)
+   {
+      if (!SendCopy(pData, uSize))
+         return false;
+
+      ++m_uThresholdCopies;
+      if (fnReleased)
+         fnReleased();
+
+      return true;
+   }
+
+   bool bZeroCopied = false;
+   uint32_t uLastId = 0;
+   size_t uSent = 0;
+   while (uSent < uSize)
+   {
+      ssize_t nSent = send(m_Fd, pData + uSent, uSize - uSent, MSG_ZEROCOPY);
+      if (nSent < 0)
+      {
+         if (errno == EINTR)
+            continue;
+
+         // the pinned pages exceed the socket's optmem limit : copy the rest
+         if (errno == ENOBUFS)
+         {
+            if (!SendCopy(pData + uSent, uSize - uSent))
+               return false;
+
+            break;
+         }
+
+         return false;
+      }
+
+      // one notification ID per successful call, whatever the sent size
+      uLastId = m_uNextId++;
+      bZeroCopied = true;
+      uSent += static_cast<size_t>(nSent);
+   }
+
+   if (!bZeroCopied)
+   {
+      if (fnReleased)
+         fnReleased();
+
+      return true;
+   }
+
+   ++m_uZeroCopySends;
+   m_deqPending.push_back(PendingSend{ uLastId, fnReleased });
+
+   // the error queue is emptied as we go, without waiting
+   return Reap(0) >= 0;
+}
+
+int CZeroCopySender::Reap(const size_t msec /*= 0*/)
+{
+   const auto Deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(msec);
+
+   int nReleased = 0;
+   for (;;)
+   {
+      int nNotifications = DrainErrorQueue();
+      if (nNotifications < 0)
+         return -1;
+
+      nReleased += ReleaseCompleted();
+
+      if (m_deqPending.empty())
+         break;
+
+      auto Remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+         Deadline - std::chrono::steady_clock::now()).count();
+      if (Remaining <= 0)
+         break;
+
+      // a pending error queue is reported as POLLERR, no event has to be requested
+      struct pollfd PollFd;
+      PollFd.fd = m_Fd;
+      PollFd.events = 0;
+      PollFd.revents = 0;
+
+      int iResult = poll(&PollFd, 1, static_cast<int>(Remaining));
+      if (iResult < 0 && errno != EINTR)
+         return -1;
+      if (iResult == 0)
+         break;
+
+      // POLLHUP alone : the peer is gone, nothing else will be queued
+      if (iResult > 0 && !(PollFd.revents & POLLERR))
+         break;
+   }
+
+   return nReleased;
+}
+
+bool CZeroCopySender::SendCopy(const char* pData, size_t uSize) const
+{
+   while (uSize > 0)
+   {
+      ssize_t nSent = send(m_Fd, pData, uSize, 0);
+      if (nSent < 0 && errno == EINTR)
+         continue;
+      if (nSent < 0)
+         return false;
+
+      pData += nSent;
+      uSize -= static_cast<size_t>(nSent);
+   }
+   return true;
+}
+
+int CZeroCopySender::DrainErrorQueue()
+{
+   int nNotifications = 0;
+   for (;;)
+   {
+      char szControl[128];
+      struct msghdr Msg;
+      memset(&Msg, 0, sizeof(Msg));
+      Msg.msg_control = szControl;
+      Msg.msg_controllen = sizeof(szControl);
+
+      if (recvmsg(m_Fd, &Msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+      {
+         if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return nNotifications;
+         if (errno == EINTR)
+            continue;
+
+         return -1;
+      }
+
+      for (struct cmsghdr* pCmsg = CMSG_FIRSTHDR(&Msg); pCmsg != nullptr; pCmsg = CMSG_NXTHDR(&Msg, pCmsg))
+      {
+         if (!(pCmsg->cmsg_level == SOL_IP && pCmsg->cmsg_type == IP_RECVERR) &&
+             !(pCmsg->cmsg_level == SOL_IPV6 && pCmsg->cmsg_type == IPV6_RECVERR))
+            continue;
+
+         struct sock_extended_err ExtErr;
+         memcpy(&ExtErr, CMSG_DATA(pCmsg), sizeof(ExtErr));
+         if (ExtErr.ee_errno != 0 || ExtErr.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+            continue;
+
+         // [ee_info, ee_data] : a range of completed calls
+         if (ExtErr.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+            m_uKernelCopies += ExtErr.ee_data - ExtErr.ee_info + 1;
+
+         MarkCompleted(ExtErr.ee_info, ExtErr.ee_data);
+         ++nNotifications;
+      }
+   }
+}
+
+void CZeroCopySender::MarkCompleted(uint32_t uFirst, const uint32_t uLast)
+{
+   for (;; ++uFirst)
+   {
+      if (uFirst == m_uCompletedBelow)
+      {
+         ++m_uCompletedBelow;
+         while (m_setCompleted.erase(m_uCompletedBelow) != 0)
+            ++m_uCompletedBelow;
+      }
+      else if (IdBefore(m_uCompletedBelow, uFirst))
+         m_setCompleted.insert(uFirst);
+
+      if (uFirst == uLast)
+         break;
+   }
+}
+
+int CZeroCopySender::ReleaseCompleted()
+{
+   int nReleased = 0;
+   while (!m_deqPending.empty() && IdBefore(m_deqPending.front().m_uLastId, m_uCompletedBelow))
+   {
+      // popped first, the callback may send again
+      ReleaseFnCallback fnReleased = std::move(m_deqPending.front().m_fnReleased);
+      m_deqPending.pop_front();
+
+      if (fnReleased)
+         fnReleased();
+
+      ++nReleased;
+   }
+   return nReleased;
+}
+#endif
@@ -0,0 +1,90 @@
+/*
+* @file ZeroCopySender.h
+* @brief MSG_ZEROCOPY sends on a connected TCP socket and their completion tracking
+* @date 2026-10-17
+*
+* With SO_ZEROCOPY, the kernel sends the user pages themselves instead of a copy :
+* the buffer must then stay untouched until the kernel reports, on the socket error
+* queue, that it doesn't need it anymore. Each send is given a callback invoked
+* (from Send or Reap, on the caller's thread) once its buffer can be reused.
+* Pinning pages costs more than copying small buffers, sends below a threshold are
+* copied as usual and their callback is invoked right away.
+*/
+
+#ifdef LINUX
+#ifndef INCLUDE_ZEROCOPYSENDER_H_
+#define INCLUDE_ZEROCOPYSENDER_H_
+
+#include <cstdint>
+#include <deque>
+#include <set>
+
+#include "Socket.h"
+
+class CZeroCopySender
+{
+public:
+   typedef std::function<void()> ReleaseFnCallback;
+
+   // kernel documentation : zero-copy is generally effective above around 10 KB
+   static const size_t DEFAULT_THRESHOLD = 10 * 1024;
+
+   explicit CZeroCopySender(const ASocket::Socket Fd, const size_t uThreshold = DEFAULT_THRESHOLD);
+
+   CZeroCopySender(const CZeroCopySender&) = delete;
+   CZeroCopySender& operator=(const CZeroCopySender&) = delete;
+
+   /* sets SO_ZEROCOPY on the socket, returns false (errno set) if the kernel doesn't
+    * support it : Send then copies everything */
+   bool Enable();
+   bool IsEnabled() const { return m_bEnabled; }
+
+   inline void SetThreshold(const size_t uThreshold) { m_uThreshold = uThreshold; }
+   inline size_t GetThreshold() const { return m_uThreshold; }
+
+   /* sends the whole buffer (blocking socket), fnReleased is called when pData can be
+    * reused or freed. Returns false with errno set on error, fnReleased isn't called then
+    * but the buffer may still be referenced by the kernel until the socket is closed. */
+   bool Send(const char* pData, const size_t uSize, const ReleaseFnCallback& fnReleased);
+
+   /* reads the completions (waiting at most msec ms while some are pending) and calls the
+    * callbacks of the released buffers. Returns their count or -1 on error. */
+   int Reap(const size_t msec = 0);
+
+   size_t GetPendingCount() const { return m_deqPending.size(); }
+
+   /* Send calls that went through MSG_ZEROCOPY, sendmsg calls the kernel had to copy
+    * anyway (e.g. over loopback) and Send calls copied because of the threshold */
+   unsigned long long GetZeroCopySends() const { return m_uZeroCopySends; }
+   unsigned long long GetKernelCopies() const { return m_uKernelCopies; }
+   unsigned long long GetThresholdCopies() const { return m_uThresholdCopies; }
+
+protected:
+   struct PendingSend
+   {
+      uint32_t          m_uLastId; // notification ID of its last sendmsg call
+      ReleaseFnCallback m_fnReleased;
+   };
+
+   bool SendCopy(const char* pData, size_t uSize) const;
+   void MarkCompleted(uint32_t uFirst, const uint32_t uLast);
+   int ReleaseCompleted();
+   int DrainErrorQueue();
+
+   ASocket::Socket m_Fd;
+   size_t          m_uThreshold;
+   bool            m_bEnabled;
+
+   // the kernel numbers each successful MSG_ZEROCOPY sendmsg call, from 0
+   uint32_t                m_uNextId;
+   uint32_t                m_uCompletedBelow; // every ID below it is completed
+   std::set<uint32_t>      m_setCompleted;    // completed IDs above it
+   std::deque<PendingSend> m_deqPending;
+
+   unsigned long long m_uZeroCopySends;
+   unsigned long long m_uKernelCopies;
+   unsigned long long m_uThresholdCopies;
+};
+
+#endif
+#endif
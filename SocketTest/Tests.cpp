@@ -6,6 +6,33 @@
 #include "TCPServer.h"
 #include "TCPSSLServer.h"
 #include "TCPSSLClient.h"
+#include "TCPEventServer.h"
+#include "TCPMultiServer.h"
+#include "SSLHandshakeDriver.h"
+#include "MessageFramer.h"
+#include "RecordReader.h"
+#include "ConnectionPool.h"
+#include "CoroSocket.h"
+#include "DnsCache.h"
+#include "SocketMultiplexer.h"
+#include "ShmConnection.h"
+#include "ShmServer.h"
+#include "SocketOptions.h"
+#include "TimerWheel.h"
+#include "UnixClient.h"
+#include "UnixServer.h"
+
+#include <map>
+#include <random>
+
+#ifdef LINUX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 #define PRINT_LOG [](const std::string& strLogMsg) { std::cout << strLogMsg << std::endl;  }
 
@@ -13,6 +40,7 @@
 extern bool TCP_TEST_ENABLED;
 extern bool SECURE_TCP_TEST_ENABLED;
 extern bool HTTP_PROXY_TEST_ENABLED;
+extern bool BENCHMARK_TEST_ENABLED;
 
 extern std::string TCP_SERVER_PORT;
 extern std::string SECURE_TCP_SERVER_PORT;
@@ -26,6 +54,23 @@ extern std::string PROXY_SERVER_FAKE;
 
 extern std::mutex g_mtxConsoleMutex;
 
+// heap allocations of a thread, counted while it points this at a counter (see BenchmarkBufferPool)
+static thread_local size_t* t_puAllocations = nullptr;
+
+void* operator new(size_t uSize)
+{
+   if (t_puAllocations != nullptr)
+      ++*t_puAllocations;
+
+   void* pMemory = std::malloc(uSize ? uSize : 1);
+   if (pMemory == nullptr)
+      throw std::bad_alloc();
+   return pMemory;
+}
+
+void operator delete(void* pMemory) noexcept { std::free(pMemory); }
+void operator delete(void* pMemory, size_t) noexcept { std::free(pMemory); }
+
 namespace
 {
 // fixture for TCP tests
@@ -64,6 +109,57 @@ protected:
    }
 };
 
+#ifdef LINUX
+// fixture for the event-driven TCP server tests
+class TCPEventTest : public ::testing::Test
+{
+protected:
+   std::unique_ptr<CTCPClient>      m_pTCPClient;
+   std::unique_ptr<CTCPEventServer> m_pEventServer;
+   std::thread                      m_LoopThread;
+
+   TCPEventTest() :
+      m_pTCPClient(nullptr),
+      m_pEventServer(nullptr)
+   {
+   }
+
+   virtual ~TCPEventTest()
+   {
+   }
+
+   virtual void SetUp()
+   {
+      m_pTCPClient.reset(new CTCPClient(PRINT_LOG));
+      m_pEventServer.reset(new CTCPEventServer(PRINT_LOG, TCP_SERVER_PORT));
+   }
+
+   virtual void TearDown()
+   {
+      m_pTCPClient.reset();
+      StopLoop();
+      m_pEventServer.reset();
+   }
+
+   void StartLoop()
+   {
+      m_LoopThread = std::thread([this] { m_pEventServer->Run(); });
+
+      // give time to let the loop thread create the listen socket.
+      SleepMs(100);
+   }
+
+   void StopLoop()
+   {
+      if (m_LoopThread.joinable())
+      {
+         m_pEventServer->Stop();
+         m_LoopThread.join();
+      }
+   }
+};
+#endif
+
 #ifdef OPENSSL
 // fixture for TCP SSL tests
 class SSLTCPTest : public ::testing::Test
@@ -215,188 +311,721 @@ TEST_F(TCPTest, TestLoopbackTenMegaBytes)
       std::cout << "TCP tests are disabled !" << std::endl;
 }
 
-TEST_F(TCPTest, TestPollSocketForReceivedBytes)
+TEST_F(TCPTest, TestVectoredSendReceive)
 {
-    if (TCP_TEST_ENABLED)
-    {
-        srand(static_cast<unsigned>(time(nullptr)));
+   if (TCP_TEST_ENABLED)
+   {
+      // a 4 bytes header then a payload split in more buffers than a single sendmsg accepts
+      const size_t uBlocks = 2000;
+      const size_t uBlockSize = 2048;
+      const size_t uPayloadSize = uBlocks * uBlockSize;
+
+      std::vector<char> Payload(uPayloadSize);
+      std::generate(Payload.begin(), Payload.end(), [] { return (std::rand() % 256); });
+      const char szHeader[4] = { 'H', 'D', 'R', '1' };
+
+      std::vector<ASocket::ConstBuffer> vecSend;
+      vecSend.push_back({ szHeader, sizeof(szHeader) });
+      vecSend.push_back({ nullptr, 0 }); // empty buffers are skipped
+      for (size_t i = 0; i < uBlocks; ++i)
+         vecSend.push_back({ Payload.data() + i * uBlockSize, uBlockSize });
+
+      // the receiver scatters the stream into unequal buffers
+      char szRcvHeader[4] = {};
+      std::vector<char> RcvPayload(uPayloadSize);
+      const size_t uFirstPart = 1000;
+      const size_t uSecondPart = uPayloadSize / 2;
+      const ASocket::MutableBuffer RcvBuffers[] = {
+         { szRcvHeader, sizeof(szRcvHeader) },
+         { RcvPayload.data(), uFirstPart },
+         { RcvPayload.data() + uFirstPart, uSecondPart },
+         { RcvPayload.data() + uFirstPart + uSecondPart, uPayloadSize - uFirstPart - uSecondPart }
+      };
+      const int nExpected = static_cast<int>(sizeof(szHeader) + uPayloadSize);
 
-        const size_t tenMeg = 10 * 1024 * 1024;
-        std::vector<char> TenMbData(tenMeg);
-        std::vector<char> RcvBuffer(tenMeg);
-        std::generate(TenMbData.begin(), TenMbData.end(), [] { return (std::rand() % 256); });
+      ASocket::Socket ConnectedClient;
 
-        ASocket::Socket ConnectedClient;
+      ASSERT_NO_THROW(m_pTCPServer.reset(new CTCPServer(PRINT_LOG, TCP_SERVER_PORT)));
 
-        ASSERT_NO_THROW(m_pTCPServer.reset(new CTCPServer(PRINT_LOG, TCP_SERVER_PORT)));
+      std::future<bool> futListen = std::async(std::launch::async,
+                                               [&] { return m_pTCPServer->Listen(ConnectedClient); });
 
-        // Not always starts a new thread, std::launch::async must be passed to force it.
-        std::future<bool> futListen = std::async(std::launch::async,
-            [&] { return m_pTCPServer->Listen(ConnectedClient); });
+      // give time to let the server object reach the accept instruction.
+      SleepMs(500);
 
-        // give time to let the server object reach the accept instruction.
-        SleepMs(500);
+      ASSERT_TRUE(m_pTCPClient->Connect("localhost", TCP_SERVER_PORT));
+      ASSERT_TRUE(futListen.get());
 
-        ASSERT_TRUE(m_pTCPClient->Connect("localhost", "6669"));
-        ASSERT_TRUE(futListen.get());
+      // client -> server
+      std::future<int> futServerReceive = std::async(std::launch::async, [&]()
+      {
+         return m_pTCPServer->Receive(ConnectedClient, RcvBuffers, 4);
+      });
+      EXPECT_TRUE(m_pTCPClient->Send(vecSend.data(), vecSend.size()));
 
-        auto ClientReceive = [&]() -> int {
-            const int chunkSize = 1024 * 1024; // 1 MB
-            int readBytes = 0;
-            int timeoutCount = 0;
+      EXPECT_EQ(futServerReceive.get(), nExpected);
+      EXPECT_TRUE(std::equal(szHeader, szHeader + sizeof(szHeader), szRcvHeader));
+      EXPECT_TRUE(Payload == RcvPayload);
 
-            while (timeoutCount < 20)
-            {
-                int ret = ASocket::SelectSocket(m_pTCPClient->GetSocketDescriptor(), 300);
+      std::fill(RcvPayload.begin(), RcvPayload.end(), 0);
+      memset(szRcvHeader, 0, sizeof(szRcvHeader));
 
-                if (ret > 0)
-                {
-                    int readCount = m_pTCPClient->Receive(RcvBuffer.data() + readBytes, chunkSize);
+      // server -> client
+      std::future<int> futClientReceive = std::async(std::launch::async, [&]()
+      {
+         return m_pTCPClient->Receive(RcvBuffers, 4);
+      });
+      EXPECT_TRUE(m_pTCPServer->Send(ConnectedClient, vecSend.data(), vecSend.size()));
 
-                    if (readCount == 0)
-                        break;
+      EXPECT_EQ(futClientReceive.get(), nExpected);
+      EXPECT_TRUE(std::equal(szHeader, szHeader + sizeof(szHeader), szRcvHeader));
+      EXPECT_TRUE(Payload == RcvPayload);
 
-                    readBytes += readCount;
-                }
-                else
-                {
-                    timeoutCount += 1;
-                }
+      // the peer shuts down before the buffers are filled : what was received is returned
+      const char szLast[] = "end";
+      const ASocket::ConstBuffer LastBuffer[] = { { szLast, 3 } };
+      EXPECT_TRUE(m_pTCPClient->Send(LastBuffer, 1));
+      EXPECT_TRUE(m_pTCPClient->Disconnect());
+      EXPECT_EQ(m_pTCPServer->Receive(ConnectedClient, RcvBuffers, 4), 3);
 
-                if (readBytes >= tenMeg)
-                    break;
-            }
+      EXPECT_TRUE(m_pTCPServer->Disconnect(ConnectedClient));
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
+}
 
-            return readBytes;
-        };
+TEST_F(TCPTest, TestPooledBuffers)
+{
+   if (TCP_TEST_ENABLED)
+   {
+      // capacity rounded up to the size class, copies share the block
+      CPooledBuffer Buffer = CBufferPool::Acquire(1000);
+      EXPECT_EQ(Buffer.Size(), 1000u);
+      EXPECT_EQ(Buffer.Capacity(), 1024u);
+      EXPECT_EQ(Buffer.UseCount(), 1u);
+      EXPECT_FALSE(Buffer.Resize(2000));
+      {
+         CPooledBuffer Shared = Buffer;
+         EXPECT_EQ(Shared.Data(), Buffer.Data());
+         EXPECT_EQ(Buffer.UseCount(), 2u);
+      }
+      EXPECT_EQ(Buffer.UseCount(), 1u);
+      Buffer.Reset();
+      EXPECT_FALSE(Buffer);
+
+      // a block released by another thread reaches the depot when that thread exits
+      const size_t uLargeSize = 300 * 1024;
+      CPooledBuffer Large = CBufferPool::Acquire(uLargeSize);
+      const char* pLargeBlock = Large.Data();
+      std::thread([&Large] { CPooledBuffer Dropped = std::move(Large); }).join();
+      CBufferPool::Stats Before = CBufferPool::GetStats();
+      Large = CBufferPool::Acquire(uLargeSize);
+      EXPECT_EQ(Large.Data(), pLargeBlock);
+      EXPECT_EQ(CBufferPool::GetStats().m_uDepotHits, Before.m_uDepotHits + 1);
+      Large.Reset();
+
+      const size_t uMessages = 200;
+      const size_t uMsgSize = 4096;
+      std::vector<char> SndData(uMessages * uMsgSize);
+      std::generate(SndData.begin(), SndData.end(), [] { return (std::rand() % 256); });
 
-        // launch the receive in another thread to prevent server from
-        // hanging when sending "many" bytes.
-        std::future<int> futClientReceive = std::async(std::launch::async, ClientReceive);
+      ASocket::Socket ConnectedClient;
 
-        ASSERT_FALSE(ConnectedClient == INVALID_SOCKET);
+      ASSERT_NO_THROW(m_pTCPServer.reset(new CTCPServer(PRINT_LOG, TCP_SERVER_PORT)));
 
-        // server -> client
-        EXPECT_TRUE(m_pTCPServer->Send(ConnectedClient, TenMbData));
+      std::future<bool> futListen = std::async(std::launch::async,
+                                               [&] { return m_pTCPServer->Listen(ConnectedClient); });
 
-        int nRcvdBytes = futClientReceive.get();
+      // give time to let the server object reach the accept instruction.
+      SleepMs(500);
 
-        EXPECT_EQ(nRcvdBytes, tenMeg);
-        EXPECT_TRUE(std::equal(TenMbData.begin(), TenMbData.end(), RcvBuffer.begin()));
+      ASSERT_TRUE(m_pTCPClient->Connect("localhost", TCP_SERVER_PORT));
+      ASSERT_TRUE(futListen.get());
 
-        std::fill(RcvBuffer.begin(), RcvBuffer.end(), 0);
+      std::future<bool> futServerSend = std::async(std::launch::async, [&]
+      {
+         CPooledBuffer Out = CBufferPool::Acquire(SndData.size());
+         memcpy(Out.Data(), SndData.data(), SndData.size());
+         return m_pTCPServer->Send(ConnectedClient, Out);
+      });
 
-        // client -> server
-        auto ServerReceive = [&]() -> int {
-            const int chunkSize = 1024 * 1024; // 1 MB
-            int readBytes = 0;
-            int timeoutCount = 0;
+      // every message gets its own handle, released at the end of each iteration
+      Before = CBufferPool::GetStats();
+      bool bSameData = true;
+      for (size_t m = 0; m < uMessages; ++m)
+      {
+         CPooledBuffer Msg;
+         ASSERT_EQ(m_pTCPClient->Receive(Msg, uMsgSize), static_cast<int>(uMsgSize));
+         ASSERT_EQ(Msg.Size(), uMsgSize);
+         bSameData = bSameData && std::equal(Msg.Data(), Msg.Data() + uMsgSize, SndData.begin() + m * uMsgSize);
+      }
+      EXPECT_TRUE(bSameData);
+      EXPECT_TRUE(futServerSend.get());
+
+      // a single block was allocated, then reused from the thread's free list
+      CBufferPool::Stats After = CBufferPool::GetStats();
+      EXPECT_LE(After.m_uSystemAllocations - Before.m_uSystemAllocations, 2u);
+      EXPECT_GE(After.m_uThreadCacheHits - Before.m_uThreadCacheHits, uMessages - 1);
+
+      // a handle that isn't shared is refilled in place
+      CPooledBuffer Reused = CBufferPool::Acquire(uMsgSize);
+      const char* pReused = Reused.Data();
+      EXPECT_TRUE(m_pTCPClient->Send(Reused));
+      EXPECT_EQ(m_pTCPServer->Receive(ConnectedClient, Reused, uMsgSize), static_cast<int>(uMsgSize));
+      EXPECT_EQ(Reused.Data(), pReused);
+
+      // the peer shuts down : the size is the received count
+      EXPECT_TRUE(m_pTCPClient->Send("end", 3));
+      EXPECT_TRUE(m_pTCPClient->Disconnect());
+      EXPECT_EQ(m_pTCPServer->Receive(ConnectedClient, Reused, uMsgSize), 3);
+      EXPECT_EQ(Reused.Size(), 3u);
 
-            while (timeoutCount < 20)
-            {
-                int ret = ASocket::SelectSocket(ConnectedClient, 300);
+      EXPECT_TRUE(m_pTCPServer->Disconnect(ConnectedClient));
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
+}
 
-                if (ret > 0)
-                {
-                    int readCount = m_pTCPServer->Receive(ConnectedClient, RcvBuffer.data() + readBytes, chunkSize);
+TEST_F(TCPTest, TestMessageFraming)
+{
+   if (TCP_TEST_ENABLED)
+   {
+      // frames of 0 to 70000 bytes, the 16 bits prefix can't carry the largest ones
+      std::vector<std::string> vecMessages;
+      for (size_t i = 0; i < 500; ++i)
+         vecMessages.push_back(std::string((i * 7919) % ((i % 50 == 0) ? 70001 : 300), static_cast<char>('a' + i % 26)));
 
-                    if (readCount == 0)
-                        break;
+      const CMessageFramer::PrefixType Prefixes[] =
+         { CMessageFramer::PREFIX_UINT16, CMessageFramer::PREFIX_UINT32, CMessageFramer::PREFIX_VARINT };
 
-                    readBytes += readCount;
-                }
-                else
-                {
-                    timeoutCount += 1;
-                }
+      ASSERT_NO_THROW(m_pTCPServer.reset(new CTCPServer(PRINT_LOG, TCP_SERVER_PORT)));
 
-                if (readBytes >= tenMeg)
-                    break;
-            }
+      for (const CMessageFramer::PrefixType ePrefix : Prefixes)
+      {
+         const size_t uMaxSize = (ePrefix == CMessageFramer::PREFIX_UINT16) ? 0xFFFF : 0x100000;
+         ASocket::Socket ConnectedClient;
 
-            return readBytes;
-        };
-        std::future<int> futServerReceive = std::async(std::launch::async, ServerReceive);
+         std::future<bool> futListen = std::async(std::launch::async,
+                                                  [&] { return m_pTCPServer->Listen(ConnectedClient); });
 
-        EXPECT_TRUE(m_pTCPClient->Send(TenMbData));
-        nRcvdBytes = futServerReceive.get();
+         // give time to let the server object reach the accept instruction.
+         SleepMs(500);
 
-        EXPECT_EQ(nRcvdBytes, tenMeg);
-        EXPECT_TRUE(std::equal(TenMbData.begin(), TenMbData.end(), RcvBuffer.begin()));
+         CTCPClient Client(PRINT_LOG, ASocket::NO_FLAGS);
+         ASSERT_TRUE(Client.Connect("localhost", TCP_SERVER_PORT));
+         ASSERT_TRUE(futListen.get());
 
-        // disconnect
-        EXPECT_TRUE(m_pTCPClient->Disconnect());
-    }
-    else
-        std::cout << "TCP tests are disabled !" << std::endl;
+         CMessageFramer ClientFramer = CMessageFramer::ForClient(Client, ePrefix, uMaxSize);
+         CMessageFramer ServerFramer = CMessageFramer::ForServer(*m_pTCPServer, ConnectedClient, ePrefix, uMaxSize);
+
+         // batches of 50 frames, one write each
+         size_t uExpectedFrames = 0;
+         std::future<bool> futSend = std::async(std::launch::async, [&]
+         {
+            for (size_t i = 0; i < vecMessages.size(); ++i)
+            {
+               if (vecMessages[i].size() > uMaxSize)
+               {
+                  if (ClientFramer.Queue(vecMessages[i].data(), vecMessages[i].size()))
+                     return false;
+                  continue;
+               }
+               if (!ClientFramer.Queue(vecMessages[i].data(), vecMessages[i].size()))
+                  return false;
+               if (ClientFramer.GetQueuedCount() == 50 && !ClientFramer.Flush())
+                  return false;
+            }
+            return ClientFramer.Flush();
+         });
+         for (const std::string& strMessage : vecMessages)
+            uExpectedFrames += (strMessage.size() <= uMaxSize) ? 1 : 0;
+
+         std::vector<CMessageFramer::FrameView> vecFrames;
+         size_t uMessage = 0;
+         size_t uReceived = 0;
+         bool bSameData = true;
+         while (uReceived < uExpectedFrames)
+         {
+            int nFrames = ServerFramer.Receive(vecFrames);
+            ASSERT_GT(nFrames, 0);
+
+            for (const CMessageFramer::FrameView& Frame : vecFrames)
+            {
+               while (vecMessages[uMessage].size() > uMaxSize)
+                  ++uMessage;
+               bSameData = bSameData && std::string(Frame.m_pData, Frame.m_uSize) == vecMessages[uMessage++];
+            }
+            uReceived += vecFrames.size();
+         }
+         EXPECT_TRUE(futSend.get());
+         EXPECT_TRUE(bSameData);
+         EXPECT_EQ(uReceived, uExpectedFrames);
+
+         // several frames per recv and per send
+         EXPECT_LT(ServerFramer.GetReceiveCalls(), uExpectedFrames / 2);
+         EXPECT_LE(ClientFramer.GetSendCalls(), uExpectedFrames / 50 + 1);
+
+         // server -> client, one frame at a time
+         EXPECT_TRUE(ServerFramer.Send("ping"));
+         EXPECT_TRUE(ServerFramer.Send(std::string()));
+         CMessageFramer::FrameView Frame;
+         ASSERT_EQ(ClientFramer.Receive(Frame), 1);
+         EXPECT_EQ(std::string(Frame.m_pData, Frame.m_uSize), "ping");
+         ASSERT_EQ(ClientFramer.Receive(Frame), 1);
+         EXPECT_EQ(Frame.m_uSize, 0u);
+
+         // a length above the maximum is a protocol error, the stream can't be trusted anymore
+         char szHeader[CMessageFramer::MAX_HEADER_SIZE];
+         const size_t uHeaderSize = CMessageFramer::EncodeLength(ePrefix, uMaxSize + 1, szHeader);
+         if (ePrefix != CMessageFramer::PREFIX_UINT16)
+         {
+            EXPECT_TRUE(Client.Send(szHeader, uHeaderSize));
+            EXPECT_EQ(ServerFramer.Receive(vecFrames), CMessageFramer::FRAME_TOO_LARGE);
+         }
+
+         EXPECT_TRUE(Client.Disconnect());
+         if (ePrefix == CMessageFramer::PREFIX_UINT16)
+         {
+            EXPECT_EQ(ServerFramer.Receive(vecFrames), CMessageFramer::PEER_SHUTDOWN);
+         }
+         EXPECT_TRUE(m_pTCPServer->Disconnect(ConnectedClient));
+      }
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
 }
 
-TEST_F(TCPTest, TestPollSocketTimeout)
+TEST_F(TCPTest, TestRecordReader)
 {
-    if (TCP_TEST_ENABLED)
-    {
-        ASocket::Socket ConnectedClient;
+   if (TCP_TEST_ENABLED)
+   {
+      // every supported kernel agrees with the scalar one, at every offset and block boundary
+      const std::string Delimiters[] = { "\n", "\r\n", "\r\n\r\n", "--boundary--" };
+      const CRecordReader::ScanKernel Kernels[] =
+         { CRecordReader::SCAN_SCALAR, CRecordReader::SCAN_SSE2, CRecordReader::SCAN_AVX2 };
+      std::cout << "** Scan kernel : " << CRecordReader::GetScanKernel() << "\n";
+
+      bool bSameResults = true;
+      for (const std::string& strDelimiter : Delimiters)
+      {
+         for (size_t uSize = 0; uSize < 100; ++uSize)
+         {
+            for (size_t uAt = 0; uAt + strDelimiter.size() <= uSize; ++uAt)
+            {
+               // decoys : the first and last delimiter bytes everywhere else
+               std::string strData(uSize, strDelimiter[0]);
+               for (size_t i = 1; i < uSize; i += 2)
+                  strData[i] = strDelimiter.back();
+               if (strDelimiter.size() == 1)
+                  std::fill(strData.begin(), strData.end(), 'x');
+               strData.replace(uAt, strDelimiter.size(), strDelimiter);
+
+               const size_t uExpected = CRecordReader::Find(CRecordReader::SCAN_SCALAR, strData.data(), uSize,
+                                                            strDelimiter.data(), strDelimiter.size());
+               for (const CRecordReader::ScanKernel eKernel : Kernels)
+               {
+                  if (CRecordReader::IsScanKernelSupported(eKernel))
+                     bSameResults = bSameResults && uExpected == CRecordReader::Find(eKernel, strData.data(), uSize,
+                                                                                      strDelimiter.data(), strDelimiter.size());
+               }
+               bSameResults = bSameResults && uExpected <= uAt;
+            }
+         }
+      }
+      EXPECT_TRUE(bSameResults);
 
-        ASSERT_NO_THROW(m_pTCPServer.reset(new CTCPServer(PRINT_LOG, TCP_SERVER_PORT)));
+      ASocket::Socket ConnectedClient;
 
-        // Not always starts a new thread, std::launch::async must be passed to force it.
-        std::future<bool> futListen = std::async(std::launch::async,
-            [&] { return m_pTCPServer->Listen(ConnectedClient); });
+      ASSERT_NO_THROW(m_pTCPServer.reset(new CTCPServer(PRINT_LOG, TCP_SERVER_PORT)));
 
-        // give time to let the server object reach the accept instruction.
-        SleepMs(100);
+      std::future<bool> futListen = std::async(std::launch::async,
+                                               [&] { return m_pTCPServer->Listen(ConnectedClient); });
 
-        ASSERT_TRUE(m_pTCPClient->Connect("localhost", "6669"));
-        ASSERT_TRUE(futListen.get());
+      // give time to let the server object reach the accept instruction.
+      SleepMs(500);
 
-        auto ClientReceive = [&](){
-            int timeoutCount = 0;
+      ASSERT_TRUE(m_pTCPClient->Connect("localhost", TCP_SERVER_PORT));
+      ASSERT_TRUE(futListen.get());
 
-            while (timeoutCount < 10)
-            {
-                int ret = ASocket::SelectSocket(m_pTCPClient->GetSocketDescriptor(), 50);
-                ASSERT_EQ(ret, 0);
-                timeoutCount += 1;
-            }
-        };
+      // lines sent in pieces that split the delimiters, then a header block and a raw body
+      std::string strStream;
+      for (size_t i = 0; i < 2000; ++i)
+         strStream += "line " + std::to_string(i) + std::string(i % 97, '.') + "\r\n";
+      strStream += "Content-Length: 5\r\nHost: x\r\n\r\nhello";
 
-        // launch the receive in another thread to prevent server from
-        // hanging when sending "many" bytes.
-        std::future<void> futClientReceive = std::async(std::launch::async, ClientReceive);
+      std::future<bool> futSend = std::async(std::launch::async, [&]
+      {
+         for (size_t uOffset = 0; uOffset < strStream.size(); uOffset += 1337)
+         {
+            if (!m_pTCPClient->Send(strStream.data() + uOffset, std::min<size_t>(1337, strStream.size() - uOffset)))
+               return false;
+         }
+         return true;
+      });
 
-        ASSERT_FALSE(ConnectedClient == INVALID_SOCKET);
+      CRecordReader Reader = CRecordReader::ForServer(*m_pTCPServer, ConnectedClient);
+      CRecordReader::RecordView Record;
+      bool bSameLines = true;
+      for (size_t i = 0; i < 2000; ++i)
+      {
+         ASSERT_EQ(Reader.ReadUntil(Record), 1);
+         bSameLines = bSameLines &&
+            std::string(Record.m_pData, Record.m_uSize) == "line " + std::to_string(i) + std::string(i % 97, '.');
+      }
+      EXPECT_TRUE(bSameLines);
+      EXPECT_TRUE(futSend.get());
+      EXPECT_LT(Reader.GetReceiveCalls(), 2000u / 10);
+
+      // the header block as a single record, then the body
+      Reader.SetDelimiter("\r\n\r\n");
+      ASSERT_EQ(Reader.ReadUntil(Record), 1);
+      EXPECT_EQ(std::string(Record.m_pData, Record.m_uSize), "Content-Length: 5\r\nHost: x");
+      char szBody[5];
+      EXPECT_EQ(Reader.Read(szBody, sizeof(szBody)), 5);
+      EXPECT_EQ(std::string(szBody, 5), "hello");
+
+      // a record without delimiter beyond the maximum size is refused
+      CRecordReader SmallReader = CRecordReader::ForServer(*m_pTCPServer, ConnectedClient, "\n", 100);
+      EXPECT_TRUE(m_pTCPClient->Send(std::string(500, 'z')));
+      EXPECT_EQ(SmallReader.ReadUntil(Record), CRecordReader::RECORD_TOO_LARGE);
 
-        // do not send anything from the server to the client
+      EXPECT_TRUE(m_pTCPClient->Disconnect());
+      EXPECT_TRUE(m_pTCPServer->Disconnect(ConnectedClient));
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
+}
 
-        futClientReceive.get();
+TEST_F(TCPTest, BenchmarkDelimiterScan)
+{
+   if (BENCHMARK_TEST_ENABLED)
+   {
+      // a receive buffer (64 KB, cache resident) of short lines, of longer records and of header
+      // blocks (lines ending with "\r\n" every 64 bytes, the block with "\r\n\r\n"), scanned
+      // record by record until 4 GB went through
+      const size_t uBufferSize = 64 * 1024;
+      const size_t uPasses = 64 * 1024;
+      const struct
+      {
+         size_t      m_uRecord;
+         std::string m_strDelimiter;
+         bool        m_bHeaderLines;
+      } Cases[] = { { 64, "\n", false }, { 64, "\r\n", false }, { 4096, "\n", false }, { 4096, "\r\n", false },
+                    { 4096, "\r\n\r\n", true } };
 
-        // client -> server
-        auto ServerReceive = [&](){
-            int timeoutCount = 0;
+      const struct
+      {
+         const char* m_szName;
+         CRecordReader::ScanKernel m_eKernel;
+      } Kernels[] = { { "memchr", CRecordReader::SCAN_SCALAR },
+                      { "sse2", CRecordReader::SCAN_SSE2 },
+                      { "avx2", CRecordReader::SCAN_AVX2 } };
 
-            while (timeoutCount < 10)
+      for (const auto& Case : Cases)
+      {
+         const size_t uRecord = Case.m_uRecord;
+         const std::string& strDelimiter = Case.m_strDelimiter;
+
+         std::string strData(uBufferSize, ' ');
+         std::generate(strData.begin(), strData.end(), [] { return static_cast<char>('a' + std::rand() % 26); });
+         for (size_t uOffset = 62; Case.m_bHeaderLines && uOffset + 2 <= uBufferSize; uOffset += 64)
+            strData.replace(uOffset, 2, "\r\n");
+         for (size_t uOffset = uRecord - strDelimiter.size(); uOffset + strDelimiter.size() <= uBufferSize; uOffset += uRecord)
+            strData.replace(uOffset, strDelimiter.size(), strDelimiter);
+
+         for (const auto& Kernel : Kernels)
+         {
+            if (!CRecordReader::IsScanKernelSupported(Kernel.m_eKernel))
+               continue;
+
+            size_t uRecords = 0;
+            auto StartTime = std::chrono::steady_clock::now();
+            for (size_t uPass = 0; uPass < uPasses; ++uPass)
             {
-                int ret = ASocket::SelectSocket(ConnectedClient, 50);
-                ASSERT_EQ(ret, 0);
-                timeoutCount += 1;
+               size_t uFound, uOffset = 0;
+               while ((uFound = CRecordReader::Find(Kernel.m_eKernel, strData.data() + uOffset, uBufferSize - uOffset,
+                                                    strDelimiter.data(), strDelimiter.size())) != CRecordReader::NOT_FOUND)
+               {
+                  uOffset += uFound + strDelimiter.size();
+                  ++uRecords;
+               }
             }
-        };
-        std::future<void> futServerReceive = std::async(std::launch::async, ServerReceive);
-
-        // do not send anything from the client to the server
-        futServerReceive.get();
+            double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
 
-        // disconnect
-        EXPECT_TRUE(m_pTCPClient->Disconnect());
-    }
-    else
-        std::cout << "TCP tests are disabled !" << std::endl;
+            EXPECT_EQ(uRecords, uPasses * (uBufferSize / uRecord));
+            std::cout << "** " << uRecord << " bytes records, " << strDelimiter.size() << " byte(s) delimiter, "
+                      << Kernel.m_szName << " : "
+                      << (static_cast<double>(uPasses) * uBufferSize / (1024.0 * 1024.0 * 1024.0)) / dSeconds << " GB/s\n";
+         }
+      }
+   }
+   else
+      std::cout << "Benchmark tests are disabled !" << std::endl;
 }
 
-TEST_F(TCPTest, TestReceivingTimeout)
+#ifdef LINUX
+TEST_F(TCPTest, TestSendFile)
 {
-    if (TCP_TEST_ENABLED)
-    {
+   if (TCP_TEST_ENABLED)
+   {
+      const size_t uFileSize = 3 * 1024 * 1024 + 123;
+      std::vector<char> FileData(uFileSize);
+      std::generate(FileData.begin(), FileData.end(), [] { return (std::rand() % 256); });
+
+      char szFileName[] = "/tmp/socket_cpp_sendfile_XXXXXX";
+      int iFileFd = mkstemp(szFileName);
+      ASSERT_GE(iFileFd, 0);
+      ASSERT_EQ(write(iFileFd, FileData.data(), uFileSize), static_cast<ssize_t>(uFileSize));
+
+      ASocket::Socket ConnectedClient;
+
+      ASSERT_NO_THROW(m_pTCPServer.reset(new CTCPServer(PRINT_LOG, TCP_SERVER_PORT)));
+
+      std::future<bool> futListen = std::async(std::launch::async,
+                                               [&] { return m_pTCPServer->Listen(ConnectedClient); });
+
+      // give time to let the server object reach the accept instruction.
+      SleepMs(500);
+
+      ASSERT_TRUE(m_pTCPClient->Connect("localhost", TCP_SERVER_PORT));
+      ASSERT_TRUE(futListen.get());
+
+      std::vector<char> RcvBuffer(uFileSize);
+
+      // server -> client : the whole file, by path
+      std::future<int> futReceive = std::async(std::launch::async, [&]()
+      {
+         return m_pTCPClient->Receive(RcvBuffer.data(), uFileSize);
+      });
+      EXPECT_TRUE(m_pTCPServer->SendFile(ConnectedClient, szFileName));
+      EXPECT_EQ(futReceive.get(), static_cast<int>(uFileSize));
+      EXPECT_TRUE(FileData == RcvBuffer);
+
+      // client -> server : a range, by descriptor
+      const off_t Offset = 4000;
+      const size_t uRange = 2 * 1024 * 1024;
+      futReceive = std::async(std::launch::async, [&]()
+      {
+         return m_pTCPServer->Receive(ConnectedClient, RcvBuffer.data(), uRange);
+      });
+      EXPECT_TRUE(m_pTCPClient->SendFile(iFileFd, Offset, uRange));
+      EXPECT_EQ(futReceive.get(), static_cast<int>(uRange));
+      EXPECT_TRUE(std::equal(FileData.begin() + Offset, FileData.begin() + Offset + uRange, RcvBuffer.begin()));
+
+      // a range going past the end of the file is an error
+      EXPECT_FALSE(m_pTCPClient->SendFile(iFileFd, uFileSize - 10, 20));
+      EXPECT_FALSE(m_pTCPClient->SendFile("/this/file/does/not/exist"));
+
+      // the send timeout stops a transfer to a peer that doesn't read
+      const size_t uBigSize = 64 * 1024 * 1024;
+      ASSERT_EQ(ftruncate(iFileFd, uBigSize), 0);
+      ASSERT_TRUE(m_pTCPServer->SetSndTimeout(ConnectedClient, 200));
+
+      auto StartTime = std::chrono::steady_clock::now();
+      EXPECT_FALSE(m_pTCPServer->SendFile(ConnectedClient, iFileFd, 0, uBigSize));
+      EXPECT_LT(std::chrono::steady_clock::now() - StartTime, std::chrono::seconds(5));
+
+      close(iFileFd);
+      unlink(szFileName);
+
+      EXPECT_TRUE(m_pTCPClient->Disconnect());
+      EXPECT_TRUE(m_pTCPServer->Disconnect(ConnectedClient));
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPTest, TestZeroCopySend)
+{
+   if (TCP_TEST_ENABLED)
+   {
+      const size_t uBuffers = 20;
+      const size_t uBufferSize = 256 * 1024;
+      const size_t uSmallSize = 100; // below the threshold : copied
+      const size_t uTotal = uBuffers * (uBufferSize + uSmallSize);
+
+      std::vector<std::vector<char>> vecBuffers(uBuffers, std::vector<char>(uBufferSize));
+      for (auto& Buffer : vecBuffers)
+         std::generate(Buffer.begin(), Buffer.end(), [] { return (std::rand() % 256); });
+      const std::vector<char> Small(uSmallSize, 's');
+
+      ASocket::Socket ConnectedClient;
+
+      ASSERT_NO_THROW(m_pTCPServer.reset(new CTCPServer(PRINT_LOG, TCP_SERVER_PORT)));
+
+      std::future<bool> futListen = std::async(std::launch::async,
+                                               [&] { return m_pTCPServer->Listen(ConnectedClient); });
+
+      // give time to let the server object reach the accept instruction.
+      SleepMs(500);
+
+      ASSERT_TRUE(m_pTCPClient->Connect("localhost", TCP_SERVER_PORT));
+      ASSERT_TRUE(futListen.get());
+
+      if (!m_pTCPClient->EnableZeroCopy())
+      {
+         std::cout << "** SO_ZEROCOPY isn't supported by this kernel\n";
+         return;
+      }
+
+      std::vector<char> RcvBuffer(uTotal);
+      std::future<int> futReceive = std::async(std::launch::async, [&]()
+      {
+         return m_pTCPServer->Receive(ConnectedClient, RcvBuffer.data(), uTotal);
+      });
+
+      std::vector<bool> vecReleased(uBuffers, false);
+      size_t uSmallReleased = 0;
+      for (size_t i = 0; i < uBuffers; ++i)
+      {
+         EXPECT_TRUE(m_pTCPClient->SendZeroCopy(vecBuffers[i].data(), uBufferSize,
+                                                [&, i] { vecReleased[i] = true; }));
+         EXPECT_TRUE(m_pTCPClient->SendZeroCopy(Small.data(), uSmallSize, [&] { ++uSmallReleased; }));
+      }
+
+      // the small sends are released as soon as they're copied
+      EXPECT_EQ(uSmallReleased, uBuffers);
+
+      EXPECT_EQ(futReceive.get(), static_cast<int>(uTotal));
+      for (int iWait = 0; iWait < 50 && m_pTCPClient->GetZeroCopyPending() > 0; ++iWait)
+         m_pTCPClient->PollZeroCopy(100);
+
+      EXPECT_EQ(m_pTCPClient->GetZeroCopyPending(), 0u);
+      EXPECT_TRUE(std::all_of(vecReleased.begin(), vecReleased.end(), [](bool b) { return b; }));
+
+      const CZeroCopySender* pSender = m_pTCPClient->GetZeroCopySender();
+      ASSERT_TRUE(pSender != nullptr);
+      EXPECT_EQ(pSender->GetZeroCopySends(), uBuffers);
+      EXPECT_EQ(pSender->GetThresholdCopies(), uBuffers);
+      // over loopback, the kernel ends up copying the pages anyway
+      std::cout << "** sendmsg calls copied by the kernel : " << pSender->GetKernelCopies() << "\n";
+
+      size_t uOffset = 0;
+      for (size_t i = 0; i < uBuffers; ++i)
+      {
+         EXPECT_TRUE(std::equal(vecBuffers[i].begin(), vecBuffers[i].end(), RcvBuffer.begin() + uOffset));
+         uOffset += uBufferSize + uSmallSize;
+      }
+
+      // server -> client
+      EXPECT_TRUE(m_pTCPServer->EnableZeroCopy(ConnectedClient));
+      futReceive = std::async(std::launch::async, [&]()
+      {
+         return m_pTCPClient->Receive(RcvBuffer.data(), uBufferSize);
+      });
+
+      bool bReleased = false;
+      EXPECT_TRUE(m_pTCPServer->SendZeroCopy(ConnectedClient, vecBuffers[0].data(), uBufferSize,
+                                             [&] { bReleased = true; }));
+      EXPECT_EQ(futReceive.get(), static_cast<int>(uBufferSize));
+      for (int iWait = 0; iWait < 50 && !bReleased; ++iWait)
+         m_pTCPServer->PollZeroCopy(ConnectedClient, 100);
+
+      EXPECT_TRUE(bReleased);
+      EXPECT_EQ(m_pTCPServer->GetZeroCopyPending(ConnectedClient), 0u);
+      EXPECT_TRUE(std::equal(vecBuffers[0].begin(), vecBuffers[0].end(), RcvBuffer.begin()));
+
+      EXPECT_TRUE(m_pTCPClient->Disconnect());
+      EXPECT_TRUE(m_pTCPServer->Disconnect(ConnectedClient));
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPTest, BenchmarkSendFile)
+{
+   if (TCP_TEST_ENABLED && BENCHMARK_TEST_ENABLED)
+   {
+      const size_t uFileSize = 1024 * 1024 * 1024;
+
+      char szFileName[] = "/tmp/socket_cpp_sendfile_XXXXXX";
+      int iFileFd = mkstemp(szFileName);
+      ASSERT_GE(iFileFd, 0);
+      {
+         std::vector<char> Chunk(16 * 1024 * 1024);
+         std::generate(Chunk.begin(), Chunk.end(), [] { return (std::rand() % 256); });
+         for (size_t uWritten = 0; uWritten < uFileSize; uWritten += Chunk.size())
+            ASSERT_EQ(write(iFileFd, Chunk.data(), Chunk.size()), static_cast<ssize_t>(Chunk.size()));
+      }
+      close(iFileFd);
+
+      ASocket::Socket ConnectedClient;
+
+      ASSERT_NO_THROW(m_pTCPServer.reset(new CTCPServer(PRINT_LOG, TCP_SERVER_PORT)));
+
+      std::future<bool> futListen = std::async(std::launch::async,
+                                               [&] { return m_pTCPServer->Listen(ConnectedClient); });
+
+      // give time to let the server object reach the accept instruction.
+      SleepMs(500);
+
+      ASSERT_TRUE(m_pTCPClient->Connect("localhost", TCP_SERVER_PORT));
+      ASSERT_TRUE(futListen.get());
+
+      auto CPUSeconds = []() -> double
+      {
+         struct rusage Usage;
+         getrusage(RUSAGE_SELF, &Usage);
+         return Usage.ru_utime.tv_sec + Usage.ru_stime.tv_sec +
+                (Usage.ru_utime.tv_usec + Usage.ru_stime.tv_usec) / 1e6;
+      };
+
+      // the client drains the stream in 1 MB chunks, its cost is the same for both paths
+      auto Measure = [&](const char* szLabel, const std::function<bool()>& fnSend)
+      {
+         std::future<size_t> futReceive = std::async(std::launch::async, [&]() -> size_t
+         {
+            std::vector<char> RcvBuffer(1024 * 1024);
+            size_t uReceived = 0;
+            while (uReceived < uFileSize)
+            {
+               int nRecvd = m_pTCPClient->Receive(RcvBuffer.data(),
+                                                  std::min(RcvBuffer.size(), uFileSize - uReceived), false);
+               if (nRecvd <= 0)
+                  break;
+               uReceived += nRecvd;
+            }
+            return uReceived;
+         });
+
+         double dStartCPU = CPUSeconds();
+         auto StartTime = std::chrono::steady_clock::now();
+         EXPECT_TRUE(fnSend());
+         EXPECT_EQ(futReceive.get(), uFileSize);
+         double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+
+         std::cout << "** " << szLabel << " : " << uFileSize / dSeconds / 1e6 << " MB/s, "
+                   << CPUSeconds() - dStartCPU << " s of CPU\n";
+      };
+
+      // what SendFile replaces : the whole file is read into memory first
+      Measure("Send(std::vector)", [&]() -> bool
+      {
+         std::ifstream File(szFileName, std::ios::binary);
+         std::vector<char> FileData(uFileSize);
+         File.read(FileData.data(), uFileSize);
+         return m_pTCPServer->Send(ConnectedClient, FileData);
+      });
+
+      Measure("SendFile", [&]() -> bool
+      {
+         return m_pTCPServer->SendFile(ConnectedClient, szFileName);
+      });
+
+      unlink(szFileName);
+
+      EXPECT_TRUE(m_pTCPClient->Disconnect());
+      EXPECT_TRUE(m_pTCPServer->Disconnect(ConnectedClient));
+   }
+   else
+      std::cout << "TCP or benchmark tests are disabled !" << std::endl;
+}
+#endif
+
+TEST_F(TCPTest, TestPollSocketForReceivedBytes)
+{
+    if (TCP_TEST_ENABLED)
+    {
         srand(static_cast<unsigned>(time(nullptr)));
 
         const size_t tenMeg = 10 * 1024 * 1024;
@@ -413,15 +1042,39 @@ TEST_F(TCPTest, TestReceivingTimeout)
             [&] { return m_pTCPServer->Listen(ConnectedClient); });
 
         // give time to let the server object reach the accept instruction.
-        SleepMs(200);
+        SleepMs(500);
 
         ASSERT_TRUE(m_pTCPClient->Connect("localhost", "6669"));
         ASSERT_TRUE(futListen.get());
 
-        ASSERT_TRUE(m_pTCPClient->SetRcvTimeout(250));
+        auto ClientReceive = [&]() -> int {
+            const int chunkSize = 1024 * 1024; // 1 MB
+            int readBytes = 0;
+            int timeoutCount = 0;
 
-        auto ClientReceive = [&]() {
-            return m_pTCPClient->Receive(RcvBuffer.data(), tenMeg);
+            while (timeoutCount < 20)
+            {
+                int ret = ASocket::SelectSocket(m_pTCPClient->GetSocketDescriptor(), 300);
+
+                if (ret > 0)
+                {
+                    int readCount = m_pTCPClient->Receive(RcvBuffer.data() + readBytes, chunkSize);
+
+                    if (readCount == 0)
+                        break;
+
+                    readBytes += readCount;
+                }
+                else
+                {
+                    timeoutCount += 1;
+                }
+
+                if (readBytes >= tenMeg)
+                    break;
+            }
+
+            return readBytes;
         };
 
         // launch the receive in another thread to prevent server from
@@ -431,78 +1084,232 @@ TEST_F(TCPTest, TestReceivingTimeout)
         ASSERT_FALSE(ConnectedClient == INVALID_SOCKET);
 
         // server -> client
-        //EXPECT_TRUE(m_pTCPServer->Send(ConnectedClient, TenMbData)); // send nothing
+        EXPECT_TRUE(m_pTCPServer->Send(ConnectedClient, TenMbData));
 
         int nRcvdBytes = futClientReceive.get();
 
-        EXPECT_EQ(nRcvdBytes, -1);
+        EXPECT_EQ(nRcvdBytes, tenMeg);
+        EXPECT_TRUE(std::equal(TenMbData.begin(), TenMbData.end(), RcvBuffer.begin()));
 
-        m_pTCPServer->SetRcvTimeout(ConnectedClient, 250);
+        std::fill(RcvBuffer.begin(), RcvBuffer.end(), 0);
 
         // client -> server
-        auto ServerReceive = [&]() {
-            return m_pTCPServer->Receive(ConnectedClient, RcvBuffer.data(), tenMeg);
+        auto ServerReceive = [&]() -> int {
+            const int chunkSize = 1024 * 1024; // 1 MB
+            int readBytes = 0;
+            int timeoutCount = 0;
+
+            while (timeoutCount < 20)
+            {
+                int ret = ASocket::SelectSocket(ConnectedClient, 300);
+
+                if (ret > 0)
+                {
+                    int readCount = m_pTCPServer->Receive(ConnectedClient, RcvBuffer.data() + readBytes, chunkSize);
+
+                    if (readCount == 0)
+                        break;
+
+                    readBytes += readCount;
+                }
+                else
+                {
+                    timeoutCount += 1;
+                }
+
+                if (readBytes >= tenMeg)
+                    break;
+            }
+
+            return readBytes;
         };
         std::future<int> futServerReceive = std::async(std::launch::async, ServerReceive);
 
-        //EXPECT_TRUE(m_pTCPClient->Send(TenMbData));
+        EXPECT_TRUE(m_pTCPClient->Send(TenMbData));
         nRcvdBytes = futServerReceive.get();
 
-        EXPECT_EQ(nRcvdBytes, -1);
+        EXPECT_EQ(nRcvdBytes, tenMeg);
+        EXPECT_TRUE(std::equal(TenMbData.begin(), TenMbData.end(), RcvBuffer.begin()));
 
         // disconnect
         EXPECT_TRUE(m_pTCPClient->Disconnect());
-        //EXPECT_TRUE(m_pTCPServer->Disconnect(ConnectedClient)); // OK tested
     }
     else
         std::cout << "TCP tests are disabled !" << std::endl;
 }
 
-TEST_F(TCPTest, TestSuccessfulListenWithTimeout)
+TEST_F(TCPTest, TestPollSocketTimeout)
 {
-   if (TCP_TEST_ENABLED)
-   {
-      srand(static_cast<unsigned>(time(nullptr)));
+    if (TCP_TEST_ENABLED)
+    {
+        ASocket::Socket ConnectedClient;
 
-      const size_t oneMeg = 1024*1024;
-      std::vector<char> OneMbData(oneMeg);
-      std::vector<char> RcvBuffer(oneMeg);
-      std::generate (OneMbData.begin(), OneMbData.end(), []{ return (std::rand() % 256); });
+        ASSERT_NO_THROW(m_pTCPServer.reset(new CTCPServer(PRINT_LOG, TCP_SERVER_PORT)));
 
-      ASocket::Socket ConnectedClient;
+        // Not always starts a new thread, std::launch::async must be passed to force it.
+        std::future<bool> futListen = std::async(std::launch::async,
+            [&] { return m_pTCPServer->Listen(ConnectedClient); });
 
-      ASSERT_NO_THROW(m_pTCPServer.reset(new CTCPServer(PRINT_LOG, TCP_SERVER_PORT)));
+        // give time to let the server object reach the accept instruction.
+        SleepMs(100);
 
-      #ifdef WINDOWS
-      // Not always starts a new thread, std::launch::async must be passed to force it.
-      std::future<bool> futListen = std::async(std::launch::async,
-                                               [&]
-                                               {
-                                                  return m_pTCPServer->Listen(ConnectedClient,
-                                                                              1000);
-                                               });
-      #else
-      auto ListenTask = [&] { return m_pTCPServer->Listen(ConnectedClient, 1000); }; // 1 sec max wait
-      std::packaged_task< bool(void) > packageListen { ListenTask };
-      std::future<bool> futListen = packageListen.get_future();
-      std::thread ListenThread { std::move(packageListen) }; // pack. task is not copyable
-      #endif
+        ASSERT_TRUE(m_pTCPClient->Connect("localhost", "6669"));
+        ASSERT_TRUE(futListen.get());
 
-      // client side
-      // give time to let the server object reach the accept instruction.
-      SleepMs(100);
+        auto ClientReceive = [&](){
+            int timeoutCount = 0;
 
-      ASSERT_TRUE(m_pTCPClient->Connect("localhost", "6669"));
-      #ifdef WINDOWS
-      ASSERT_TRUE(futListen.get());
-      #else
-      /* with std::thread we can't easily get the result of Listen
-       * unlike std::async/promise/packaged_task
-       */
-      ASSERT_TRUE(futListen.get());
-      ListenThread.join();
-      #endif
-      ASSERT_FALSE(ConnectedClient == INVALID_SOCKET);
+            while (timeoutCount < 10)
+            {
+                int ret = ASocket::SelectSocket(m_pTCPClient->GetSocketDescriptor(), 50);
+                ASSERT_EQ(ret, 0);
+                timeoutCount += 1;
+            }
+        };
+
+        // launch the receive in another thread to prevent server from
+        // hanging when sending "many" bytes.
+        std::future<void> futClientReceive = std::async(std::launch::async, ClientReceive);
+
+        ASSERT_FALSE(ConnectedClient == INVALID_SOCKET);
+
+        // do not send anything from the server to the client
+
+        futClientReceive.get();
+
+        // client -> server
+        auto ServerReceive = [&](){
+            int timeoutCount = 0;
+
+            while (timeoutCount < 10)
+            {
+                int ret = ASocket::SelectSocket(ConnectedClient, 50);
+                ASSERT_EQ(ret, 0);
+                timeoutCount += 1;
+            }
+        };
+        std::future<void> futServerReceive = std::async(std::launch::async, ServerReceive);
+
+        // do not send anything from the client to the server
+        futServerReceive.get();
+
+        // disconnect
+        EXPECT_TRUE(m_pTCPClient->Disconnect());
+    }
+    else
+        std::cout << "TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPTest, TestReceivingTimeout)
+{
+    if (TCP_TEST_ENABLED)
+    {
+        srand(static_cast<unsigned>(time(nullptr)));
+
+        const size_t tenMeg = 10 * 1024 * 1024;
+        std::vector<char> TenMbData(tenMeg);
+        std::vector<char> RcvBuffer(tenMeg);
+        std::generate(TenMbData.begin(), TenMbData.end(), [] { return (std::rand() % 256); });
+
+        ASocket::Socket ConnectedClient;
+
+        ASSERT_NO_THROW(m_pTCPServer.reset(new CTCPServer(PRINT_LOG, TCP_SERVER_PORT)));
+
+        // Not always starts a new thread, std::launch::async must be passed to force it.
+        std::future<bool> futListen = std::async(std::launch::async,
+            [&] { return m_pTCPServer->Listen(ConnectedClient); });
+
+        // give time to let the server object reach the accept instruction.
+        SleepMs(200);
+
+        ASSERT_TRUE(m_pTCPClient->Connect("localhost", "6669"));
+        ASSERT_TRUE(futListen.get());
+
+        ASSERT_TRUE(m_pTCPClient->SetRcvTimeout(250));
+
+        auto ClientReceive = [&]() {
+            return m_pTCPClient->Receive(RcvBuffer.data(), tenMeg);
+        };
+
+        // launch the receive in another thread to prevent server from
+        // hanging when sending "many" bytes.
+        std::future<int> futClientReceive = std::async(std::launch::async, ClientReceive);
+
+        ASSERT_FALSE(ConnectedClient == INVALID_SOCKET);
+
+        // server -> client
+        //EXPECT_TRUE(m_pTCPServer->Send(ConnectedClient, TenMbData)); // send nothing
+
+        int nRcvdBytes = futClientReceive.get();
+
+        EXPECT_EQ(nRcvdBytes, -1);
+
+        m_pTCPServer->SetRcvTimeout(ConnectedClient, 250);
+
+        // client -> server
+        auto ServerReceive = [&]() {
+            return m_pTCPServer->Receive(ConnectedClient, RcvBuffer.data(), tenMeg);
+        };
+        std::future<int> futServerReceive = std::async(std::launch::async, ServerReceive);
+
+        //EXPECT_TRUE(m_pTCPClient->Send(TenMbData));
+        nRcvdBytes = futServerReceive.get();
+
+        EXPECT_EQ(nRcvdBytes, -1);
+
+        // disconnect
+        EXPECT_TRUE(m_pTCPClient->Disconnect());
+        //EXPECT_TRUE(m_pTCPServer->Disconnect(ConnectedClient)); // OK tested
+    }
+    else
+        std::cout << "TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPTest, TestSuccessfulListenWithTimeout)
+{
+   if (TCP_TEST_ENABLED)
+   {
+      srand(static_cast<unsigned>(time(nullptr)));
+
+      const size_t oneMeg = 1024*1024;
+      std::vector<char> OneMbData(oneMeg);
+      std::vector<char> RcvBuffer(oneMeg);
+      std::generate (OneMbData.begin(), OneMbData.end(), []{ return (std::rand() % 256); });
+
+      ASocket::Socket ConnectedClient;
+
+      ASSERT_NO_THROW(m_pTCPServer.reset(new CTCPServer(PRINT_LOG, TCP_SERVER_PORT)));
+
+      #ifdef WINDOWS
+      // Not always starts a new thread, std::launch::async must be passed to force it.
+      std::future<bool> futListen = std::async(std::launch::async,
+                                               [&]
+                                               {
+                                                  return m_pTCPServer->Listen(ConnectedClient,
+                                                                              1000);
+                                               });
+      #else
+      auto ListenTask = [&] { return m_pTCPServer->Listen(ConnectedClient, 1000); }; // 1 sec max wait
+      std::packaged_task< bool(void) > packageListen { ListenTask };
+      std::future<bool> futListen = packageListen.get_future();
+      std::thread ListenThread { std::move(packageListen) }; // pack. task is not copyable
+      #endif
+
+      // client side
+      // give time to let the server object reach the accept instruction.
+      SleepMs(100);
+
+      ASSERT_TRUE(m_pTCPClient->Connect("localhost", "6669"));
+      #ifdef WINDOWS
+      ASSERT_TRUE(futListen.get());
+      #else
+      /* with std::thread we can't easily get the result of Listen
+       * unlike std::async/promise/packaged_task
+       */
+      ASSERT_TRUE(futListen.get());
+      ListenThread.join();
+      #endif
+      ASSERT_FALSE(ConnectedClient == INVALID_SOCKET);
 
       // server -> client
       EXPECT_TRUE(m_pTCPServer->Send(ConnectedClient, OneMbData));
@@ -524,21 +1331,2215 @@ TEST_F(TCPTest, TestSuccessfulListenWithTimeout)
       std::cout << "TCP tests are disabled !" << std::endl;
 }
 
-TEST_F(TCPTest, TestListenFailureWithTimeout)
+TEST_F(TCPTest, TestListenFailureWithTimeout)
+{
+   if (TCP_TEST_ENABLED)
+   {
+      ASocket::Socket ConnectedClient;
+
+      ASSERT_NO_THROW(m_pTCPServer.reset(new CTCPServer(PRINT_LOG, TCP_SERVER_PORT)));
+
+      ASSERT_FALSE(m_pTCPServer->Listen(ConnectedClient, 3000)); // 3 sec max wait
+
+      ASSERT_TRUE(ConnectedClient == INVALID_SOCKET);
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPTest, TestDnsCache)
+{
+   if (TCP_TEST_ENABLED)
+   {
+      CDnsCache::Clear();
+      std::vector<CDnsCache::Address> vecAddresses;
+      CDnsCache::Stats oBefore = CDnsCache::GetStats();
+
+      // literal addresses never reach the resolver
+      ASSERT_EQ(0, CDnsCache::Resolve("127.0.0.1", TCP_SERVER_PORT, AF_INET, vecAddresses));
+      ASSERT_EQ(1u, vecAddresses.size());
+      EXPECT_EQ(AF_INET, vecAddresses[0].m_iFamily);
+      EXPECT_EQ(htons(static_cast<unsigned short>(std::stoi(TCP_SERVER_PORT))),
+                reinterpret_cast<const sockaddr_in*>(vecAddresses[0].GetSockAddr())->sin_port);
+      ASSERT_EQ(0, CDnsCache::Resolve("::1", "443", AF_UNSPEC, vecAddresses));
+      EXPECT_EQ(AF_INET6, vecAddresses[0].m_iFamily);
+
+      CDnsCache::Stats oAfter = CDnsCache::GetStats();
+      EXPECT_EQ(2u, oAfter.m_uNumericHits - oBefore.m_uNumericHits);
+      EXPECT_EQ(oBefore.m_uResolverCalls, oAfter.m_uResolverCalls);
+
+      // a name is resolved once, then served from the cache
+      std::vector<CDnsCache::Address> vecCached;
+      ASSERT_EQ(0, CDnsCache::Resolve("localhost", TCP_SERVER_PORT, AF_INET, vecAddresses));
+      ASSERT_EQ(0, CDnsCache::Resolve("localhost", TCP_SERVER_PORT, AF_INET, vecCached));
+      ASSERT_EQ(vecAddresses.size(), vecCached.size());
+      EXPECT_EQ(0, memcmp(&vecAddresses[0].m_SockAddr, &vecCached[0].m_SockAddr, vecCached[0].m_uSockAddrLen));
+
+      oBefore = oAfter;
+      oAfter = CDnsCache::GetStats();
+      EXPECT_EQ(1u, oAfter.m_uResolverCalls - oBefore.m_uResolverCalls);
+      EXPECT_EQ(1u, oAfter.m_uCacheHits - oBefore.m_uCacheHits);
+
+      // unknown hosts are remembered too (unless the resolver itself is unavailable)
+      const int iError = CDnsCache::Resolve("no-such-host.invalid", "80", AF_INET, vecAddresses);
+      EXPECT_NE(0, iError);
+      if (iError != EAI_AGAIN)
+      {
+         EXPECT_EQ(iError, CDnsCache::Resolve("no-such-host.invalid", "80", AF_INET, vecAddresses));
+         EXPECT_TRUE(vecAddresses.empty());
+         EXPECT_EQ(1u, CDnsCache::GetStats().m_uNegativeHits - oAfter.m_uNegativeHits);
+      }
+
+      // without a TTL, every lookup of a name is a resolver call
+      CDnsCache::SetTtl(0);
+      CDnsCache::Clear();
+      oBefore = CDnsCache::GetStats();
+      ASSERT_EQ(0, CDnsCache::Resolve("localhost", TCP_SERVER_PORT, AF_INET, vecAddresses));
+      ASSERT_EQ(0, CDnsCache::Resolve("localhost", TCP_SERVER_PORT, AF_INET, vecAddresses));
+      EXPECT_EQ(2u, CDnsCache::GetStats().m_uResolverCalls - oBefore.m_uResolverCalls);
+      CDnsCache::SetTtl(CDnsCache::DEFAULT_TTL_MS);
+
+      // Connect goes through the cache
+      ASocket::Socket ConnectedClient;
+      ASSERT_NO_THROW(m_pTCPServer.reset(new CTCPServer(PRINT_LOG, TCP_SERVER_PORT)));
+      std::future<bool> futListen = std::async(std::launch::async,
+                                               [&] { return m_pTCPServer->Listen(ConnectedClient, 3000); });
+      SleepMs(100);
+
+      oBefore = CDnsCache::GetStats();
+      ASSERT_TRUE(m_pTCPClient->Connect("127.0.0.1", TCP_SERVER_PORT));
+      ASSERT_TRUE(futListen.get());
+      oAfter = CDnsCache::GetStats();
+      EXPECT_EQ(oBefore.m_uResolverCalls, oAfter.m_uResolverCalls);
+      EXPECT_EQ(1u, oAfter.GetResolverCallsAvoided() - oBefore.GetResolverCallsAvoided());
+
+      EXPECT_TRUE(m_pTCPClient->Send("dns"));
+      char szReply[3] = {};
+      EXPECT_EQ(3, m_pTCPServer->Receive(ConnectedClient, szReply, 3));
+      EXPECT_TRUE(m_pTCPClient->Disconnect());
+      EXPECT_TRUE(m_pTCPServer->Disconnect(ConnectedClient));
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPTest, TestTimerWheel)
+{
+   if (TCP_TEST_ENABLED)
+   {
+      // the wheel is driven with a simulated clock
+      const CTimerWheel::TimePoint Start = CTimerWheel::Clock::now();
+      auto At = [&](const long long llMs) { return Start + std::chrono::milliseconds(llMs); };
+
+      CTimerWheel Wheel(1, Start);
+      std::vector<uint64_t> vecExpired;
+      auto OnExpired = [&](const CTimerWheel::TimerId, const uint64_t uCookie) { vecExpired.push_back(uCookie); };
+
+      // deadlines on every level of the wheel, and beyond its range
+      const size_t uHour = 3600 * 1000;
+      CTimerWheel::TimerId Short = Wheel.Arm(10, 1, At(0));
+      Wheel.Arm(300, 2, At(0));
+      Wheel.Arm(70000, 3, At(0));
+      Wheel.Arm(48 * uHour, 4, At(0));
+      CTimerWheel::TimerId Cancelled = Wheel.Arm(20, 5, At(0));
+      CTimerWheel::TimerId Moved = Wheel.Arm(20, 6, At(0));
+      Wheel.Arm(100 * 24 * uHour, 7, At(0)); // clamped to 2^32 ms
+      EXPECT_EQ(Wheel.GetCount(), 7u);
+
+      EXPECT_EQ(Wheel.GetTimeoutMs(At(0)), 10);
+      EXPECT_TRUE(Wheel.Cancel(Cancelled));
+      EXPECT_FALSE(Wheel.Cancel(Cancelled));
+      EXPECT_TRUE(Wheel.Rearm(Moved, 500, At(5)));
+
+      EXPECT_EQ(Wheel.Advance(At(9), OnExpired), 0u);
+      EXPECT_EQ(Wheel.Advance(At(10), OnExpired), 1u);
+      EXPECT_FALSE(Wheel.IsPending(Short));
+      EXPECT_FALSE(Wheel.Rearm(Short, 10, At(10)));
+
+      // a stale id doesn't reach the timer reusing its slot
+      CTimerWheel::TimerId Reused = Wheel.Arm(100, 8, At(10));
+      EXPECT_FALSE(Wheel.Cancel(Short));
+      EXPECT_FALSE(Wheel.Cancel(Cancelled));
+      EXPECT_TRUE(Wheel.IsPending(Reused));
+
+      EXPECT_EQ(Wheel.Advance(At(504), OnExpired), 2u);  // 110 and 300 ms
+      EXPECT_EQ(Wheel.Advance(At(505), OnExpired), 1u);  // moved to 505 ms
+      EXPECT_EQ(Wheel.Advance(At(69999), OnExpired), 0u);
+      EXPECT_EQ(Wheel.Advance(At(70000), OnExpired), 1u); // cascaded from level 1
+      EXPECT_EQ(Wheel.Advance(At(48 * uHour - 1), OnExpired), 0u);
+      EXPECT_EQ(Wheel.Advance(At(48 * uHour), OnExpired), 1u); // from level 3
+      EXPECT_EQ(Wheel.Advance(At(4294967294LL), OnExpired), 0u);
+      EXPECT_EQ(Wheel.Advance(At(4294967295LL), OnExpired), 1u);
+      EXPECT_EQ(vecExpired, std::vector<uint64_t>({ 1, 8, 2, 6, 3, 4, 7 }));
+      EXPECT_EQ(Wheel.GetCount(), 0u);
+      EXPECT_EQ(Wheel.GetTimeoutMs(), -1);
+
+      // callbacks may re-arm and cancel, even timers expiring in the same tick
+      const long long llNow = 4294967295LL;
+      vecExpired.clear();
+      CTimerWheel::TimerId First = Wheel.Arm(5, 10, At(llNow));
+      CTimerWheel::TimerId Second = Wheel.Arm(5, 11, At(llNow));
+      size_t uExpired = Wheel.Advance(At(llNow + 5), [&](const CTimerWheel::TimerId Id, const uint64_t uCookie)
+      {
+         vecExpired.push_back(uCookie);
+         Wheel.Cancel((Id == First) ? Second : First);
+         Wheel.Arm(1, uCookie + 10, At(llNow + 5));
+      });
+      EXPECT_EQ(uExpired, 1u);
+      EXPECT_EQ(Wheel.Advance(At(llNow + 6), OnExpired), 1u);
+      EXPECT_EQ(vecExpired.size(), 2u);
+      EXPECT_EQ(vecExpired[1], vecExpired[0] + 10);
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPTest, BenchmarkTimerWheel)
+{
+   if (BENCHMARK_TEST_ENABLED)
+   {
+      // per-connection deadlines of a loaded server : armed on accept, re-armed on each read
+      // (idle timeout), cancelled on close, or expiring
+      const size_t uTimers = 1000000;
+      const size_t uRearms = 5000000;
+      const CTimerWheel::TimePoint Start = CTimerWheel::Clock::now();
+
+      std::mt19937 Generator(42);
+      std::vector<size_t> vecDelays(uRearms);
+      std::vector<size_t> vecTargets(uRearms);
+      for (size_t i = 0; i < uRearms; ++i)
+      {
+         vecDelays[i] = 1000 + Generator() % 59000;
+         vecTargets[i] = Generator() % uTimers;
+      }
+
+      auto Elapsed = [](const std::chrono::steady_clock::time_point StartTime, const size_t uOps)
+      {
+         return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - StartTime).count() / uOps;
+      };
+
+      auto Report = [](const char* szName, const double dArm, const double dRearm, const double dCancel, const double dExpire)
+      {
+         std::cout << "** " << szName << " : arm " << dArm << " ns, re-arm " << dRearm << " ns, cancel "
+                   << dCancel << " ns, expiry " << dExpire << " ns (per timer)\n";
+      };
+
+      std::cout << "** " << uTimers << " timers, " << uRearms << " re-arms\n";
+
+      // a sorted multimap keyed by deadline, as CSSLHandshakeDriver used to keep them
+      {
+         typedef std::multimap<CTimerWheel::TimePoint, size_t> DeadlineMap;
+         DeadlineMap mapDeadlines;
+         std::vector<DeadlineMap::iterator> vecTimers(uTimers);
+
+         auto StartTime = std::chrono::steady_clock::now();
+         for (size_t i = 0; i < uTimers; ++i)
+            vecTimers[i] = mapDeadlines.emplace(Start + std::chrono::milliseconds(vecDelays[i]), i);
+         const double dArm = Elapsed(StartTime, uTimers);
+
+         // the simulated clock moves 1 ms every 1000 re-arms
+         StartTime = std::chrono::steady_clock::now();
+         for (size_t i = 0; i < uRearms; ++i)
+         {
+            const size_t uTimer = vecTargets[i];
+            mapDeadlines.erase(vecTimers[uTimer]);
+            vecTimers[uTimer] = mapDeadlines.emplace(Start + std::chrono::milliseconds(i / 1000 + vecDelays[i]), uTimer);
+         }
+         const double dRearm = Elapsed(StartTime, uRearms);
+
+         StartTime = std::chrono::steady_clock::now();
+         for (size_t i = 0; i < uTimers / 2; ++i)
+            mapDeadlines.erase(vecTimers[i]);
+         const double dCancel = Elapsed(StartTime, uTimers / 2);
+
+         StartTime = std::chrono::steady_clock::now();
+         size_t uExpired = 0;
+         for (long long llMs = 0; !mapDeadlines.empty(); llMs += 10)
+         {
+            const CTimerWheel::TimePoint Now = Start + std::chrono::milliseconds(llMs);
+            while (!mapDeadlines.empty() && mapDeadlines.begin()->first <= Now)
+            {
+               mapDeadlines.erase(mapDeadlines.begin());
+               ++uExpired;
+            }
+         }
+         EXPECT_EQ(uExpired, uTimers - uTimers / 2);
+         Report("multimap", dArm, dRearm, dCancel, Elapsed(StartTime, uExpired));
+      }
+
+      {
+         CTimerWheel Wheel(1, Start);
+         Wheel.Reserve(uTimers);
+         std::vector<CTimerWheel::TimerId> vecTimers(uTimers);
+
+         auto StartTime = std::chrono::steady_clock::now();
+         for (size_t i = 0; i < uTimers; ++i)
+            vecTimers[i] = Wheel.Arm(vecDelays[i], i, Start);
+         const double dArm = Elapsed(StartTime, uTimers);
+
+         StartTime = std::chrono::steady_clock::now();
+         for (size_t i = 0; i < uRearms; ++i)
+            Wheel.Rearm(vecTimers[vecTargets[i]], vecDelays[i], Start + std::chrono::milliseconds(i / 1000));
+         const double dRearm = Elapsed(StartTime, uRearms);
+
+         StartTime = std::chrono::steady_clock::now();
+         for (size_t i = 0; i < uTimers / 2; ++i)
+            Wheel.Cancel(vecTimers[i]);
+         const double dCancel = Elapsed(StartTime, uTimers / 2);
+
+         StartTime = std::chrono::steady_clock::now();
+         size_t uExpired = 0;
+         for (long long llMs = 0; Wheel.GetCount() > 0; llMs += 10)
+            uExpired += Wheel.Advance(Start + std::chrono::milliseconds(llMs), nullptr);
+         EXPECT_EQ(uExpired, uTimers - uTimers / 2);
+         Report("timer wheel", dArm, dRearm, dCancel, Elapsed(StartTime, uExpired));
+      }
+   }
+   else
+      std::cout << "Benchmark tests are disabled !" << std::endl;
+}
+
+#ifndef WINDOWS
+TEST_F(TCPTest, TestConnectWithTimeout)
+{
+   if (TCP_TEST_ENABLED)
+   {
+      ASocket::Socket ConnectedClient;
+      ASSERT_NO_THROW(m_pTCPServer.reset(new CTCPServer(PRINT_LOG, TCP_SERVER_PORT)));
+      const std::string strLoopback = "127.0.0.1:" + TCP_SERVER_PORT;
+
+      // the server listens on IPv4 only : if localhost resolves to ::1 too, that attempt is refused
+      std::future<bool> futListen = std::async(std::launch::async,
+                                               [&] { return m_pTCPServer->Listen(ConnectedClient, 3000); });
+      SleepMs(100);
+
+      ASSERT_TRUE(m_pTCPClient->Connect("localhost", TCP_SERVER_PORT, 2000));
+      ASSERT_TRUE(futListen.get());
+      EXPECT_EQ(strLoopback, m_pTCPClient->GetConnectedAddress().ToString());
+
+      // the connection is back in blocking mode
+      EXPECT_TRUE(m_pTCPServer->Send(ConnectedClient, "ok"));
+      char szReply[2] = {};
+      EXPECT_EQ(2, m_pTCPClient->Receive(szReply, 2));
+      EXPECT_TRUE(m_pTCPClient->Disconnect());
+      EXPECT_TRUE(m_pTCPServer->Disconnect(ConnectedClient));
+
+      /* a listener whose accept queue is full drops the SYNs : a connection to it stays pending
+       * like one to an unreachable host */
+      ASocket::Socket Silent = socket(AF_INET, SOCK_STREAM, 0);
+      ASSERT_GE(Silent, 0);
+      sockaddr_in SilentAddr = {};
+      SilentAddr.sin_family = AF_INET;
+      SilentAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      socklen_t SilentAddrLen = sizeof(SilentAddr);
+      ASSERT_EQ(0, bind(Silent, reinterpret_cast<sockaddr*>(&SilentAddr), sizeof(SilentAddr)));
+      ASSERT_EQ(0, listen(Silent, 0));
+      ASSERT_EQ(0, getsockname(Silent, reinterpret_cast<sockaddr*>(&SilentAddr), &SilentAddrLen));
+      const std::string strSilentPort = std::to_string(ntohs(SilentAddr.sin_port));
+
+      std::vector<std::unique_ptr<CTCPClient>> vecFillers;
+      for (int i = 0; i < 4; ++i)
+      {
+         vecFillers.emplace_back(new CTCPClient(PRINT_LOG, ASocket::NO_FLAGS));
+         if (!vecFillers.back()->Connect("127.0.0.1", strSilentPort, 200))
+            break;
+      }
+
+      // the silent address first : the loopback one is tried after the attempt delay and wins the race
+      std::vector<CDnsCache::Address> vecAddresses(2);
+      ASSERT_TRUE(CDnsCache::ParseNumeric("127.0.0.1", strSilentPort, AF_INET, vecAddresses[0]));
+      ASSERT_TRUE(CDnsCache::ParseNumeric("127.0.0.1", TCP_SERVER_PORT, AF_INET, vecAddresses[1]));
+
+      futListen = std::async(std::launch::async, [&] { return m_pTCPServer->Listen(ConnectedClient, 3000); });
+      SleepMs(100);
+
+      m_pTCPClient->SetConnectionAttemptDelay(100);
+      auto StartTime = std::chrono::steady_clock::now();
+      ASSERT_TRUE(m_pTCPClient->Connect(vecAddresses, 2000));
+      auto ElapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - StartTime).count();
+      ASSERT_TRUE(futListen.get());
+      EXPECT_EQ(strLoopback, m_pTCPClient->GetConnectedAddress().ToString());
+      EXPECT_GE(ElapsedMs, 90);
+      EXPECT_LT(ElapsedMs, 1000);
+      std::cout << "** raced connection established in " << ElapsedMs << " ms" << std::endl;
+
+      EXPECT_TRUE(m_pTCPClient->Disconnect());
+      EXPECT_TRUE(m_pTCPServer->Disconnect(ConnectedClient));
+
+      // the deadline bounds an attempt the kernel would retry for minutes
+      vecAddresses.resize(1);
+      StartTime = std::chrono::steady_clock::now();
+      EXPECT_FALSE(m_pTCPClient->Connect(vecAddresses, 300));
+      ElapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - StartTime).count();
+      EXPECT_GE(ElapsedMs, 290);
+      EXPECT_LT(ElapsedMs, 1000);
+      EXPECT_FALSE(m_pTCPClient->IsConnected());
+
+      vecFillers.clear();
+      close(Silent);
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
+}
+#endif
+
+#ifdef LINUX
+TEST_F(TCPTest, TestSocketMultiplexer)
+{
+   if (TCP_TEST_ENABLED)
+   {
+      int Pairs[3][2];
+      for (auto& Pair : Pairs)
+         ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, Pair));
+
+      CSocketMultiplexer Multiplexer(PRINT_LOG);
+      ASSERT_TRUE(Multiplexer.IsValid());
+
+      // without any socket, Wait still waits for the timeout
+      {
+         std::vector<CSocketMultiplexer::Event> vecNone;
+         const auto StartTime = std::chrono::steady_clock::now();
+         EXPECT_EQ(0, Multiplexer.Wait(vecNone, 50));
+         EXPECT_GE(std::chrono::steady_clock::now() - StartTime, std::chrono::milliseconds(45));
+      }
+
+      for (auto& Pair : Pairs)
+         ASSERT_TRUE(Multiplexer.Add(Pair[0]));
+      EXPECT_FALSE(Multiplexer.Add(Pairs[0][0])); // already registered
+      EXPECT_EQ(3u, Multiplexer.GetSocketCount());
+
+      std::vector<CSocketMultiplexer::Event> vecReady;
+      EXPECT_EQ(0, Multiplexer.Wait(vecReady, 0));
+      EXPECT_TRUE(vecReady.empty());
+
+      // every ready socket is returned by one call, the data stays until it's read (level-triggered)
+      ASSERT_EQ(1, write(Pairs[0][1], "a", 1));
+      ASSERT_EQ(1, write(Pairs[2][1], "c", 1));
+      for (int iPass = 0; iPass < 2; ++iPass)
+      {
+         ASSERT_EQ(2, Multiplexer.Wait(vecReady, 1000));
+         std::sort(vecReady.begin(), vecReady.end(), [](const CSocketMultiplexer::Event& A, const CSocketMultiplexer::Event& B)
+                   { return A.m_Socket < B.m_Socket; });
+         EXPECT_EQ(Pairs[0][0], vecReady[0].m_Socket);
+         EXPECT_EQ(Pairs[2][0], vecReady[1].m_Socket);
+         EXPECT_EQ(static_cast<unsigned>(CSocketMultiplexer::EVENT_READ), vecReady[0].m_uFlags);
+      }
+
+      char cByte;
+      ASSERT_EQ(1, read(Pairs[0][0], &cByte, 1));
+      ASSERT_EQ(1, read(Pairs[2][0], &cByte, 1));
+      EXPECT_EQ(0, Multiplexer.Wait(vecReady, 50));
+
+      // writability on demand
+      ASSERT_TRUE(Multiplexer.Modify(Pairs[1][0], CSocketMultiplexer::EVENT_READ | CSocketMultiplexer::EVENT_WRITE));
+      ASSERT_EQ(1, Multiplexer.Wait(vecReady, 1000));
+      EXPECT_EQ(Pairs[1][0], vecReady[0].m_Socket);
+      EXPECT_EQ(static_cast<unsigned>(CSocketMultiplexer::EVENT_WRITE), vecReady[0].m_uFlags);
+      ASSERT_TRUE(Multiplexer.Modify(Pairs[1][0], CSocketMultiplexer::EVENT_READ));
+
+      // the peer's shutdown makes the socket readable
+      close(Pairs[1][1]);
+      ASSERT_EQ(1, Multiplexer.Wait(vecReady, 1000));
+      EXPECT_EQ(Pairs[1][0], vecReady[0].m_Socket);
+      EXPECT_TRUE(vecReady[0].m_uFlags & CSocketMultiplexer::EVENT_READ);
+      EXPECT_EQ(0, read(Pairs[1][0], &cByte, 1));
+
+      EXPECT_TRUE(Multiplexer.Remove(Pairs[1][0]));
+      EXPECT_FALSE(Multiplexer.Remove(Pairs[1][0]));
+      EXPECT_EQ(0, Multiplexer.Wait(vecReady, 0));
+      EXPECT_EQ(2u, Multiplexer.GetSocketCount());
+
+      // descriptors above FD_SETSIZE, which select can't watch
+      struct rlimit FdLimit;
+      ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &FdLimit), 0);
+      FdLimit.rlim_cur = FdLimit.rlim_max;
+      setrlimit(RLIMIT_NOFILE, &FdLimit);
+      const int HighFd = fcntl(Pairs[2][0], F_DUPFD, FD_SETSIZE + 16);
+      if (HighFd >= 0)
+      {
+         ASSERT_EQ(1, write(Pairs[2][1], "c", 1));
+         EXPECT_EQ(1, ASocket::SelectSocket(HighFd, 1000));
+         size_t uSelected = 0;
+         const ASocket::Socket Sockets[] = { Pairs[0][0], HighFd };
+         EXPECT_EQ(1, ASocket::SelectSockets(Sockets, 2, 1000, uSelected));
+         EXPECT_EQ(1u, uSelected);
+         close(HighFd);
+      }
+      else
+         std::cout << "** RLIMIT_NOFILE is too low to test descriptors above FD_SETSIZE\n";
+
+      for (auto& Pair : Pairs)
+      {
+         close(Pair[0]);
+         if (&Pair != &Pairs[1])
+            close(Pair[1]);
+      }
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPTest, TestAcceptBatch)
+{
+   if (TCP_TEST_ENABLED)
+   {
+      ASSERT_NO_THROW(m_pTCPServer.reset(new CTCPServer(PRINT_LOG, TCP_SERVER_PORT)));
+      m_pTCPServer->SetBacklog(64);
+
+      // the first call starts listening, nothing is queued yet
+      std::vector<ASocket::Socket> vecAccepted;
+      ASSERT_EQ(0, m_pTCPServer->AcceptBatch(vecAccepted, 16));
+
+      // the handshakes complete in the kernel, the connections wait in the accept queue
+      const size_t uClients = 50;
+      std::vector<std::unique_ptr<CTCPClient>> vecClients;
+      for (size_t i = 0; i < uClients; ++i)
+      {
+         vecClients.emplace_back(new CTCPClient(PRINT_LOG, ASocket::NO_FLAGS));
+         ASSERT_TRUE(vecClients.back()->Connect("127.0.0.1", TCP_SERVER_PORT));
+      }
+
+      CTCPServer::AcceptQueueStats oStats;
+      ASSERT_TRUE(m_pTCPServer->GetAcceptQueueStats(oStats));
+      EXPECT_EQ(uClients, oStats.m_uQueued);
+      EXPECT_EQ(64u, oStats.m_uBacklog);
+
+      ASSERT_EQ(16, m_pTCPServer->AcceptBatch(vecAccepted, 16));
+      ASSERT_EQ(static_cast<int>(uClients - 16), m_pTCPServer->AcceptBatch(vecAccepted, 1000));
+      ASSERT_EQ(0, m_pTCPServer->AcceptBatch(vecAccepted, 1000));
+      ASSERT_EQ(uClients, vecAccepted.size());
+
+      ASSERT_TRUE(m_pTCPServer->GetAcceptQueueStats(oStats));
+      EXPECT_EQ(0u, oStats.m_uQueued);
+
+      for (const ASocket::Socket Client : vecAccepted)
+      {
+         EXPECT_TRUE(fcntl(Client, F_GETFL, 0) & O_NONBLOCK);
+         EXPECT_TRUE(fcntl(Client, F_GETFD, 0) & FD_CLOEXEC);
+      }
+
+      // the sockets belong to the clients, in order
+      ASSERT_TRUE(vecClients[0]->Send("first"));
+      char szReceived[5] = {};
+      ASSERT_EQ(1, ASocket::SelectSocket(vecAccepted[0], 1000));
+      EXPECT_EQ(5, m_pTCPServer->Receive(vecAccepted[0], szReceived, 5));
+      EXPECT_EQ("first", std::string(szReceived, 5));
+
+      // waits for the first client when asked to
+      auto StartTime = std::chrono::steady_clock::now();
+      EXPECT_EQ(0, m_pTCPServer->AcceptBatch(vecAccepted, 1, 100));
+      EXPECT_GE(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - StartTime).count(), 90);
+
+      // Listen still blocks until a client arrives, although the listen socket is now non-blocking
+      ASocket::Socket ConnectedClient;
+      std::future<bool> futListen = std::async(std::launch::async, [&] { return m_pTCPServer->Listen(ConnectedClient); });
+      SleepMs(100);
+      ASSERT_TRUE(m_pTCPClient->Connect("127.0.0.1", TCP_SERVER_PORT));
+      ASSERT_TRUE(futListen.get());
+      EXPECT_TRUE(m_pTCPServer->Disconnect(ConnectedClient));
+      EXPECT_TRUE(m_pTCPClient->Disconnect());
+
+      for (const ASocket::Socket Client : vecAccepted)
+         m_pTCPServer->Disconnect(Client);
+      vecAccepted.clear();
+      vecClients.clear();
+
+      // a full queue drops the next connections, they are counted as overflows
+      ASSERT_NO_THROW(m_pTCPServer.reset(new CTCPServer(PRINT_LOG, TCP_SERVER_PORT)));
+      m_pTCPServer->SetBacklog(1);
+      ASSERT_EQ(0, m_pTCPServer->AcceptBatch(vecAccepted, 16));
+
+      size_t uQueued = 0;
+      for (size_t i = 0; i < 4; ++i)
+      {
+         vecClients.emplace_back(new CTCPClient(PRINT_LOG, ASocket::NO_FLAGS));
+         if (vecClients.back()->Connect("127.0.0.1", TCP_SERVER_PORT, 300))
+            ++uQueued;
+      }
+      EXPECT_LT(uQueued, 4u);
+
+      ASSERT_TRUE(m_pTCPServer->GetAcceptQueueStats(oStats));
+      EXPECT_EQ(uQueued, oStats.m_uQueued);
+      EXPECT_EQ(1u, oStats.m_uBacklog);
+      EXPECT_GE(oStats.m_ullOverflows, 1u);
+      std::cout << "** backlog 1 : " << uQueued << " queued, " << oStats.m_ullOverflows << " overflow(s), "
+                << oStats.m_ullDrops << " drop(s)" << std::endl;
+
+      EXPECT_EQ(static_cast<int>(uQueued), m_pTCPServer->AcceptBatch(vecAccepted, 16));
+      for (const ASocket::Socket Client : vecAccepted)
+         m_pTCPServer->Disconnect(Client);
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPTest, TestSocketOptions)
+{
+   if (TCP_TEST_ENABLED)
+   {
+      EXPECT_TRUE(CSocketOptions().IsEmpty());
+      EXPECT_FALSE(m_pTCPClient->ApplySocketOptions(CSocketOptions().SetNoDelay(true)));
+
+      m_pTCPClient->SetSocketOptions(CSocketOptions().SetSendBufferSize(128 * 1024)
+                                                     .SetReceiveBufferSize(128 * 1024)
+                                                     .SetNoDelay(true)
+                                                     .SetNotSentLowAt(16 * 1024)
+                                                     .SetCongestionControl("reno")
+                                                     .SetPriority(3)
+                                                     .SetTypeOfService(0x10));
+
+      ASSERT_NO_THROW(m_pTCPServer.reset(new CTCPServer(PRINT_LOG, TCP_SERVER_PORT)));
+      m_pTCPServer->SetSocketOptions(CSocketOptions().SetNoDelay(true).SetCork(true).SetLinger(2));
+
+      ASocket::Socket ConnectedClient;
+      std::future<bool> futListen = std::async(std::launch::async, [&] { return m_pTCPServer->Listen(ConnectedClient); });
+      SleepMs(100);
+      ASSERT_TRUE(m_pTCPClient->Connect("127.0.0.1", TCP_SERVER_PORT));
+      ASSERT_TRUE(futListen.get());
+
+      // the effective values : the kernel doubles the buffer sizes
+      CSocketOptions oEffective;
+      ASSERT_TRUE(CSocketOptions::Read(m_pTCPClient->GetSocketDescriptor(), oEffective));
+      EXPECT_GE(oEffective.m_SendBufferSize.m_Value, 128 * 1024);
+      EXPECT_GE(oEffective.m_ReceiveBufferSize.m_Value, 128 * 1024);
+      EXPECT_TRUE(oEffective.m_NoDelay.m_Value);
+      EXPECT_FALSE(oEffective.m_Cork.m_Value);
+      EXPECT_EQ(16u * 1024u, oEffective.m_NotSentLowAt.m_Value);
+      EXPECT_EQ("reno", oEffective.m_CongestionControl.m_Value);
+      EXPECT_EQ(3, oEffective.m_Priority.m_Value);
+      EXPECT_EQ(0x10, oEffective.m_TypeOfService.m_Value);
+      EXPECT_EQ(-1, oEffective.m_Linger.m_Value);
+
+      ASSERT_TRUE(CSocketOptions::Read(ConnectedClient, oEffective));
+      EXPECT_TRUE(oEffective.m_NoDelay.m_Value);
+      EXPECT_TRUE(oEffective.m_Cork.m_Value);
+      EXPECT_EQ(2, oEffective.m_Linger.m_Value);
+
+      // a corked partial frame is held until it's flushed (or for 200 ms)
+      ASSERT_TRUE(m_pTCPServer->Send(ConnectedClient, "corked"));
+      EXPECT_EQ(0, ASocket::SelectSocket(m_pTCPClient->GetSocketDescriptor(), 50));
+      ASSERT_TRUE(m_pTCPServer->Flush(ConnectedClient));
+      ASSERT_EQ(1, ASocket::SelectSocket(m_pTCPClient->GetSocketDescriptor(), 1000));
+      char szReceived[6] = {};
+      EXPECT_EQ(6, m_pTCPClient->Receive(szReceived, 6));
+      EXPECT_EQ("corked", std::string(szReceived, 6));
+
+      // an unknown algorithm fails without preventing the other options from being applied
+      EXPECT_FALSE(m_pTCPClient->ApplySocketOptions(CSocketOptions().SetCongestionControl("no-such-algorithm")
+                                                                    .SetNoDelay(false)
+                                                                    .SetQuickAck(true)));
+      ASSERT_TRUE(CSocketOptions::Read(m_pTCPClient->GetSocketDescriptor(), oEffective));
+      EXPECT_FALSE(oEffective.m_NoDelay.m_Value);
+      EXPECT_EQ("reno", oEffective.m_CongestionControl.m_Value);
+
+      EXPECT_TRUE(m_pTCPServer->Disconnect(ConnectedClient));
+      EXPECT_TRUE(m_pTCPClient->Disconnect());
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPTest, TestUnixSocket)
+{
+   if (TCP_TEST_ENABLED)
+   {
+      const std::string strPath = "/tmp/socket_cpp_test_" + std::to_string(getpid()) + ".sock";
+
+      // same semantics as TCP : Listen with a timeout, then Send/Receive both ways
+      std::unique_ptr<CUnixServer> pServer(new CUnixServer(PRINT_LOG, strPath));
+      ASocket::Socket ConnectedClient;
+      EXPECT_FALSE(pServer->Listen(ConnectedClient, 100));
+
+      struct stat FileStat;
+      ASSERT_EQ(0, stat(strPath.c_str(), &FileStat));
+      EXPECT_TRUE(S_ISSOCK(FileStat.st_mode));
+
+      CUnixClient oClient(PRINT_LOG);
+      EXPECT_FALSE(oClient.Connect(strPath + ".missing"));
+
+      std::future<bool> futListen = std::async(std::launch::async, [&] { return pServer->Listen(ConnectedClient); });
+      ASSERT_TRUE(oClient.Connect(strPath));
+      ASSERT_TRUE(futListen.get());
+      EXPECT_EQ(strPath, oClient.GetConnectedAddress().ToString());
+
+      ASSERT_TRUE(oClient.Send("ping"));
+      char szReceived[4] = {};
+      EXPECT_EQ(4, pServer->Receive(ConnectedClient, szReceived, 4));
+      EXPECT_EQ("ping", std::string(szReceived, 4));
+      ASSERT_TRUE(pServer->Send(ConnectedClient, "pong"));
+      EXPECT_EQ(4, oClient.Receive(szReceived, 4));
+      EXPECT_EQ("pong", std::string(szReceived, 4));
+
+      // the peer's disconnection is seen like with TCP
+      EXPECT_TRUE(oClient.Disconnect());
+      EXPECT_EQ(0, pServer->Receive(ConnectedClient, szReceived, 4));
+      EXPECT_TRUE(pServer->Disconnect(ConnectedClient));
+
+      // a live server's file isn't taken over (its probe connection is left in the accept queue)
+      {
+         CUnixServer oSecondServer(PRINT_LOG, strPath);
+         ASocket::Socket SecondClient;
+         EXPECT_FALSE(oSecondServer.Listen(SecondClient, 10));
+      }
+
+      // the file is removed with the server
+      pServer.reset();
+      EXPECT_NE(0, stat(strPath.c_str(), &FileStat));
+
+      // a file left by a crashed server is replaced
+      {
+         int iStale = socket(AF_UNIX, SOCK_STREAM, 0);
+         struct sockaddr_un Addr;
+         memset(&Addr, 0, sizeof(Addr));
+         Addr.sun_family = AF_UNIX;
+         strncpy(Addr.sun_path, strPath.c_str(), sizeof(Addr.sun_path) - 1);
+         ASSERT_EQ(0, bind(iStale, reinterpret_cast<struct sockaddr*>(&Addr), sizeof(Addr)));
+         close(iStale);
+      }
+      pServer.reset(new CUnixServer(PRINT_LOG, strPath));
+      std::vector<ASocket::Socket> vecAccepted;
+      ASSERT_EQ(0, pServer->AcceptBatch(vecAccepted, 16));
+      ASSERT_TRUE(oClient.Connect(strPath));
+      EXPECT_EQ(1, pServer->AcceptBatch(vecAccepted, 16, 1000));
+      EXPECT_TRUE(oClient.Disconnect());
+      for (const ASocket::Socket Client : vecAccepted)
+         pServer->Disconnect(Client);
+      pServer.reset();
+
+      // abstract name : no file
+      const std::string strAbstract = "@socket_cpp_test_" + std::to_string(getpid());
+      pServer.reset(new CUnixServer(PRINT_LOG, strAbstract));
+      futListen = std::async(std::launch::async, [&] { return pServer->Listen(ConnectedClient); });
+      SleepMs(100);
+      ASSERT_TRUE(oClient.Connect(strAbstract));
+      ASSERT_TRUE(futListen.get());
+      EXPECT_EQ(strAbstract, oClient.GetConnectedAddress().ToString());
+      EXPECT_NE(0, stat(strAbstract.c_str(), &FileStat));
+
+      ASSERT_TRUE(oClient.Send("abstract"));
+      char szAbstract[8] = {};
+      EXPECT_EQ(8, pServer->Receive(ConnectedClient, szAbstract, 8));
+      EXPECT_EQ("abstract", std::string(szAbstract, 8));
+
+      EXPECT_TRUE(oClient.Disconnect());
+      EXPECT_TRUE(pServer->Disconnect(ConnectedClient));
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPTest, BenchmarkUnixSocket)
+{
+   if (TCP_TEST_ENABLED && BENCHMARK_TEST_ENABLED)
+   {
+      // request/response round trips, then a bulk transfer, over an established connection
+      auto Measure = [](CTCPServer& Server, const ASocket::Socket ServerSocket, CTCPClient& Client,
+                        double& dRoundTripUs, double& dThroughputMBs)
+      {
+         const size_t uRoundTrips = 20000;
+         const size_t uMessageSize = 64;
+         std::thread Echo([&]
+         {
+            char szBuffer[uMessageSize];
+            for (size_t i = 0; i < uRoundTrips; ++i)
+            {
+               if (Server.Receive(ServerSocket, szBuffer, uMessageSize) != static_cast<int>(uMessageSize) ||
+                   !Server.Send(ServerSocket, szBuffer, uMessageSize))
+                  break;
+            }
+         });
+
+         char szMessage[uMessageSize] = {};
+         auto StartTime = std::chrono::steady_clock::now();
+         for (size_t i = 0; i < uRoundTrips; ++i)
+         {
+            ASSERT_TRUE(Client.Send(szMessage, uMessageSize));
+            ASSERT_EQ(static_cast<int>(uMessageSize), Client.Receive(szMessage, uMessageSize));
+         }
+         dRoundTripUs = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - StartTime).count() / uRoundTrips;
+         Echo.join();
+
+         const size_t uChunkSize = 64 * 1024;
+         const size_t uTotalSize = size_t(1) << 30;
+         std::thread Sink([&]
+         {
+            std::vector<char> vecBuffer(uChunkSize);
+            size_t uReceived = 0;
+            while (uReceived < uTotalSize)
+            {
+               const int iRead = Server.Receive(ServerSocket, vecBuffer.data(), uChunkSize, false);
+               if (iRead <= 0)
+                  break;
+               uReceived += static_cast<size_t>(iRead);
+            }
+            Server.Send(ServerSocket, "k", 1);
+         });
+
+         std::vector<char> vecChunk(uChunkSize, 'x');
+         StartTime = std::chrono::steady_clock::now();
+         for (size_t uSent = 0; uSent < uTotalSize; uSent += uChunkSize)
+            ASSERT_TRUE(Client.Send(vecChunk.data(), uChunkSize));
+         char cAck;
+         ASSERT_EQ(1, Client.Receive(&cAck, 1));
+         dThroughputMBs = (uTotalSize / (1024.0 * 1024.0)) /
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+         Sink.join();
+      };
+
+      double dTcpRoundTripUs = 0, dTcpThroughputMBs = 0;
+      {
+         ASSERT_NO_THROW(m_pTCPServer.reset(new CTCPServer(PRINT_LOG, TCP_SERVER_PORT)));
+         m_pTCPServer->SetSocketOptions(CSocketOptions().SetNoDelay(true));
+         m_pTCPClient->SetSocketOptions(CSocketOptions().SetNoDelay(true));
+
+         ASocket::Socket ConnectedClient;
+         std::future<bool> futListen = std::async(std::launch::async, [&] { return m_pTCPServer->Listen(ConnectedClient); });
+         SleepMs(100);
+         ASSERT_TRUE(m_pTCPClient->Connect("127.0.0.1", TCP_SERVER_PORT));
+         ASSERT_TRUE(futListen.get());
+
+         Measure(*m_pTCPServer, ConnectedClient, *m_pTCPClient, dTcpRoundTripUs, dTcpThroughputMBs);
+
+         EXPECT_TRUE(m_pTCPClient->Disconnect());
+         EXPECT_TRUE(m_pTCPServer->Disconnect(ConnectedClient));
+      }
+
+      double dUnixRoundTripUs = 0, dUnixThroughputMBs = 0;
+      {
+         CUnixServer oServer(PRINT_LOG, "@socket_cpp_bench_" + std::to_string(getpid()));
+         CUnixClient oClient(PRINT_LOG);
+
+         ASocket::Socket ConnectedClient;
+         std::future<bool> futListen = std::async(std::launch::async, [&] { return oServer.Listen(ConnectedClient); });
+         SleepMs(100);
+         ASSERT_TRUE(oClient.Connect(oServer.GetPath()));
+         ASSERT_TRUE(futListen.get());
+
+         Measure(oServer, ConnectedClient, oClient, dUnixRoundTripUs, dUnixThroughputMBs);
+
+         EXPECT_TRUE(oClient.Disconnect());
+         EXPECT_TRUE(oServer.Disconnect(ConnectedClient));
+      }
+
+      std::cout << "** 64 bytes round trip : 127.0.0.1 TCP " << dTcpRoundTripUs << " us, AF_UNIX "
+                << dUnixRoundTripUs << " us" << std::endl;
+      std::cout << "** 1 GB in 64 KB sends : 127.0.0.1 TCP " << dTcpThroughputMBs << " MB/s, AF_UNIX "
+                << dUnixThroughputMBs << " MB/s" << std::endl;
+   }
+   else
+      std::cout << "TCP or benchmark tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPTest, TestShmConnection)
+{
+   if (TCP_TEST_ENABLED)
+   {
+      const std::string strPath = "@socket_cpp_shm_test_" + std::to_string(getpid());
+      CShmServer oServer(PRINT_LOG, strPath);
+      oServer.SetRingCapacity(50000);
+      EXPECT_EQ(65536u, oServer.GetRingCapacity());
+
+      // binds the control socket before forking, the child connects to it
+      CShmConnection oConnection(PRINT_LOG);
+      EXPECT_FALSE(oServer.Listen(oConnection, 10));
+      EXPECT_FALSE(oConnection.Send("not connected"));
+
+      // the peer is another process : it echoes everything until the link is closed
+      pid_t Child = fork();
+      ASSERT_GE(Child, 0);
+      if (Child == 0)
+      {
+         CShmConnection oEcho(ASocket::LogFnCallback(), ASocket::NO_FLAGS);
+         if (!oEcho.Connect(strPath))
+            _exit(1);
+
+         char szBuffer[4096];
+         int iRead;
+         while ((iRead = oEcho.Receive(szBuffer, sizeof(szBuffer), false)) > 0)
+         {
+            if (!oEcho.Send(szBuffer, static_cast<size_t>(iRead)))
+               _exit(2);
+         }
+         _exit(iRead == 0 ? 0 : 3);
+      }
+
+      ASSERT_TRUE(oServer.Listen(oConnection, 5000));
+      EXPECT_EQ(65536u, oConnection.GetRingCapacity());
+
+      ASSERT_TRUE(oConnection.Send("hello"));
+      char szReceived[5] = {};
+      EXPECT_EQ(5, oConnection.Receive(szReceived, 5));
+      EXPECT_EQ("hello", std::string(szReceived, 5));
+
+      // much more than the rings hold : the writers block on full rings and wrap around
+      std::vector<char> vecSent(8 * 1024 * 1024);
+      for (size_t i = 0; i < vecSent.size(); ++i)
+         vecSent[i] = static_cast<char>((i * 2654435761u) >> 13);
+
+      std::future<bool> futSend = std::async(std::launch::async, [&] { return oConnection.Send(vecSent); });
+      std::vector<char> vecReceived(vecSent.size());
+      EXPECT_EQ(static_cast<int>(vecReceived.size()), oConnection.Receive(vecReceived.data(), vecReceived.size()));
+      EXPECT_TRUE(futSend.get());
+      EXPECT_TRUE(vecSent == vecReceived);
+
+      // the child sees the end of the stream and exits
+      EXPECT_TRUE(oConnection.Disconnect());
+      int iStatus = -1;
+      ASSERT_EQ(Child, waitpid(Child, &iStatus, 0));
+      EXPECT_TRUE(WIFEXITED(iStatus));
+      EXPECT_EQ(0, WEXITSTATUS(iStatus));
+
+      // a peer which dies without disconnecting is noticed through the control socket
+      Child = fork();
+      ASSERT_GE(Child, 0);
+      if (Child == 0)
+      {
+         CShmConnection oDying(ASocket::LogFnCallback(), ASocket::NO_FLAGS);
+         _exit(oDying.Connect(strPath) && oDying.Send("last words", 10) ? 0 : 1);
+      }
+
+      ASSERT_TRUE(oServer.Listen(oConnection, 5000));
+      ASSERT_EQ(Child, waitpid(Child, &iStatus, 0));
+      EXPECT_EQ(0, WEXITSTATUS(iStatus));
+
+      char szLastWords[32] = {};
+      EXPECT_EQ(10, oConnection.Receive(szLastWords, sizeof(szLastWords)));
+      EXPECT_EQ("last words", std::string(szLastWords, 10));
+      EXPECT_EQ(0, oConnection.Receive(szLastWords, sizeof(szLastWords)));
+      EXPECT_FALSE(oConnection.Send("anyone ?"));
+      EXPECT_TRUE(oConnection.Disconnect());
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
+}
+
+// exposes the ring the server side reads from, to overwrite its indexes
+class CCorruptibleShmConnection : public CShmConnection
+{
+public:
+   using CShmConnection::CShmConnection;
+
+   CShmRing::Header* GetInHeader()
+   {
+      return reinterpret_cast<CShmRing::Header*>(static_cast<char*>(m_pMapping) + sizeof(SharedHeader));
+   }
+};
+
+TEST_F(TCPTest, TestShmRingCorruption)
+{
+   if (TCP_TEST_ENABLED)
+   {
+      const size_t uCapacity = 4096;
+      const size_t uMappingSize = CShmRing::GetMappingSize(uCapacity);
+      void* pMemory = mmap(nullptr, uMappingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+      ASSERT_NE(MAP_FAILED, pMemory);
+      CShmRing::Header* pHeader = static_cast<CShmRing::Header*>(pMemory);
+
+      CShmRing Producer;
+      CShmRing Consumer;
+      Producer.Attach(pMemory, uCapacity, true);
+      Consumer.Attach(pMemory, uCapacity, false);
+      ASSERT_EQ(5u, Producer.Write("hello", 5));
+
+      // the producer's index claims more than the ring holds : reading it would overrun the mapping
+      std::vector<char> vecBuffer(4 * uCapacity);
+      pHeader->m_uHead.store(pHeader->m_uTail.load() + 2 * uCapacity);
+      EXPECT_EQ(0u, Consumer.Read(vecBuffer.data(), vecBuffer.size()));
+      EXPECT_TRUE(Consumer.IsCorrupted());
+      EXPECT_TRUE(Consumer.WaitReadable(0, 1000));
+      EXPECT_EQ(0u, Consumer.Read(vecBuffer.data(), 1));
+
+      // the consumer's index ahead of the producer's : the free space would underflow
+      Producer.Attach(pMemory, uCapacity, true);
+      Consumer.Attach(pMemory, uCapacity, false);
+      EXPECT_FALSE(Producer.IsCorrupted());
+      pHeader->m_uTail.store(pHeader->m_uHead.load() + 1);
+      EXPECT_EQ(0u, Producer.Write(vecBuffer.data(), vecBuffer.size()));
+      EXPECT_TRUE(Producer.IsCorrupted());
+      EXPECT_TRUE(Producer.WaitWritable(0, 1000));
+
+      munmap(pMemory, uMappingSize);
+
+      // a connection with a corrupted ring fails and closes the link
+      const std::string strPath = "@socket_cpp_shm_corruption_" + std::to_string(getpid());
+      CShmServer oServer(PRINT_LOG, strPath);
+      CCorruptibleShmConnection oConnection(PRINT_LOG);
+      EXPECT_FALSE(oServer.Listen(oConnection, 10));
+
+      pid_t Child = fork();
+      ASSERT_GE(Child, 0);
+      if (Child == 0)
+      {
+         CShmConnection oPeer(ASocket::LogFnCallback(), ASocket::NO_FLAGS);
+         if (!oPeer.Connect(strPath) || !oPeer.Send("hi", 2))
+            _exit(1);
+
+         // returns once the server side closed the link
+         char cByte;
+         _exit(oPeer.Receive(&cByte, 1) == 0 ? 0 : 2);
+      }
+
+      ASSERT_TRUE(oServer.Listen(oConnection, 5000));
+      char szReceived[2] = {};
+      ASSERT_EQ(2, oConnection.Receive(szReceived, 2));
+
+      CShmRing::Header* pInHeader = oConnection.GetInHeader();
+      pInHeader->m_uHead.store(pInHeader->m_uTail.load() + 10 * oConnection.GetRingCapacity());
+      EXPECT_EQ(-1, oConnection.Receive(szReceived, 2));
+
+      int iStatus = -1;
+      ASSERT_EQ(Child, waitpid(Child, &iStatus, 0));
+      EXPECT_TRUE(WIFEXITED(iStatus));
+      EXPECT_EQ(0, WEXITSTATUS(iStatus));
+      EXPECT_FALSE(oConnection.Send("bye"));
+      EXPECT_TRUE(oConnection.Disconnect());
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPTest, BenchmarkShmConnection)
+{
+   if (TCP_TEST_ENABLED && BENCHMARK_TEST_ENABLED)
+   {
+      const size_t uRoundTrips = 50000;
+      const size_t uMessageSize = 64;
+
+      // 64 bytes ping-pongs against an echo thread, p50/p99/p99.9 of the round trips
+      auto Measure = [&](const std::string& strName, std::function<bool(char*)> fnRoundTrip)
+      {
+         char szMessage[uMessageSize] = {};
+         std::vector<double> vecRoundTripsUs;
+         vecRoundTripsUs.reserve(uRoundTrips);
+         for (size_t i = 0; i < uRoundTrips; ++i)
+         {
+            auto StartTime = std::chrono::steady_clock::now();
+            ASSERT_TRUE(fnRoundTrip(szMessage));
+            vecRoundTripsUs.push_back(std::chrono::duration<double, std::micro>(
+               std::chrono::steady_clock::now() - StartTime).count());
+         }
+
+         std::sort(vecRoundTripsUs.begin(), vecRoundTripsUs.end());
+         auto Percentile = [&](const double dRank)
+         {
+            return vecRoundTripsUs[std::min(vecRoundTripsUs.size() - 1, static_cast<size_t>(dRank * vecRoundTripsUs.size()))];
+         };
+         std::cout << "** " << strName << " : p50 " << Percentile(0.5) << " us, p99 " << Percentile(0.99)
+                   << " us, p99.9 " << Percentile(0.999) << " us" << std::endl;
+      };
+
+      std::cout << "** " << uRoundTrips << " round trips of " << uMessageSize << " bytes, "
+                << std::thread::hardware_concurrency() << " CPU(s)" << std::endl;
+
+      const std::string strShmPath = "@socket_cpp_shm_bench_" + std::to_string(getpid());
+      CShmServer oShmServer(PRINT_LOG, strShmPath);
+      // without a second CPU there's no spinning anyway
+      std::vector<unsigned int> vecSpinCounts = { CShmConnection::DEFAULT_SPIN_COUNT };
+      if (std::thread::hardware_concurrency() > 1)
+         vecSpinCounts.push_back(0);
+
+      for (const unsigned int uSpinCount : vecSpinCounts)
+      {
+         CShmConnection oServerSide(PRINT_LOG);
+         CShmConnection oClientSide(PRINT_LOG);
+         oServerSide.SetSpinCount(uSpinCount);
+         oClientSide.SetSpinCount(uSpinCount);
+
+         std::future<bool> futListen = std::async(std::launch::async, [&] { return oShmServer.Listen(oServerSide); });
+         SleepMs(100);
+         ASSERT_TRUE(oClientSide.Connect(strShmPath));
+         ASSERT_TRUE(futListen.get());
+
+         std::thread Echo([&]
+         {
+            char szBuffer[uMessageSize];
+            while (oServerSide.Receive(szBuffer, uMessageSize) == static_cast<int>(uMessageSize) &&
+                   oServerSide.Send(szBuffer, uMessageSize)) {}
+         });
+
+         Measure("shared memory, spin count " + std::to_string(oClientSide.GetSpinCount()), [&](char* pMessage)
+         {
+            return oClientSide.Send(pMessage, uMessageSize) &&
+                   oClientSide.Receive(pMessage, uMessageSize) == static_cast<int>(uMessageSize);
+         });
+
+         oClientSide.Disconnect();
+         Echo.join();
+      }
+
+      {
+         CUnixServer oUnixServer(PRINT_LOG, "@socket_cpp_shm_bench_unix_" + std::to_string(getpid()));
+         CUnixClient oUnixClient(PRINT_LOG);
+         ASocket::Socket ConnectedClient;
+         std::future<bool> futListen = std::async(std::launch::async, [&] { return oUnixServer.Listen(ConnectedClient); });
+         SleepMs(100);
+         ASSERT_TRUE(oUnixClient.Connect(oUnixServer.GetPath()));
+         ASSERT_TRUE(futListen.get());
+
+         std::thread Echo([&]
+         {
+            char szBuffer[uMessageSize];
+            while (oUnixServer.Receive(ConnectedClient, szBuffer, uMessageSize) == static_cast<int>(uMessageSize) &&
+                   oUnixServer.Send(ConnectedClient, szBuffer, uMessageSize)) {}
+         });
+
+         Measure("AF_UNIX", [&](char* pMessage)
+         {
+            return oUnixClient.Send(pMessage, uMessageSize) &&
+                   oUnixClient.Receive(pMessage, uMessageSize) == static_cast<int>(uMessageSize);
+         });
+
+         oUnixClient.Disconnect();
+         Echo.join();
+         oUnixServer.Disconnect(ConnectedClient);
+      }
+
+      {
+         ASSERT_NO_THROW(m_pTCPServer.reset(new CTCPServer(PRINT_LOG, TCP_SERVER_PORT)));
+         m_pTCPServer->SetSocketOptions(CSocketOptions().SetNoDelay(true));
+         m_pTCPClient->SetSocketOptions(CSocketOptions().SetNoDelay(true));
+         ASocket::Socket ConnectedClient;
+         std::future<bool> futListen = std::async(std::launch::async, [&] { return m_pTCPServer->Listen(ConnectedClient); });
+         SleepMs(100);
+         ASSERT_TRUE(m_pTCPClient->Connect("127.0.0.1", TCP_SERVER_PORT));
+         ASSERT_TRUE(futListen.get());
+
+         std::thread Echo([&]
+         {
+            char szBuffer[uMessageSize];
+            while (m_pTCPServer->Receive(ConnectedClient, szBuffer, uMessageSize) == static_cast<int>(uMessageSize) &&
+                   m_pTCPServer->Send(ConnectedClient, szBuffer, uMessageSize)) {}
+         });
+
+         Measure("127.0.0.1 TCP", [&](char* pMessage)
+         {
+            return m_pTCPClient->Send(pMessage, uMessageSize) &&
+                   m_pTCPClient->Receive(pMessage, uMessageSize) == static_cast<int>(uMessageSize);
+         });
+
+         m_pTCPClient->Disconnect();
+         Echo.join();
+         m_pTCPServer->Disconnect(ConnectedClient);
+      }
+   }
+   else
+      std::cout << "TCP or benchmark tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPTest, BenchmarkSocketMultiplexer)
+{
+   if (TCP_TEST_ENABLED && BENCHMARK_TEST_ENABLED)
+   {
+      struct rlimit FdLimit;
+      ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &FdLimit), 0);
+      FdLimit.rlim_cur = FdLimit.rlim_max;
+      setrlimit(RLIMIT_NOFILE, &FdLimit);
+      ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &FdLimit), 0);
+
+      // 10 ready sockets among N idle ones : one wait returning all of them, against the
+      // set rebuilt on each call (and select, while the descriptors fit in an fd_set)
+      const size_t uReady = 10;
+      for (size_t uSockets : { size_t(100), size_t(1000), size_t(10000) })
+      {
+         // each socket has its peer in this process
+         if (2 * uSockets + 64 > FdLimit.rlim_cur)
+         {
+            uSockets = (FdLimit.rlim_cur - 64) / 2;
+            std::cout << "** RLIMIT_NOFILE is too low, benchmarking " << uSockets << " sockets\n";
+         }
+
+         std::vector<ASocket::Socket> vecSockets;
+         std::vector<ASocket::Socket> vecPeers;
+         CSocketMultiplexer Multiplexer(PRINT_LOG);
+         for (size_t i = 0; i < uSockets; ++i)
+         {
+            int Pair[2];
+            ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, Pair));
+            vecSockets.push_back(Pair[0]);
+            vecPeers.push_back(Pair[1]);
+            ASSERT_TRUE(Multiplexer.Add(Pair[0]));
+         }
+         for (size_t i = 0; i < uReady; ++i)
+            ASSERT_EQ(1, write(vecPeers[(i * 7919) % uSockets], "x", 1));
+
+         const size_t uIterations = 2000000 / uSockets;
+         std::vector<CSocketMultiplexer::Event> vecEvents;
+
+         auto StartTime = std::chrono::steady_clock::now();
+         for (size_t i = 0; i < uIterations; ++i)
+            ASSERT_EQ(static_cast<int>(uReady), Multiplexer.Wait(vecEvents, 0));
+         const double dMultiplexerUs = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - StartTime).count() / uIterations;
+
+         size_t uSelected = 0;
+         StartTime = std::chrono::steady_clock::now();
+         for (size_t i = 0; i < uIterations; ++i)
+            ASSERT_EQ(1, ASocket::SelectSockets(vecSockets.data(), uSockets, 1, uSelected));
+         const double dSelectSocketsUs = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - StartTime).count() / uIterations;
+
+         std::string strSelect = "n/a (FD_SETSIZE)";
+         if (*std::max_element(vecSockets.begin(), vecSockets.end()) < FD_SETSIZE)
+         {
+            StartTime = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < uIterations; ++i)
+            {
+               fd_set ReadSet;
+               FD_ZERO(&ReadSet);
+               int iMaxFd = -1;
+               for (const ASocket::Socket Sock : vecSockets)
+               {
+                  FD_SET(Sock, &ReadSet);
+                  iMaxFd = std::max(iMaxFd, Sock);
+               }
+               struct timeval Timeout = { 0, 0 };
+               ASSERT_EQ(static_cast<int>(uReady), select(iMaxFd + 1, &ReadSet, nullptr, nullptr, &Timeout));
+            }
+            strSelect = std::to_string(std::chrono::duration<double, std::micro>(
+               std::chrono::steady_clock::now() - StartTime).count() / uIterations) + " us";
+         }
+
+         std::cout << "** " << uSockets << " sockets, " << uReady << " ready : multiplexer " << dMultiplexerUs
+                   << " us per wait (all ready), SelectSockets " << dSelectSocketsUs
+                   << " us (first ready only), select " << strSelect << std::endl;
+
+         for (size_t i = 0; i < uSockets; ++i)
+         {
+            close(vecSockets[i]);
+            close(vecPeers[i]);
+         }
+      }
+   }
+   else
+      std::cout << "TCP or benchmark tests are disabled !" << std::endl;
+}
+#endif
+
+#ifdef LINUX
+TEST_F(TCPEventTest, TestTenThousandIdleConnections)
+{
+   if (TCP_TEST_ENABLED)
+   {
+      // each connection costs two descriptors in this process (client + accepted socket)
+      struct rlimit FdLimit;
+      ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &FdLimit), 0);
+      FdLimit.rlim_cur = FdLimit.rlim_max;
+      setrlimit(RLIMIT_NOFILE, &FdLimit);
+      ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &FdLimit), 0);
+
+      const size_t uConnections = std::min<size_t>(10000, (FdLimit.rlim_cur - 64) / 2);
+      if (uConnections < 10000)
+         std::cout << "** RLIMIT_NOFILE is too low, testing " << uConnections << " connections\n";
+
+      std::atomic<size_t> uAccepted(0);
+      std::atomic<size_t> uClosed(0);
+
+      m_pEventServer->SetOnAccept([&](const ASocket::Socket) { ++uAccepted; });
+      m_pEventServer->SetOnClose([&](const ASocket::Socket) { ++uClosed; });
+      m_pEventServer->SetOnData([&](const ASocket::Socket Client, const char* pData, const size_t uSize)
+      {
+         m_pEventServer->Write(Client, pData, uSize);
+      });
+      StartLoop();
+
+      std::vector<std::unique_ptr<CTCPClient>> vecClients;
+      vecClients.reserve(uConnections);
+      for (size_t i = 0; i < uConnections; ++i)
+      {
+         vecClients.emplace_back(new CTCPClient(PRINT_LOG, ASocket::NO_FLAGS));
+         ASSERT_TRUE(vecClients.back()->Connect("localhost", TCP_SERVER_PORT));
+      }
+
+      for (int iWait = 0; iWait < 100 && uAccepted < uConnections; ++iWait)
+         SleepMs(100);
+      EXPECT_EQ(uAccepted.load(), uConnections);
+
+      // the loop must still be responsive with all those idle clients
+      const std::string strPing = "ping";
+      char szRcvBuffer[5] = {};
+      CTCPClient& LastClient = *vecClients.back();
+      ASSERT_TRUE(LastClient.Send(strPing));
+      EXPECT_EQ(LastClient.Receive(szRcvBuffer, strPing.size()), static_cast<int>(strPing.size()));
+      EXPECT_EQ(strPing, szRcvBuffer);
+
+      vecClients.clear();
+
+      for (int iWait = 0; iWait < 100 && uClosed < uConnections; ++iWait)
+         SleepMs(100);
+      EXPECT_EQ(uClosed.load(), uConnections);
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPEventTest, TestEchoThroughput)
+{
+   if (TCP_TEST_ENABLED)
+   {
+      srand(static_cast<unsigned>(time(nullptr)));
+
+      const size_t uTotal = 64 * 1024 * 1024;
+      const size_t uChunk = 64 * 1024;
+      std::vector<char> SndData(uTotal);
+      std::vector<char> RcvBuffer(uTotal);
+      std::generate(SndData.begin(), SndData.end(), [] { return (std::rand() % 256); });
+
+      m_pEventServer->SetOnData([&](const ASocket::Socket Client, const char* pData, const size_t uSize)
+      {
+         m_pEventServer->Write(Client, pData, uSize);
+      });
+      StartLoop();
+
+      ASSERT_TRUE(m_pTCPClient->Connect("localhost", TCP_SERVER_PORT));
+
+      auto StartTime = std::chrono::steady_clock::now();
+
+      std::future<int> futClientReceive = std::async(std::launch::async,
+                                                     [&] { return m_pTCPClient->Receive(RcvBuffer.data(), uTotal); });
+
+      for (size_t uOffset = 0; uOffset < uTotal; uOffset += uChunk)
+         ASSERT_TRUE(m_pTCPClient->Send(SndData.data() + uOffset, uChunk));
+
+      EXPECT_EQ(futClientReceive.get(), static_cast<int>(uTotal));
+      EXPECT_TRUE(std::equal(SndData.begin(), SndData.end(), RcvBuffer.begin()));
+
+      double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+      std::cout << "** Echo throughput : " << (uTotal / (1024.0 * 1024.0)) / dSeconds << " MB/s\n";
+
+      EXPECT_TRUE(m_pTCPClient->Disconnect());
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPEventTest, TestDeadlines)
+{
+   if (TCP_TEST_ENABLED)
+   {
+      const size_t uIdleTimeoutMs = 300;
+      m_pEventServer->SetIdleTimeout(uIdleTimeoutMs);
+      m_pEventServer->SetOnTimeout([&](const ASocket::Socket Client)
+      {
+         m_pEventServer->Write(Client, std::string("bye"));
+         m_pEventServer->Close(Client);
+      });
+      m_pEventServer->SetOnData([&](const ASocket::Socket Client, const char* pData, const size_t uSize)
+      {
+         // "keep" cancels the client's deadline
+         if (std::string(pData, uSize) == "keep")
+            m_pEventServer->SetDeadline(Client, 0);
+         m_pEventServer->Write(Client, pData, uSize);
+      });
+      StartLoop();
+
+      CTCPClient Silent(PRINT_LOG, ASocket::NO_FLAGS);
+      CTCPClient Chatty(PRINT_LOG, ASocket::NO_FLAGS);
+      CTCPClient Kept(PRINT_LOG, ASocket::NO_FLAGS);
+      ASSERT_TRUE(Silent.Connect("localhost", TCP_SERVER_PORT));
+      ASSERT_TRUE(Chatty.Connect("localhost", TCP_SERVER_PORT));
+      ASSERT_TRUE(Kept.Connect("localhost", TCP_SERVER_PORT));
+      auto StartTime = std::chrono::steady_clock::now();
+
+      char szRcvBuffer[5] = {};
+      ASSERT_TRUE(Kept.Send(std::string("keep")));
+      EXPECT_EQ(Kept.Receive(szRcvBuffer, 4), 4);
+
+      // each read pushes the idle deadline back
+      for (int i = 0; i < 8; ++i)
+      {
+         ASSERT_TRUE(Chatty.Send(std::string("ping")));
+         EXPECT_EQ(Chatty.Receive(szRcvBuffer, 4), 4);
+         SleepMs(100);
+      }
+      EXPECT_STREQ(szRcvBuffer, "ping");
+
+      // the silent client got OnTimeout's goodbye, then the server closed it
+      std::fill(std::begin(szRcvBuffer), std::end(szRcvBuffer), '\0');
+      EXPECT_EQ(Silent.Receive(szRcvBuffer, 3), 3);
+      EXPECT_STREQ(szRcvBuffer, "bye");
+      EXPECT_EQ(Silent.Receive(szRcvBuffer, 1), 0);
+      EXPECT_GE(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - StartTime).count(),
+                static_cast<long long>(uIdleTimeoutMs));
+
+      for (int i = 0; i < 100 && m_pEventServer->GetConnectionCount() != 2; ++i)
+         SleepMs(10);
+      EXPECT_EQ(m_pEventServer->GetConnectionCount(), 2u);
+      EXPECT_EQ(m_pEventServer->GetTimeoutCount(), 1u);
+
+      ASSERT_TRUE(Kept.Send(std::string("pong")));
+      EXPECT_EQ(Kept.Receive(szRcvBuffer, 4), 4);
+
+      Silent.Disconnect();
+      Chatty.Disconnect();
+      Kept.Disconnect();
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPEventTest, TestReapers)
+{
+   if (TCP_TEST_ENABLED)
+   {
+      const size_t uIdleTimeoutMs = 400;
+      m_pEventServer->SetIdleTimeout(uIdleTimeoutMs);
+      m_pEventServer->SetMinTransferRate(64, 200);
+      m_pEventServer->SetMaxConnections(3);
+      m_pEventServer->SetResetOnReap(true);
+      m_pEventServer->SetOnData([&](const ASocket::Socket Client, const char* pData, const size_t uSize)
+      {
+         m_pEventServer->Write(Client, pData, uSize);
+      });
+      StartLoop();
+
+      CTCPClient Fast(PRINT_LOG, ASocket::NO_FLAGS);
+      CTCPClient Trickler(PRINT_LOG, ASocket::NO_FLAGS);
+      CTCPClient Idle(PRINT_LOG, ASocket::NO_FLAGS);
+      ASSERT_TRUE(Fast.Connect("localhost", TCP_SERVER_PORT));
+      ASSERT_TRUE(Trickler.Connect("localhost", TCP_SERVER_PORT));
+      ASSERT_TRUE(Idle.Connect("localhost", TCP_SERVER_PORT));
+      for (int i = 0; i < 100 && m_pEventServer->GetConnectionCount() != 3; ++i)
+         SleepMs(10);
+      ASSERT_EQ(m_pEventServer->GetConnectionCount(), 3u);
+
+      // the server is full : the TCP handshake completes, then the client is reset
+      CTCPClient Extra(PRINT_LOG, ASocket::NO_FLAGS);
+      ASSERT_TRUE(Extra.Connect("localhost", TCP_SERVER_PORT));
+      char szRcvBuffer[100] = {};
+      ASSERT_EQ(1, ASocket::SelectSocket(Extra.GetSocketDescriptor(), 1000));
+      EXPECT_LT(recv(Extra.GetSocketDescriptor(), szRcvBuffer, 1, 0), 0);
+      EXPECT_EQ(errno, ECONNRESET);
+
+      // Fast moves 200 bytes per 50 ms, Trickler 2 bytes (its echo included)
+      const std::string strChunk(100, 'x');
+      for (int i = 0; i < 12; ++i)
+      {
+         ASSERT_TRUE(Fast.Send(strChunk));
+         EXPECT_EQ(Fast.Receive(szRcvBuffer, sizeof(szRcvBuffer)), 100);
+         send(Trickler.GetSocketDescriptor(), ".", 1, MSG_NOSIGNAL); // fails once it's reset
+         SleepMs(50);
+      }
+
+      // Trickler was below the rate, Idle was left to the idle timeout
+      ASSERT_EQ(1, ASocket::SelectSocket(Idle.GetSocketDescriptor(), 1000));
+      EXPECT_LE(recv(Idle.GetSocketDescriptor(), szRcvBuffer, 1, 0), 0);
+      for (int i = 0; i < 100 && m_pEventServer->GetConnectionCount() != 1; ++i)
+         SleepMs(10);
+      EXPECT_EQ(m_pEventServer->GetConnectionCount(), 1u);
+
+      EXPECT_EQ(m_pEventServer->GetReapCount(CTCPEventServer::REAP_TIMEOUT), 1u);
+      EXPECT_EQ(m_pEventServer->GetReapCount(CTCPEventServer::REAP_SLOW_CLIENT), 1u);
+      EXPECT_EQ(m_pEventServer->GetReapCount(CTCPEventServer::REAP_CONNECTION_LIMIT), 1u);
+
+      ASSERT_TRUE(Fast.Send(strChunk));
+      EXPECT_EQ(Fast.Receive(szRcvBuffer, sizeof(szRcvBuffer)), 100);
+
+      Fast.Disconnect();
+      Trickler.Disconnect();
+      Idle.Disconnect();
+      Extra.Disconnect();
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPEventTest, TestReusePortWorkers)
+{
+   if (TCP_TEST_ENABLED)
+   {
+      const size_t uWorkers = 4;
+      const size_t uConnections = 400;
+
+      CTCPMultiServer MultiServer(PRINT_LOG, TCP_SERVER_PORT, uWorkers);
+      MultiServer.SetOnData([](CTCPEventServer& Worker, const ASocket::Socket Client,
+                               const char* pData, const size_t uSize)
+      {
+         Worker.Write(Client, pData, uSize);
+      });
+      ASSERT_TRUE(MultiServer.Start());
+      EXPECT_EQ(MultiServer.GetWorkerCount(), uWorkers);
+
+      std::vector<std::unique_ptr<CTCPClient>> vecClients;
+      for (size_t i = 0; i < uConnections; ++i)
+      {
+         vecClients.emplace_back(new CTCPClient(PRINT_LOG, ASocket::NO_FLAGS));
+         ASSERT_TRUE(vecClients.back()->Connect("localhost", TCP_SERVER_PORT));
+      }
+
+      // whichever worker accepted it, every client is served
+      const std::string strPing = "ping";
+      for (auto& pClient : vecClients)
+      {
+         char szRcvBuffer[5] = {};
+         ASSERT_TRUE(pClient->Send(strPing));
+         ASSERT_EQ(pClient->Receive(szRcvBuffer, strPing.size()), static_cast<int>(strPing.size()));
+         EXPECT_EQ(strPing, szRcvBuffer);
+      }
+
+      std::vector<unsigned long long> vecCounts = MultiServer.GetAcceptCounts();
+      ASSERT_EQ(vecCounts.size(), uWorkers);
+
+      unsigned long long uTotal = 0;
+      for (size_t i = 0; i < uWorkers; ++i)
+      {
+         std::cout << "** worker " << i << " (CPU " << MultiServer.GetWorkerCPU(i) << ") accepted "
+                   << vecCounts[i] << " connections\n";
+
+         // the kernel hashes the clients' ports, no worker should be left out
+         EXPECT_GT(vecCounts[i], 0u);
+         uTotal += vecCounts[i];
+      }
+      EXPECT_EQ(uTotal, uConnections);
+
+      vecClients.clear();
+      MultiServer.Stop();
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPEventTest, TestReusePortWorkersFailedStart)
+{
+   if (TCP_TEST_ENABLED)
+   {
+      CTCPMultiServer MultiServer(PRINT_LOG, TCP_SERVER_PORT, 3);
+      MultiServer.SetOnData([](CTCPEventServer& Worker, const ASocket::Socket Client,
+                               const char* pData, const size_t uSize)
+      {
+         Worker.Write(Client, pData, uSize);
+      });
+
+      // room for the first two workers' descriptors (listen socket and epoll or io_uring) only
+      const int iNextFd = dup(0);
+      ASSERT_GE(iNextFd, 0);
+      close(iNextFd);
+
+      struct rlimit FdLimit;
+      ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &FdLimit), 0);
+      const struct rlimit SavedLimit = FdLimit;
+      FdLimit.rlim_cur = static_cast<rlim_t>(iNextFd + 4);
+      ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &FdLimit), 0);
+      const bool bStarted = MultiServer.Start();
+      ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &SavedLimit), 0);
+
+      EXPECT_FALSE(bStarted);
+      EXPECT_FALSE(MultiServer.IsRunning());
+
+      // no listen socket was left bound : the connection is refused instead of never served
+      CTCPClient Client(PRINT_LOG, ASocket::NO_FLAGS);
+      EXPECT_FALSE(Client.Connect("localhost", TCP_SERVER_PORT));
+
+      // the workers can be started again
+      ASSERT_TRUE(MultiServer.Start());
+      ASSERT_TRUE(Client.Connect("localhost", TCP_SERVER_PORT));
+      char szRcvBuffer[5] = {};
+      ASSERT_TRUE(Client.Send("ping"));
+      EXPECT_EQ(Client.Receive(szRcvBuffer, 4), 4);
+      EXPECT_STREQ(szRcvBuffer, "ping");
+
+      EXPECT_TRUE(Client.Disconnect());
+      MultiServer.Stop();
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPEventTest, TestConnectionPool)
+{
+   if (TCP_TEST_ENABLED)
+   {
+      // echo server, "bye" makes it close the connection
+      m_pEventServer->SetOnData([&](const ASocket::Socket Client, const char* pData, const size_t uSize)
+      {
+         if (std::string(pData, uSize) == "bye")
+            m_pEventServer->Close(Client);
+         else
+            m_pEventServer->Write(Client, pData, uSize);
+      });
+      StartLoop();
+
+      CConnectionPool<CTCPClient>::Settings oSettings;
+      oSettings.m_uMinIdle = 1;
+      oSettings.m_uMaxIdle = 4;
+      oSettings.m_uIdleTimeoutMs = 200;
+      CConnectionPool<CTCPClient> Pool([] { return std::unique_ptr<CTCPClient>(new CTCPClient(PRINT_LOG, ASocket::NO_FLAGS)); },
+                                       oSettings);
+
+      auto Echo = [](CConnectionPool<CTCPClient>::Lease& Lease) -> bool
+      {
+         char szReply[4] = {};
+         return Lease->Send("ping") && Lease->Receive(szReply, 4) == 4 && std::string(szReply, 4) == "ping";
+      };
+
+      // the connection given back is lent out again, the last one given back first
+      const CTCPClient* pFirst = nullptr;
+      {
+         CConnectionPool<CTCPClient>::Lease Lease = Pool.Acquire("localhost", TCP_SERVER_PORT);
+         ASSERT_TRUE(Lease);
+         EXPECT_TRUE(Echo(Lease));
+         pFirst = Lease.Get();
+      }
+      EXPECT_EQ(Pool.GetIdleCount("localhost", TCP_SERVER_PORT), 1u);
+      {
+         CConnectionPool<CTCPClient>::Lease Lease = Pool.Acquire("localhost", TCP_SERVER_PORT);
+         EXPECT_EQ(Lease.Get(), pFirst);
+         EXPECT_TRUE(Echo(Lease));
+
+         CConnectionPool<CTCPClient>::Lease Second = Pool.Acquire("localhost", TCP_SERVER_PORT);
+         EXPECT_NE(Second.Get(), pFirst);
+         Lease.Release();
+         Second.Release();
+         EXPECT_NE(Pool.Acquire("localhost", TCP_SERVER_PORT).Get(), pFirst);
+      }
+
+      CConnectionPool<CTCPClient>::Stats Stats = Pool.GetStats();
+      EXPECT_EQ(Stats.m_uConnects, 2u);
+      EXPECT_EQ(Stats.m_uHits, 2u);
+
+      // a connection the server closed while it was idle isn't lent out
+      {
+         CConnectionPool<CTCPClient>::Lease Lease = Pool.Acquire("localhost", TCP_SERVER_PORT);
+         EXPECT_TRUE(Lease->Send("bye"));
+         CConnectionPool<CTCPClient>::Lease Other = Pool.Acquire("localhost", TCP_SERVER_PORT);
+         Other.Release();
+      }
+      SleepMs(100);
+      {
+         CConnectionPool<CTCPClient>::Lease Lease = Pool.Acquire("localhost", TCP_SERVER_PORT);
+         ASSERT_TRUE(Lease);
+         EXPECT_TRUE(Echo(Lease));
+      }
+      EXPECT_EQ(Pool.GetStats().m_uProbeFailures, 1u);
+
+      // at most 4 idle connections, then only the minimum survives the idle timeout
+      {
+         std::vector<CConnectionPool<CTCPClient>::Lease> vecLeases;
+         for (int i = 0; i < 6; ++i)
+            vecLeases.push_back(Pool.Acquire("localhost", TCP_SERVER_PORT));
+      }
+      EXPECT_EQ(Pool.GetIdleCount("localhost", TCP_SERVER_PORT), 4u);
+      EXPECT_EQ(Pool.GetStats().m_uOverflows, 2u);
+      EXPECT_EQ(Pool.Prune(), 0u);
+      SleepMs(300);
+      EXPECT_EQ(Pool.Prune(), 3u);
+      EXPECT_EQ(Pool.GetIdleCount("localhost", TCP_SERVER_PORT), 1u);
+
+      // a discarded connection isn't given back
+      Pool.Acquire("localhost", TCP_SERVER_PORT).Discard();
+      EXPECT_EQ(Pool.GetIdleCount("localhost", TCP_SERVER_PORT), 0u);
+      EXPECT_TRUE(Pool.Warm("localhost", TCP_SERVER_PORT));
+      EXPECT_EQ(Pool.GetIdleCount("localhost", TCP_SERVER_PORT), 1u);
+
+      // a minimum above the maximum : warmed up to the maximum only
+      {
+         CConnectionPool<CTCPClient>::Settings oCapped;
+         oCapped.m_uMinIdle = 5;
+         oCapped.m_uMaxIdle = 2;
+         CConnectionPool<CTCPClient> CappedPool([] { return std::unique_ptr<CTCPClient>(new CTCPClient(PRINT_LOG, ASocket::NO_FLAGS)); },
+                                                oCapped);
+         EXPECT_TRUE(CappedPool.Warm("localhost", TCP_SERVER_PORT));
+         EXPECT_EQ(CappedPool.GetIdleCount("localhost", TCP_SERVER_PORT), 2u);
+         EXPECT_EQ(CappedPool.GetStats().m_uConnects, 2u);
+         EXPECT_EQ(CappedPool.GetStats().m_uOverflows, 0u);
+      }
+
+      // short-lived requests from several threads : new connections vs pooled ones
+      const size_t uThreads = 4;
+      const size_t uRequests = 250;
+      auto RunRequests = [&](const std::function<bool()>& fnRequest) -> double
+      {
+         auto StartTime = std::chrono::steady_clock::now();
+         std::vector<std::future<bool>> vecThreads;
+         for (size_t t = 0; t < uThreads; ++t)
+            vecThreads.push_back(std::async(std::launch::async, [&]
+            {
+               bool bSuccess = true;
+               for (size_t r = 0; r < uRequests; ++r)
+                  bSuccess = fnRequest() && bSuccess;
+               return bSuccess;
+            }));
+
+         bool bSuccess = true;
+         for (auto& fut : vecThreads)
+            bSuccess = fut.get() && bSuccess;
+         EXPECT_TRUE(bSuccess);
+
+         return std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+      };
+
+      double dFreshSeconds = RunRequests([&]
+      {
+         CTCPClient Client(PRINT_LOG, ASocket::NO_FLAGS);
+         char szReply[4] = {};
+         return Client.Connect("localhost", TCP_SERVER_PORT) && Client.Send("ping") && Client.Receive(szReply, 4) == 4;
+      });
+
+      const CConnectionPool<CTCPClient>::Stats Before = Pool.GetStats();
+      double dPooledSeconds = RunRequests([&]
+      {
+         CConnectionPool<CTCPClient>::Lease Lease = Pool.Acquire("localhost", TCP_SERVER_PORT);
+         return Lease && Echo(Lease);
+      });
+      const CConnectionPool<CTCPClient>::Stats After = Pool.GetStats();
+
+      EXPECT_LE(After.m_uConnects - Before.m_uConnects, uThreads);
+      std::cout << "** " << uThreads * uRequests << " requests, new connections : " << dFreshSeconds
+                << " s, pooled : " << dPooledSeconds << " s (hit rate " << After.GetHitRate() * 100
+                << " %, average checkout " << After.GetAverageCheckoutUs() << " us, max "
+                << After.m_ullMaxCheckoutNs / 1000.0 << " us)\n";
+
+      Pool.Clear();
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPEventTest, TestFastOpen)
+{
+   if (TCP_TEST_ENABLED)
+   {
+      // both the client (1) and server (2) bits are needed for the data to ride on the SYN
+      int iSysctl = 0;
+      std::ifstream("/proc/sys/net/ipv4/tcp_fastopen") >> iSysctl;
+      const bool bFastOpenEnabled = (iSysctl & 3) == 3;
+
+      std::atomic<size_t> uFastOpened(0);
+      m_pEventServer->SetFastOpen(16);
+      m_pEventServer->SetOnAccept([&](const ASocket::Socket Client)
+      {
+         if (m_pEventServer->IsFastOpenUsed(Client))
+            ++uFastOpened;
+      });
+      m_pEventServer->SetOnData([&](const ASocket::Socket Client, const char* pData, const size_t uSize)
+      {
+         m_pEventServer->Write(Client, pData, uSize);
+      });
+      StartLoop();
+
+      // the first connection fetches the cookie (unless a previous run already did), the next ones use it
+      const std::string strRequest(100, 'r');
+      bool bLastFastOpened = false;
+      for (int i = 0; i < 3; ++i)
+      {
+         CTCPClient Client(PRINT_LOG, ASocket::NO_FLAGS);
+         ASSERT_TRUE(Client.ConnectAndSend("127.0.0.1", TCP_SERVER_PORT, strRequest.data(), strRequest.size()));
+         std::vector<char> Reply(strRequest.size());
+         ASSERT_EQ(static_cast<int>(Reply.size()), Client.Receive(Reply.data(), Reply.size()));
+         EXPECT_EQ(strRequest, std::string(Reply.begin(), Reply.end()));
+         bLastFastOpened = Client.IsFastOpenUsed();
+         EXPECT_TRUE(Client.Disconnect());
+      }
+
+      if (bFastOpenEnabled)
+      {
+         EXPECT_TRUE(bLastFastOpened);
+         EXPECT_GE(uFastOpened.load(), 1u);
+      }
+      else
+      {
+         EXPECT_FALSE(bLastFastOpened);
+         std::cout << "** net.ipv4.tcp_fastopen = " << iSysctl << " : TCP Fast Open isn't enabled on both sides, "
+                      "the data was sent after the handshake" << std::endl;
+      }
+
+      // a server refusing the connection is reported as usual
+      CTCPClient Client(PRINT_LOG, ASocket::NO_FLAGS);
+      EXPECT_FALSE(Client.ConnectAndSend("127.0.0.1", "1", strRequest.data(), strRequest.size()));
+      EXPECT_FALSE(Client.IsConnected());
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPEventTest, BenchmarkFastOpen)
+{
+   if (TCP_TEST_ENABLED && BENCHMARK_TEST_ENABLED)
+   {
+      m_pEventServer->SetFastOpen(256);
+      m_pEventServer->SetOnData([&](const ASocket::Socket Client, const char* pData, const size_t uSize)
+      {
+         m_pEventServer->Write(Client, pData, uSize);
+      });
+      StartLoop();
+
+      // a short request/response per connection : time to the first response byte
+      const size_t uConnections = 1000;
+      const std::string strRequest(64, 'q');
+      char szReply[64];
+
+      auto RunRequests = [&](const bool bFastOpen, size_t& uFastOpened) -> double
+      {
+         uFastOpened = 0;
+         const auto StartTime = std::chrono::steady_clock::now();
+         for (size_t i = 0; i < uConnections; ++i)
+         {
+            CTCPClient Client(PRINT_LOG, ASocket::NO_FLAGS);
+            if (bFastOpen)
+               EXPECT_TRUE(Client.ConnectAndSend("127.0.0.1", TCP_SERVER_PORT, strRequest.data(), strRequest.size()));
+            else
+               EXPECT_TRUE(Client.Connect("127.0.0.1", TCP_SERVER_PORT) && Client.Send(strRequest));
+            EXPECT_EQ(64, Client.Receive(szReply, sizeof(szReply)));
+            if (Client.IsFastOpenUsed())
+               ++uFastOpened;
+         }
+         return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - StartTime).count() / uConnections;
+      };
+
+      size_t uFastOpened = 0;
+      const double dPlainUs = RunRequests(false, uFastOpened);
+      const double dFastOpenUs = RunRequests(true, uFastOpened);
+
+      std::cout << "** " << uConnections << " loopback request/responses, one connection each : connect + send "
+                << dPlainUs << " us, ConnectAndSend " << dFastOpenUs << " us (" << uFastOpened
+                << " fast opened)" << std::endl;
+   }
+   else
+      std::cout << "TCP or benchmark tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPEventTest, BenchmarkBufferPool)
+{
+   if (TCP_TEST_ENABLED && BENCHMARK_TEST_ENABLED)
+   {
+      // the server keeps the last received chunks (e.g. queued for a worker) : with OnData each
+      // one is copied into a new vector, with OnBuffer the pooled block itself is kept
+      const size_t uTotal = 256 * 1024 * 1024;
+      const size_t uChunk = 16 * 1024;
+      const size_t uKept = 64;
+      const std::vector<char> Chunk(uChunk, 'x');
+
+      auto Run = [&](const char* szName, const bool bPooled)
+      {
+         CTCPEventServer EventServer(PRINT_LOG, TCP_SERVER_PORT, ASocket::NO_FLAGS);
+         #ifdef IO_URING
+         EventServer.DisableIoUring(); // recv straight into the pooled blocks
+         #endif
+
+         std::vector<std::vector<char>> vecCopies(uKept);
+         std::vector<CPooledBuffer>     vecPooled(uKept);
+         size_t uReceived = 0;
+         size_t uSlot = 0;
+
+         // warm-up : the pool fills up with the kept blocks. Checked by the callbacks, a single
+         // Poll can drain the whole transfer.
+         bool bWarmedUp = false;
+         CBufferPool::Stats Before = {};
+         size_t uAllocations = 0; // by this thread, which runs the loop
+         size_t uSlotBefore = 0;
+         size_t uWarmUp = 0;
+         std::chrono::steady_clock::time_point StartTime;
+         auto CheckWarmUp = [&]
+         {
+            if (bWarmedUp || uReceived < uTotal / 8)
+               return;
+            bWarmedUp = true;
+            Before = CBufferPool::GetStats();
+            t_puAllocations = &uAllocations;
+            uSlotBefore = uSlot;
+            uWarmUp = uReceived;
+            StartTime = std::chrono::steady_clock::now();
+         };
+
+         if (bPooled)
+            EventServer.SetOnBuffer([&](const ASocket::Socket, CPooledBuffer& Buffer)
+            {
+               uReceived += Buffer.Size();
+               vecPooled[uSlot++ % uKept] = std::move(Buffer);
+               CheckWarmUp();
+            });
+         else
+            EventServer.SetOnData([&](const ASocket::Socket, const char* pData, const size_t uSize)
+            {
+               uReceived += uSize;
+               vecCopies[uSlot++ % uKept] = std::vector<char>(pData, pData + uSize);
+               CheckWarmUp();
+            });
+
+         ASSERT_TRUE(EventServer.Open());
+
+         CTCPClient Client(PRINT_LOG, ASocket::NO_FLAGS);
+         ASSERT_TRUE(Client.Connect("localhost", TCP_SERVER_PORT));
+
+         std::future<void> futSend = std::async(std::launch::async, [&]
+         {
+            for (size_t uOffset = 0; uOffset < uTotal; uOffset += uChunk)
+               Client.Send(Chunk);
+         });
+
+         int iPolled = 0;
+         while (uReceived < uTotal && iPolled >= 0)
+            iPolled = EventServer.Poll(1000);
+         t_puAllocations = nullptr;
+         ASSERT_GE(iPolled, 0);
+
+         double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+         CBufferPool::Stats After = CBufferPool::GetStats();
+         futSend.get();
+
+         const size_t uChunks = uSlot - uSlotBefore;
+         std::cout << "** " << szName << " : " << ((uTotal - uWarmUp) / (1024.0 * 1024.0)) / dSeconds << " MB/s, "
+                   << uChunks << " chunks, heap allocations : " << uAllocations << "\n";
+
+         if (bPooled)
+         {
+            // steady state : every block comes back to the loop thread's free list
+            EXPECT_EQ(After.m_uSystemAllocations, Before.m_uSystemAllocations);
+            EXPECT_LT(uAllocations, uChunks / 10);
+         }
+         else
+         {
+            EXPECT_GE(uAllocations, uChunks);
+         }
+
+         EXPECT_TRUE(Client.Disconnect());
+      };
+
+      Run("vector per chunk", false);
+      Run("pooled buffers", true);
+   }
+   else
+      std::cout << "TCP or benchmark tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPEventTest, BenchmarkSmallMessages)
+{
+   if (TCP_TEST_ENABLED && BENCHMARK_TEST_ENABLED)
+   {
+      const size_t uClients = 8;
+      const size_t uMessages = 50000; // per client
+      const size_t uMsgSize = 64;
+      const double dTotalMsgs = static_cast<double>(uClients * uMessages);
+
+      // every client pipelines its messages and reads back the echoes
+      auto RunClients = [&]() -> double
+      {
+         auto StartTime = std::chrono::steady_clock::now();
+         std::vector<std::future<bool>> vecClients;
+
+         for (size_t c = 0; c < uClients; ++c)
+         {
+            vecClients.push_back(std::async(std::launch::async, [&]() -> bool
+            {
+               CTCPClient Client(PRINT_LOG, ASocket::NO_FLAGS);
+               if (!Client.Connect("localhost", TCP_SERVER_PORT))
+                  return false;
+
+               std::future<int> futReceive = std::async(std::launch::async, [&]
+               {
+                  std::vector<char> RcvBuffer(uMessages * uMsgSize);
+                  return Client.Receive(RcvBuffer.data(), RcvBuffer.size());
+               });
+
+               const std::vector<char> Msg(uMsgSize, 'x');
+               for (size_t m = 0; m < uMessages; ++m)
+                  Client.Send(Msg);
+
+               return futReceive.get() == static_cast<int>(uMessages * uMsgSize);
+            }));
+         }
+
+         bool bSuccess = true;
+         for (auto& fut : vecClients)
+            bSuccess = fut.get() && bSuccess;
+         EXPECT_TRUE(bSuccess);
+
+         return std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+      };
+
+      auto Report = [&](const char* szName, const double dSeconds, const unsigned long long uSyscalls)
+      {
+         std::cout << "** " << szName << " : " << dTotalMsgs / dSeconds << " msgs/sec, "
+                   << uSyscalls / dTotalMsgs << " server syscalls/msg\n";
+      };
+
+      // blocking path : one thread per client, Receive + Send per chunk
+      {
+         std::atomic<unsigned long long> uSyscalls(0);
+         CTCPServer BlockingServer(PRINT_LOG, TCP_SERVER_PORT, ASocket::NO_FLAGS);
+
+         std::future<void> futServer = std::async(std::launch::async, [&]
+         {
+            std::vector<std::future<void>> vecWorkers;
+            for (size_t c = 0; c < uClients; ++c)
+            {
+               ASocket::Socket ConnectedClient;
+               if (!BlockingServer.Listen(ConnectedClient))
+                  break;
+
+               vecWorkers.push_back(std::async(std::launch::async, [&, ConnectedClient]
+               {
+                  std::vector<char> Buffer(64 * 1024);
+                  int nRecvd;
+                  while ((nRecvd = BlockingServer.Receive(ConnectedClient, Buffer.data(), Buffer.size(), false)) > 0)
+                  {
+                     BlockingServer.Send(ConnectedClient, Buffer.data(), nRecvd);
+                     uSyscalls += 2;
+                  }
+                  BlockingServer.Disconnect(ConnectedClient);
+               }));
+            }
+         });
+         SleepMs(100);
+
+         double dSeconds = RunClients();
+         futServer.get();
+         Report("blocking", dSeconds, uSyscalls);
+      }
+
+      auto RunEventServer = [&](const char* szName, const bool bAllowIoUring)
+      {
+         CTCPEventServer EventServer(PRINT_LOG, TCP_SERVER_PORT, ASocket::NO_FLAGS);
+         #ifdef IO_URING
+         if (!bAllowIoUring)
+            EventServer.DisableIoUring();
+         #else
+         (void) bAllowIoUring;
+         #endif
+         EventServer.SetOnData([&](const ASocket::Socket Client, const char* pData, const size_t uSize)
+         {
+            EventServer.Write(Client, pData, uSize);
+         });
+
+         std::thread LoopThread([&] { EventServer.Run(); });
+         SleepMs(100);
+
+         double dSeconds = RunClients();
+         EventServer.Stop();
+         LoopThread.join();
+         Report(szName, dSeconds, EventServer.GetSyscallCount());
+      };
+
+      RunEventServer("epoll", false);
+      #ifdef IO_URING
+      RunEventServer("io_uring", true);
+      #endif
+   }
+   else
+      std::cout << "TCP or benchmark tests are disabled !" << std::endl;
+}
+#endif
+
+#if defined(COROUTINES) && defined(LINUX)
+// coroutines spawned on a reactor : their arguments are copied in their frames, unlike a lambda's captures
+static CCoroTask<void> CoroEchoSession(CCoroReactor& Reactor, const ASocket::Socket ClientSocket)
+{
+   CCoroSocket Client(Reactor, ClientSocket);
+   char szBuffer[4096];
+   int nRecvd;
+   while ((nRecvd = co_await Client.Receive(szBuffer, sizeof(szBuffer))) > 0)
+      if (!co_await Client.Send(szBuffer, nRecvd))
+         break;
+}
+
+// accepts until the reactor stops, each client is served on the next reactor of the pool (if any)
+static CCoroTask<void> CoroEchoAcceptor(CCoroReactor& Reactor, CTCPServer& Server, CCoroReactorPool* pPool)
+{
+   for (;;)
+   {
+      const ASocket::Socket ClientSocket = co_await CCoroSocket::Accept(Reactor, Server);
+      if (ClientSocket == INVALID_SOCKET)
+         break;
+
+      CCoroReactor& SessionReactor = pPool ? pPool->GetNext() : Reactor;
+      SessionReactor.Spawn(CoroEchoSession(SessionReactor, ClientSocket));
+   }
+}
+
+// uRounds request/echo exchanges of uMsgSize bytes
+static CCoroTask<void> CoroEchoClient(CCoroReactor& Reactor, const size_t uRounds, const size_t uMsgSize,
+                                      std::atomic<size_t>* pSucceeded, std::atomic<size_t>* pDone)
+{
+   CCoroSocket Client(Reactor, co_await CCoroSocket::Connect(Reactor, "localhost", TCP_SERVER_PORT));
+
+   std::vector<char> Msg(uMsgSize);
+   std::vector<char> Echo(uMsgSize);
+   bool bSuccess = Client.IsOpen();
+   for (size_t r = 0; bSuccess && r < uRounds; ++r)
+   {
+      std::fill(Msg.begin(), Msg.end(), static_cast<char>('a' + (Client.GetSocket() + r) % 26));
+      bSuccess = co_await Client.Send(Msg.data(), Msg.size()) &&
+                 co_await Client.ReceiveExactly(Echo.data(), Echo.size()) == static_cast<int>(uMsgSize) &&
+                 Echo == Msg;
+   }
+
+   if (bSuccess)
+      ++*pSucceeded;
+   ++*pDone;
+}
+
+TEST_F(TCPTest, TestCoroutines)
+{
+   if (TCP_TEST_ENABLED)
+   {
+      const size_t uClients = 100;
+      const size_t uRounds = 20;
+      const size_t uMsgSize = 10000; // several receives per message
+
+      ASSERT_NO_THROW(m_pTCPServer.reset(new CTCPServer(PRINT_LOG, TCP_SERVER_PORT, ASocket::NO_FLAGS)));
+
+      // the server and its clients all run on this reactor's thread
+      CCoroReactor Reactor(PRINT_LOG);
+      std::thread LoopThread([&] { EXPECT_TRUE(Reactor.Run()); });
+
+      std::atomic<size_t> uSucceeded(0);
+      std::atomic<size_t> uDone(0);
+      Reactor.Spawn(CoroEchoAcceptor(Reactor, *m_pTCPServer, nullptr));
+      for (size_t c = 0; c < uClients; ++c)
+         Reactor.Spawn(CoroEchoClient(Reactor, uRounds, uMsgSize, &uSucceeded, &uDone));
+
+      for (int i = 0; i < 1000 && uDone < uClients; ++i)
+         SleepMs(10);
+      EXPECT_EQ(uSucceeded, uClients);
+
+      // a silent client keeps its session waiting : stopping the reactor must end it, and the acceptor
+      ASSERT_TRUE(m_pTCPClient->Connect("localhost", TCP_SERVER_PORT));
+      for (int i = 0; i < 100 && Reactor.GetTaskCount() != 2; ++i)
+         SleepMs(10);
+      EXPECT_EQ(Reactor.GetTaskCount(), 2u);
+
+      Reactor.Stop();
+      LoopThread.join();
+      EXPECT_EQ(Reactor.GetTaskCount(), 0u);
+
+      // the session closed its socket on its way out
+      char cByte;
+      EXPECT_EQ(m_pTCPClient->Receive(&cByte, 1), 0);
+      m_pTCPClient->Disconnect();
+   }
+   else
+      std::cout << "TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(TCPTest, BenchmarkCoroutineEcho)
 {
-   if (TCP_TEST_ENABLED)
+   if (TCP_TEST_ENABLED && BENCHMARK_TEST_ENABLED)
    {
-      ASocket::Socket ConnectedClient;
+      const size_t uClients = 1000;
+      const size_t uRounds = 100;
+      const size_t uMsgSize = 64;
+      const double dTotalRoundTrips = static_cast<double>(uClients * uRounds);
+
+      // both ends of every connection live in this process
+      struct rlimit FdLimit;
+      ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &FdLimit), 0);
+      FdLimit.rlim_cur = FdLimit.rlim_max;
+      setrlimit(RLIMIT_NOFILE, &FdLimit);
+      ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &FdLimit), 0);
+      ASSERT_GT(FdLimit.rlim_cur, 2 * uClients + 64);
+
+      // VmSize and VmRSS of the process, in kB
+      auto ReadMemory = [](size_t& uVirtualKb, size_t& uResidentKb)
+      {
+         std::ifstream Status("/proc/self/status");
+         std::string strLine;
+         while (std::getline(Status, strLine))
+         {
+            if (strLine.compare(0, 7, "VmSize:") == 0)
+               uVirtualKb = std::stoul(strLine.substr(7));
+            else if (strLine.compare(0, 6, "VmRSS:") == 0)
+               uResidentKb = std::stoul(strLine.substr(6));
+         }
+      };
 
-      ASSERT_NO_THROW(m_pTCPServer.reset(new CTCPServer(PRINT_LOG, TCP_SERVER_PORT)));
+      // the same coroutine clients, on their own thread, load every server
+      auto RunClients = [&](const char* szName, const size_t uServerThreads)
+      {
+         size_t uBaseVirtualKb = 0, uBaseResidentKb = 0;
+         ReadMemory(uBaseVirtualKb, uBaseResidentKb);
+
+         CCoroReactor ClientReactor(PRINT_LOG);
+         std::atomic<size_t> uSucceeded(0);
+         std::atomic<size_t> uDone(0);
+         for (size_t c = 0; c < uClients; ++c)
+            ClientReactor.Spawn(CoroEchoClient(ClientReactor, uRounds, uMsgSize, &uSucceeded, &uDone));
+
+         auto StartTime = std::chrono::steady_clock::now();
+         std::thread ClientThread([&] { ClientReactor.Run(); });
+
+         size_t uPeakVirtualKb = uBaseVirtualKb, uPeakResidentKb = uBaseResidentKb;
+         for (int i = 0; i < 12000 && uDone < uClients; ++i)
+         {
+            size_t uVirtualKb = 0, uResidentKb = 0;
+            ReadMemory(uVirtualKb, uResidentKb);
+            uPeakVirtualKb = std::max(uPeakVirtualKb, uVirtualKb);
+            uPeakResidentKb = std::max(uPeakResidentKb, uResidentKb);
+            SleepMs(5);
+         }
+         const double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+
+         ClientReactor.Stop();
+         ClientThread.join();
+         EXPECT_EQ(uSucceeded, uClients);
+
+         std::cout << "** " << szName << " (" << uServerThreads << " server threads) : "
+                   << dTotalRoundTrips / dSeconds << " round trips/sec, peak memory growth "
+                   << (uPeakVirtualKb - uBaseVirtualKb) / 1024 << " MB virtual, "
+                   << (uPeakResidentKb - uBaseResidentKb) / 1024 << " MB resident\n";
+      };
 
-      ASSERT_FALSE(m_pTCPServer->Listen(ConnectedClient, 3000)); // 3 sec max wait
+      std::cout << "** " << uClients << " connections, " << uRounds << " round trips of "
+                << uMsgSize << " bytes each\n";
 
-      ASSERT_TRUE(ConnectedClient == INVALID_SOCKET);
+      // the blocking pattern : one std::async thread per client
+      {
+         CTCPServer BlockingServer(PRINT_LOG, TCP_SERVER_PORT, ASocket::NO_FLAGS);
+
+         std::future<void> futServer = std::async(std::launch::async, [&]
+         {
+            std::vector<std::future<void>> vecWorkers;
+            for (size_t c = 0; c < uClients; ++c)
+            {
+               ASocket::Socket ConnectedClient;
+               if (!BlockingServer.Listen(ConnectedClient))
+                  break;
+
+               vecWorkers.push_back(std::async(std::launch::async, [&, ConnectedClient]
+               {
+                  char szBuffer[4096];
+                  int nRecvd;
+                  while ((nRecvd = BlockingServer.Receive(ConnectedClient, szBuffer, sizeof(szBuffer), false)) > 0)
+                     BlockingServer.Send(ConnectedClient, szBuffer, nRecvd);
+                  BlockingServer.Disconnect(ConnectedClient);
+               }));
+            }
+         });
+         SleepMs(100);
+
+         RunClients("thread per connection", uClients + 1);
+         futServer.get();
+      }
+
+      // coroutines : a single reactor, then the sessions spread over a pool
+      {
+         CTCPServer CoroServer(PRINT_LOG, TCP_SERVER_PORT, ASocket::NO_FLAGS);
+         CCoroReactor Reactor(PRINT_LOG);
+         Reactor.Spawn(CoroEchoAcceptor(Reactor, CoroServer, nullptr));
+         std::thread LoopThread([&] { Reactor.Run(); });
+
+         RunClients("coroutines, 1 reactor", 1);
+         Reactor.Stop();
+         LoopThread.join();
+      }
+
+      {
+         const size_t uPoolThreads = 2;
+         CTCPServer CoroServer(PRINT_LOG, TCP_SERVER_PORT, ASocket::NO_FLAGS);
+         CCoroReactorPool Pool(PRINT_LOG, uPoolThreads);
+         CCoroReactor Acceptor(PRINT_LOG);
+         Acceptor.Spawn(CoroEchoAcceptor(Acceptor, CoroServer, &Pool));
+         std::thread AcceptorThread([&] { Acceptor.Run(); });
+
+         RunClients("coroutines, reactor pool", uPoolThreads + 1);
+         Acceptor.Stop();
+         AcceptorThread.join();
+         Pool.Stop();
+      }
    }
    else
-      std::cout << "TCP tests are disabled !" << std::endl;
+      std::cout << "TCP or benchmark tests are disabled !" << std::endl;
 }
+#endif
 
 #ifdef OPENSSL
 /*
@@ -672,6 +3673,686 @@ TEST_F(SSLTCPTest, TestLoopbackTenMegabytes)
       std::cout << "SECURE TCP tests are disabled !" << std::endl;
 }
 
+TEST_F(SSLTCPTest, TestMessageFraming)
+{
+   if (SECURE_TCP_TEST_ENABLED)
+   {
+      ASSERT_NO_THROW(m_pSSLTCPServer.reset(new CTCPSSLServer(PRINT_LOG, SECURE_TCP_SERVER_PORT)));
+
+      m_pSSLTCPServer->SetSSLCertFile(SSL_CERT_FILE);
+      m_pSSLTCPServer->SetSSLKeyFile(SSL_KEY_FILE);
+
+      std::vector<std::string> vecMessages;
+      for (size_t i = 0; i < 1000; ++i)
+         vecMessages.push_back(std::string(i % 100, static_cast<char>('a' + i % 26)));
+
+      std::future<bool> futClient = std::async(std::launch::async, [&]() -> bool
+      {
+         // give time to let the server object reach the accept instruction.
+         SleepMs(100);
+
+         if (!m_pSSLTCPClient->Connect("localhost", SECURE_TCP_SERVER_PORT))
+            return false;
+
+         CMessageFramer Framer = CMessageFramer::ForClient(*m_pSSLTCPClient, CMessageFramer::PREFIX_VARINT);
+         for (const std::string& strMessage : vecMessages)
+            Framer.Queue(strMessage.data(), strMessage.size());
+
+         // the whole batch in one SSL_write
+         if (!Framer.Flush() || Framer.GetSendCalls() != 1)
+            return false;
+
+         CMessageFramer::FrameView Frame;
+         return Framer.Receive(Frame) == 1 && std::string(Frame.m_pData, Frame.m_uSize) == "done";
+      });
+
+      ASecureSocket::SSLSocket ConnectedClient;
+      ASSERT_TRUE(m_pSSLTCPServer->Listen(ConnectedClient, 5000));
+
+      CMessageFramer Framer = CMessageFramer::ForServer(*m_pSSLTCPServer, ConnectedClient, CMessageFramer::PREFIX_VARINT);
+      std::vector<CMessageFramer::FrameView> vecFrames;
+      size_t uReceived = 0;
+      bool bSameData = true;
+      while (uReceived < vecMessages.size())
+      {
+         ASSERT_GT(Framer.Receive(vecFrames), 0);
+         for (const CMessageFramer::FrameView& Frame : vecFrames)
+            bSameData = bSameData && std::string(Frame.m_pData, Frame.m_uSize) == vecMessages[uReceived++];
+      }
+      EXPECT_TRUE(bSameData);
+      EXPECT_LT(Framer.GetReceiveCalls(), vecMessages.size() / 10);
+
+      EXPECT_TRUE(Framer.Send("done"));
+      EXPECT_TRUE(futClient.get());
+
+      EXPECT_TRUE(m_pSSLTCPClient->Disconnect());
+      EXPECT_TRUE(m_pSSLTCPServer->Disconnect(ConnectedClient));
+   }
+   else
+      std::cout << "SECURE TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(SSLTCPTest, TestReloadCertificates)
+{
+   if (SECURE_TCP_TEST_ENABLED)
+   {
+      ASSERT_NO_THROW(m_pSSLTCPServer.reset(new CTCPSSLServer(PRINT_LOG, SECURE_TCP_SERVER_PORT)));
+
+      m_pSSLTCPServer->SetSSLCertFile(SSL_CERT_FILE);
+      m_pSSLTCPServer->SetSSLKeyFile(SSL_KEY_FILE);
+
+      // the server closes first, the client waits for its close_notify
+      auto HandshakeOnce = [&]() -> bool
+      {
+         std::future<bool> futConnect = std::async(std::launch::async, [&]() -> bool
+         {
+            // give time to let the server object reach the accept instruction.
+            SleepMs(100);
+
+            CTCPSSLClient SSLClient(PRINT_LOG, ASecureSocket::OpenSSLProtocol::TLS, ASocket::NO_FLAGS);
+            if (!SSLClient.Connect("localhost", SECURE_TCP_SERVER_PORT))
+               return false;
+
+            char cByte;
+            SSLClient.Receive(&cByte, 1);
+            return SSLClient.Disconnect();
+         });
+
+         ASecureSocket::SSLSocket ConnectedClient;
+         bool bAccepted = m_pSSLTCPServer->Listen(ConnectedClient, 5000);
+         if (bAccepted)
+            m_pSSLTCPServer->Disconnect(ConnectedClient);
+
+         return futConnect.get() && bAccepted;
+      };
+
+      EXPECT_TRUE(HandshakeOnce());
+
+      // a broken certificate path is refused and the current context is kept
+      m_pSSLTCPServer->SetSSLCertFile("this_file_does_not_exist.pem");
+      EXPECT_FALSE(m_pSSLTCPServer->ReloadCertificates());
+      EXPECT_TRUE(HandshakeOnce());
+
+      m_pSSLTCPServer->SetSSLCertFile(SSL_CERT_FILE);
+      EXPECT_TRUE(m_pSSLTCPServer->ReloadCertificates());
+      EXPECT_TRUE(HandshakeOnce());
+   }
+   else
+      std::cout << "SECURE TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(SSLTCPTest, TestSessionResumption)
+{
+   if (SECURE_TCP_TEST_ENABLED)
+   {
+      const size_t uConnections = 20;
+
+      ASSERT_NO_THROW(m_pSSLTCPServer.reset(new CTCPSSLServer(PRINT_LOG, SECURE_TCP_SERVER_PORT)));
+
+      m_pSSLTCPServer->SetSSLCertFile(SSL_CERT_FILE);
+      m_pSSLTCPServer->SetSSLKeyFile(SSL_KEY_FILE);
+
+      CTCPSSLClient::ClearSessionCache();
+      const unsigned long long uHitsBefore = CTCPSSLClient::GetSessionCacheHits();
+      const unsigned long long uMissesBefore = CTCPSSLClient::GetSessionCacheMisses();
+
+      std::future<size_t> futClients = std::async(std::launch::async, [&]() -> size_t
+      {
+         // give time to let the server object reach the accept instruction.
+         SleepMs(100);
+
+         size_t uResumed = 0;
+         for (size_t i = 0; i < uConnections; ++i)
+         {
+            // a new client object each time : the cache is shared by the process
+            CTCPSSLClient SSLClient(PRINT_LOG, ASecureSocket::OpenSSLProtocol::TLS, ASocket::NO_FLAGS);
+            if (!SSLClient.Connect("localhost", SECURE_TCP_SERVER_PORT))
+               continue;
+
+            if (SSLClient.IsSessionResumed())
+               ++uResumed;
+
+            // with TLS 1.3 the tickets come after the handshake, read until the server closes
+            char cByte;
+            SSLClient.Receive(&cByte, 1);
+            SSLClient.Disconnect();
+         }
+         return uResumed;
+      });
+
+      for (size_t i = 0; i < uConnections; ++i)
+      {
+         ASecureSocket::SSLSocket ConnectedClient;
+         if (m_pSSLTCPServer->Listen(ConnectedClient, 5000))
+            m_pSSLTCPServer->Disconnect(ConnectedClient);
+      }
+
+      // only the first connection needs a full handshake
+      EXPECT_EQ(futClients.get(), uConnections - 1);
+      EXPECT_EQ(CTCPSSLClient::GetSessionCacheHits() - uHitsBefore, uConnections - 1);
+      EXPECT_EQ(CTCPSSLClient::GetSessionCacheMisses() - uMissesBefore, 1u);
+
+      EXPECT_EQ(m_pSSLTCPServer->GetSessionHits(), uConnections - 1);
+      EXPECT_EQ(m_pSSLTCPServer->GetSessionMisses(), 1u);
+
+      std::cout << "** resumption rate : "
+                << 100.0 * m_pSSLTCPServer->GetSessionHits() / uConnections << " %\n";
+   }
+   else
+      std::cout << "SECURE TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(SSLTCPTest, TestSessionCacheIsolation)
+{
+   if (SECURE_TCP_TEST_ENABLED)
+   {
+      ASSERT_NO_THROW(m_pSSLTCPServer.reset(new CTCPSSLServer(PRINT_LOG, SECURE_TCP_SERVER_PORT)));
+
+      m_pSSLTCPServer->SetSSLCertFile(SSL_CERT_FILE);
+      m_pSSLTCPServer->SetSSLKeyFile(SSL_KEY_FILE);
+
+      CTCPSSLClient::ClearSessionCache();
+
+      // no CA, no CA, the server's certificate as CA, the same again
+      const std::vector<std::string> vecCAFiles = { "", "", SSL_CERT_FILE, SSL_CERT_FILE };
+      std::future<std::vector<bool>> futClients = std::async(std::launch::async, [&]() -> std::vector<bool>
+      {
+         // give time to let the server object reach the accept instruction.
+         SleepMs(100);
+
+         std::vector<bool> vecResumed;
+         for (const std::string& strCAFile : vecCAFiles)
+         {
+            CTCPSSLClient SSLClient(PRINT_LOG, ASecureSocket::OpenSSLProtocol::TLS, ASocket::NO_FLAGS);
+            SSLClient.SetSSLCerthAuth(strCAFile);
+            const bool bConnected = SSLClient.Connect("localhost", SECURE_TCP_SERVER_PORT);
+            vecResumed.push_back(bConnected && SSLClient.IsSessionResumed());
+
+            // with TLS 1.3 the tickets come after the handshake, read until the server closes
+            char cByte;
+            if (bConnected)
+               SSLClient.Receive(&cByte, 1);
+            SSLClient.Disconnect();
+         }
+         return vecResumed;
+      });
+
+      for (size_t i = 0; i < vecCAFiles.size(); ++i)
+      {
+         ASecureSocket::SSLSocket ConnectedClient;
+         if (m_pSSLTCPServer->Listen(ConnectedClient, 5000))
+            m_pSSLTCPServer->Disconnect(ConnectedClient);
+      }
+
+      // the session received without a CA isn't offered by the client verifying the server
+      const std::vector<bool> vecResumed = futClients.get();
+      EXPECT_EQ(vecResumed, std::vector<bool>({ false, true, false, true }));
+   }
+   else
+      std::cout << "SECURE TCP tests are disabled !" << std::endl;
+}
+
+TEST_F(SSLTCPTest, TestConnectionPool)
+{
+   if (SECURE_TCP_TEST_ENABLED)
+   {
+      ASSERT_NO_THROW(m_pSSLTCPServer.reset(new CTCPSSLServer(PRINT_LOG, SECURE_TCP_SERVER_PORT)));
+
+      m_pSSLTCPServer->SetSSLCertFile(SSL_CERT_FILE);
+      m_pSSLTCPServer->SetSSLKeyFile(SSL_KEY_FILE);
+
+      typedef CConnectionPool<CTCPSSLClient> SSLPool;
+      std::future<SSLPool::Stats> futClient = std::async(std::launch::async, [&]() -> SSLPool::Stats
+      {
+         // give time to let the server object reach the accept instruction.
+         SleepMs(100);
+
+         SSLPool::Settings oSettings;
+         oSettings.m_uMinIdle = 1;
+         SSLPool Pool([] { return std::unique_ptr<CTCPSSLClient>(
+                              new CTCPSSLClient(PRINT_LOG, ASecureSocket::OpenSSLProtocol::TLS, ASocket::NO_FLAGS)); },
+                      oSettings);
+
+         auto Ping = [](SSLPool::Lease& Lease) -> bool
+         {
+            char szReply[4] = {};
+            return Lease && Lease->SetRcvTimeout(2000) && Lease->Send("ping") &&
+                   Lease->Receive(szReply, 4) == 4 && std::string(szReply, 4) == "ping";
+         };
+
+         // nothing read since the handshake : the TLS 1.3 session tickets are waiting on the socket
+         Pool.Warm("localhost", SECURE_TCP_SERVER_PORT);
+         SleepMs(100);
+         {
+            SSLPool::Lease Lease = Pool.Acquire("localhost", SECURE_TCP_SERVER_PORT);
+            EXPECT_TRUE(Ping(Lease));
+         }
+
+         // half of the reply left in OpenSSL's buffer, the socket itself is empty
+         {
+            SSLPool::Lease Lease = Pool.Acquire("localhost", SECURE_TCP_SERVER_PORT);
+            EXPECT_TRUE(Ping(Lease));
+         }
+
+         // closed by the server (close_notify) while it was idle
+         SleepMs(100);
+         {
+            SSLPool::Lease Lease = Pool.Acquire("localhost", SECURE_TCP_SERVER_PORT);
+            EXPECT_TRUE(Ping(Lease));
+         }
+         return Pool.GetStats();
+      });
+
+      char szRequest[4] = {};
+      ASecureSocket::SSLSocket Warmed;
+      ASSERT_TRUE(m_pSSLTCPServer->Listen(Warmed, 5000));
+      m_pSSLTCPServer->SetRcvTimeout(Warmed, 2000);
+      EXPECT_EQ(4, m_pSSLTCPServer->Receive(Warmed, szRequest, 4));
+      EXPECT_TRUE(m_pSSLTCPServer->Send(Warmed, "pingpong"));
+
+      ASecureSocket::SSLSocket Closed;
+      ASSERT_TRUE(m_pSSLTCPServer->Listen(Closed, 5000));
+      m_pSSLTCPServer->SetRcvTimeout(Closed, 2000);
+      EXPECT_EQ(4, m_pSSLTCPServer->Receive(Closed, szRequest, 4));
+      EXPECT_TRUE(m_pSSLTCPServer->Send(Closed, "ping"));
+      EXPECT_TRUE(m_pSSLTCPServer->Disconnect(Closed));
+
+      ASecureSocket::SSLSocket Last;
+      ASSERT_TRUE(m_pSSLTCPServer->Listen(Last, 5000));
+      m_pSSLTCPServer->SetRcvTimeout(Last, 2000);
+      EXPECT_EQ(4, m_pSSLTCPServer->Receive(Last, szRequest, 4));
+      EXPECT_TRUE(m_pSSLTCPServer->Send(Last, "ping"));
+
+      const SSLPool::Stats Stats = futClient.get();
+      EXPECT_EQ(Stats.m_uCheckouts, 3u);
+      EXPECT_EQ(Stats.m_uHits, 1u);
+      EXPECT_EQ(Stats.m_uConnects, 3u);
+      EXPECT_EQ(Stats.m_uProbeFailures, 2u);
+
+      EXPECT_TRUE(m_pSSLTCPServer->Disconnect(Last));
+      EXPECT_TRUE(m_pSSLTCPServer->Disconnect(Warmed));
+   }
+   else
+      std::cout << "SECURE TCP tests are disabled !" << std::endl;
+}
+
+#ifdef LINUX
+TEST_F(SSLTCPTest, TestHandshakeTimeout)
+{
+   if (SECURE_TCP_TEST_ENABLED)
+   {
+      const size_t uHandshakeTimeoutMs = 300;
+
+      ASSERT_NO_THROW(m_pSSLTCPServer.reset(new CTCPSSLServer(PRINT_LOG, SECURE_TCP_SERVER_PORT)));
+
+      m_pSSLTCPServer->SetSSLCertFile(SSL_CERT_FILE);
+      m_pSSLTCPServer->SetSSLKeyFile(SSL_KEY_FILE);
+      m_pSSLTCPServer->SetHandshakeTimeout(uHandshakeTimeoutMs, true);
+
+      // a plain TCP client never starts the handshake
+      std::future<int> futSilent = std::async(std::launch::async, [&]() -> int
+      {
+         // give time to let the server object reach the accept instruction.
+         SleepMs(100);
+
+         CTCPClient Silent(PRINT_LOG, ASocket::NO_FLAGS);
+         if (!Silent.Connect("localhost", SECURE_TCP_SERVER_PORT) ||
+             ASocket::SelectSocket(Silent.GetSocketDescriptor(), 5000) != 1)
+            return 0;
+
+         char cByte;
+         return (recv(Silent.GetSocketDescriptor(), &cByte, 1, 0) < 0) ? errno : 0;
+      });
+
+      ASecureSocket::SSLSocket ConnectedClient;
+      auto StartTime = std::chrono::steady_clock::now();
+      EXPECT_FALSE(m_pSSLTCPServer->Listen(ConnectedClient, 5000));
+      const long long llElapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+         std::chrono::steady_clock::now() - StartTime).count();
+      EXPECT_GE(llElapsedMs, static_cast<long long>(uHandshakeTimeoutMs));
+      EXPECT_LT(llElapsedMs, 5000);
+
+      // reset, not closed gracefully
+      EXPECT_EQ(futSilent.get(), ECONNRESET);
+      EXPECT_EQ(m_pSSLTCPServer->GetHandshakeTimeoutCount(), 1u);
+
+      // a real client completes its handshake in time
+      std::future<bool> futConnect = std::async(std::launch::async, [&]() -> bool
+      {
+         SleepMs(100);
+
+         CTCPSSLClient SSLClient(PRINT_LOG, ASecureSocket::OpenSSLProtocol::TLS, ASocket::NO_FLAGS);
+         if (!SSLClient.Connect("localhost", SECURE_TCP_SERVER_PORT))
+            return false;
+
+         char cByte;
+         SSLClient.Receive(&cByte, 1);
+         return SSLClient.Disconnect();
+      });
+
+      ASecureSocket::SSLSocket SecondClient;
+      const bool bAccepted = m_pSSLTCPServer->Listen(SecondClient, 5000);
+      EXPECT_TRUE(bAccepted);
+      if (bAccepted)
+         m_pSSLTCPServer->Disconnect(SecondClient);
+
+      EXPECT_TRUE(futConnect.get());
+      EXPECT_EQ(m_pSSLTCPServer->GetHandshakeTimeoutCount(), 1u);
+   }
+   else
+      std::cout << "SECURE TCP tests are disabled !" << std::endl;
+}
+#endif
+
+TEST_F(SSLTCPTest, BenchmarkHandshakes)
+{
+   if (SECURE_TCP_TEST_ENABLED && BENCHMARK_TEST_ENABLED)
+   {
+      const size_t uHandshakes = 500;
+
+      ASSERT_NO_THROW(m_pSSLTCPServer.reset(new CTCPSSLServer(PRINT_LOG, SECURE_TCP_SERVER_PORT)));
+
+      m_pSSLTCPServer->SetSSLCertFile(SSL_CERT_FILE);
+      m_pSSLTCPServer->SetSSLKeyFile(SSL_KEY_FILE);
+
+      // bReloadEachTime rebuilds the context before every accept, as Listen used to do
+      auto Measure = [&](const bool bReloadEachTime) -> double
+      {
+         std::future<size_t> futClients = std::async(std::launch::async, [&]() -> size_t
+         {
+            // give time to let the server object reach the accept instruction.
+            SleepMs(100);
+
+            size_t uConnected = 0;
+            for (size_t i = 0; i < uHandshakes; ++i)
+            {
+               CTCPSSLClient SSLClient(PRINT_LOG, ASecureSocket::OpenSSLProtocol::TLS, ASocket::NO_FLAGS);
+               if (!SSLClient.Connect("localhost", SECURE_TCP_SERVER_PORT))
+                  continue;
+
+               char cByte;
+               SSLClient.Receive(&cByte, 1);
+               SSLClient.Disconnect();
+               ++uConnected;
+            }
+            return uConnected;
+         });
+
+         auto StartTime = std::chrono::steady_clock::now();
+         for (size_t i = 0; i < uHandshakes; ++i)
+         {
+            if (bReloadEachTime)
+               m_pSSLTCPServer->ReloadCertificates();
+
+            ASecureSocket::SSLSocket ConnectedClient;
+            if (m_pSSLTCPServer->Listen(ConnectedClient, 5000))
+               m_pSSLTCPServer->Disconnect(ConnectedClient);
+         }
+         double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+
+         EXPECT_EQ(futClients.get(), uHandshakes);
+         return uHandshakes / dSeconds;
+      };
+
+      double dPerConnection = Measure(true);
+      double dShared = Measure(false);
+
+      std::cout << "** context per connection : " << dPerConnection << " handshakes/sec\n";
+      std::cout << "** shared context : " << dShared << " handshakes/sec\n";
+   }
+   else
+      std::cout << "SECURE TCP or benchmark tests are disabled !" << std::endl;
+}
+
+#ifdef LINUX
+TEST_F(SSLTCPTest, TestThousandConcurrentHandshakes)
+{
+   if (SECURE_TCP_TEST_ENABLED)
+   {
+      const size_t uConnections = 1000;
+
+      // both ends of every connection live in this process
+      struct rlimit FdLimit;
+      ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &FdLimit), 0);
+      FdLimit.rlim_cur = FdLimit.rlim_max;
+      setrlimit(RLIMIT_NOFILE, &FdLimit);
+      ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &FdLimit), 0);
+      ASSERT_GT(FdLimit.rlim_cur, 2 * uConnections + 64);
+
+      ASSERT_NO_THROW(m_pSSLTCPServer.reset(new CTCPSSLServer(PRINT_LOG, SECURE_TCP_SERVER_PORT)));
+
+      m_pSSLTCPServer->SetSSLCertFile(SSL_CERT_FILE);
+      m_pSSLTCPServer->SetSSLKeyFile(SSL_KEY_FILE);
+
+      std::vector<std::unique_ptr<CTCPSSLClient>> vecClients;
+      for (size_t i = 0; i < uConnections; ++i)
+      {
+         vecClients.emplace_back(new CTCPSSLClient(PRINT_LOG, ASecureSocket::OpenSSLProtocol::TLS, ASocket::NO_FLAGS));
+         vecClients.back()->SetSessionResumption(false);
+      }
+
+      // only the TCP connections are established here, no handshake is started
+      std::future<size_t> futConnect = std::async(std::launch::async, [&]() -> size_t
+      {
+         // give time to let the server object reach the accept instruction.
+         SleepMs(100);
+
+         size_t uConnected = 0;
+         for (auto& pClient : vecClients)
+            if (pClient->BeginConnect("localhost", SECURE_TCP_SERVER_PORT))
+               ++uConnected;
+         return uConnected;
+      });
+
+      std::vector<ASecureSocket::SSLSocket> vecAccepted(uConnections);
+      size_t uAccepted = 0;
+      for (auto& Accepted : vecAccepted)
+         if (m_pSSLTCPServer->BeginAccept(Accepted, 5000))
+            ++uAccepted;
+
+      ASSERT_EQ(futConnect.get(), uConnections);
+      ASSERT_EQ(uAccepted, uConnections);
+
+      // a client that never speaks must not hold the others back
+      CTCPClient SilentClient(PRINT_LOG, ASocket::NO_FLAGS);
+      std::thread SilentThread([&] { SleepMs(100); SilentClient.Connect("localhost", SECURE_TCP_SERVER_PORT); });
+      ASecureSocket::SSLSocket SilentAccepted;
+      ASSERT_TRUE(m_pSSLTCPServer->BeginAccept(SilentAccepted, 5000));
+      SilentThread.join();
+
+      // every handshake, client and server side, is run by this single thread
+      CSSLHandshakeDriver Driver(PRINT_LOG);
+      size_t uSucceeded = 0;
+      size_t uFailed = 0;
+      auto OnDone = [&](const bool bSuccess) { ++(bSuccess ? uSucceeded : uFailed); };
+
+      for (size_t i = 0; i < uConnections; ++i)
+      {
+         ASecureSocket::SSLSocket& Accepted = vecAccepted[i];
+         CTCPSSLClient& Client = *vecClients[i];
+
+         ASSERT_TRUE(Driver.Add(Accepted.m_SockFd, [&] { return m_pSSLTCPServer->ContinueAccept(Accepted); },
+                                OnDone, 60000));
+         ASSERT_TRUE(Driver.Add(Client.GetSocketDescriptor(), [&] { return Client.ContinueConnect(); },
+                                OnDone, 60000));
+      }
+      ASSERT_TRUE(Driver.Add(SilentAccepted.m_SockFd, [&] { return m_pSSLTCPServer->ContinueAccept(SilentAccepted); },
+                             OnDone, 500));
+
+      auto StartTime = std::chrono::steady_clock::now();
+      while (Driver.GetPendingCount() > 0 && Driver.Poll(1000) >= 0)
+         ;
+      double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+
+      EXPECT_EQ(uSucceeded, 2 * uConnections);
+      EXPECT_EQ(uFailed, 1u);
+      EXPECT_EQ(Driver.GetTimeoutCount(), 1u);
+
+      std::cout << "** " << uConnections << " concurrent handshakes : "
+                << uConnections / dSeconds << " handshakes/sec\n";
+
+      // the sockets are back in blocking mode, the connections are usable as usual
+      const std::string strPing = "ping";
+      char szRcvBuffer[5] = {};
+      ASSERT_TRUE(vecClients.back()->Send(strPing));
+      EXPECT_EQ(m_pSSLTCPServer->Receive(vecAccepted.back(), szRcvBuffer, strPing.size()),
+                static_cast<int>(strPing.size()));
+      EXPECT_EQ(strPing, szRcvBuffer);
+
+      m_pSSLTCPServer->Disconnect(SilentAccepted);
+      SilentClient.Disconnect();
+
+      for (auto& Accepted : vecAccepted)
+         m_pSSLTCPServer->Disconnect(Accepted);
+      for (auto& pClient : vecClients)
+         pClient->Disconnect();
+   }
+   else
+      std::cout << "SECURE TCP tests are disabled !" << std::endl;
+}
+
+#ifdef COROUTINES
+static CCoroTask<void> CoroHandshake(CCoroReactor& Reactor, const ASocket::Socket Fd,
+                                     std::function<ASecureSocket::HandshakeStatus()> fnStep,
+                                     std::atomic<int>* pSucceeded, std::atomic<int>* pDone)
+{
+   // not owned : the socket is given back in blocking mode to the SSL classes
+   CCoroSocket Sock(Reactor, Fd, false);
+   if (co_await Sock.Handshake(fnStep))
+      ++*pSucceeded;
+
+   if (++*pDone == 2)
+      Reactor.Stop();
+}
+
+TEST_F(SSLTCPTest, TestCoroutineHandshake)
+{
+   if (SECURE_TCP_TEST_ENABLED)
+   {
+      ASSERT_NO_THROW(m_pSSLTCPServer.reset(new CTCPSSLServer(PRINT_LOG, SECURE_TCP_SERVER_PORT)));
+      m_pSSLTCPServer->SetSSLCertFile(SSL_CERT_FILE);
+      m_pSSLTCPServer->SetSSLKeyFile(SSL_KEY_FILE);
+
+      std::future<bool> futConnect = std::async(std::launch::async, [&]
+      {
+         // give time to let the server object reach the accept instruction.
+         SleepMs(100);
+         return m_pSSLTCPClient->BeginConnect("localhost", SECURE_TCP_SERVER_PORT);
+      });
+
+      ASecureSocket::SSLSocket Accepted;
+      ASSERT_TRUE(m_pSSLTCPServer->BeginAccept(Accepted, 5000));
+      ASSERT_TRUE(futConnect.get());
+
+      // both sides of the handshake are coroutines of this thread's reactor
+      CCoroReactor Reactor(PRINT_LOG);
+      std::atomic<int> iSucceeded(0);
+      std::atomic<int> iDone(0);
+      Reactor.Spawn(CoroHandshake(Reactor, Accepted.m_SockFd,
+                                  [&] { return m_pSSLTCPServer->ContinueAccept(Accepted); }, &iSucceeded, &iDone));
+      Reactor.Spawn(CoroHandshake(Reactor, m_pSSLTCPClient->GetSocketDescriptor(),
+                                  [&] { return m_pSSLTCPClient->ContinueConnect(); }, &iSucceeded, &iDone));
+      ASSERT_TRUE(Reactor.Run());
+      EXPECT_EQ(iSucceeded, 2);
+
+      // the connection is usable with the blocking calls
+      const std::string strPing = "ping";
+      char szRcvBuffer[5] = {};
+      ASSERT_TRUE(m_pSSLTCPClient->Send(strPing));
+      EXPECT_EQ(m_pSSLTCPServer->Receive(Accepted, szRcvBuffer, strPing.size()), static_cast<int>(strPing.size()));
+      EXPECT_EQ(strPing, szRcvBuffer);
+
+      m_pSSLTCPServer->Disconnect(Accepted);
+      m_pSSLTCPClient->Disconnect();
+   }
+   else
+      std::cout << "SECURE TCP tests are disabled !" << std::endl;
+}
+#endif
+
+TEST_F(SSLTCPTest, BenchmarkKernelTLS)
+{
+   if (SECURE_TCP_TEST_ENABLED && BENCHMARK_TEST_ENABLED)
+   {
+      const size_t tenMeg = 10 * 1024 * 1024;
+      std::vector<char> TenMbData(tenMeg);
+      std::vector<char> RcvBuffer(tenMeg);
+      std::generate(TenMbData.begin(), TenMbData.end(), [] { return (std::rand() % 256); });
+
+      // SendFile reads the payload from a file
+      char szFileName[] = "/tmp/socket_cpp_ktls_XXXXXX";
+      int iFileFd = mkstemp(szFileName);
+      ASSERT_GE(iFileFd, 0);
+      unlink(szFileName);
+      ASSERT_EQ(write(iFileFd, TenMbData.data(), tenMeg), static_cast<ssize_t>(tenMeg));
+
+      ASSERT_NO_THROW(m_pSSLTCPServer.reset(new CTCPSSLServer(PRINT_LOG, SECURE_TCP_SERVER_PORT)));
+
+      m_pSSLTCPServer->SetSSLCertFile(SSL_CERT_FILE);
+      m_pSSLTCPServer->SetSSLKeyFile(SSL_KEY_FILE);
+
+      // returns the server -> client throughput in MB/s
+      auto Measure = [&](const bool bKernelTLS, const bool bSendFile) -> double
+      {
+         m_pSSLTCPServer->SetKernelTLS(bKernelTLS);
+
+         CTCPSSLClient SSLClient(PRINT_LOG, ASecureSocket::OpenSSLProtocol::TLS, ASocket::NO_FLAGS);
+         SSLClient.SetKernelTLS(bKernelTLS);
+
+         std::future<bool> futConnect = std::async(std::launch::async, [&]() -> bool
+         {
+            // give time to let the server object reach the accept instruction.
+            SleepMs(100);
+            return SSLClient.Connect("localhost", SECURE_TCP_SERVER_PORT);
+         });
+
+         ASecureSocket::SSLSocket ConnectedClient;
+         bool bAccepted = m_pSSLTCPServer->Listen(ConnectedClient, 5000);
+         EXPECT_TRUE(futConnect.get());
+         EXPECT_TRUE(bAccepted);
+         if (!bAccepted)
+            return 0;
+
+         const bool bActive = ASecureSocket::IsKernelTLSSendActive(ConnectedClient);
+         if (!bKernelTLS)
+         {
+            EXPECT_FALSE(bActive);
+         }
+
+         std::fill(RcvBuffer.begin(), RcvBuffer.end(), 0);
+         std::future<int> futReceive = std::async(std::launch::async, [&]()
+         {
+            return SSLClient.Receive(RcvBuffer.data(), tenMeg);
+         });
+
+         auto StartTime = std::chrono::steady_clock::now();
+         EXPECT_TRUE(bSendFile ? m_pSSLTCPServer->SendFile(ConnectedClient, iFileFd, 0, tenMeg)
+                               : m_pSSLTCPServer->Send(ConnectedClient, TenMbData));
+         EXPECT_EQ(futReceive.get(), static_cast<int>(tenMeg));
+         double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+
+         EXPECT_TRUE(std::equal(TenMbData.begin(), TenMbData.end(), RcvBuffer.begin()));
+
+         std::cout << "** kTLS " << (bKernelTLS ? "requested" : "off") << " (" << (bActive ? "active" : "inactive")
+                   << "), " << (bSendFile ? "SendFile" : "Send") << " : " << tenMeg / dSeconds / 1e6 << " MB/s\n";
+
+         m_pSSLTCPServer->Disconnect(ConnectedClient);
+         SSLClient.Disconnect();
+         return tenMeg / dSeconds / 1e6;
+      };
+
+      Measure(false, false);
+      Measure(false, true);
+      Measure(true, false);
+      Measure(true, true);
+
+      close(iFileFd);
+   }
+   else
+      std::cout << "SECURE TCP or benchmark tests are disabled !" << std::endl;
+}
+#endif
+
 #endif
 
 } // namespace
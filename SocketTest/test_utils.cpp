@@ -4,6 +4,7 @@
 bool TCP_TEST_ENABLED;
 bool SECURE_TCP_TEST_ENABLED;
 bool HTTP_PROXY_TEST_ENABLED;
+bool BENCHMARK_TEST_ENABLED;
 
 // TCP
 std::string TCP_SERVER_PORT;
@@ -40,6 +41,10 @@ bool GlobalTestInit(const std::string& strConfFile)
    std::transform(strTmp.begin(), strTmp.end(), strTmp.begin(), ::toupper);
    HTTP_PROXY_TEST_ENABLED = (strTmp == "YES") ? true : false;
 
+   strTmp = ini.GetValue("tests", "benchmark", "");
+   std::transform(strTmp.begin(), strTmp.end(), strTmp.begin(), ::toupper);
+   BENCHMARK_TEST_ENABLED = (strTmp == "YES") ? true : false;
+
    TCP_SERVER_PORT = ini.GetValue("tcp", "server_port", "");
 
    // build must be generated with the macro OPENSSL to enable SSL tests